@@ -0,0 +1,237 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Runs the registered microbenchmarks and prints the time per operation of
+// each, optionally checking it against a saved baseline:
+//
+//   badgerdb_bench [--filter <text>] [--threads <n>] [--min-time <ms>]
+//                  [--save <file>] [--compare <file>] [--tolerance <percent>]
+//
+// With --compare, the exit status is 1 if any benchmark got slower than its
+// baseline by more than the tolerance, 10% by default.
+
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "exceptions/badgerdb_exception.h"
+
+namespace badgerdb {
+namespace bench {
+
+namespace {
+
+struct Registration {
+  std::string name;
+  std::unique_ptr<Benchmark> benchmark;
+  std::vector<std::uint64_t> args;
+  bool threaded;
+};
+
+std::vector<Registration>& registry() {
+  static std::vector<Registration> benchmarks;
+  return benchmarks;
+}
+
+/**
+ * Releases threads waiting for a round all at once.
+ */
+class Gate {
+ public:
+  Gate() : round_(0), waiting_(0) {}
+
+  void wait(const int threads) {
+    std::unique_lock<std::mutex> guard(mutex_);
+    const std::uint64_t round = round_;
+    if (++waiting_ == threads) {
+      waiting_ = 0;
+      ++round_;
+      open_.notify_all();
+      return;
+    }
+    while (round_ == round) {
+      open_.wait(guard);
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable open_;
+  std::uint64_t round_;
+  int waiting_;
+};
+
+// Runs <iterations> operations on each of <threads> threads started at the
+// same moment and returns the seconds until the last one finished.
+double timeRound(Benchmark& benchmark, const std::uint64_t arg,
+                 const int threads, const std::uint64_t iterations) {
+  Gate gate;
+  std::vector<std::thread> workers;
+  for (int t = 1; t < threads; ++t) {
+    workers.push_back(std::thread([&, t]() {
+      gate.wait(threads);
+      benchmark.run(arg, t, iterations);
+      gate.wait(threads);
+    }));
+  }
+  gate.wait(threads);
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  benchmark.run(arg, 0, iterations);
+  gate.wait(threads);
+  const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  for (std::size_t i = 0; i < workers.size(); ++i) {
+    workers[i].join();
+  }
+  return seconds;
+}
+
+// Returns the nanoseconds per operation per thread, the median of three
+// rounds long enough to time.
+double measure(Benchmark& benchmark, const std::uint64_t arg,
+               const int threads, const double min_seconds) {
+  std::uint64_t iterations = 1;
+  double seconds = timeRound(benchmark, arg, threads, iterations);
+  while (seconds < min_seconds && iterations < (std::uint64_t(1) << 40)) {
+    // aim a little past the target, from the rate so far.
+    const double scale = seconds <= 0 ? 10.0 : std::min(10.0, 1.4 * min_seconds / seconds);
+    iterations = std::max<std::uint64_t>(iterations + 1, iterations * scale);
+    seconds = timeRound(benchmark, arg, threads, iterations);
+  }
+  std::vector<double> rounds(1, seconds);
+  rounds.push_back(timeRound(benchmark, arg, threads, iterations));
+  rounds.push_back(timeRound(benchmark, arg, threads, iterations));
+  std::sort(rounds.begin(), rounds.end());
+  return rounds[1] * 1e9 / iterations;
+}
+
+std::map<std::string, double> loadBaseline(const std::string& path) {
+  std::map<std::string, double> baseline;
+  std::ifstream in(path.c_str());
+  std::string name;
+  double nanos;
+  while (in >> name >> nanos) {
+    baseline[name] = nanos;
+  }
+  return baseline;
+}
+
+}
+
+int registerBenchmark(const std::string& name, Benchmark* benchmark,
+                      const std::vector<std::uint64_t>& args,
+                      const bool threaded) {
+  Registration registration;
+  registration.name = name;
+  registration.benchmark.reset(benchmark);
+  registration.args = args;
+  registration.threaded = threaded;
+  registry().push_back(std::move(registration));
+  return 0;
+}
+
+}
+}
+
+using namespace badgerdb;
+using namespace badgerdb::bench;
+
+int main(int argc, char* argv[]) {
+  std::string filter;
+  int max_threads = std::max(1u, std::thread::hardware_concurrency());
+  double min_seconds = 0.2;
+  std::string save;
+  std::string compare;
+  double tolerance = 10.0;
+  for (int i = 1; i < argc; ++i) {
+    const std::string option = argv[i];
+    if (i + 1 == argc) {
+      std::fprintf(stderr, "missing value of %s\n", option.c_str());
+      return 2;
+    }
+    const char* value = argv[++i];
+    if (option == "--filter") {
+      filter = value;
+    } else if (option == "--threads") {
+      max_threads = std::max(1, std::atoi(value));
+    } else if (option == "--min-time") {
+      min_seconds = std::atof(value) / 1000;
+    } else if (option == "--save") {
+      save = value;
+    } else if (option == "--compare") {
+      compare = value;
+    } else if (option == "--tolerance") {
+      tolerance = std::atof(value);
+    } else {
+      std::fprintf(stderr, "unknown option %s\n", option.c_str());
+      return 2;
+    }
+  }
+
+  const std::map<std::string, double> baseline = loadBaseline(compare);
+  std::ofstream saved;
+  if (!save.empty()) {
+    saved.open(save.c_str());
+  }
+  int regressions = 0;
+  std::printf("%-40s %12s %12s %10s\n", "benchmark", "ns/op", "Mops/s", "baseline");
+  std::vector<Registration>& benchmarks = registry();
+  for (std::size_t b = 0; b < benchmarks.size(); ++b) {
+    Registration& registration = benchmarks[b];
+    if (registration.name.find(filter) == std::string::npos) {
+      continue;
+    }
+    for (std::size_t a = 0; a < registration.args.size(); ++a) {
+      const std::uint64_t arg = registration.args[a];
+      for (int threads = 1; threads <= (registration.threaded ? max_threads : 1);
+           threads *= 2) {
+        std::ostringstream name;
+        name << registration.name << "/" << arg << "/threads:" << threads;
+        double nanos = 0;
+        try {
+          registration.benchmark->setUp(arg, threads);
+          nanos = measure(*registration.benchmark, arg, threads, min_seconds);
+          registration.benchmark->tearDown();
+        } catch (const BadgerDbException& e) {
+          std::ostringstream message;
+          message << e;
+          std::fprintf(stderr, "%s failed: %s\n", name.str().c_str(), message.str().c_str());
+          return 1;
+        }
+        std::printf("%-40s %12.1f %12.3f", name.str().c_str(), nanos,
+                    threads * 1e3 / nanos);
+        const std::map<std::string, double>::const_iterator base = baseline.find(name.str());
+        if (base != baseline.end()) {
+          const double change = (nanos / base->second - 1) * 100;
+          const bool regressed = change > tolerance;
+          regressions += regressed;
+          std::printf(" %+9.1f%%%s", change, regressed ? "  REGRESSED" : "");
+        }
+        std::printf("\n");
+        if (saved.is_open()) {
+          saved << name.str() << " " << nanos << "\n";
+        }
+      }
+    }
+  }
+  if (regressions != 0) {
+    std::printf("%d benchmarks regressed by more than %.0f%%\n", regressions, tolerance);
+    return 1;
+  }
+  return 0;
+}
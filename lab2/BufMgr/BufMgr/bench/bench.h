@@ -0,0 +1,81 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace badgerdb {
+namespace bench {
+
+/**
+ * @brief A microbenchmark: an operation timed over many iterations, on
+ *        one or more threads at once, for each of its arguments.
+ *
+ * For every argument and thread count the runner calls setUp() once, then
+ * run() on every thread at the same moment, doubling the number of
+ * iterations until a round takes long enough to time, and then tearDown().
+ * Everything run() does is timed, so per-thread state it needs should be
+ * built in setUp().
+ */
+class Benchmark {
+ public:
+  virtual ~Benchmark() {}
+
+  /**
+   * Builds the state shared by the threads, e.g. a pool and its file.
+   *
+   * @param arg       Argument of this run, e.g. a record size.
+   * @param threads   Number of threads run() is about to be called on.
+   */
+  virtual void setUp(const std::uint64_t arg, const int threads) {}
+
+  /**
+   * Performs the operation <iterations> times.
+   *
+   * @param arg         Argument of this run.
+   * @param thread      Number of the calling thread, from 0.
+   * @param iterations  Number of operations to perform.
+   */
+  virtual void run(const std::uint64_t arg, const int thread,
+                   const std::uint64_t iterations) = 0;
+
+  /**
+   * Frees the state built by setUp().
+   */
+  virtual void tearDown() {}
+};
+
+/**
+ * Adds a benchmark to those the runner knows, under <name>, e.g.
+ * "buffer/hit".  <args> lists the arguments to run it with; <threaded> runs
+ * it on 1, 2, 4, ... threads up to the limit given on the command line,
+ * instead of only on one.  Returns 0, for use in static initializers.
+ */
+int registerBenchmark(const std::string& name, Benchmark* benchmark,
+                      const std::vector<std::uint64_t>& args,
+                      const bool threaded);
+
+/**
+ * Keeps the compiler from optimizing away a value a benchmark computes.
+ */
+template <typename T>
+inline void doNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+}
+}
+
+/**
+ * Registers a new instance of the class <type> as a benchmark.
+ */
+#define BADGERDB_BENCHMARK(type, name, threaded, ...)                      \
+  static const int registered_##type = ::badgerdb::bench::registerBenchmark( \
+      name, new type, std::vector<std::uint64_t>{__VA_ARGS__}, threaded)
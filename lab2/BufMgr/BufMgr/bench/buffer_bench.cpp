@@ -0,0 +1,154 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Benchmarks of BufMgr: the hit path, the miss path with an eviction per
+// read, and mixes of page accesses over a file larger than the pool.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+#include "file.h"
+#include "workload.h"
+
+namespace badgerdb {
+namespace bench {
+
+namespace {
+
+const char FILENAME[] = "bench.buffer";
+
+/**
+ * @brief A pool over a file of <pages> pages, the first <bufs> of which are
+ *        resident when run() starts.
+ */
+class PoolBenchmark : public Benchmark {
+ public:
+  PoolBenchmark(const std::uint32_t bufs, const PageId pages)
+      : bufs_(bufs), num_pages_(pages) {}
+
+  void setUp(const std::uint64_t arg, const int threads) {
+    try {
+      File::remove(FILENAME);
+    } catch (const FileNotFoundException&) {
+    }
+    file_.reset(new File(File::create(FILENAME)));
+    pool_.reset(new BufMgr(bufs_));
+    pages_.clear();
+    for (PageId i = 0; i < num_pages_; ++i) {
+      PageId page_number;
+      Page* page;
+      pool_->allocPage(file_.get(), page_number, page);
+      pool_->unPinPage(file_.get(), page_number, true);
+      pages_.push_back(page_number);
+    }
+    pool_->flushFile(file_.get());
+    for (PageId i = 0; i < bufs_ && i < num_pages_; ++i) {
+      read(pages_[i]);
+    }
+  }
+
+  void tearDown() {
+    pool_.reset();
+    file_.reset();
+    File::remove(FILENAME);
+  }
+
+ protected:
+  void read(const PageId page_number) {
+    Page* page;
+    pool_->readPage(file_.get(), page_number, page);
+    doNotOptimize(page);
+    pool_->unPinPage(file_.get(), page_number, false);
+  }
+
+  std::uint32_t bufs_;
+  PageId num_pages_;
+  std::unique_ptr<File> file_;
+  std::unique_ptr<BufMgr> pool_;
+  std::vector<PageId> pages_;
+};
+
+/**
+ * readPage and unPinPage of resident pages, each thread on pages of its own.
+ */
+class BufferHit : public PoolBenchmark {
+ public:
+  BufferHit() : PoolBenchmark(1024, 512) {}
+
+  void run(const std::uint64_t arg, const int thread,
+           const std::uint64_t iterations) {
+    std::size_t next = thread * 64;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      read(pages_[next % pages_.size()]);
+      ++next;
+    }
+  }
+};
+
+BADGERDB_BENCHMARK(BufferHit, "buffer/hit", true, 0);
+
+/**
+ * readPage and unPinPage of pages that are never resident, so that every
+ * read evicts a page and reads one, from the page cache of the kernel.
+ */
+class BufferMiss : public PoolBenchmark {
+ public:
+  BufferMiss() : PoolBenchmark(64, 4096) {}
+
+  void run(const std::uint64_t arg, const int thread,
+           const std::uint64_t iterations) {
+    // cycle through the pages in order, each thread a strip of its own.
+    std::size_t next = thread * 1024;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      read(pages_[next % pages_.size()]);
+      ++next;
+    }
+  }
+};
+
+BADGERDB_BENCHMARK(BufferMiss, "buffer/miss", true, 0);
+
+/**
+ * Reads of pages drawn from a distribution, with a pool holding an eighth of
+ * the file.  The argument is a KeyDistribution: 0 uniform, 1 zipfian,
+ * 2 scan.
+ */
+class BufferMix : public PoolBenchmark {
+ public:
+  BufferMix() : PoolBenchmark(512, 4096) {}
+
+  void setUp(const std::uint64_t arg, const int threads) {
+    PoolBenchmark::setUp(arg, threads);
+    keys_.clear();
+    for (int t = 0; t < threads; ++t) {
+      keys_.push_back(std::unique_ptr<KeyGenerator>(new KeyGenerator(
+          static_cast<KeyDistribution>(arg), pages_.size(), t + 1)));
+    }
+  }
+
+  void run(const std::uint64_t arg, const int thread,
+           const std::uint64_t iterations) {
+    KeyGenerator& keys = *keys_[thread];
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      read(pages_[keys.next()]);
+    }
+  }
+
+ private:
+  std::vector<std::unique_ptr<KeyGenerator> > keys_;
+};
+
+BADGERDB_BENCHMARK(BufferMix, "buffer/mix", true, KEYS_UNIFORM, KEYS_ZIPFIAN, KEYS_SCAN);
+
+}
+
+}
+}
@@ -0,0 +1,159 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Benchmarks of the structures under BufMgr: its hash table, the slotted
+// page and page allocation in a file.
+
+#include <memory>
+#include <string>
+
+#include "bench.h"
+#include "bufHashTbl.h"
+#include "exceptions/file_not_found_exception.h"
+#include "file.h"
+#include "page.h"
+
+namespace badgerdb {
+namespace bench {
+
+namespace {
+
+// Stands in for the File pointers the table is keyed by; never dereferenced.
+const File* const KEY_FILE = reinterpret_cast<const File*>(0x1000);
+
+/**
+ * Inserts and removes one entry in a table holding <arg> entries.
+ */
+class HashInsertRemove : public Benchmark {
+ public:
+  void setUp(const std::uint64_t arg, const int threads) {
+    table_.reset(new BufHashTbl(arg * 2));
+    for (std::uint64_t i = 0; i < arg; ++i) {
+      table_->insert(KEY_FILE, i, i);
+    }
+  }
+
+  void run(const std::uint64_t arg, const int thread,
+           const std::uint64_t iterations) {
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      const PageId page_number = arg + i % arg;
+      table_->insert(KEY_FILE, page_number, 0);
+      table_->remove(KEY_FILE, page_number);
+    }
+  }
+
+  void tearDown() { table_.reset(); }
+
+ protected:
+  std::unique_ptr<BufHashTbl> table_;
+};
+
+BADGERDB_BENCHMARK(HashInsertRemove, "hash/insert_remove", false, 1024, 65536);
+
+/**
+ * Looks up entries present in a table holding <arg> entries.
+ */
+class HashLookup : public HashInsertRemove {
+ public:
+  void run(const std::uint64_t arg, const int thread,
+           const std::uint64_t iterations) {
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      FrameId frame;
+      // a stride that is odd visits every entry, in no order the table sees.
+      table_->find(KEY_FILE, (i * 7919) % arg, frame);
+      doNotOptimize(frame);
+    }
+  }
+};
+
+BADGERDB_BENCHMARK(HashLookup, "hash/lookup", false, 1024, 65536);
+
+/**
+ * Inserts records of <arg> bytes, starting over on a new page when one is
+ * full.
+ */
+class PageInsert : public Benchmark {
+ public:
+  void setUp(const std::uint64_t arg, const int threads) {
+    record_.assign(arg, 'x');
+  }
+
+  void run(const std::uint64_t arg, const int thread,
+           const std::uint64_t iterations) {
+    Page page;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      if (!page.hasSpaceForRecord(record_)) {
+        page = Page();
+      }
+      doNotOptimize(page.insertRecord(record_));
+    }
+  }
+
+ protected:
+  std::string record_;
+};
+
+BADGERDB_BENCHMARK(PageInsert, "page/insert", false, 16, 128, 1024);
+
+/**
+ * Inserts and deletes a record of <arg> bytes on a page kept half full.
+ */
+class PageInsertDelete : public PageInsert {
+ public:
+  void run(const std::uint64_t arg, const int thread,
+           const std::uint64_t iterations) {
+    Page page;
+    while (page.getFreeSpace() > Page::DATA_SIZE / 2 &&
+           page.hasSpaceForRecord(record_)) {
+      page.insertRecord(record_);
+    }
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      page.deleteRecord(page.insertRecord(record_));
+    }
+  }
+};
+
+BADGERDB_BENCHMARK(PageInsertDelete, "page/insert_delete", false, 16, 128, 1024);
+
+const char FILENAME[] = "bench.file";
+
+/**
+ * Allocates pages at the end of a file that keeps growing.
+ */
+class FileAllocate : public Benchmark {
+ public:
+  void setUp(const std::uint64_t arg, const int threads) {
+    try {
+      File::remove(FILENAME);
+    } catch (const FileNotFoundException&) {
+    }
+    file_.reset(new File(File::create(FILENAME)));
+  }
+
+  void run(const std::uint64_t arg, const int thread,
+           const std::uint64_t iterations) {
+    Page page;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      file_->allocatePage(page);
+    }
+  }
+
+  void tearDown() {
+    file_.reset();
+    File::remove(FILENAME);
+  }
+
+ private:
+  std::unique_ptr<File> file_;
+};
+
+BADGERDB_BENCHMARK(FileAllocate, "file/allocate", false, 0);
+
+}
+
+}
+}
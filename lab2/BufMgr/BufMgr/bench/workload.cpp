@@ -0,0 +1,84 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "workload.h"
+
+#include <cmath>
+
+namespace badgerdb {
+namespace bench {
+
+const double KeyGenerator::ZIPFIAN_THETA = 0.99;
+
+namespace {
+
+// Generalized harmonic number of <n> with exponent <theta>.
+double zeta(const std::uint64_t n, const double theta) {
+  double sum = 0;
+  for (std::uint64_t i = 1; i <= n; ++i) {
+    sum += 1 / std::pow(static_cast<double>(i), theta);
+  }
+  return sum;
+}
+
+// Spreads the ranks of a zipfian draw over the key space (FNV-1a).
+std::uint64_t scatter(const std::uint64_t rank) {
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (int i = 0; i < 8; ++i) {
+    hash = (hash ^ ((rank >> (8 * i)) & 0xff)) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+}
+
+KeyGenerator::KeyGenerator(const KeyDistribution distribution,
+                           const std::uint64_t count, const std::uint64_t seed)
+    : distribution_(distribution), count_(count == 0 ? 1 : count),
+      random_(seed), unit_(0.0, 1.0), position_(0), alpha_(0), zeta_(0),
+      eta_(0), half_pow_theta_(0) {
+  if (distribution_ == KEYS_ZIPFIAN) {
+    const double theta = ZIPFIAN_THETA;
+    zeta_ = zeta(count_, theta);
+    alpha_ = 1 / (1 - theta);
+    eta_ = (1 - std::pow(2.0 / count_, 1 - theta)) / (1 - zeta(2, theta) / zeta_);
+    half_pow_theta_ = 1 + std::pow(0.5, theta);
+  }
+}
+
+std::uint64_t KeyGenerator::next() {
+  switch (distribution_) {
+    case KEYS_SCAN: {
+      const std::uint64_t key = position_;
+      position_ = position_ + 1 == count_ ? 0 : position_ + 1;
+      return key;
+    }
+    case KEYS_ZIPFIAN: {
+      const double u = unit_(random_);
+      const double uz = u * zeta_;
+      std::uint64_t rank;
+      if (uz < 1) {
+        rank = 0;
+      } else if (uz < half_pow_theta_) {
+        rank = 1;
+      } else {
+        rank = static_cast<std::uint64_t>(
+            count_ * std::pow(eta_ * u - eta_ + 1, alpha_));
+      }
+      if (rank >= count_) {
+        rank = count_ - 1;
+      }
+      return scatter(rank) % count_;
+    }
+    case KEYS_UNIFORM:
+    default:
+      return random_() % count_;
+  }
+}
+
+}
+}
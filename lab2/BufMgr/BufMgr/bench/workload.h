@@ -0,0 +1,84 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <random>
+
+namespace badgerdb {
+namespace bench {
+
+/**
+ * @brief How a workload picks the keys, e.g. pages, it accesses.
+ */
+enum KeyDistribution {
+  /**
+   * Every key equally likely.
+   */
+  KEYS_UNIFORM,
+
+  /**
+   * Zipfian with exponent 0.99, as in YCSB: the hottest key is the most
+   * likely, the next half as likely, and so on.  The hot keys are scattered
+   * over the key space, so that they are not all on neighbouring pages.
+   */
+  KEYS_ZIPFIAN,
+
+  /**
+   * Every key in order, wrapping around at the end.
+   */
+  KEYS_SCAN
+};
+
+/**
+ * @brief Draws keys in [0, <count>) from a distribution; one per thread.
+ *
+ * Zipfian keys are drawn with the method of Gray et al., "Quickly generating
+ * billion-record synthetic databases", in constant time per key after a setup
+ * linear in <count>.
+ */
+class KeyGenerator {
+ public:
+  /**
+   * Zipfian exponent used for KEYS_ZIPFIAN.
+   */
+  static const double ZIPFIAN_THETA;
+
+  /**
+   * Creates a generator of keys in [0, <count>), seeded with <seed>.
+   */
+  KeyGenerator(const KeyDistribution distribution, const std::uint64_t count,
+               const std::uint64_t seed);
+
+  /**
+   * Returns the next key.
+   */
+  std::uint64_t next();
+
+ private:
+  KeyDistribution distribution_;
+  std::uint64_t count_;
+  std::mt19937_64 random_;
+  std::uniform_real_distribution<double> unit_;
+
+  /**
+   * Next key of a scan.
+   */
+  std::uint64_t position_;
+
+  /**
+   * Constants of the zipfian method.
+   */
+  double alpha_;
+  double zeta_;
+  double eta_;
+  double half_pow_theta_;
+};
+
+}
+}
@@ -0,0 +1,140 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "arc_policy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+ArcPolicy::ArcPolicy(const std::uint32_t numBufs)
+    : capacity(numBufs),
+      target(0),
+      lists(numBufs, 3),
+      pages(numBufs) {
+  for (FrameId i = 0; i < numBufs; ++i) {
+    lists.pushFront(FREE, i);
+  }
+}
+
+void ArcPolicy::recordAccess(const FrameId frame) {
+  std::lock_guard<std::mutex> guard(mutex);
+  const std::uint8_t list = lists.listOf(frame);
+  if (list == T1 || list == T2) {
+    lists.remove(frame);
+    lists.pushFront(T2, frame);
+  }
+}
+
+void ArcPolicy::recordLoad(const FrameId frame, const File* file,
+                           const PageId pageNo) {
+  std::lock_guard<std::mutex> guard(mutex);
+  const PageKey key = {file->id(), pageNo};
+  lists.remove(frame);
+  pages[frame] = key;
+
+  if (b1.contains(key)) {
+    // T1 was too small to keep this page: grow its target.
+    const std::uint32_t delta =
+        std::max<std::uint32_t>(1, b2.size() / b1.size());
+    target = std::min(capacity, target + delta);
+    b1.remove(key);
+    lists.pushFront(T2, frame);
+    return;
+  }
+  if (b2.contains(key)) {
+    // T2 was too small to keep this page: shrink the target of T1.
+    const std::uint32_t delta =
+        std::max<std::uint32_t>(1, b1.size() / b2.size());
+    target = target > delta ? target - delta : 0;
+    b2.remove(key);
+    lists.pushFront(T2, frame);
+    return;
+  }
+
+  // a new page: keep the directory within 2c pages.
+  if (lists.size(T1) + b1.size() >= capacity) {
+    b1.popBack();
+  } else if (lists.size(T1) + lists.size(T2) + b1.size() + b2.size() >=
+             2 * capacity) {
+    b2.popBack();
+  }
+  lists.pushFront(T1, frame);
+}
+
+void ArcPolicy::recordRemove(const FrameId frame) {
+  std::lock_guard<std::mutex> guard(mutex);
+  lists.remove(frame);
+  lists.pushFront(FREE, frame);
+}
+
+void ArcPolicy::resize(const std::uint32_t numBufs) {
+  std::lock_guard<std::mutex> guard(mutex);
+  for (FrameId frame = numBufs; frame < capacity; ++frame) {
+    lists.remove(frame);
+  }
+  for (FrameId frame = capacity; frame < numBufs; ++frame) {
+    lists.pushFront(FREE, frame);
+  }
+  // the ghost lists shrink to the new bound as pages are evicted.
+  capacity = numBufs;
+  target = std::min(target, capacity);
+}
+
+bool ArcPolicy::claimFrom(const std::uint8_t list, FrameClaimer& claimer,
+                          FrameId& frame) {
+  for (FrameId candidate = lists.back(list); candidate != lists.end();
+       candidate = lists.towardsFront(candidate)) {
+    if (claimer.claim(candidate)) {
+      if (list == T1) {
+        b1.pushFront(pages[candidate], capacity);
+      } else if (list == T2) {
+        b2.pushFront(pages[candidate], capacity);
+      }
+      lists.remove(candidate);
+      frame = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ArcPolicy::selectVictim(const File* file, const PageId pageNo,
+                             FrameClaimer& claimer, FrameId& frame) {
+  std::lock_guard<std::mutex> guard(mutex);
+  if (claimFrom(FREE, claimer, frame)) {
+    return true;
+  }
+  const PageKey key = {file->id(), pageNo};
+  const std::uint32_t t1 = lists.size(T1);
+  const bool preferT1 =
+      t1 > 0 && (t1 > target || (b2.contains(key) && t1 == target));
+  if (preferT1) {
+    return claimFrom(T1, claimer, frame) || claimFrom(T2, claimer, frame);
+  }
+  return claimFrom(T2, claimer, frame) || claimFrom(T1, claimer, frame);
+}
+
+void ArcPolicy::listFrom(const std::uint8_t list, const std::uint32_t count,
+                         std::vector<FrameId>& frames) const {
+  for (FrameId candidate = lists.back(list);
+       candidate != lists.end() && frames.size() < count;
+       candidate = lists.towardsFront(candidate)) {
+    frames.push_back(candidate);
+  }
+}
+
+void ArcPolicy::nextVictims(const std::uint32_t count,
+                            std::vector<FrameId>& frames) {
+  std::lock_guard<std::mutex> guard(mutex);
+  frames.clear();
+  const bool preferT1 = lists.size(T1) > 0 && lists.size(T1) > target;
+  listFrom(preferT1 ? T1 : T2, count, frames);
+  listFrom(preferT1 ? T2 : T1, count, frames);
+}
+
+}
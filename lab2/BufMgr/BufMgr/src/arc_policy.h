@@ -0,0 +1,100 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Adaptive Replacement Cache (Megiddo and Modha).
+ *
+ * Resident pages are split between T1 (seen once recently) and T2 (seen at
+ * least twice).  The ghost lists B1 and B2 remember pages recently evicted
+ * from T1 and T2; a miss on a remembered page moves the target size of T1
+ * towards the list that would have kept it.
+ */
+class ArcPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructs an ARC policy for <numBufs> frames.
+   */
+  explicit ArcPolicy(const std::uint32_t numBufs);
+
+  const char* name() const { return "arc"; }
+  void recordAccess(const FrameId frame);
+  void recordLoad(const FrameId frame, const File* file, const PageId pageNo);
+  void recordRemove(const FrameId frame);
+  void resize(const std::uint32_t numBufs);
+  bool selectVictim(const File* file, const PageId pageNo,
+                    FrameClaimer& claimer, FrameId& frame);
+  void nextVictims(const std::uint32_t count, std::vector<FrameId>& frames);
+
+ private:
+  /**
+   * Lists kept in <lists>.
+   */
+  enum {
+    T1 = 0,
+    T2 = 1,
+    FREE = 2
+  };
+
+  /**
+   * Offers the frames of one list, oldest first, to the claimer and moves
+   * the page of the claimed frame to the matching ghost list.
+   */
+  bool claimFrom(const std::uint8_t list, FrameClaimer& claimer,
+                 FrameId& frame);
+
+  /**
+   * Appends the frames of one list, oldest first, until <count> are listed.
+   */
+  void listFrom(const std::uint8_t list, const std::uint32_t count,
+                std::vector<FrameId>& frames) const;
+
+  /**
+   * Serializes all calls.
+   */
+  std::mutex mutex;
+
+  /**
+   * Number of frames in use in the pool (c in the paper).
+   */
+  std::uint32_t capacity;
+
+  /**
+   * Target size of T1 (p in the paper).
+   */
+  std::uint32_t target;
+
+  /**
+   * T1, T2 and the free frames.
+   */
+  FrameLists lists;
+
+  /**
+   * Page held by each frame.
+   */
+  std::vector<PageKey> pages;
+
+  /**
+   * Pages recently evicted from T1.
+   */
+  GhostList b1;
+
+  /**
+   * Pages recently evicted from T2.
+   */
+  GhostList b2;
+};
+
+}
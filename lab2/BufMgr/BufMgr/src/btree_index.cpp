@@ -0,0 +1,348 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "btree_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "buffer.h"
+#include "bulk_loader.h"
+#include "exceptions/badgerdb_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "file.h"
+#include "file_iterator.h"
+
+namespace badgerdb {
+
+namespace {
+
+// Marks the meta page of an index file.
+const std::uint32_t INDEX_MAGIC = 0x42545265;  // "BTRe"
+
+BTreeIndex::Entry makeEntry(const std::int64_t key, const RecordId& record_id) {
+  BTreeIndex::Entry entry;
+  entry.key = key;
+  entry.page_number = record_id.page_number;
+  entry.slot_number = record_id.slot_number;
+  entry.unused = 0;
+  return entry;
+}
+
+}
+
+const std::size_t BTreeIndex::LEAF_CAPACITY;
+const std::size_t BTreeIndex::INNER_CAPACITY;
+
+BTreeIndex::BTreeIndex(BufMgr* buf_mgr, File* file)
+    : buf_mgr_(buf_mgr), file_(file) {
+  if (file_->begin() == file_->end()) {
+    PageGuard meta = buf_mgr_->allocPage(file_, meta_page_);
+    PageGuard root = buf_mgr_->allocPage(file_, root_);
+    initNode(*root, 0);
+    height_ = 1;
+    MetaPage& contents = *reinterpret_cast<MetaPage*>(meta->data_);
+    contents.magic = INDEX_MAGIC;
+    contents.root = root_;
+    contents.height = height_;
+    return;
+  }
+  // The meta page is allocated first and never freed.
+  meta_page_ = (*file_->begin()).page_number();
+  PageGuard meta = buf_mgr_->readPage(file_, meta_page_);
+  const MetaPage& contents = *reinterpret_cast<const MetaPage*>(meta->data_);
+  if (contents.magic != INDEX_MAGIC) {
+    throw InvalidPageException(meta_page_, file_->filename());
+  }
+  root_ = contents.root;
+  height_ = contents.height;
+}
+
+void BTreeIndex::build(
+    File* file, const std::function<bool(std::int64_t&, RecordId&)>& next,
+    const double fill_factor) {
+  if (file->begin() != file->end()) {
+    throw BadgerDbException("Index can only be built in a file with no pages: " +
+                            file->filename());
+  }
+  const double fill = fill_factor <= 0 || fill_factor > 1 ? 1.0 : fill_factor;
+  const std::size_t leaf_entries =
+      std::max<std::size_t>(1, static_cast<std::size_t>(fill * LEAF_CAPACITY));
+  const std::size_t inner_children = std::max<std::size_t>(
+      2, static_cast<std::size_t>(fill * (INNER_CAPACITY + 1)));
+
+  PageAppender appender(file);
+  // Written once the root is known; until then the file is no valid index.
+  PageId meta_number;
+  appender.newPage(meta_number);
+
+  // The smallest entry under each node of the level being built on.
+  std::vector<std::pair<Entry, PageId> > level;
+  Page* leaf = NULL;
+  std::int64_t key;
+  RecordId record_id;
+  while (next(key, record_id)) {
+    const Entry entry = makeEntry(key, record_id);
+    if (leaf != NULL && !(entries(*leaf)[header(*leaf).count - 1] < entry)) {
+      throw BadgerDbException("Index entries are not in increasing order: " +
+                              file->filename());
+    }
+    if (leaf == NULL || header(*leaf).count == leaf_entries) {
+      if (leaf != NULL) {
+        header(*leaf).next_leaf = appender.nextPageNumber();
+      }
+      PageId leaf_number;
+      leaf = &appender.newPage(leaf_number);
+      initNode(*leaf, 0);
+      level.push_back(std::make_pair(entry, leaf_number));
+    }
+    entries(*leaf)[header(*leaf).count++] = entry;
+  }
+  if (leaf == NULL) {
+    PageId leaf_number;
+    initNode(appender.newPage(leaf_number), 0);
+    level.push_back(std::make_pair(Entry(), leaf_number));
+  }
+
+  std::uint32_t height = 1;
+  while (level.size() > 1) {
+    std::vector<std::pair<Entry, PageId> > parents;
+    std::size_t begin = 0;
+    while (begin < level.size()) {
+      std::size_t end = std::min(begin + inner_children, level.size());
+      if (level.size() - end == 1 && end - begin > 2) {
+        --end;  // leave the last node two children rather than one
+      }
+      PageId node_number;
+      Page& node = appender.newPage(node_number);
+      initNode(node, height);
+      children(node)[0] = level[begin].second;
+      for (std::size_t i = begin + 1; i < end; ++i) {
+        entries(node)[i - begin - 1] = level[i].first;
+        children(node)[i - begin] = level[i].second;
+      }
+      header(node).count = end - begin - 1;
+      parents.push_back(std::make_pair(level[begin].first, node_number));
+      begin = end;
+    }
+    level.swap(parents);
+    ++height;
+  }
+  appender.flush();
+
+  Page meta = file->readPage(meta_number);
+  MetaPage& contents = *reinterpret_cast<MetaPage*>(meta.data_);
+  contents.magic = INDEX_MAGIC;
+  contents.root = level[0].second;
+  contents.height = height;
+  file->writePage(meta);
+}
+
+bool BTreeIndex::insert(const std::int64_t key, const RecordId& record_id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  const Entry entry = makeEntry(key, record_id);
+  std::vector<PageId> path;
+  PageGuard leaf = buf_mgr_->readPage(file_, findLeaf(entry, &path));
+  NodeHeader& node = header(*leaf);
+  Entry* first = entries(*leaf);
+  Entry* position = std::lower_bound(first, first + node.count, entry);
+  if (position != first + node.count && *position == entry) {
+    return false;
+  }
+  leaf.markDirty();
+  if (node.count < LEAF_CAPACITY) {
+    std::memmove(position + 1, position,
+                 (first + node.count - position) * sizeof(Entry));
+    *position = entry;
+    ++node.count;
+    return true;
+  }
+
+  // Split the leaf in half, the upper half going to a new right sibling.
+  std::vector<Entry> all(first, first + node.count);
+  all.insert(all.begin() + (position - first), entry);
+  const std::size_t left = all.size() / 2;
+  PageId right_number;
+  PageGuard right = buf_mgr_->allocPage(file_, right_number);
+  initNode(*right, 0);
+  NodeHeader& right_node = header(*right);
+  std::copy(all.begin(), all.begin() + left, first);
+  node.count = left;
+  std::copy(all.begin() + left, all.end(), entries(*right));
+  right_node.count = all.size() - left;
+  right_node.next_leaf = node.next_leaf;
+  node.next_leaf = right_number;
+  leaf.release();
+  right.release();
+
+  if (path.empty()) {
+    growRoot(all[left], right_number);
+  } else {
+    insertSeparator(path, all[left], right_number);
+  }
+  return true;
+}
+
+bool BTreeIndex::remove(const std::int64_t key, const RecordId& record_id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  const Entry entry = makeEntry(key, record_id);
+  PageGuard leaf = buf_mgr_->readPage(file_, findLeaf(entry, NULL));
+  NodeHeader& node = header(*leaf);
+  Entry* first = entries(*leaf);
+  Entry* position = std::lower_bound(first, first + node.count, entry);
+  if (position == first + node.count || !(*position == entry)) {
+    return false;
+  }
+  std::memmove(position, position + 1,
+               (first + node.count - position - 1) * sizeof(Entry));
+  --node.count;
+  leaf.markDirty();
+  return true;
+}
+
+std::vector<RecordId> BTreeIndex::lookup(const std::int64_t key) {
+  std::vector<RecordId> record_ids;
+  scan(key, key, [&record_ids](std::int64_t, const RecordId& record_id) {
+    record_ids.push_back(record_id);
+    return true;
+  });
+  return record_ids;
+}
+
+void BTreeIndex::scan(
+    const std::int64_t low, const std::int64_t high,
+    const std::function<bool(std::int64_t, const RecordId&)>& visit) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  const RecordId lowest = {0, 0};
+  const Entry start = makeEntry(low, lowest);
+  PageId leaf_number = findLeaf(start, NULL);
+  while (leaf_number != Page::INVALID_NUMBER) {
+    PageGuard leaf = buf_mgr_->readPage(file_, leaf_number);
+    const NodeHeader& node = header(*leaf);
+    const Entry* first = entries(*leaf);
+    for (const Entry* entry = std::lower_bound(first, first + node.count, start);
+         entry != first + node.count; ++entry) {
+      const RecordId record_id = {entry->page_number, entry->slot_number};
+      if (entry->key > high || !visit(entry->key, record_id)) {
+        return;
+      }
+    }
+    leaf_number = node.next_leaf;
+  }
+}
+
+std::uint32_t BTreeIndex::height() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return height_;
+}
+
+BTreeIndex::NodeHeader& BTreeIndex::header(Page& page) {
+  return *reinterpret_cast<NodeHeader*>(page.data_);
+}
+
+BTreeIndex::Entry* BTreeIndex::entries(Page& page) {
+  return reinterpret_cast<Entry*>(page.data_ + sizeof(NodeHeader));
+}
+
+PageId* BTreeIndex::children(Page& page) {
+  return reinterpret_cast<PageId*>(page.data_ + sizeof(NodeHeader) +
+                                   INNER_CAPACITY * sizeof(Entry));
+}
+
+void BTreeIndex::initNode(Page& page, const std::uint16_t level) {
+  NodeHeader& node = header(page);
+  node.level = level;
+  node.count = 0;
+  node.next_leaf = Page::INVALID_NUMBER;
+}
+
+PageId BTreeIndex::findLeaf(const Entry& entry, std::vector<PageId>* path) {
+  PageId node_number = root_;
+  for (std::uint32_t level = height_ - 1; level > 0; --level) {
+    if (path != NULL) {
+      path->push_back(node_number);
+    }
+    PageGuard node = buf_mgr_->readPage(file_, node_number);
+    const Entry* first = entries(*node);
+    // Child i holds the entries from separator i - 1 up to separator i.
+    const std::size_t child =
+        std::upper_bound(first, first + header(*node).count, entry) - first;
+    node_number = children(*node)[child];
+  }
+  return node_number;
+}
+
+void BTreeIndex::insertSeparator(std::vector<PageId>& path, Entry separator,
+                                 PageId child) {
+  for (;;) {
+    const PageId node_number = path.back();
+    path.pop_back();
+    PageGuard page = buf_mgr_->readPage(file_, node_number);
+    page.markDirty();
+    NodeHeader& node = header(*page);
+    Entry* keys = entries(*page);
+    PageId* kids = children(*page);
+    const std::size_t position =
+        std::upper_bound(keys, keys + node.count, separator) - keys;
+    if (node.count < INNER_CAPACITY) {
+      std::memmove(keys + position + 1, keys + position,
+                   (node.count - position) * sizeof(Entry));
+      keys[position] = separator;
+      std::memmove(kids + position + 2, kids + position + 1,
+                   (node.count - position) * sizeof(PageId));
+      kids[position + 1] = child;
+      ++node.count;
+      return;
+    }
+
+    // Split the node; the middle separator moves up to the parent.
+    std::vector<Entry> all_keys(keys, keys + node.count);
+    all_keys.insert(all_keys.begin() + position, separator);
+    std::vector<PageId> all_kids(kids, kids + node.count + 1);
+    all_kids.insert(all_kids.begin() + position + 1, child);
+    const std::size_t middle = all_keys.size() / 2;
+    PageId right_number;
+    PageGuard right = buf_mgr_->allocPage(file_, right_number);
+    initNode(*right, node.level);
+    std::copy(all_keys.begin(), all_keys.begin() + middle, keys);
+    std::copy(all_kids.begin(), all_kids.begin() + middle + 1, kids);
+    node.count = middle;
+    std::copy(all_keys.begin() + middle + 1, all_keys.end(), entries(*right));
+    std::copy(all_kids.begin() + middle + 1, all_kids.end(), children(*right));
+    header(*right).count = all_keys.size() - middle - 1;
+    page.release();
+    right.release();
+
+    separator = all_keys[middle];
+    child = right_number;
+    if (path.empty()) {
+      growRoot(separator, child);
+      return;
+    }
+  }
+}
+
+void BTreeIndex::growRoot(const Entry& separator, const PageId child) {
+  PageId root_number;
+  PageGuard root = buf_mgr_->allocPage(file_, root_number);
+  initNode(*root, height_);
+  header(*root).count = 1;
+  entries(*root)[0] = separator;
+  children(*root)[0] = root_;
+  children(*root)[1] = child;
+  root.release();
+
+  root_ = root_number;
+  ++height_;
+  PageGuard meta = buf_mgr_->readPage(file_, meta_page_);
+  MetaPage& contents = *reinterpret_cast<MetaPage*>(meta->data_);
+  contents.root = root_;
+  contents.height = height_;
+  meta.markDirty();
+}
+
+}
@@ -0,0 +1,234 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class BufMgr;
+class File;
+
+/**
+ * @brief B+-tree index mapping 64-bit integer keys to record IDs, with its
+ *        nodes stored in the pages of a file and pinned through a BufMgr.
+ *
+ * The first page of the index file holds the number of the root page; every
+ * other page is a node.  Leaves hold (key, record ID) entries in order and are
+ * chained left to right for range scans; inner nodes hold separator entries
+ * and the numbers of their children.  A key may map to several record IDs, as
+ * entries are ordered by key and then by record ID.
+ *
+ * Nodes split when they overflow.  Deleting an entry never merges nodes: a
+ * node left empty stays in the tree and is skipped by scans, as inserts of
+ * keys in its range will fill it again.
+ *
+ * Operations on one index are serialized, so an index may be shared by
+ * threads.  Each operation pins at most two nodes at a time.
+ */
+class BTreeIndex {
+ public:
+  /**
+   * Opens the index stored in <file>, building an empty index if the file has
+   * no pages.  <buf_mgr> and <file> must outlive the index.
+   *
+   * @param buf_mgr   Buffer manager the nodes are pinned in.
+   * @param file      File holding the nodes.
+   * @throws  InvalidPageException  If the file holds something other than an
+   *                                index.
+   */
+  BTreeIndex(BufMgr* buf_mgr, File* file);
+
+  /**
+   * Builds an index in <file> from entries given in increasing order, without
+   * a BufMgr.  Leaves are filled to <fill_factor> and written in batches with
+   * File::appendPages; each level of inner nodes is then built over the level
+   * below it, up to the root.  Open the index with the constructor after.
+   *
+   * @param file          File with no used pages to build the index in.
+   * @param next          Function filling in the next entry, returning false
+   *                      once there are no more.
+   * @param fill_factor   Fraction of each node filled, in (0, 1].
+   * @throws  BadgerDbException  If the file has pages or the entries are not in
+   *                             increasing order.
+   */
+  static void build(File* file,
+                    const std::function<bool(std::int64_t&, RecordId&)>& next,
+                    const double fill_factor = 1.0);
+
+  BTreeIndex(const BTreeIndex&) = delete;
+  BTreeIndex& operator=(const BTreeIndex&) = delete;
+
+  /**
+   * Adds an entry to the index.
+   *
+   * @param key         Key of the record.
+   * @param record_id   ID of the record.
+   * @return  False if the index already held the entry.
+   */
+  bool insert(const std::int64_t key, const RecordId& record_id);
+
+  /**
+   * Removes an entry from the index.
+   *
+   * @param key         Key of the record.
+   * @param record_id   ID of the record.
+   * @return  False if the index did not hold the entry.
+   */
+  bool remove(const std::int64_t key, const RecordId& record_id);
+
+  /**
+   * Returns the IDs of the records with the given key, in order.
+   *
+   * @param key   Key to look up.
+   * @return  IDs of the records with the key.
+   */
+  std::vector<RecordId> lookup(const std::int64_t key);
+
+  /**
+   * Calls <visit> for every entry with a key in [<low>, <high>], in order,
+   * until it returns false.  <visit> must not call back into the index.
+   *
+   * @param low     Smallest key to visit.
+   * @param high    Largest key to visit.
+   * @param visit   Function called with the key and record ID of an entry.
+   */
+  void scan(const std::int64_t low, const std::int64_t high,
+            const std::function<bool(std::int64_t, const RecordId&)>& visit);
+
+  /**
+   * Returns the number of levels in the tree, 1 while the root is a leaf.
+   */
+  std::uint32_t height() const;
+
+  /**
+   * Entry of a leaf, and separator of an inner node.
+   */
+  struct Entry {
+    std::int64_t key;
+    PageId page_number;
+    SlotId slot_number;
+    std::uint16_t unused;
+
+    bool operator<(const Entry& rhs) const {
+      if (key != rhs.key) {
+        return key < rhs.key;
+      }
+      if (page_number != rhs.page_number) {
+        return page_number < rhs.page_number;
+      }
+      return slot_number < rhs.slot_number;
+    }
+
+    bool operator==(const Entry& rhs) const {
+      return key == rhs.key && page_number == rhs.page_number &&
+             slot_number == rhs.slot_number;
+    }
+  };
+
+  /**
+   * Node layout in the data area of a page.  Leaves are at level 0.
+   */
+  struct NodeHeader {
+    std::uint16_t level;
+    std::uint16_t count;
+    PageId next_leaf;
+  };
+
+  /**
+   * Most entries in a leaf.
+   */
+  static const std::size_t LEAF_CAPACITY =
+      (Page::DATA_SIZE - sizeof(NodeHeader)) / sizeof(Entry);
+
+  /**
+   * Most separators in an inner node, which has one child more.
+   */
+  static const std::size_t INNER_CAPACITY =
+      (Page::DATA_SIZE - sizeof(NodeHeader) - sizeof(PageId)) /
+      (sizeof(Entry) + sizeof(PageId));
+
+ private:
+  /**
+   * Layout of the first page of the index file.
+   */
+  struct MetaPage {
+    std::uint32_t magic;
+    PageId root;
+    std::uint32_t height;
+  };
+
+  /**
+   * Returns the node header, the entries or separators, and the children in
+   * the data area of a node page.
+   */
+  static NodeHeader& header(Page& page);
+  static Entry* entries(Page& page);
+  static PageId* children(Page& page);
+
+  /**
+   * Makes <page> an empty node at <level>.
+   */
+  static void initNode(Page& page, const std::uint16_t level);
+
+  /**
+   * Returns the leaf <entry> belongs in, and fills <path> with the inner nodes
+   * passed through, from the root down.  The caller must hold <mutex_>.
+   */
+  PageId findLeaf(const Entry& entry, std::vector<PageId>* path);
+
+  /**
+   * Inserts a separator and the child to its right into the inner node
+   * <path.back()>, splitting it and its ancestors as needed.  The caller must
+   * hold <mutex_>.
+   */
+  void insertSeparator(std::vector<PageId>& path, Entry separator, PageId child);
+
+  /**
+   * Makes a new root with the old root and <child> as its children, split by
+   * <separator>.  The caller must hold <mutex_>.
+   */
+  void growRoot(const Entry& separator, const PageId child);
+
+  /**
+   * Buffer manager the nodes are pinned in.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * File holding the nodes.
+   */
+  File* file_;
+
+  /**
+   * Number of the meta page.
+   */
+  PageId meta_page_;
+
+  /**
+   * Copy of the root page number and height in the meta page.
+   */
+  PageId root_;
+  std::uint32_t height_;
+
+  /**
+   * Serializes the operations on the index.
+   */
+  mutable std::mutex mutex_;
+};
+
+static_assert(sizeof(BTreeIndex::Entry) == 16,
+              "Index entries must pack into 16 bytes.");
+
+}
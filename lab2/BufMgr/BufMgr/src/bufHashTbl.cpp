@@ -5,7 +5,10 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include <memory>
+#include <new>
+#include <utility>
 #include <iostream>
 #include "buffer.h"
 #include "bufHashTbl.h"
@@ -15,100 +18,165 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File* file, const PageId pageNo)
+const std::uint64_t BufHashTbl::EMPTY_KEY;
+
+namespace {
+
+// splitmix64 finalizer over the key, so sequential page numbers of one file
+// spread over the whole table.
+std::uint64_t mix(std::uint64_t value)
 {
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebULL;
+  value ^= value >> 31;
   return value;
 }
 
+}
+
+std::uint64_t BufHashTbl::hash(const FileId file, const PageId pageNo)
+{
+  return mix(key(file, pageNo));
+}
+
 BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+	: HTSIZE(capacityFor(htSize)), numEntries(0)
 {
-  // allocate an array of pointers to hashBuckets
-  ht = new hashBucket* [htSize];
-  for(int i=0; i < HTSIZE; i++)
-    ht[i] = NULL;
+  ht = new hashBucket [HTSIZE];
+  for (std::uint32_t i = 0; i < HTSIZE; i++)
+    ht[i].key = EMPTY_KEY;
 }
 
 BufHashTbl::~BufHashTbl()
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
-      delete tmpBuf;
-    }
-  }
   delete [] ht;
 }
 
-void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+std::uint32_t BufHashTbl::probeDistance(const std::uint32_t index) const
+{
+  const std::uint32_t home = mix(ht[index].key) & (HTSIZE - 1);
+  return (index - home) & (HTSIZE - 1);
+}
+
+std::uint32_t BufHashTbl::findSlot(const std::uint64_t key) const
+{
+  std::uint32_t index = mix(key) & (HTSIZE - 1);
+  for (std::uint32_t dist = 0; ; ++dist) {
+    const hashBucket& slot = ht[index];
+    if (slot.key == key)
+      return index;
+    // with Robin Hood ordering the key would have displaced any entry that is
+    // closer to its home slot than we are to ours.
+    if (slot.key == EMPTY_KEY || probeDistance(index) < dist)
+      return HTSIZE;
+    index = (index + 1) & (HTSIZE - 1);
+  }
+}
+
+std::uint32_t BufHashTbl::capacityFor(const std::uint32_t entries)
+{
+  // keep the load factor at or below 7/8 for the requested number of entries.
+  std::uint32_t size = 8;
+  while (size / 8 * 7 < entries)
+    size *= 2;
+  return size;
+}
+
+void BufHashTbl::rebuild(const std::uint32_t newSize)
 {
-  int index = hash(file, pageNo);
+  hashBucket* old = ht;
+  const std::uint32_t oldSize = HTSIZE;
 
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
+  ht = new (std::nothrow) hashBucket [newSize];
+  if (!ht) {
+    ht = old;
+    throw HashTableException();
+  }
+  HTSIZE = newSize;
+  numEntries = 0;
+  for (std::uint32_t i = 0; i < HTSIZE; i++)
+    ht[i].key = EMPTY_KEY;
+
+  for (std::uint32_t i = 0; i < oldSize; i++) {
+    if (old[i].key != EMPTY_KEY)
+      insertKey(old[i].key, old[i].frameNo);
   }
+  delete [] old;
+}
 
-  tmpBuc = new hashBucket;
-  if (!tmpBuc)
-  	throw HashTableException();
+void BufHashTbl::resize(const int htSize)
+{
+  const std::uint32_t newSize = capacityFor(std::max<std::uint32_t>(htSize, numEntries));
+  if (newSize != HTSIZE)
+    rebuild(newSize);
+}
 
-  tmpBuc->file = (File*) file;
-  tmpBuc->pageNo = pageNo;
-  tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
+void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+{
+  const std::uint64_t pageKey = key(file->id(), pageNo);
+  const std::uint32_t present = findSlot(pageKey);
+  if (present != HTSIZE)
+    throw HashAlreadyPresentException(file->filename(), pageNo, ht[present].frameNo);
+  if ((numEntries + 1) > HTSIZE / 8 * 7)
+    rebuild(HTSIZE * 2);
+  insertKey(pageKey, frameNo);
 }
 
-void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
+void BufHashTbl::insertKey(const std::uint64_t key, const FrameId frameNo)
 {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-    {
-      frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
+  hashBucket entry;
+  entry.key = key;
+  entry.frameNo = frameNo;
+
+  std::uint32_t index = mix(key) & (HTSIZE - 1);
+  std::uint32_t dist = 0;
+  while (ht[index].key != EMPTY_KEY) {
+    // steal the slot from entries that are closer to their home slot.
+    const std::uint32_t slotDist = probeDistance(index);
+    if (slotDist < dist) {
+      std::swap(entry, ht[index]);
+      dist = slotDist;
     }
-    tmpBuc = tmpBuc->next;
+    index = (index + 1) & (HTSIZE - 1);
+    ++dist;
   }
+  ht[index] = entry;
+  ++numEntries;
+}
 
-  throw HashNotFoundException(file->filename(), pageNo);
+void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
+{
+  if (!find(file, pageNo, frameNo))
+    throw HashNotFoundException(file->filename(), pageNo);
+}
+
+bool BufHashTbl::find(const File* file, const PageId pageNo, FrameId &frameNo) const
+{
+  const std::uint32_t index = findSlot(key(file->id(), pageNo));
+  if (index == HTSIZE)
+    return false;
+  frameNo = ht[index].frameNo; // return frameNo by reference
+  return true;
 }
 
 void BufHashTbl::remove(const File* file, const PageId pageNo) {
 
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  hashBucket* prevBuc = NULL;
-
-  while (tmpBuc)
-	{
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-		{
-      if(prevBuc) 
-				prevBuc->next = tmpBuc->next;
-      else
-				ht[index] = tmpBuc->next;
-
-      delete tmpBuc;
-      return;
-    }
-		else
-		{
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
-    }
+  std::uint32_t index = findSlot(key(file->id(), pageNo));
+  if (index == HTSIZE)
+    throw HashNotFoundException(file->filename(), pageNo);
+
+  // shift the following entries of the cluster back by one slot until an empty
+  // slot or an entry already in its home slot is reached.
+  std::uint32_t next = (index + 1) & (HTSIZE - 1);
+  while (ht[next].key != EMPTY_KEY && probeDistance(next) != 0) {
+    ht[index] = ht[next];
+    index = next;
+    next = (next + 1) & (HTSIZE - 1);
   }
-
-  throw HashNotFoundException(file->filename(), pageNo);
+  ht[index].key = EMPTY_KEY;
+  --numEntries;
 }
 
 }
@@ -7,65 +7,141 @@
 
 #pragma once
 
+#include <cstdint>
 #include "file.h"
 
 namespace badgerdb {
 
 /**
-* @brief Declarations for buffer pool hash table
+* @brief Declarations for buffer pool hash table slot.  A slot whose key is
+* BufHashTbl::EMPTY_KEY is empty.
 */
 struct hashBucket {
 	/**
-	 * pointer a file object (more on this below)
+	 * id of the file and page number within it, packed by BufHashTbl::key
 	 */
-	File *file;
-
-	/**
-	 * page number within a file
-	 */
-	PageId pageNo;
+	std::uint64_t key;
 
 	/**
 	 * frame number of page in the buffer pool
 	 */
 	FrameId frameNo;
-
-	/**
-	 * Next node in the hash table
-	 */
-	hashBucket*   next;
 };
 
 
 /**
 * @brief Hash table class to keep track of pages in the buffer pool
 *
+* The table uses open addressing with Robin Hood probing over one flat,
+* preallocated array of slots, so insert, lookup and remove never allocate.
+* Removal uses backward shifting instead of tombstones.  Pages are keyed by
+* the FileId of their file and their number packed into 64 bits, so that
+* every File object for a file maps to the same entries and a probe compares
+* one word.  The array only grows
+* (doubling) when the load factor would exceed 7/8, or changes size when
+* resize() is called.
+*
 * @warning This class is not threadsafe.
 */
 class BufHashTbl
 {
  private:
 	/**
-	 *	Size of Hash Table
+	 *	Size of Hash Table, always a power of two
 	 */
-  int HTSIZE;
+  std::uint32_t HTSIZE;
+
+	/**
+	 *	Number of occupied slots
+	 */
+  std::uint32_t numEntries;
+
 	/**
 	 * Actual Hash table object
 	 */
-  hashBucket**  ht;
+  hashBucket*  ht;
+
+	/**
+	 * Returns how far the entry in slot <index> is from its home slot.
+	 *
+	 * @param index   Slot holding an entry
+	 * @return  			Probe distance of that entry.
+	 */
+  std::uint32_t probeDistance(const std::uint32_t index) const;
 
 	/**
-	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+	 * Returns the slot holding <key>, or HTSIZE if it is not present.
+	 *
+	 * @param key   	Key of the page
+	 * @return  			Slot index.
+	 */
+  std::uint32_t findSlot(const std::uint64_t key) const;
+
+	/**
+	 * Inserts an entry known not to be present into a table with room for it.
+	 *
+	 * @param key   	Key of the page
+	 * @param frameNo Frame number assigned to the page
+	 */
+  void insertKey(const std::uint64_t key, const FrameId frameNo);
+
+	/**
+	 * Returns the smallest number of slots that holds <entries> entries
+	 * without growing.
+	 */
+  static std::uint32_t capacityFor(const std::uint32_t entries);
+
+	/**
+	 * Replaces the slot array by one of <newSize> slots and reinserts all entries.
+	 *
+	 * @param newSize Number of slots, a power of two
+   * @throws  HashTableException if the new slot array could not be allocated
+	 */
+  void rebuild(const std::uint32_t newSize);
+
+ public:
+	/**
+	 * Key of no page, marking empty slots
+	 */
+  static const std::uint64_t EMPTY_KEY = ~std::uint64_t(0);
+
+	/**
+	 * Packs a file id and page number into the key of a page.
+	 *
+	 * @param file   	Id of the file
+	 * @param pageNo  Page number in the file
+	 * @return  			Key of the page.
+	 */
+  static std::uint64_t key(const FileId file, const PageId pageNo)
+	{
+    return static_cast<std::uint64_t>(file) << 32 | pageNo;
+  }
+
+	/**
+	 * returns a well mixed 64-bit hash value computed using file and pageNo
+	 *
+	 * @param file   	Id of the file
+	 * @param pageNo  Page number in the file
+	 * @return  			Hash value.
+	 */
+  static std::uint64_t hash(const FileId file, const PageId pageNo);
+
+	/**
+	 * returns a well mixed 64-bit hash value computed using file and pageNo
 	 *
 	 * @param file   	File object
 	 * @param pageNo  Page number in the file
 	 * @return  			Hash value.
 	 */
-  int	 hash(const File* file, const PageId pageNo);
+  static std::uint64_t hash(const File* file, const PageId pageNo)
+	{
+    return hash(file->id(), pageNo);
+  }
 
- public:
 	/**
    * Constructor of BufHashTbl class
+	 *
+	 * @param htSize  Number of entries the table should hold without growing
 	 */
 	BufHashTbl(const int htSize);  // constructor
 
@@ -81,7 +157,7 @@ class BufHashTbl
 	 * @param pageNo 	Page number in the file
 	 * @param frameNo Frame number assigned to that page of the file
    * @throws  HashAlreadyPresentException	if the corresponding page already exists in the hash table
-   * @throws  HashTableException (optional) if could not create a new bucket as running of memory
+   * @throws  HashTableException if the table had to grow and ran out of memory
 	 */
   void insert(const File* file, const PageId pageNo, const FrameId frameNo);
 
@@ -96,6 +172,26 @@ class BufHashTbl
 	 */
   void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
 
+	/**
+   * Check if (file, pageNo) is currently in the buffer pool (ie. in the hash
+   * table) without throwing, so a buffer miss costs no exception.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference, only assigned if the page is found
+	 * @return  			True if the page entry is found in the hash table
+	 */
+  bool find(const File* file, const PageId pageNo, FrameId &frameNo) const;
+
+	/**
+   * Resizes the slot array to hold <htSize> entries without growing, or all
+   * entries present if they are more.  Used when the buffer pool is resized.
+	 *
+	 * @param htSize  Number of entries the table should hold without growing
+   * @throws  HashTableException if the new slot array could not be allocated
+	 */
+  void resize(const int htSize);
+
 	/**
    * Delete entry (file,pageNo) from hash table.
 	 *
@@ -5,179 +5,1719 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <functional>
 #include <memory>
 #include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <unordered_map>
+#include <errno.h>
+#include <stdlib.h>
 #include <sys/types.h>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/corrupt_page_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
-#include "exceptions/hash_not_found_exception.h"
 #include "types.h"
 
 namespace badgerdb { 
 
-BufMgr::BufMgr(std::uint32_t bufs)
-  : numBufs(bufs) {
-  bufDescTable = new BufDesc[bufs];
+// records an operation if a tracer is attached; make TRACE=0 compiles it out.
+#if BADGERDB_TRACE
+#define BUFMGR_TRACE(op, file, pageNo, flags) \
+  do { \
+    TraceRecorder* recorder = tracer.load(std::memory_order_relaxed); \
+    if (recorder) \
+      recorder->record(op, file, pageNo, flags); \
+  } while (0)
+#else
+#define BUFMGR_TRACE(op, file, pageNo, flags) do {} while (0)
+#endif
 
-  for (FrameId i = 0; i < bufs; i++) 
+const FrameId BufAccessStrategy::NO_FRAME;
+const FrameId BufDesc::NO_FRAME;
+
+namespace {
+
+// first bytes of the marker record a checkpoint appends to the log, followed
+// by its redo LSN.
+const char CHECKPOINT_RECORD[] = {'B', 'D', 'B', 'C', 'K', 'P', 'T', '\0'};
+
+}
+
+class BufMgr::Claimer : public FrameClaimer {
+ public:
+  Claimer(BufMgr& mgr, std::unique_lock<std::mutex>& latch)
+    : mgr(mgr), latch(latch) {}
+
+  bool claim(const FrameId frame)
+  {
+    return mgr.claimFrame(frame, latch);
+  }
+
+ private:
+  BufMgr& mgr;
+  std::unique_lock<std::mutex>& latch;
+};
+
+class BufMgr::AsyncIo {
+ public:
+  AsyncIo(const IoEngineType type, const std::uint32_t depth)
+    : engine(IoEngine::create(type, depth)), requests(engine->depth()), staging(NULL), inFlight(0)
+  {
+    // aligned like the buffer pool, so that direct I/O can use the pages.
+    void* pages = NULL;
+    if (posix_memalign(&pages, Page::SIZE, requests.size() * sizeof(Page)) != 0)
+      throw std::bad_alloc();
+    staging = static_cast<Page*>(pages);
+    for (std::size_t i = 0; i < requests.size(); i++) {
+      new (&staging[i]) Page();
+      requests[i].tag = i;
+      slots.push_back(i);
+    }
+  }
+
+  ~AsyncIo()
+  {
+    free(staging);
+  }
+
+  std::size_t depth() const { return requests.size(); }
+  bool full() const { return slots.empty(); }
+  std::size_t pending() const { return inFlight; }
+
+  std::size_t acquire()
+  {
+    const std::size_t slot = slots.back();
+    slots.pop_back();
+    return slot;
+  }
+
+  void release(const std::size_t slot) { slots.push_back(slot); }
+  IoRequest& request(const std::size_t slot) { return requests[slot]; }
+  Page& page(const std::size_t slot) { return staging[slot]; }
+
+  void submit(const std::size_t slot)
+  {
+    engine->submit(requests[slot]);
+    ++inFlight;
+  }
+
+  std::size_t wait()
   {
+    const std::size_t slot = engine->wait().tag;
+    --inFlight;
+    return slot;
+  }
+
+ private:
+  std::unique_ptr<IoEngine> engine;
+  std::vector<IoRequest> requests;
+  Page* staging;
+  std::vector<std::size_t> slots;  // free request slots
+  std::size_t inFlight;
+};
+
+BufMgr::BufMgr(std::uint32_t bufs, const BufMgrOptions& options)
+  : numBufs(bufs), activeBufs(bufs), maxBufs(std::max(bufs, options.maxBufs)),
+    numShards(options.numShards == 0 ? 1 : options.numShards) {
+  // one contiguous pool, aligned to the page size so that frames can be the
+  // buffers of direct I/O, with the descriptors in the same mapping.  The
+  // arena places the memory before it is first touched here; frames past the
+  // initial size stay untouched until resize grows into them.
+  std::vector<std::size_t> arrays;
+  arrays.push_back(sizeof(std::atomic<std::uint32_t>));
+  arrays.push_back(sizeof(BufDesc));
+  arena = new BufferArena(maxBufs, sizeof(Page), arrays, options.hugePages, options.numaPlacement);
+  bufStateTable = static_cast<std::atomic<std::uint32_t>*>(arena->array(0));
+  bufDescTable = static_cast<BufDesc*>(arena->array(1));
+  bufPool = static_cast<Page*>(arena->frames());
+  for (FrameId i = 0; i < maxBufs; i++) 
+  {
+    new (&bufStateTable[i]) std::atomic<std::uint32_t>(0);
+    new (&bufDescTable[i]) BufDesc(&bufStateTable[i]);
     bufDescTable[i].frameNo = i;
-    bufDescTable[i].valid = false;
   }
+  for (FrameId i = 0; i < bufs; i++)
+    new (&bufPool[i]) Page();
+
+  // size every shard for twice its fair share of frames, so a skewed
+  // distribution of pages over shards rarely makes a table grow.
+  int htsize = (bufs / numShards + 1) * 2;
+  shards = new BufShard[numShards];
+  for (std::uint32_t i = 0; i < numShards; i++)
+    shards[i].hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+
+  policy = ReplacementPolicy::create(options.policy, bufStateTable, maxBufs, options.lruK);
+  if (bufs < maxBufs)
+    policy->resize(bufs);
+  bufStats.policy = policy->name();
+
+  ioEngineType = options.ioEngine;
+  ioQueueDepth = options.ioQueueDepth == 0 ? 1 : options.ioQueueDepth;
+  log = options.log;
+  secondaryCache = SecondaryCache::create(options.secondaryCache, options.secondaryCacheBytes,
+                                          options.secondaryCachePath);
 
-  bufPool = new Page[bufs];
+  bgWriterDelayMs = options.bgWriterDelayMs;
+  bgWriterCleanTarget = options.bgWriterCleanTarget;
+  bgWriterMaxPages = options.bgWriterMaxPages;
+  bgWriterStop = false;
+  if (bgWriterDelayMs != 0)
+    bgWriter = std::thread(&BufMgr::bgWriterLoop, this);
 
-  int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
-  hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+  warmupFile = options.warmupFile;
+  warmupSaveMs = options.warmupSaveMs;
+  warmupStop = false;
+  if (!warmupFile.empty() && warmupSaveMs != 0)
+    warmupSaver = std::thread(&BufMgr::warmupSaverLoop, this);
 
-  clockHand = bufs - 1;
+  readAheadPages = options.readAheadPages;
+  prefetchBusy = NULL;
+  prefetchStop = false;
+  fileVersion = 0;
+  checkpointsStarted = checkpointsCompleted = 0;
+  checkpointRunning = false;
+  checkpointPagesPerSec = options.checkpointPagesPerSec;
+  logCheckpoints = options.logCheckpoints;
+  checkpointRedo = 0;
+  tracer = NULL;
 }
 
 
 BufMgr::~BufMgr() {
+  if (warmupSaver.joinable()) {
+    {
+      std::lock_guard<std::mutex> guard(warmupMutex);
+      warmupStop = true;
+    }
+    warmupWake.notify_one();
+    warmupSaver.join();
+  }
+  if (!warmupFile.empty()) {
+    try {
+      saveResidentPages(warmupFile);
+    } catch (...) {
+      // the next start just begins cold.
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(prefetchMutex);
+    prefetchStop = true;
+  }
+  prefetchWake.notify_one();
+  if (prefetcher.joinable())
+    prefetcher.join();
+
+  if (bgWriter.joinable()) {
+    {
+      std::lock_guard<std::mutex> guard(bgWriterMutex);
+      bgWriterStop = true;
+    }
+    bgWriterWake.notify_one();
+    bgWriter.join();
+  }
+
   // write back all modified page before we free the resouces.
   for (FrameId id = 0; id < numBufs; ++id) {
     BufDesc& entry = bufDescTable[id];
-    if (!entry.valid)
+    if (!entry.isValid())
       continue;
-    if (entry.pinCnt != 0)
+    if (entry.pinCount() != 0)
       throw PagePinnedException(entry.file->filename(), entry.pageNo, id);
-    if (entry.dirty)
+    // temporary files are not kept past the process.
+    if (entry.isDirty() && !entry.file->isTemporary()) {
+      forceLog(bufPool[id].lsn());
       entry.file->writePage(bufPool[id]);
+    }
   }
 
   // free resouces.
-  delete hashTable;
-  delete[] bufPool;
-  delete[] bufDescTable;
+  delete secondaryCache;
+  delete policy;
+  for (std::uint32_t i = 0; i < numShards; i++)
+    delete shards[i].hashTable;
+  delete[] shards;
+  for (FrameId id = 0; id < maxBufs; ++id) {
+    bufDescTable[id].~BufDesc();  // pages are trivially destructible
+    bufStateTable[id].~atomic();
+  }
+  delete arena;
 }
 
-void BufMgr::advanceClock()
+BufShard& BufMgr::shardOf(const File* file, const PageId pageNo)
 {
-  clockHand = clockHand == numBufs - 1 ? 0 : clockHand + 1;
+  // the tables index slots by the low bits of the hash, so pick the shard with
+  // the high bits.
+  return shards[(BufHashTbl::hash(file, pageNo) >> 32) % numShards];
 }
 
-void BufMgr::allocBuf(FrameId & frame) 
+void BufMgr::writeBack(File* file, const Page& page)
 {
-  int count = 0;
-  int trylimit = numBufs * 2;
-  while (count++ <= trylimit) {
-    advanceClock();
+  forceLog(page.lsn());
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  file->writePage(page);
+  bufStats.writeLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count());
+  ++bufStats.diskwrites;
+  fileWritten(file);
+}
 
-    BufDesc& entry = bufDescTable[clockHand];
-    if (!entry.valid) { // invalid(not alllocated) entry
-      entry.Clear();
-      frame = clockHand;
-      return;
-    }
-    if (entry.refbit) {
-      entry.refbit = false;
+void BufMgr::lockShard(BufShard& shard, std::unique_lock<std::mutex>& guard)
+{
+  // only a latch we have to wait for is timed, so uncontended reads pay for
+  // no clock reads.
+  guard = std::unique_lock<std::mutex>(shard.latch, std::try_to_lock);
+  if (guard.owns_lock())
+    return;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  guard.lock();
+  bufStats.pinWaitNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+FileStats& BufMgr::fileStatsOf(BufShard& shard, const File* file)
+{
+  std::unordered_map<const File*, FileStats>::iterator it = shard.fileStats.find(file);
+  if (it == shard.fileStats.end()) {
+    it = shard.fileStats.insert(std::make_pair(file, FileStats())).first;
+    it->second.filename = file->filename();
+  }
+  return it->second;
+}
+
+void BufMgr::forceLog(const Lsn lsn)
+{
+  if (log)
+    log->flush(lsn);
+}
+
+void BufMgr::fileWritten(File* file)
+{
+  ++fileVersion;
+  if (!file->isTemporary()) {
+    std::lock_guard<std::mutex> guard(unsyncedLatch);
+    unsyncedFiles.insert(file);
+  }
+}
+
+void BufMgr::checkpoint()
+{
+  std::unique_lock<std::mutex> guard(checkpointMutex);
+  // a round already running may have passed pages written before this call,
+  // so wait for the next one.
+  const std::uint64_t target = checkpointsStarted + 1;
+  while (checkpointsCompleted < target) {
+    if (checkpointRunning) {
+      checkpointDone.wait(guard);
       continue;
     }
-    if (entry.pinCnt != 0)
+    checkpointRunning = true;
+    const std::uint64_t round = ++checkpointsStarted;
+    guard.unlock();
+    try {
+      checkpointRound();
+    } catch (...) {
+      // let a waiting caller lead another round.
+      guard.lock();
+      checkpointRunning = false;
+      checkpointDone.notify_all();
+      throw;
+    }
+    guard.lock();
+    checkpointRunning = false;
+    checkpointsCompleted = round;
+    checkpointDone.notify_all();
+  }
+}
+
+void BufMgr::checkpointRound()
+{
+  // changes logged from here on may be missed by the snapshot.
+  const Lsn redo = log ? log->endLsn() : 0;
+
+  // snapshot the dirty frames; frames are only latched one at a time, so
+  // other threads go on meanwhile.
+  struct DirtyPage {
+    FileId fileId;
+    PageId pageNo;
+    FrameId frame;
+    bool operator<(const DirtyPage& other) const {
+      return fileId != other.fileId ? fileId < other.fileId : pageNo < other.pageNo;
+    }
+  };
+  std::vector<DirtyPage> dirty;
+  for (FrameId id = 0; id < numBufs; ++id) {
+    BufDesc& entry = bufDescTable[id];
+    std::lock_guard<std::mutex> latch(entry.latch);
+    if (entry.isValid() && entry.isDirty() && !entry.file->isTemporary()) {
+      const DirtyPage page = {entry.fileId, entry.pageNo, id};
+      dirty.push_back(page);
+    }
+  }
+  std::sort(dirty.begin(), dirty.end());
+
+  AsyncIo io(ioEngineType, ioQueueDepth);
+  std::size_t chunk = io.depth();
+  if (checkpointPagesPerSec != 0 && checkpointPagesPerSec < chunk)
+    chunk = checkpointPagesPerSec;
+  std::vector<std::unique_lock<std::mutex> > latches;
+  std::vector<std::pair<FrameId, std::size_t> > batch;
+  std::vector<DirtyPage> frames;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::uint64_t skipped = 0;
+  for (std::size_t next = 0; next < dirty.size(); next += chunk) {
+    if (checkpointPagesPerSec != 0) {
+      std::this_thread::sleep_until(start + std::chrono::microseconds(
+          static_cast<std::uint64_t>(next) * 1000000 / checkpointPagesPerSec));
+    }
+    // cleanFrame waits for frame latches, which must be taken in frame order;
+    // the copies are put back in page order before they are written.
+    frames.assign(dirty.begin() + next, dirty.begin() + std::min(next + chunk, dirty.size()));
+    std::sort(frames.begin(), frames.end(),
+              [](const DirtyPage& a, const DirtyPage& b) { return a.frame < b.frame; });
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+      if (!cleanFrame(frames[i].frame, io, latches, batch, true /* wait */,
+                      frames[i].fileId, frames[i].pageNo))
+        ++skipped;
+    }
+    std::sort(batch.begin(), batch.end(),
+              [this](const std::pair<FrameId, std::size_t>& a, const std::pair<FrameId, std::size_t>& b) {
+                const BufDesc& x = bufDescTable[a.first];
+                const BufDesc& y = bufDescTable[b.first];
+                return x.fileId != y.fileId ? x.fileId < y.fileId : x.pageNo < y.pageNo;
+              });
+    const std::size_t queued = batch.size();
+    const std::uint64_t written = bufStats.checkpointWrites;
+    writeBatch(io, latches, batch, bufStats.checkpointWrites);
+    skipped += queued - (bufStats.checkpointWrites - written);
+  }
+  bufStats.checkpointSkips += skipped;
+
+  // write the headers under unsyncedLatch, so that none of the files is
+  // released meanwhile, but not the data, which the device may take long to
+  // sync.
+  std::vector<File*> files;
+  {
+    std::lock_guard<std::mutex> guard(unsyncedLatch);
+    files.assign(unsyncedFiles.begin(), unsyncedFiles.end());
+    unsyncedFiles.clear();
+    try {
+      for (std::size_t i = 0; i < files.size(); ++i)
+        files[i]->flushHeader();
+    } catch (...) {
+      unsyncedFiles.insert(files.begin(), files.end());
+      throw;
+    }
+  }
+  try {
+    for (std::size_t i = 0; i < files.size(); ++i)
+      files[i]->syncData();
+  } catch (...) {
+    std::lock_guard<std::mutex> guard(unsyncedLatch);
+    unsyncedFiles.insert(files.begin(), files.end());
+    throw;
+  }
+
+  // a skipped page may hold changes from before the last redo LSN, but none
+  // from before the one before it, which it was written back for.
+  if (skipped == 0)
+    checkpointRedo = redo;
+  if (log && logCheckpoints) {
+    std::string record(CHECKPOINT_RECORD, sizeof(CHECKPOINT_RECORD));
+    const Lsn redoLsn = checkpointRedo;
+    record.append(reinterpret_cast<const char*>(&redoLsn), sizeof(redoLsn));
+    log->flush(log->append(record));
+  }
+  ++bufStats.checkpoints;
+}
+
+bool BufMgr::parseCheckpointRecord(const std::string& record, Lsn& redoLsn)
+{
+  if (record.size() != sizeof(CHECKPOINT_RECORD) + sizeof(Lsn) ||
+      record.compare(0, sizeof(CHECKPOINT_RECORD), CHECKPOINT_RECORD, sizeof(CHECKPOINT_RECORD)) != 0)
+    return false;
+  std::memcpy(&redoLsn, record.data() + sizeof(CHECKPOINT_RECORD), sizeof(redoLsn));
+  return true;
+}
+
+bool BufMgr::claimFrame(const FrameId frame, std::unique_lock<std::mutex>& latch)
+{
+  BufDesc& entry = bufDescTable[frame];
+  ++bufStats.victimCandidates;
+  // another thread is claiming or evicting this frame.
+  std::unique_lock<std::mutex> frameLatch(entry.latch, std::try_to_lock);
+  if (!frameLatch.owns_lock())
+    return false;
+  // checked under the latch, so resize either waits for this claim or sees
+  // the frame refused.
+  if (frame >= activeBufs)
+    return false;
+  if (!entry.isValid()) { // invalid(not alllocated) entry
+    clearFrame(entry);
+    latch.swap(frameLatch);
+    ++bufStats.allocations;
+    return true;
+  }
+  if (entry.pinCount() != 0)
+    return false;
+
+  // pins are only taken under the shard latch, so hold it while evicting.
+  BufShard& victim = shardOf(entry.file, entry.pageNo);
+  std::unique_lock<std::mutex> victimLatch(victim.latch, std::try_to_lock);
+  if (!victimLatch.owns_lock())
+    return false;
+  if (entry.pinCount() != 0)
+    return false;
+
+  const bool dirty = entry.isDirty();
+  const bool relatched = writeOut(frame, victimLatch, false);
+  if (dirty) {  // has been modified and written back.
+    ++bufStats.evictionWrites;
+    // the background writer is falling behind.
+    if (bgWriter.joinable())
+      bgWriterWake.notify_one();
+  }
+  if (!relatched)
+    return false;
+
+  // now we get an available buffer.
+  FileStats& fileStats = fileStatsOf(victim, entry.file);
+  ++fileStats.evictions;
+  if (dirty)
+    ++fileStats.evictionWrites;
+  BUFMGR_TRACE(TRACE_EVICT, entry.file, entry.pageNo, dirty ? TraceRecord::DIRTY : 0);
+
+  // update mapping
+  victim.hashTable->remove(entry.file, entry.pageNo);
+  clearFrame(entry);
+  latch.swap(frameLatch);
+  ++bufStats.allocations;
+  ++bufStats.evictions;
+  return true;
+}
+
+bool BufMgr::writeOut(const FrameId frame, std::unique_lock<std::mutex>& shardLatch, const bool wait)
+{
+  BufDesc& entry = bufDescTable[frame];
+  const bool dirty = entry.isDirty();
+  if (!dirty && !secondaryCache)
+    return true;
+  // whoever looks the page up meanwhile waits for the frame latch instead of
+  // pinning the page, so the shard stays free for other pages.
+  entry.SetIo(true);
+  shardLatch.unlock();
+  try {
+    if (dirty) {
+      writeBack(entry.file, bufPool[frame]);
+      // nobody could pin the page since, so nobody dirtied it again.
+      entry.SetDirty(false);
+    }
+    // keep the clean copy below the pool.  This is done before the mapping
+    // goes, so a miss on the page finds it there.
+    if (secondaryCache) {
+      secondaryCache->put(entry.file, bufPool[frame]);
+      ++bufStats.secondaryStores;
+    }
+  } catch (...) {
+    entry.SetIo(false);
+    throw;
+  }
+  if (wait)
+    shardLatch.lock();
+  else
+    shardLatch.try_lock();
+  entry.SetIo(false);
+  return shardLatch.owns_lock();
+}
+
+void BufMgr::waitForIo(BufShard& shard, const FrameId frame, std::unique_lock<std::mutex>& guard)
+{
+  guard.unlock();
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> latch(bufDescTable[frame].latch);
+  }
+  bufStats.pinWaitNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  lockShard(shard, guard);
+}
+
+void BufMgr::queuePrefetch(File* file, const PageId first, const PageId count)
+{
+  // a scan that outruns the prefetcher gains nothing from a longer queue.
+  if (prefetchStop || prefetchQueue.size() >= 64)
+    return;
+  PrefetchRequest request;
+  request.file = file;
+  request.first = first;
+  request.count = count;
+  prefetchQueue.push_back(request);
+  if (!prefetcher.joinable())
+    prefetcher = std::thread(&BufMgr::prefetchLoop, this);
+  prefetchWake.notify_one();
+}
+
+void BufMgr::prefetch(File* file, const PageId first, const PageId count)
+{
+  if (count == 0)
+    return;
+  std::lock_guard<std::mutex> guard(prefetchMutex);
+  queuePrefetch(file, first, count);
+}
+
+void BufMgr::saveResidentPages(const std::string& path)
+{
+  // rank the frames by the order the policy would evict them in.
+  const std::uint32_t frames = numBufs;
+  std::vector<FrameId> order;
+  policy->nextVictims(frames, order);
+  std::vector<std::uint32_t> rank(frames, frames);
+  for (std::size_t i = 0; i < order.size(); i++)
+    if (order[i] < frames)
+      rank[order[i]] = i;
+
+  const std::string temporary = path + ".tmp";
+  std::ofstream out(temporary.c_str(), std::ios::out | std::ios::trunc);
+  for (FrameId id = 0; id < frames && out; ++id) {
+    BufDesc& entry = bufDescTable[id];
+    std::lock_guard<std::mutex> latch(entry.latch);
+    // temporary files do not outlive the process, so cannot be prewarmed.
+    if (!entry.isValid() || entry.file->isTemporary())
       continue;
+    const std::uint32_t hotness = rank[id] + (entry.isReferenced() ? frames : 0);
+    out << hotness << ' ' << entry.pageNo << ' ' << entry.file->filename() << '\n';
+  }
+  out.close();
+  if (!out)
+    throw FileIOException(temporary, "write", errno);
+  if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    throw FileIOException(path, "rename", errno);
+}
 
-    // now we get an available buffer.
+std::size_t BufMgr::prewarm(const std::string& path, const std::vector<File*>& files, const bool wait)
+{
+  std::unordered_map<std::string, File*> byName;
+  for (std::size_t i = 0; i < files.size(); i++)
+    byName[files[i]->filename()] = files[i];
+
+  struct Listed {
+    std::uint32_t hotness;
+    File* file;
+    PageId pageNo;
+  };
+  std::vector<Listed> pages;
+  std::ifstream in(path.c_str());
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    Listed listed;
+    std::string name;
+    if (!(fields >> listed.hotness >> listed.pageNo) || fields.get() != ' ' ||
+        !std::getline(fields, name))
+      break;  // cut short by a crash while saving: use what came before
+    auto it = byName.find(name);
+    if (it == byName.end())
+      continue;
+    listed.file = it->second;
+    pages.push_back(listed);
+  }
 
-    if (entry.dirty)  // has been modified, write it back.
-      entry.file->writePage(bufPool[clockHand]);
+  // the hottest pages that fit, in runs of consecutive pages of a file.
+  std::sort(pages.begin(), pages.end(), [](const Listed& lhs, const Listed& rhs) {
+    return lhs.hotness > rhs.hotness;
+  });
+  if (pages.size() > numBufs)
+    pages.resize(numBufs);
+  std::sort(pages.begin(), pages.end(), [](const Listed& lhs, const Listed& rhs) {
+    return lhs.file != rhs.file ? std::less<File*>()(lhs.file, rhs.file) : lhs.pageNo < rhs.pageNo;
+  });
+  std::vector<std::pair<std::uint32_t, PrefetchRequest> > runs;
+  for (std::size_t i = 0; i < pages.size(); i++) {
+    if (!runs.empty()) {
+      PrefetchRequest& last = runs.back().second;
+      if (last.file == pages[i].file && last.first + last.count == pages[i].pageNo) {
+        ++last.count;
+        runs.back().first = std::max(runs.back().first, pages[i].hotness);
+        continue;
+      }
+      if (last.file == pages[i].file && last.first + last.count > pages[i].pageNo)
+        continue;  // listed twice
+    }
+    PrefetchRequest request;
+    request.file = pages[i].file;
+    request.first = pages[i].pageNo;
+    request.count = 1;
+    runs.push_back(std::make_pair(pages[i].hotness, request));
+  }
+  std::stable_sort(runs.begin(), runs.end(),
+                   [](const std::pair<std::uint32_t, PrefetchRequest>& lhs,
+                      const std::pair<std::uint32_t, PrefetchRequest>& rhs) {
+    return lhs.first > rhs.first;
+  });
 
-    // update mapping
-    hashTable->remove(entry.file, entry.pageNo);
-    entry.Clear();
-    frame = clockHand;
+  // queued past the limit of queuePrefetch, as the list is bounded by the
+  // pool size.
+  std::unique_lock<std::mutex> guard(prefetchMutex);
+  if (prefetchStop || runs.empty())
+    return 0;
+  std::size_t queued = 0;
+  for (std::size_t i = 0; i < runs.size(); i++) {
+    prefetchQueue.push_back(runs[i].second);
+    queued += runs[i].second.count;
+  }
+  if (!prefetcher.joinable())
+    prefetcher = std::thread(&BufMgr::prefetchLoop, this);
+  prefetchWake.notify_one();
+  while (wait && (!prefetchQueue.empty() || prefetchBusy != NULL))
+    prefetchDone.wait(guard);
+  return queued;
+}
+
+void BufMgr::warmupSaverLoop()
+{
+  std::unique_lock<std::mutex> guard(warmupMutex);
+  while (!warmupStop) {
+    warmupWake.wait_for(guard, std::chrono::milliseconds(warmupSaveMs));
+    if (warmupStop)
+      break;
+    guard.unlock();
+    try {
+      saveResidentPages(warmupFile);
+    } catch (...) {
+      // keep the last list saved; the next round tries again.
+    }
+    guard.lock();
+  }
+}
+
+void BufMgr::noteRead(File* file, const PageId pageNo)
+{
+  std::lock_guard<std::mutex> guard(prefetchMutex);
+  ReadAheadState& state = readAheadState[file];
+  const bool sequential = pageNo == state.last + 1;
+  state.last = pageNo;
+  if (!sequential) {
+    state.ahead = pageNo;
     return;
   }
+  // queue the next window once the reader is halfway through the current one.
+  if (state.ahead >= pageNo + readAheadPages / 2)
+    return;
+  const PageId first = (state.ahead > pageNo ? state.ahead : pageNo) + 1;
+  const PageId last = pageNo + readAheadPages;
+  state.ahead = last;
+  queuePrefetch(file, first, last - first + 1);
+}
 
-  throw BufferExceededException();
+void BufMgr::readAsync(AsyncIo& io, File* file, const std::vector<PageId>& pageNos,
+                       const std::function<bool(std::size_t, const Page*, std::uint64_t)>& done)
+{
+  std::vector<std::size_t> index(io.depth());
+  std::vector<std::uint64_t> version(io.depth());
+  std::exception_ptr error;
+  std::size_t next = 0;
+  bool more = true;
+  for (;;) {
+    // keep the engine full.
+    while (more && next < pageNos.size() && !io.full()) {
+      const std::size_t slot = io.acquire();
+      bool prepared = true;
+      try {
+        version[slot] = fileVersion;
+        file->prepareRead(pageNos[next], io.page(slot), io.request(slot));
+      } catch (...) {
+        prepared = false;  // past the end of the file
+      }
+      if (prepared) {
+        index[slot] = next;
+        io.submit(slot);
+      } else {
+        io.release(slot);
+        try {
+          more = done(next, NULL, 0);
+        } catch (...) {
+          error = std::current_exception();
+          more = false;
+        }
+      }
+      ++next;
+    }
+    if (io.pending() == 0)
+      break;
+
+    const std::size_t slot = io.wait();
+    const Page* contents = &io.page(slot);
+    ++bufStats.diskreads;
+    try {
+      file->finishRead(pageNos[index[slot]], io.page(slot), io.request(slot));
+    } catch (const CorruptPageException&) {
+      ++bufStats.checksumFailures;
+      contents = NULL;
+    } catch (...) {
+      contents = NULL;  // a deleted page, or an I/O error
+    }
+    if (more) {
+      try {
+        more = done(index[slot], contents, version[slot]);
+      } catch (...) {
+        error = std::current_exception();
+        more = false;
+      }
+    }
+    io.release(slot);
+  }
+  if (error)
+    std::rethrow_exception(error);
 }
 
-  
-void BufMgr::readPage(File* file, const PageId pageNo, Page*& page) {
+void BufMgr::prefetchLoop()
+{
+  AsyncIo io(ioEngineType, ioQueueDepth);
+  std::unique_lock<std::mutex> guard(prefetchMutex);
+  for (;;) {
+    while (!prefetchStop && prefetchQueue.empty())
+      prefetchWake.wait(guard);
+    if (prefetchStop)
+      break;
+    const PrefetchRequest request = prefetchQueue.front();
+    prefetchQueue.pop_front();
+    prefetchBusy = request.file;
+    guard.unlock();
+    prefetchRun(request, io);
+    guard.lock();
+    prefetchBusy = NULL;
+    prefetchDone.notify_all();
+  }
+}
+
+void BufMgr::prefetchRun(const PrefetchRequest& request, AsyncIo& io)
+{
+  std::vector<PageId> pageNos;
+  for (PageId i = 0; i < request.count; i++)
+    pageNos.push_back(request.first + i);
+  // pages past the end of the file or deleted are skipped; stop once no frame
+  // is left to load into.
+  readAsync(io, request.file, pageNos,
+            [&](std::size_t i, const Page* contents, std::uint64_t version) {
+              return !contents || prefetchPage(request.file, pageNos[i], contents, version);
+            });
+}
+
+bool BufMgr::prefetchPage(File* file, const PageId pageNo, const Page* contents,
+                          const std::uint64_t version)
+{
+  BufShard& shard = shardOf(file, pageNo);
+  std::unique_lock<std::mutex> guard(shard.latch);
+  FrameId id = numBufs;
+  // a page being read in by someone else is as good as loaded.
+  if (shard.hashTable->find(file, pageNo, id))
+    return true;
   try {
-    FrameId id = numBufs;
-    hashTable->lookup(file, pageNo, id);
-    // now we know there is already a buffer corresponding to the page to be read.
-    bufDescTable[id].refbit = true;
-    ++bufDescTable[id].pinCnt;
-    page = &bufPool[id];
-  } catch (HashNotFoundException& e) {
+    if (!loadPage(file, pageNo, shard, guard, id, NULL, contents, version))
+      return true;
+  } catch (...) {
+    // past the end of the file, or every frame is pinned.
+    return false;
+  }
+  bufDescTable[id].Unpin(false);
+  bufDescTable[id].ClearReference();  // load it cold until someone reads it
+  ++bufStats.prefetches;
+  return true;
+}
+
+FrameId BufMgr::pinPage(File* file, const PageId pageNo, const Page* contents,
+                        const std::uint64_t version)
+{
+  BufShard& shard = shardOf(file, pageNo);
+  std::unique_lock<std::mutex> guard(shard.latch);
+  FrameId id = numBufs;
+  for (;;) {
+    if (shard.hashTable->find(file, pageNo, id)) {
+      if (bufDescTable[id].isIoInProgress()) {
+        waitForIo(shard, id, guard);
+        continue;
+      }
+      // loaded by someone else since the caller looked.
+      bufDescTable[id].Reference();
+      bufDescTable[id].Pin();
+      guard.unlock();
+      policy->recordAccess(id);
+      return id;
+    }
+    if (loadPage(file, pageNo, shard, guard, id, NULL, contents, version))
+      return id;
+  }
+}
+
+void BufMgr::bgWriterLoop()
+{
+  AsyncIo io(ioEngineType, ioQueueDepth);
+  std::unique_lock<std::mutex> guard(bgWriterMutex);
+  while (!bgWriterStop) {
+    bgWriterWake.wait_for(guard, std::chrono::milliseconds(bgWriterDelayMs));
+    if (bgWriterStop)
+      break;
+    guard.unlock();
+    try {
+      bgWriterRound(io);
+    } catch (...) {
+      // leave the page dirty; the eviction that needs the frame will retry the
+      // write and report the error to its caller.
+    }
+    guard.lock();
+  }
+}
+
+void BufMgr::bgWriterRound(AsyncIo& io)
+{
+  std::vector<FrameId> candidates;
+  policy->nextVictims(numBufs, candidates);
+  std::vector<std::unique_lock<std::mutex> > latches;
+  std::vector<std::pair<FrameId, std::size_t> > batch;
+  std::uint32_t clean = 0;
+  std::uint32_t written = 0;
+  for (std::size_t i = 0; i < candidates.size(); ++i) {
+    if (clean >= bgWriterCleanTarget || written >= bgWriterMaxPages)
+      break;
+    const std::size_t queued = batch.size();
+    if (cleanFrame(candidates[i], io, latches, batch))
+      ++clean;
+    written += batch.size() - queued;
+    if (io.full())
+      writeBatch(io, latches, batch, bufStats.backgroundWrites);
+  }
+  writeBatch(io, latches, batch, bufStats.backgroundWrites);
+}
+
+bool BufMgr::cleanFrame(const FrameId frame, AsyncIo& io,
+                        std::vector<std::unique_lock<std::mutex> >& latches,
+                        std::vector<std::pair<FrameId, std::size_t> >& batch,
+                        const bool wait, const FileId fileId, const PageId pageNo)
+{
+  BufDesc& entry = bufDescTable[frame];
+  std::unique_lock<std::mutex> latch(entry.latch, std::defer_lock);
+  if (wait)
+    latch.lock();
+  else if (!latch.try_lock())
+    return false;
+  if (!entry.isValid())
+    return true;
+  // the expected page was written back when it was evicted.
+  if (fileId != File::INVALID_ID && (entry.fileId != fileId || entry.pageNo != pageNo))
+    return true;
+  // hold the shard latch so the page cannot be pinned and dirtied meanwhile.
+  BufShard& shard = shardOf(entry.file, entry.pageNo);
+  std::lock_guard<std::mutex> guard(shard.latch);
+  if (entry.pinCount() != 0)
+    return false;
+  // pages of temporary files are only written when evicted.
+  if (entry.file->isTemporary())
+    return !entry.isDirty();
+  if (entry.isDirty()) {
+    // write a copy, so the page can be pinned and dirtied again while the
+    // write is in flight; the frame latch keeps it from being evicted first.
+    const std::size_t slot = io.acquire();
+    io.page(slot) = bufPool[frame];
+    entry.SetDirty(false);
+    batch.push_back(std::make_pair(frame, slot));
+    latches.push_back(std::move(latch));
+  }
+  return true;
+}
+
+void BufMgr::writeBatch(AsyncIo& io, std::vector<std::unique_lock<std::mutex> >& latches,
+                        std::vector<std::pair<FrameId, std::size_t> >& batch,
+                        std::atomic<std::uint64_t>& written)
+{
+  if (batch.empty())
+    return;
+  std::vector<std::size_t> position(io.depth());
+  std::vector<bool> submitted(batch.size(), false);
+  std::vector<bool> done(batch.size(), false);
+  // one log flush covers the whole batch.
+  Lsn lsn = 0;
+  for (std::size_t i = 0; i < batch.size(); ++i)
+    lsn = std::max(lsn, io.page(batch[i].second).lsn());
+  bool logged = true;
+  try {
+    forceLog(lsn);
+  } catch (...) {
+    logged = false;  // write nothing, so every page stays dirty.
+  }
+  if (logged) {
+    // hold off page allocation and deletion in the files until every write
+    // has completed: the next page pointers written are only current until
+    // then.
+    std::vector<File*> files;
+    std::vector<std::unique_ptr<File::WriteScope> > scopes;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+      File* file = bufDescTable[batch[i].first].file;
+      if (std::find(files.begin(), files.end(), file) == files.end()) {
+        files.push_back(file);
+        scopes.push_back(std::unique_ptr<File::WriteScope>(new File::WriteScope(*file)));
+      }
+    }
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+      const std::size_t slot = batch[i].second;
+      position[slot] = i;
+      try {
+        bufDescTable[batch[i].first].file->prepareWrite(io.page(slot), io.page(slot), io.request(slot));
+        io.submit(slot);
+        submitted[i] = true;
+      } catch (...) {
+        // deleted since it was dirtied; disposePage will free the frame.
+      }
+    }
+    try {
+      while (io.pending() != 0) {
+        const std::size_t slot = io.wait();
+        const std::size_t i = position[slot];
+        try {
+          bufDescTable[batch[i].first].file->finishWrite(io.page(slot), io.request(slot));
+          done[i] = true;
+        } catch (...) {
+        }
+      }
+    } catch (...) {
+      // the engine itself failed; treat the rest of the batch as not written.
+    }
+  }
+
+  for (std::size_t i = 0; i < batch.size(); ++i) {
+    BufDesc& entry = bufDescTable[batch[i].first];
+    // counted once the write has completed, so that a read started before it
+    // is not taken as current.
+    if (submitted[i])
+      fileWritten(entry.file);
+    if (done[i]) {
+      ++written;
+      ++bufStats.diskwrites;
+    } else {
+      // leave the page dirty; the eviction that needs the frame will retry the
+      // write and report the error to its caller.
+      std::lock_guard<std::mutex> guard(shardOf(entry.file, entry.pageNo).latch);
+      entry.SetDirty(true);
+    }
+    io.release(batch[i].second);
+  }
+  latches.clear();
+  batch.clear();
+}
+
+void BufMgr::allocBuf(FrameId & frame, std::unique_lock<std::mutex>& latch,
+                      const File* file, const PageId pageNo)
+{
+  Claimer claimer(*this, latch);
+  if (!policy->selectVictim(file, pageNo, claimer, frame))
+    throw BufferExceededException();
+}
+
+void BufMgr::allocRingBuf(FrameId & frame, std::unique_lock<std::mutex>& latch,
+                          const File* file, const PageId pageNo, BufAccessStrategy& strategy)
+{
+  FrameId& slot = strategy.ring[strategy.current];
+  strategy.current = (strategy.current + 1) % strategy.ring.size();
+
+  // reuse the frame of this slot unless another access has referenced it
+  // since we loaded it; then it belongs to the shared pool from now on.
+  if (slot != BufAccessStrategy::NO_FRAME && !bufDescTable[slot].isReferenced() &&
+      claimFrame(slot, latch)) {
+    frame = slot;
+    return;
+  }
+  allocBuf(frame, latch, file, pageNo);
+  slot = frame;
+}
+
+BufAccessStrategy BufMgr::getAccessStrategy(const BufferAccessType type) const
+{
+  std::uint32_t ringSize = 0;
+  if (type == ACCESS_SEQUENTIAL_SCAN)
+    ringSize = 32;    // 256 KB, small enough to stay in L2 cache
+  else if (type == ACCESS_BULK_WRITE)
+    ringSize = 2048;  // 16 MB, so write-backs of the ring are batched
+  if (ringSize > numBufs / 8)
+    ringSize = numBufs / 8;
+  return BufAccessStrategy(type, ringSize);
+}
+
+PageGuard::PageGuard(PageGuard&& other)
+  : mgr(other.mgr), page(other.page), dirty(other.dirty)
+{
+  other.page = NULL;
+}
+
+PageGuard& PageGuard::operator=(PageGuard&& other)
+{
+  if (this != &other) {
+    release();
+    mgr = other.mgr;
+    page = other.page;
+    dirty = other.dirty;
+    other.page = NULL;
+  }
+  return *this;
+}
+
+PageGuard::~PageGuard()
+{
+  release();
+}
+
+void PageGuard::release()
+{
+  if (page) {
+    Page* held = page;
+    page = NULL;
+    mgr->unPinPage(held, dirty);
+  }
+}
+
+PageGuard BufMgr::readPage(File* file, const PageId pageNo, BufAccessStrategy* strategy)
+{
+  Page* page = NULL;
+  readPage(file, pageNo, page, strategy);
+  return PageGuard(this, page);
+}
+
+PageGuard BufMgr::allocPage(File* file, PageId& pageNo, BufAccessStrategy* strategy)
+{
+  Page* page = NULL;
+  allocPage(file, pageNo, page, strategy);
+  PageGuard guard(this, page);
+  // new pages are allocated to be filled in.
+  guard.markDirty();
+  return guard;
+}
+  
+void BufMgr::readPage(File* file, const PageId pageNo, Page*& page, BufAccessStrategy* strategy) {
+  BufShard& shard = shardOf(file, pageNo);
+  std::unique_lock<std::mutex> guard;
+  lockShard(shard, guard);
+  FrameId id = numBufs;
+  ++bufStats.accesses;
+  bool missed = false;
+  for (;;) {
+    FileStats& fileStats = fileStatsOf(shard, file);
+    if (shard.hashTable->find(file, pageNo, id)) {
+      if (bufDescTable[id].isIoInProgress()) {
+        waitForIo(shard, id, guard);
+        continue;
+      }
+      // now we know there is already a buffer corresponding to the page to be read.
+      bufDescTable[id].Reference();
+      bufDescTable[id].Pin();
+      if (missed) {
+        // loaded by someone else while we claimed a frame for it.
+        guard.unlock();
+        policy->recordAccess(id);
+        break;
+      }
+      ++fileStats.hits;
+      guard.unlock();
+      BUFMGR_TRACE(TRACE_READ, file, pageNo, TraceRecord::HIT);
+      // the pin keeps the frame assigned to this page.
+      policy->recordAccess(id);
+      ++bufStats.hits;
+      if (readAheadPages != 0)
+        noteRead(file, pageNo);
+      page = &bufPool[id];
+      return;
+    }
+
     // there is no appropriate buffer, we have to allocate a new one.
-    FrameId id = numBufs;
-    allocBuf(id);
-    // associate the page with the new buffer.
-    bufPool[id] = file->readPage(pageNo);
-    // update mapping.
-    hashTable->insert(file, pageNo, id);
-    bufDescTable[id].Set(file, pageNo);
-    page = &bufPool[id];
+    if (!missed) {
+      ++bufStats.misses;
+      ++fileStats.misses;
+      missed = true;
+    }
+    if (loadPage(file, pageNo, shard, guard, id, strategy))
+      break;
   }
+  BUFMGR_TRACE(TRACE_READ, file, pageNo, 0);
+  if (readAheadPages != 0)
+    noteRead(file, pageNo);
+  page = &bufPool[id];
 }
 
+void BufMgr::readPages(File* file, const PageId* pageNos, const std::size_t count, Page** pages)
+{
+  std::vector<PageId> misses;
+  std::vector<std::size_t> missIndex;
+  for (std::size_t i = 0; i < count; i++)
+    pages[i] = NULL;
+  try {
+    for (std::size_t i = 0; i < count; i++) {
+      BufShard& shard = shardOf(file, pageNos[i]);
+      std::unique_lock<std::mutex> guard;
+      lockShard(shard, guard);
+      FrameId id = numBufs;
+      ++bufStats.accesses;
+      FileStats& fileStats = fileStatsOf(shard, file);
+      bool found;
+      while ((found = shard.hashTable->find(file, pageNos[i], id)) && bufDescTable[id].isIoInProgress())
+        waitForIo(shard, id, guard);
+      if (found) {
+        bufDescTable[id].Reference();
+        bufDescTable[id].Pin();
+        ++fileStats.hits;
+        guard.unlock();
+        BUFMGR_TRACE(TRACE_READ, file, pageNos[i], TraceRecord::HIT);
+        policy->recordAccess(id);
+        ++bufStats.hits;
+        pages[i] = &bufPool[id];
+      } else {
+        ++bufStats.misses;
+        ++fileStats.misses;
+        BUFMGR_TRACE(TRACE_READ, file, pageNos[i], 0);
+        misses.push_back(pageNos[i]);
+        missIndex.push_back(i);
+      }
+    }
+    if (!misses.empty()) {
+      // pin every page as its read completes; a page that could not be read
+      // this way is read again by loadPage, which throws the error.
+      AsyncIo io(ioEngineType, std::min<std::size_t>(misses.size(), ioQueueDepth));
+      readAsync(io, file, misses,
+                [&](std::size_t i, const Page* contents, std::uint64_t version) {
+                  pages[missIndex[i]] = &bufPool[pinPage(file, misses[i], contents, version)];
+                  return true;
+                });
+    }
+  } catch (...) {
+    for (std::size_t i = 0; i < count; i++) {
+      if (pages[i] != NULL) {
+        unPinPage(file, pageNos[i], false);
+        pages[i] = NULL;
+      }
+    }
+    throw;
+  }
+}
 
-void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
+bool BufMgr::loadPage(File* file, const PageId pageNo, BufShard& shard, std::unique_lock<std::mutex>& guard,
+                      FrameId& id, BufAccessStrategy* strategy, const Page* contents,
+                      const std::uint64_t version)
 {
+  // evicting the page in the frame claimed may write it back, which is not
+  // done under the shard latch; someone else may load the page meanwhile.
+  FrameId frame = numBufs;
+  std::unique_lock<std::mutex> latch;
+  const bool ring = strategy && strategy->type() != ACCESS_NORMAL;
+  guard.unlock();
+  if (ring)
+    allocRingBuf(frame, latch, file, pageNo, *strategy);
+  else
+    allocBuf(frame, latch, file, pageNo);
+  lockShard(shard, guard);
+  if (shard.hashTable->find(file, pageNo, id)) {
+    // give the empty frame back to the policy.
+    policy->recordRemove(frame);
+    return false;
+  }
+  // the page is not mapped, so nobody can write it while we hold the shard
+  // latch; if no page was written since <contents> was read, it is current.
+  if (contents && fileVersion != version)
+    contents = NULL;
+
+  // map the page before reading it, so that whoever looks it up meanwhile
+  // waits for the frame latch, which we hold until the page is in.
+  shard.hashTable->insert(file, pageNo, frame);
+  mapFrame(frame, file, pageNo, true /* loading */);
+  if (ring)
+    bufDescTable[frame].ClearReference();  // load it cold
+  policy->recordLoad(frame, file, pageNo);
+  guard.unlock();
+
   try {
-    FrameId id = numBufs;
-    hashTable->lookup(file, pageNo, id);
-    if (bufDescTable[id].pinCnt == 0)
-      throw PageNotPinnedException(file->filename(), pageNo, id);
-    --bufDescTable[id].pinCnt;
-    if (dirty)
-      bufDescTable[id].dirty = true;
-  } catch (HashNotFoundException& e) {
-    // no this page, do nothing
+    if (contents) {
+      bufPool[frame] = *contents;
+      // read from the file while the page was not resident; whatever the tier
+      // holds is the same.
+      if (secondaryCache)
+        secondaryCache->remove(file, pageNo);
+    } else if (secondaryCache && secondaryCache->take(file, pageNo, bufPool[frame])) {
+      ++bufStats.secondaryHits;
+    } else {
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      try {
+        file->readPage(pageNo, bufPool[frame]);
+      } catch (const CorruptPageException&) {
+        ++bufStats.checksumFailures;
+        throw;
+      }
+      bufStats.readLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start).count());
+      ++bufStats.diskreads;
+    }
+  } catch (...) {
+    // unmap the page again; whoever waited for it will not find it.
+    std::lock_guard<std::mutex> relock(shard.latch);
+    shard.hashTable->remove(file, pageNo);
+    clearFrame(bufDescTable[frame]);
+    policy->recordRemove(frame);
+    throw;
+  }
+  bufDescTable[frame].EndLoad();
+  id = frame;
+  return true;
+}
+
+
+void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
+{
+  BufShard& shard = shardOf(file, pageNo);
+  std::lock_guard<std::mutex> guard(shard.latch);
+  FrameId id = numBufs;
+  if (!shard.hashTable->find(file, pageNo, id))
+    return;  // no this page, do nothing
+  if (!bufDescTable[id].Unpin(dirty))
+    throw PageNotPinnedException(file->filename(), pageNo, id);
+  BUFMGR_TRACE(TRACE_UNPIN, file, pageNo, dirty ? TraceRecord::DIRTY : 0);
+}
+
+void BufMgr::unPinPage(const Page* page, const bool dirty)
+{
+  if (page < bufPool || page >= bufPool + numBufs)
+    throw BadBufferException(numBufs, dirty, false, false);
+  BufDesc& entry = bufDescTable[page - bufPool];
+  // the dirty flag is set in the same update that drops the pin, so it is
+  // seen by whoever evicts the frame once the pin is gone.
+  if (!entry.Unpin(dirty))
+    throw PageNotPinnedException(entry.file ? entry.file->filename() : std::string(),
+                                 page->page_number(), entry.frameNo);
+  BUFMGR_TRACE(TRACE_UNPIN, entry.file, page->page_number(), dirty ? TraceRecord::DIRTY : 0);
+}
+
+bool BufMgr::readPageOptimistic(File* file, const PageId pageNo, OptimisticRead& read)
+{
+  if (read.page >= bufPool && read.page < bufPool + numBufs) {
+    // the hint is right if the frame still holds the page and is not being
+    // written.  The identity fields may be changing under us; validateRead
+    // rejects the read if they were.
+    const BufDesc& entry = bufDescTable[read.page - bufPool];
+    const std::uint64_t version = entry.version.load(std::memory_order_acquire);
+    if ((version & 1) == 0 &&
+        __atomic_load_n(&entry.fileId, __ATOMIC_RELAXED) == file->id() &&
+        __atomic_load_n(&entry.pageNo, __ATOMIC_RELAXED) == pageNo) {
+      read.version = version;
+      return true;
+    }
   }
+
+  BufShard& shard = shardOf(file, pageNo);
+  std::lock_guard<std::mutex> guard(shard.latch);
+  FrameId id = numBufs;
+  if (!shard.hashTable->find(file, pageNo, id))
+    return false;
+  read.page = &bufPool[id];
+  read.version = bufDescTable[id].version.load(std::memory_order_acquire);
+  return (read.version & 1) == 0;
+}
+
+bool BufMgr::validateRead(const OptimisticRead& read) const
+{
+  // order the reads of the page before the second read of the version.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return bufDescTable[read.page - bufPool].version.load(std::memory_order_relaxed) == read.version;
+}
+
+void BufMgr::beginPageWrite(const Page* page)
+{
+  BufDesc& entry = bufDescTable[page - bufPool];
+  std::uint64_t version = entry.version.load(std::memory_order_relaxed);
+  for (;;) {
+    if (version & 1) {
+      // another writer of the page is not done yet.
+      std::this_thread::yield();
+      version = entry.version.load(std::memory_order_relaxed);
+    } else if (entry.version.compare_exchange_weak(version, version + 1,
+                                                   std::memory_order_relaxed)) {
+      break;
+    }
+  }
+  // keep the changes to the page from becoming visible before the version.
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void BufMgr::endPageWrite(const Page* page)
+{
+  BufDesc& entry = bufDescTable[page - bufPool];
+  entry.version.store(entry.version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
 }
 
 void BufMgr::flushFile(const File* file) 
 {
-  for (FrameId id = 0; id < numBufs; ++id) {
-    BufDesc& entry = bufDescTable[id];
-    if (entry.file != file)
-      continue;
-    if (!entry.valid) // has right data, but invalid
-      throw BadBufferException(id, entry.dirty, entry.valid, entry.refbit);
-    if (entry.pinCnt != 0)  // there is already no reference to this page
-      throw PagePinnedException(file->filename(), entry.pageNo, id);
-    if (entry.dirty)  // write it back if dirty(modified)
-      entry.file->writePage(bufPool[id]);
-    // free buffer
-    hashTable->remove(file, entry.pageNo);
-    entry.Clear();
+  cancelPrefetches(file);
+
+  // pages read through any File object for the file are flushed.
+  const FileId fileId = file->id();
+
+  // find the frames of the file from its list, in page order so that
+  // adjacent pages are written back together.
+  std::vector<std::pair<PageId, FrameId> > frames;
+  framesOf(fileId, frames);
+  for (std::size_t i = 0; i < frames.size(); ++i) {
+    BufDesc& entry = bufDescTable[frames[i].second];
+    std::lock_guard<std::mutex> latch(entry.latch);
+    if (entry.fileId != fileId || entry.pageNo != frames[i].first)
+      continue;  // evicted since we looked
+    if (!entry.isValid()) // has right data, but invalid
+      throw BadBufferException(entry.frameNo, entry.isDirty(), entry.isValid(), entry.isReferenced());
+    BufShard& shard = shardOf(file, entry.pageNo);
+    std::lock_guard<std::mutex> guard(shard.latch);
+    if (entry.pinCount() != 0)  // there is already no reference to this page
+      throw PagePinnedException(file->filename(), entry.pageNo, entry.frameNo);
   }
+  std::sort(frames.begin(), frames.end());
+
+  // write back and free the frames a batch at a time.  Latches of a batch are
+  // taken in frame order, so two flushes cannot deadlock.  A batch is kept
+  // small enough that its latches and a shard latch stay within the 64 locks
+  // a thread may hold at once under ThreadSanitizer's deadlock detector.
+  const std::size_t batch = 32;
+  std::vector<FrameId> order;
+  std::vector<Page> dirty;
+  for (std::size_t begin = 0; begin < frames.size(); begin += batch) {
+    const std::size_t end = std::min(begin + batch, frames.size());
+    order.clear();
+    for (std::size_t i = begin; i < end; ++i)
+      order.push_back(frames[i].second);
+    std::sort(order.begin(), order.end());
+    std::vector<std::unique_lock<std::mutex> > latches;
+    for (std::size_t i = 0; i < order.size(); ++i)
+      latches.push_back(std::unique_lock<std::mutex>(bufDescTable[order[i]].latch));
+
+    dirty.clear();
+    for (std::size_t i = begin; i < end; ++i) {
+      BufDesc& entry = bufDescTable[frames[i].second];
+      if (!entry.isValid() || entry.fileId != fileId || entry.pageNo != frames[i].first)
+        continue;  // evicted since we looked
+      std::lock_guard<std::mutex> guard(shardOf(file, entry.pageNo).latch);
+      if (entry.pinCount() != 0)
+        throw PagePinnedException(file->filename(), entry.pageNo, entry.frameNo);
+      if (entry.isDirty())  // write it back if dirty(modified)
+        dirty.push_back(bufPool[entry.frameNo]);
+    }
+    if (!dirty.empty()) {
+      Lsn lsn = 0;
+      for (std::size_t i = 0; i < dirty.size(); ++i)
+        lsn = std::max(lsn, dirty[i].lsn());
+      forceLog(lsn);
+      bufDescTable[frames[begin].second].file->writePages(&dirty[0], dirty.size());
+      bufStats.diskwrites += dirty.size();
+      fileWritten(bufDescTable[frames[begin].second].file);
+    }
+
+    for (std::size_t i = begin; i < end; ++i) {
+      BufDesc& entry = bufDescTable[frames[i].second];
+      if (!entry.isValid() || entry.fileId != fileId || entry.pageNo != frames[i].first)
+        continue;
+      BufShard& shard = shardOf(file, entry.pageNo);
+      std::lock_guard<std::mutex> guard(shard.latch);
+      if (entry.pinCount() != 0)
+        throw PagePinnedException(file->filename(), entry.pageNo, entry.frameNo);
+      // free buffer
+      shard.hashTable->remove(file, entry.pageNo);
+      clearFrame(entry);
+      policy->recordRemove(entry.frameNo);
+    }
+  }
+
+  releaseFile(file);
 }
 
-void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
+void BufMgr::dropFile(const File* file)
 {
-  Page&& new_page = file->allocatePage();
+  cancelPrefetches(file);
+  const FileId fileId = file->id();
+  std::vector<std::pair<PageId, FrameId> > frames;
+  framesOf(fileId, frames);
+  // check every page first, so that a pinned one leaves the pool unchanged.
+  for (int pass = 0; pass < 2; ++pass) {
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+      BufDesc& entry = bufDescTable[frames[i].second];
+      std::lock_guard<std::mutex> latch(entry.latch);
+      if (!entry.isValid() || entry.fileId != fileId || entry.pageNo != frames[i].first)
+        continue;  // evicted since we looked
+      BufShard& shard = shardOf(file, entry.pageNo);
+      std::lock_guard<std::mutex> guard(shard.latch);
+      if (entry.pinCount() != 0)
+        throw PagePinnedException(file->filename(), entry.pageNo, entry.frameNo);
+      if (pass == 1) {
+        shard.hashTable->remove(file, entry.pageNo);
+        clearFrame(entry);
+        policy->recordRemove(entry.frameNo);
+      }
+    }
+  }
+  releaseFile(file);
+}
+
+void BufMgr::cancelPrefetches(const File* file)
+{
+  // the file may be closed once its pages are gone, so make sure the
+  // prefetcher is done with it.
+  std::unique_lock<std::mutex> guard(prefetchMutex);
+  for (std::deque<PrefetchRequest>::iterator it = prefetchQueue.begin(); it != prefetchQueue.end(); ) {
+    if (it->file->id() == file->id())
+      it = prefetchQueue.erase(it);
+    else
+      ++it;
+  }
+  readAheadState.erase(file);
+  while (prefetchBusy != NULL && prefetchBusy->id() == file->id())
+    prefetchDone.wait(guard);
+}
+
+void BufMgr::framesOf(const FileId fileId, std::vector<std::pair<PageId, FrameId> >& frames)
+{
+  std::lock_guard<std::mutex> guard(fileFramesLatch);
+  const std::unordered_map<FileId, FrameId>::const_iterator head = fileFrames.find(fileId);
+  for (FrameId id = head == fileFrames.end() ? BufDesc::NO_FRAME : head->second;
+       id != BufDesc::NO_FRAME; id = bufDescTable[id].nextInFile)
+    frames.push_back(std::make_pair(bufDescTable[id].pageNo, id));
+}
+
+void BufMgr::releaseFile(const File* file)
+{
+  // pages are known by the id of their file, which a file opened later may
+  // reuse once this one is closed.
+  if (secondaryCache)
+    secondaryCache->removeFile(file);
+  for (std::uint32_t i = 0; i < numShards; i++) {
+    std::lock_guard<std::mutex> guard(shards[i].latch);
+    shards[i].fileStats.erase(file);
+  }
+#if BADGERDB_TRACE
+  if (TraceRecorder* recorder = tracer.load())
+    recorder->forgetFile(file);
+#endif
+
+  // the file may be closed now, so later checkpoints must not sync it.
+  std::lock_guard<std::mutex> guard(unsyncedLatch);
+  unsyncedFiles.erase(const_cast<File*>(file));
+}
+
+void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page, BufAccessStrategy* strategy) 
+{
+  // the page number, and so the shard, is only known once the page exists, so
+  // claim an empty frame first and let the file fill it in place.
   FrameId fid = numBufs;
-  allocBuf(fid);
+  ++bufStats.accesses;
+  std::unique_lock<std::mutex> latch;
+  const bool ring = strategy && strategy->type() != ACCESS_NORMAL;
+  if (ring)
+    allocRingBuf(fid, latch, file, Page::INVALID_NUMBER, *strategy);
+  else
+    allocBuf(fid, latch, file, Page::INVALID_NUMBER);
+  try {
+    file->allocatePage(bufPool[fid]);
+    fileWritten(file);
+  } catch (...) {
+    // give the empty frame back to the policy.
+    policy->recordRemove(fid);
+    throw;
+  }
+  pageNo = bufPool[fid].page_number();
   // associate new page with new buffer.
-  hashTable->insert(file, new_page.page_number(), fid);
-  bufDescTable[fid].Set(file, new_page.page_number());
-  bufPool[fid] = new_page;
+  BufShard& shard = shardOf(file, pageNo);
+  std::lock_guard<std::mutex> guard(shard.latch);
+  shard.hashTable->insert(file, pageNo, fid);
+  mapFrame(fid, file, pageNo);
+  if (ring)
+    bufDescTable[fid].ClearReference();  // load it cold
+  policy->recordLoad(fid, file, pageNo);
   page = &bufPool[fid];
-  pageNo = new_page.page_number();
+  BUFMGR_TRACE(TRACE_ALLOC, file, pageNo, 0);
+}
+
+std::vector<PageId> BufMgr::usedPages(File* file)
+{
+  return file->usedPages();
 }
 
 void BufMgr::disposePage(File* file, const PageId PageNo)
 {
+  BUFMGR_TRACE(TRACE_DISPOSE, file, PageNo, 0);
   file->deletePage(PageNo);
-  try {
+  fileWritten(file);
+  BufShard& shard = shardOf(file, PageNo);
+  FrameId fid = numBufs;
+  {
     // see if there is any buffer corresponding to the page.
-    FrameId fid = numBufs;
-    hashTable->lookup(file, PageNo, fid);
+    std::lock_guard<std::mutex> guard(shard.latch);
+    if (secondaryCache)
+      secondaryCache->remove(file, PageNo);
+    if (!shard.hashTable->find(file, PageNo, fid))
+      return;  // no that buffer, do nothing
+  }
+
+  // now we know there is, free the buffer.  The frame latch has to be taken
+  // before the shard latch, so check the mapping again once both are held.
+  BufDesc& entry = bufDescTable[fid];
+  std::lock_guard<std::mutex> latch(entry.latch);
+  std::lock_guard<std::mutex> guard(shard.latch);
+  if (entry.isValid() && entry.fileId == file->id() && entry.pageNo == PageNo) {
+    shard.hashTable->remove(file, PageNo);
+    clearFrame(entry);
+    policy->recordRemove(fid);
+  }
+}
 
-    // now we know there is, free the buffer.
-    hashTable->remove(file, PageNo);
-    bufDescTable[fid].Clear();
-  } catch (HashNotFoundException& e) {
-    // no that buffer, do nothing
+void BufMgr::mapFrame(const FrameId frame, File* file, const PageId pageNo, const bool loading)
+{
+  BufDesc& entry = bufDescTable[frame];
+  entry.Set(file, pageNo, loading);
+  std::lock_guard<std::mutex> guard(fileFramesLatch);
+  FrameId& head = fileFrames.insert(std::make_pair(entry.fileId, BufDesc::NO_FRAME)).first->second;
+  entry.prevInFile = BufDesc::NO_FRAME;
+  entry.nextInFile = head;
+  if (head != BufDesc::NO_FRAME)
+    bufDescTable[head].prevInFile = frame;
+  head = frame;
+}
+
+void BufMgr::clearFrame(BufDesc& entry)
+{
+  if (entry.fileId != File::INVALID_ID) {
+    std::lock_guard<std::mutex> guard(fileFramesLatch);
+    if (entry.nextInFile != BufDesc::NO_FRAME)
+      bufDescTable[entry.nextInFile].prevInFile = entry.prevInFile;
+    if (entry.prevInFile != BufDesc::NO_FRAME) {
+      bufDescTable[entry.prevInFile].nextInFile = entry.nextInFile;
+    } else if (entry.nextInFile != BufDesc::NO_FRAME) {
+      fileFrames[entry.fileId] = entry.nextInFile;
+    } else {
+      fileFrames.erase(entry.fileId);
+    }
+    entry.prevInFile = entry.nextInFile = BufDesc::NO_FRAME;
+  }
+  entry.Clear();
+}
+
+bool BufMgr::retireFrame(const FrameId frame)
+{
+  BufDesc& entry = bufDescTable[frame];
+  std::lock_guard<std::mutex> latch(entry.latch);
+  if (!entry.isValid()) {
+    clearFrame(entry);
+    return true;
+  }
+  BufShard& shard = shardOf(entry.file, entry.pageNo);
+  std::unique_lock<std::mutex> guard(shard.latch);
+  if (entry.pinCount() != 0)
+    return false;
+  writeOut(frame, guard, true);
+  shard.hashTable->remove(entry.file, entry.pageNo);
+  clearFrame(entry);
+  return true;
+}
+
+std::uint32_t BufMgr::resize(const std::uint32_t newBufs)
+{
+  if (newBufs == 0 || newBufs > maxBufs)
+    throw BufferExceededException();
+  std::lock_guard<std::mutex> guard(resizeMutex);
+  const std::uint32_t oldBufs = numBufs;
+  if (newBufs > oldBufs) {
+    // the new frames are empty; the policy offers them once claims are allowed.
+    for (FrameId i = oldBufs; i < newBufs; i++)
+      new (&bufPool[i]) Page();
+    numBufs = newBufs;
+    activeBufs = newBufs;
+    policy->resize(newBufs);
+  } else if (newBufs < oldBufs) {
+    // refuse claims of the frames given up first, then empty them from the
+    // top, so that the pool stays one run of frames.
+    activeBufs = newBufs;
+    FrameId top = oldBufs;
+    while (top > newBufs && retireFrame(top - 1))
+      --top;
+    activeBufs = top;
+    policy->resize(top);
+    numBufs = top;
+    arena->discard(top, oldBufs);
+  }
+
+  const int htsize = (numBufs / numShards + 1) * 2;
+  for (std::uint32_t i = 0; i < numShards; i++) {
+    std::lock_guard<std::mutex> latch(shards[i].latch);
+    shards[i].hashTable->resize(htsize);
+  }
+  return numBufs;
+}
+
+BufStatsSnapshot BufMgr::getStatsSnapshot()
+{
+  BufStatsSnapshot snapshot;
+  snapshot.accesses = bufStats.accesses;
+  snapshot.hits = bufStats.hits;
+  snapshot.misses = bufStats.misses;
+  snapshot.diskreads = bufStats.diskreads;
+  snapshot.diskwrites = bufStats.diskwrites;
+  snapshot.allocations = bufStats.allocations;
+  snapshot.evictions = bufStats.evictions;
+  snapshot.victimCandidates = bufStats.victimCandidates;
+  snapshot.pinWaitNanos = bufStats.pinWaitNanos;
+  snapshot.backgroundWrites = bufStats.backgroundWrites;
+  snapshot.evictionWrites = bufStats.evictionWrites;
+  snapshot.prefetches = bufStats.prefetches;
+  snapshot.checkpoints = bufStats.checkpoints;
+  snapshot.checkpointWrites = bufStats.checkpointWrites;
+  snapshot.checkpointSkips = bufStats.checkpointSkips;
+  snapshot.checksumFailures = bufStats.checksumFailures;
+  snapshot.secondaryHits = bufStats.secondaryHits;
+  snapshot.secondaryStores = bufStats.secondaryStores;
+  snapshot.readLatency = bufStats.readLatency.snapshot();
+  snapshot.writeLatency = bufStats.writeLatency.snapshot();
+  snapshot.policy = bufStats.policy;
+
+  // the pages of a file are spread over every shard.
+  std::unordered_map<const File*, std::size_t> index;
+  for (std::uint32_t i = 0; i < numShards; i++) {
+    std::lock_guard<std::mutex> guard(shards[i].latch);
+    for (std::unordered_map<const File*, FileStats>::const_iterator it = shards[i].fileStats.begin();
+         it != shards[i].fileStats.end(); ++it) {
+      std::unordered_map<const File*, std::size_t>::iterator found = index.find(it->first);
+      if (found == index.end()) {
+        index[it->first] = snapshot.files.size();
+        snapshot.files.push_back(it->second);
+        continue;
+      }
+      FileStats& total = snapshot.files[found->second];
+      total.hits += it->second.hits;
+      total.misses += it->second.misses;
+      total.evictions += it->second.evictions;
+      total.evictionWrites += it->second.evictionWrites;
+    }
+  }
+  std::sort(snapshot.files.begin(), snapshot.files.end(),
+            [](const FileStats& lhs, const FileStats& rhs) {
+              return lhs.hits + lhs.misses > rhs.hits + rhs.misses;
+            });
+  return snapshot;
+}
+
+void BufMgr::clearBufStats()
+{
+  bufStats.clear();
+  for (std::uint32_t i = 0; i < numShards; i++) {
+    std::lock_guard<std::mutex> guard(shards[i].latch);
+    shards[i].fileStats.clear();
   }
 }
 
@@ -192,7 +1732,7 @@ void BufMgr::printSelf(void)
     std::cout << "FrameNo:" << i << " ";
     tmpbuf->Print();
 
-    if (tmpbuf->valid == true)
+    if (tmpbuf->isValid())
       validFrames++;
   }
 
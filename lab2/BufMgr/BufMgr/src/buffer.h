@@ -7,8 +7,26 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include "file.h"
 #include "bufHashTbl.h"
+#include "buffer_arena.h"
+#include "io_engine.h"
+#include "latency_histogram.h"
+#include "log_manager.h"
+#include "replacement_policy.h"
+#include "secondary_cache.h"
+#include "trace.h"
 
 namespace badgerdb {
 
@@ -17,6 +35,45 @@ namespace badgerdb {
 */
 class BufMgr;
 
+/**
+* @brief Bits of the state word of a frame.  The words of all frames are packed
+* in one array apart from the descriptors, so that the clock sweep reads sixteen
+* frames per cache line.
+*/
+struct BufState
+{
+	/**
+   * Has this buffer frame been referenced recently
+	 */
+  static const std::uint32_t REF = 1u << 0;
+
+	/**
+   * The page is dirty.  Set before the pin that dirtied it is dropped.
+	 */
+  static const std::uint32_t DIRTY = 1u << 1;
+
+	/**
+   * The frame holds a page
+	 */
+  static const std::uint32_t VALID = 1u << 2;
+
+	/**
+   * The page is being read into the frame or written out of it by the holder
+   * of the frame latch.  The frame is not pinned meanwhile; whoever looks the
+   * page up waits for the frame latch and looks again.
+	 */
+  static const std::uint32_t IO = 1u << 3;
+
+	/**
+   * Number of times the page has been pinned, in the bits above the flags.
+   * Only incremented while holding the lock of the page table shard that maps
+   * the frame; a holder of a pin may drop it without the lock.
+	 */
+  static const std::uint32_t PIN_SHIFT = 8;
+  static const std::uint32_t PIN_ONE = 1u << PIN_SHIFT;
+  static const std::uint32_t PIN_MASK = ~(PIN_ONE - 1);
+};
+
 /**
 * @brief Class for maintaining information about buffer pool frames
 */
@@ -25,11 +82,22 @@ class BufDesc {
 	friend class BufMgr;
 
  private:
+	/**
+   * Link of no frame
+	 */
+  static const FrameId NO_FRAME = 0xffffffff;
+
 	/**
    * Pointer to file to which corresponding frame is assigned
 	 */
   File* file;
 
+	/**
+   * Id of <file>, or File::INVALID_ID; pages of a file are its whichever File
+   * object they were read through
+	 */
+  FileId fileId;
+
 	/**
    * Page within file to which corresponding frame is assigned
 	 */
@@ -40,37 +108,119 @@ class BufDesc {
 	 */
   FrameId	frameNo;
 
+	/**
+   * Neighbours of the frame in the list of frames holding pages of its file,
+   * or NO_FRAME; only used under BufMgr::fileFramesLatch
+	 */
+  FrameId prevInFile;
+  FrameId nextInFile;
+
+	/**
+   * State word of the frame, with its pin count and BufState flags
+	 */
+  std::atomic<std::uint32_t>* state;
+
+	/**
+   * Per-frame latch.  Held while the frame is being claimed, evicted or assigned
+   * to a page, and until its page has been read in, so the file, pageNo and
+   * valid flag only change while both this latch and the lock of the owning
+   * page table shard are held.
+	 */
+  std::mutex latch;
+
+	/**
+   * Sequence number validating optimistic reads of this frame.  Odd while the
+   * frame holds no page or its page is being written between beginPageWrite
+   * and endPageWrite; it changes whenever the page or its contents change.
+	 */
+  std::atomic<std::uint64_t> version;
+
 	/**
    * Number of times this page has been pinned
 	 */
-  int pinCnt;
+  std::uint32_t pinCount() const { return state->load() >> BufState::PIN_SHIFT; }
+
+	/**
+   * True if page is valid
+	 */
+  bool isValid() const { return (state->load() & BufState::VALID) != 0; }
 
 	/**
    * True if page is dirty;  false otherwise
 	 */
-  bool dirty;
+  bool isDirty() const { return (state->load() & BufState::DIRTY) != 0; }
 
 	/**
-   * True if page is valid
+   * True if the frame has been referenced recently
+	 */
+  bool isReferenced() const { return (state->load(std::memory_order_relaxed) & BufState::REF) != 0; }
+
+	/**
+   * True if the page is being read in or written out
+	 */
+  bool isIoInProgress() const { return (state->load() & BufState::IO) != 0; }
+
+	/**
+   * Marks the page as being written out, or done with.  The caller holds the
+   * frame latch for as long as the mark is set.
+	 */
+  void SetIo(const bool io)
+	{
+    if (io)
+      state->fetch_or(BufState::IO);
+    else
+      state->fetch_and(~BufState::IO);
+  }
+
+	/**
+   * Adds a pin.  The caller must hold the lock of the shard mapping the frame.
+	 */
+  void Pin() { state->fetch_add(BufState::PIN_ONE); }
+
+	/**
+   * Drops a pin, marking the page dirty first if <dirty>, in one update of the
+   * state word.  Returns false, changing nothing, if the page is not pinned.
+	 */
+  bool Unpin(const bool dirty)
+	{
+    std::uint32_t old = state->load();
+    do {
+      if ((old & BufState::PIN_MASK) == 0)
+        return false;
+    } while (!state->compare_exchange_weak(old, (old | (dirty ? BufState::DIRTY : 0)) - BufState::PIN_ONE));
+    return true;
+  }
+
+	/**
+   * Marks the page dirty, or clean once it has been written back
 	 */
-  bool valid;
+  void SetDirty(const bool dirty)
+	{
+    if (dirty)
+      state->fetch_or(BufState::DIRTY);
+    else
+      state->fetch_and(~BufState::DIRTY);
+  }
 
 	/**
-   * Has this buffer frame been reference recently
+	 * Clears the reference bit, so the page is evicted on the next sweep unless
+	 * someone references it first
 	 */
-  bool refbit;
+  void ClearReference() { state->fetch_and(~BufState::REF, std::memory_order_relaxed); }
 
 	/**
    * Initialize buffer frame for a new user
 	 */
   void Clear()
 	{
-    pinCnt = 0;
+    // make the version odd before any field or the page contents change.
+    if ((version.load(std::memory_order_relaxed) & 1) == 0)
+      version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    state->store(0);
 		file = NULL;
+    fileId = File::INVALID_ID;
 		pageNo = Page::INVALID_NUMBER;
-    dirty = false;
-    refbit = false;
-		valid = false;
   };
 
 	/**
@@ -79,15 +229,36 @@ class BufDesc {
 	 *
 	 * @param filePtr	File object
 	 * @param pageNum	Page number in the file
+	 * @param loading	Whether the page is yet to be read in, see EndLoad()
 	 */
-  void Set(File* filePtr, PageId pageNum)
+  void Set(File* filePtr, PageId pageNum, const bool loading = false)
 	{ 
 		file = filePtr;
+    fileId = filePtr->id();
     pageNo = pageNum;
-    pinCnt = 1;
-    dirty = false;
-    valid = true;
-    refbit = true;
+    state->store(BufState::VALID | BufState::REF | BufState::PIN_ONE | (loading ? BufState::IO : 0));
+    // publish the page to optimistic readers.
+    if (!loading)
+      version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+	/**
+	 * Publishes a page set loading once it has been read into the frame
+	 */
+  void EndLoad()
+	{
+    state->fetch_and(~BufState::IO);
+    version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+	/**
+	 * Sets the reference bit on a hit.  The bit is only written if it is clear,
+	 * so hits on a hot frame do not keep taking its cache line away from other cores.
+	 */
+  void Reference()
+	{
+    if (!isReferenced())
+      state->fetch_or(BufState::REF, std::memory_order_relaxed);
   }
 
   void Print()
@@ -100,17 +271,22 @@ class BufDesc {
 		else
 			std::cout << "file:NULL ";
 
-		std::cout << "valid:" << valid << " ";
-		std::cout << "pinCnt:" << pinCnt << " ";
-		std::cout << "dirty:" << dirty << " ";
-		std::cout << "refbit:" << refbit << "\n";
+		std::cout << "valid:" << isValid() << " ";
+		std::cout << "pinCnt:" << pinCount() << " ";
+		std::cout << "dirty:" << isDirty() << " ";
+		std::cout << "refbit:" << isReferenced() << "\n";
   }
 
 	/**
    * Constructor of BufDesc class 
+	 *
+	 * @param stateWord	State word of the frame
 	 */
-  BufDesc()
+  explicit BufDesc(std::atomic<std::uint32_t>* stateWord)
 	{
+    state = stateWord;
+    version = 1;
+    prevInFile = nextInFile = NO_FRAME;
   	Clear();
   }
 };
@@ -124,30 +300,141 @@ struct BufStats
 	/**
    * Total number of accesses to buffer pool
 	 */
-  int accesses;
+  std::atomic<std::uint64_t> accesses;
+
+	/**
+   * Number of readPage calls served by a page already in the buffer pool
+	 */
+  std::atomic<std::uint64_t> hits;
+
+	/**
+   * Number of readPage calls that had to read the page from disk
+	 */
+  std::atomic<std::uint64_t> misses;
 
 	/**
-   * Number of pages read from disk (including allocs)
+   * Number of pages read from disk, by misses and by the prefetcher
 	 */
-  int diskreads;
+  std::atomic<std::uint64_t> diskreads;
 
 	/**
    * Number of pages written back to disk
 	 */
-  int diskwrites;
+  std::atomic<std::uint64_t> diskwrites;
+
+	/**
+   * Number of frames claimed for a page being read or allocated
+	 */
+  std::atomic<std::uint64_t> allocations;
+
+	/**
+   * Number of valid pages evicted to free a frame
+	 */
+  std::atomic<std::uint64_t> evictions;
+
+	/**
+   * Number of frames the replacement policy offered as victims, claimed or
+   * not; with the clock policy, the frames the hand stopped at.  Divided by
+   * allocations, how hard it is to find a frame
+	 */
+  std::atomic<std::uint64_t> victimCandidates;
+
+	/**
+   * Nanoseconds readPage spent waiting for shard latches held by other
+   * threads, and for pages other threads were reading in or writing out
+	 */
+  std::atomic<std::uint64_t> pinWaitNanos;
+
+	/**
+   * Latency of the page reads of misses, one File::readPage call each
+	 */
+  LatencyRecorder readLatency;
+
+	/**
+   * Latency of the write-backs of single pages by evictions, one
+   * File::writePage call each; batched writes are not timed
+	 */
+  LatencyRecorder writeLatency;
+
+	/**
+   * Number of dirty pages written back by the background writer
+	 */
+  std::atomic<std::uint64_t> backgroundWrites;
+
+	/**
+   * Number of dirty victims allocBuf had to write back itself
+	 */
+  std::atomic<std::uint64_t> evictionWrites;
+
+	/**
+   * Number of pages loaded ahead of time by the prefetcher
+	 */
+  std::atomic<std::uint64_t> prefetches;
+
+	/**
+   * Number of checkpoint rounds run; concurrent checkpoint calls share rounds
+	 */
+  std::atomic<std::uint64_t> checkpoints;
+
+	/**
+   * Number of dirty pages written back by checkpoints
+	 */
+  std::atomic<std::uint64_t> checkpointWrites;
+
+	/**
+   * Number of dirty pages checkpoints left behind because they were pinned
+   * or could not be written
+	 */
+  std::atomic<std::uint64_t> checkpointSkips;
+
+	/**
+   * Number of pages read from disk that did not match their checksum
+	 */
+  std::atomic<std::uint64_t> checksumFailures;
+
+	/**
+   * Number of misses served by the secondary cache instead of a disk read
+	 */
+  std::atomic<std::uint64_t> secondaryHits;
+
+	/**
+   * Number of evicted pages stored in the secondary cache
+	 */
+  std::atomic<std::uint64_t> secondaryStores;
+
+	/**
+   * Name of the replacement policy these statistics were collected under
+	 */
+  const char* policy;
 
 	/**
    * Clear all values 
 	 */
   void clear()
   {
-		accesses = diskreads = diskwrites = 0;
+		accesses = hits = misses = diskreads = diskwrites = 0;
+		backgroundWrites = evictionWrites = prefetches = 0;
+		checkpoints = checkpointWrites = checkpointSkips = checksumFailures = 0;
+		secondaryHits = secondaryStores = 0;
+		allocations = evictions = victimCandidates = pinWaitNanos = 0;
+		readLatency.clear();
+		writeLatency.clear();
+  }
+
+	/**
+   * Fraction of readPage calls that were hits, or 0 if there were none
+	 */
+  double hitRate() const
+  {
+		const std::uint64_t total = hits + misses;
+		return total == 0 ? 0.0 : static_cast<double>(hits) / total;
   }
       
 	/**
    * Constructor of BufStats class 
 	 */
   BufStats()
+    : policy("")
   {
 		clear();
   }
@@ -155,136 +442,1413 @@ struct BufStats
 
 
 /**
-* @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+* @brief Usage of the buffer pool by the pages of one file, counted under the
+* latches of the shards the pages are in
 */
-class BufMgr 
+struct FileStats
 {
- private:
 	/**
-   * Current position of clockhand in our buffer pool
+   * Name of the file
 	 */
-  FrameId clockHand;
+  std::string filename;
 
 	/**
-   * Number of frames in the buffer pool
+   * Number of reads of pages of the file served by the buffer pool
 	 */
-  std::uint32_t numBufs;
-	
+  std::uint64_t hits;
+
 	/**
-   * Hash table mapping (File, page) to frame
+   * Number of reads of pages of the file that had to load them
 	 */
-  BufHashTbl *hashTable;
+  std::uint64_t misses;
 
 	/**
-   * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
+   * Number of pages of the file evicted to free a frame
 	 */
-  BufDesc *bufDescTable;
+  std::uint64_t evictions;
 
 	/**
-   * Maintains Buffer pool usage statistics 
+   * Number of evicted pages of the file that had to be written back first
 	 */
-  BufStats bufStats;
+  std::uint64_t evictionWrites;
 
 	/**
-   * Advance clock to next frame in the buffer pool
+   * Constructor of FileStats class 
 	 */
-  void advanceClock();
+  FileStats()
+    : hits(0), misses(0), evictions(0), evictionWrites(0)
+  {
+  }
+};
+
+
+/**
+* @brief Copy of the statistics of a buffer pool at one moment, see BufStats.
+* Counters are read one by one while the pool runs, so they may be a few
+* operations apart from each other
+*/
+struct BufStatsSnapshot
+{
+  std::uint64_t accesses;
+  std::uint64_t hits;
+  std::uint64_t misses;
+  std::uint64_t diskreads;
+  std::uint64_t diskwrites;
+  std::uint64_t allocations;
+  std::uint64_t evictions;
+  std::uint64_t victimCandidates;
+  std::uint64_t pinWaitNanos;
+  std::uint64_t backgroundWrites;
+  std::uint64_t evictionWrites;
+  std::uint64_t prefetches;
+  std::uint64_t checkpoints;
+  std::uint64_t checkpointWrites;
+  std::uint64_t checkpointSkips;
+  std::uint64_t checksumFailures;
+  std::uint64_t secondaryHits;
+  std::uint64_t secondaryStores;
+  LatencyHistogram readLatency;
+  LatencyHistogram writeLatency;
+  const char* policy;
 
 	/**
-	 * Allocate a free frame.  
-	 *
-	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
-	 * @throws BufferExceededException If no such buffer is found which can be allocated
+   * Usage per file read through the pool since it was last flushed with
+   * flushFile, busiest first
 	 */
-  void allocBuf(FrameId & frame);
+  std::vector<FileStats> files;
 
- public:
 	/**
-   * Actual buffer pool from which frames are allocated
+   * Fraction of readPage calls that were hits, or 0 if there were none
 	 */
-  Page* bufPool;
+  double hitRate() const
+  {
+		const std::uint64_t total = hits + misses;
+		return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+  }
 
 	/**
-   * Constructor of BufMgr class
+   * Average number of frames the policy offered per allocation, or 0 if there
+   * were none
 	 */
-  BufMgr(std::uint32_t bufs);
-	
+  double candidatesPerAllocation() const
+  {
+		return allocations == 0 ? 0.0 : static_cast<double>(victimCandidates) / allocations;
+  }
+};
+
+
+/**
+* @brief Settings of a BufMgr that are fixed at construction
+*/
+struct BufMgrOptions
+{
 	/**
-   * Destructor of BufMgr class
+   * Number of shards the page table is partitioned into
 	 */
-  ~BufMgr();
+  std::uint32_t numShards;
 
 	/**
-	 * Reads the given page from the file into a frame and returns the pointer to page.
-	 * If the requested page is already present in the buffer pool pointer to that frame is returned
-	 * otherwise a new frame is allocated from the buffer pool for reading the page.
-	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number in the file to be read
-	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+   * Replacement policy used to pick frames in allocBuf
 	 */
-  void readPage(File* file, const PageId PageNo, Page*& page);
+  ReplacementPolicyType policy;
 
 	/**
-	 * Unpin a page from memory since it is no longer required for it to remain in memory.
-	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number
-	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
-   * @throws  PageNotPinnedException If the page is not already pinned
+   * Number of accesses remembered per page by the LRU-K policy
 	 */
-  void unPinPage(File* file, const PageId PageNo, const bool dirty);
+  std::uint32_t lruK;
 
 	/**
-	 * Allocates a new, empty page in the file and returns the Page object.
-	 * The newly allocated page is also assigned a frame in the buffer pool.
-	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
-	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+   * Milliseconds the background writer sleeps between rounds; 0 disables it
 	 */
-  void allocPage(File* file, PageId &PageNo, Page*& page); 
+  std::uint32_t bgWriterDelayMs;
 
 	/**
-	 * Writes out all dirty pages of the file to disk.
-	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
-	 * Otherwise Error returned.
-	 *
-	 * @param file   	File object
-   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool 
-   * @throws BadBufferException If any frame allocated to the file is found to be invalid
+   * Number of clean, unpinned frames the background writer tries to keep
+   * among the next victims of the replacement policy
 	 */
-  void flushFile(const File* file);
+  std::uint32_t bgWriterCleanTarget;
 
 	/**
-	 * Delete page from file and also from buffer pool if present.
-	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
-	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number
+   * Maximum number of pages the background writer writes back per round
 	 */
-  void disposePage(File* file, const PageId PageNo);
+  std::uint32_t bgWriterMaxPages;
 
 	/**
-   * Print member variable values. 
+   * Number of pages read ahead once readPage sees sequential access to a
+   * file; 0 disables sequential read-ahead
 	 */
-  void  printSelf();
+  std::uint32_t readAheadPages;
 
 	/**
-   * Get buffer pool usage statistics
+   * Backend the prefetcher, the background writer and readPages keep their
+   * reads and writes in flight with
 	 */
-  BufStats & getBufStats()
-  {
-		return bufStats;
-  }
+  IoEngineType ioEngine;
+
+	/**
+   * Maximum number of reads or writes each of them keeps in flight
+	 */
+  std::uint32_t ioQueueDepth;
+
+	/**
+   * Write-ahead log the pages are changed under, or NULL.  With a log, a page
+   * is only written back once the log is durable up to the page's LSN; the
+   * log must outlive the BufMgr
+	 */
+  LogManager* log;
+
+	/**
+   * Pages the frames and their descriptors are backed by
+	 */
+  HugePageMode hugePages;
+
+	/**
+   * How the frames and their descriptors are spread over the NUMA nodes
+	 */
+  NumaPlacement numaPlacement;
+
+	/**
+   * Most frames resize can grow the pool to; the arena reserves, but does not
+   * touch, memory for them.  0 means the initial number of frames
+	 */
+  std::uint32_t maxBufs;
+
+	/**
+   * File the resident pages are saved to with saveResidentPages when the
+   * BufMgr is destroyed, and every warmupSaveMs, for prewarm to reload after a
+   * restart; empty to save nothing
+	 */
+  std::string warmupFile;
+
+	/**
+   * Milliseconds between saves of the resident pages to warmupFile; 0 saves
+   * them only when the BufMgr is destroyed
+	 */
+  std::uint32_t warmupSaveMs;
+
+	/**
+   * Second tier evicted pages are kept in, and checked on a miss before the
+   * page is read from its file
+	 */
+  SecondaryCacheType secondaryCache;
+
+	/**
+   * Bytes the secondary cache may use, in memory or in its file
+	 */
+  std::size_t secondaryCacheBytes;
+
+	/**
+   * File the flash secondary cache keeps pages in, on a fast local device
+	 */
+  std::string secondaryCachePath;
+
+	/**
+   * Most pages a checkpoint writes back per second, so that it does not
+   * starve the reads of other threads; 0 writes them as fast as possible
+	 */
+  std::uint32_t checkpointPagesPerSec;
 
 	/**
-   * Clear buffer pool usage statistics
+   * Whether each checkpoint appends a marker record to the log, see
+   * BufMgr::checkpoint
 	 */
-  void clearBufStats() 
+  bool logCheckpoints;
+
+	/**
+   * Constructor of BufMgrOptions class, with 16 shards, clock replacement, no
+   * background writer, no read-ahead, up to 32 I/Os in flight on io_uring
+   * where available, no log, the pool on transparent huge pages wherever the
+   * kernel places it, no secondary cache and unthrottled, unlogged checkpoints
+	 */
+  BufMgrOptions()
+    : numShards(16), policy(POLICY_CLOCK), lruK(2),
+      bgWriterDelayMs(0), bgWriterCleanTarget(64), bgWriterMaxPages(100),
+      readAheadPages(0), ioEngine(IO_ENGINE_AUTO), ioQueueDepth(32), log(NULL),
+      hugePages(HUGE_PAGES_TRANSPARENT), numaPlacement(NUMA_DEFAULT), maxBufs(0),
+      warmupSaveMs(0), secondaryCache(SECONDARY_CACHE_NONE), secondaryCacheBytes(0),
+      checkpointPagesPerSec(0), logCheckpoints(false)
   {
-		bufStats.clear();
   }
 };
 
+
+/**
+* @brief How a caller is going to use the pages it reads or allocates
+*/
+enum BufferAccessType
+{
+	/**
+   * Pages compete for frames through the replacement policy
+	 */
+  ACCESS_NORMAL,
+
+	/**
+   * One pass over many pages, e.g. a FileIterator scan of a whole relation
+	 */
+  ACCESS_SEQUENTIAL_SCAN,
+
+	/**
+   * Writing many new pages, e.g. a bulk load
+	 */
+  ACCESS_BULK_WRITE
+};
+
+
+/**
+* @brief Private ring of frames that confines a scan or bulk write to a small
+* part of the buffer pool, like PostgreSQL's buffer access strategies
+*
+* On a miss the frame used one trip around the ring ago is reused, unless it
+* is pinned or has been referenced by another access since.  Pages read through
+* a ring are loaded cold, so they are the first to go if the ring lets them
+* drop into the shared pool.  A strategy is meant to be used by one scan (and
+* thread) at a time, with the BufMgr that created it.
+*/
+class BufAccessStrategy
+{
+	friend class BufMgr;
+
+ public:
+	/**
+   * Ring slot that does not hold a frame yet
+	 */
+  static const FrameId NO_FRAME = 0xffffffff;
+
+	/**
+   * Constructor of BufAccessStrategy class; see BufMgr::getAccessStrategy
+	 *
+	 * @param type   	How the pages are going to be used
+	 * @param ringSize  Number of frames in the ring
+	 */
+  BufAccessStrategy(const BufferAccessType type, const std::uint32_t ringSize)
+    : accessType(type), ring(ringSize == 0 ? 1 : ringSize, NO_FRAME), current(0)
+  {
+  }
+
+	/**
+   * Returns how the pages are going to be used
+	 */
+  BufferAccessType type() const { return accessType; }
+
+ private:
+	/**
+   * How the pages are going to be used
+	 */
+  BufferAccessType accessType;
+
+	/**
+   * Frames this strategy has loaded pages into
+	 */
+  std::vector<FrameId> ring;
+
+	/**
+   * Ring slot used by the next miss
+	 */
+  std::uint32_t current;
+};
+
+
+/**
+* @brief Run of pages of one file queued for the prefetcher
+*/
+struct PrefetchRequest
+{
+	/**
+   * File to read from
+	 */
+  File* file;
+
+	/**
+   * First page of the run
+	 */
+  PageId first;
+
+	/**
+   * Number of pages in the run
+	 */
+  PageId count;
+};
+
+
+/**
+* @brief Move-only handle to a pinned page that unpins it when it goes out of
+* scope
+*
+* Returned by BufMgr::readPage and BufMgr::allocPage.  The guard remembers the
+* frame, so unpinning needs no page table lookup.
+*/
+class PageGuard
+{
+ public:
+	/**
+   * Constructor of PageGuard class, holding no page
+	 */
+  PageGuard() : mgr(NULL), page(NULL), dirty(false) {}
+
+	/**
+   * Takes over the pin held by <other>, which is left holding no page
+	 */
+  PageGuard(PageGuard&& other);
+
+	/**
+   * Unpins the page held, if any, and takes over the pin held by <other>
+	 */
+  PageGuard& operator=(PageGuard&& other);
+
+  PageGuard(const PageGuard&) = delete;
+  PageGuard& operator=(const PageGuard&) = delete;
+
+	/**
+   * Destructor of PageGuard class; unpins the page held, if any
+	 */
+  ~PageGuard();
+
+	/**
+   * Returns the page held, or NULL
+	 */
+  Page* get() const { return page; }
+
+  Page* operator->() const { return page; }
+  Page& operator*() const { return *page; }
+
+	/**
+   * Returns true if the guard holds a page
+	 */
+  explicit operator bool() const { return page != NULL; }
+
+	/**
+   * Marks the page dirty when it is unpinned
+	 */
+  void markDirty() { dirty = true; }
+
+	/**
+   * Marks the page dirty after a change logged with LSN <lsn>, and stamps the
+   * page with it
+	 */
+  void markDirty(const Lsn lsn)
+  {
+    if (lsn > page->lsn())
+      page->set_lsn(lsn);
+    dirty = true;
+  }
+
+	/**
+   * Unpins the page now, leaving the guard holding no page
+	 */
+  void release();
+
+ private:
+  friend class BufMgr;
+
+	/**
+   * Constructor used by BufMgr for a page it has just pinned
+	 */
+  PageGuard(BufMgr* mgr, Page* page) : mgr(mgr), page(page), dirty(false) {}
+
+	/**
+   * Buffer manager the page is pinned in
+	 */
+  BufMgr* mgr;
+
+	/**
+   * Frame of the page in the buffer pool
+	 */
+  Page* page;
+
+	/**
+   * Whether to mark the page dirty when it is unpinned
+	 */
+  bool dirty;
+};
+
+
+/**
+* @brief Page read without a pin through BufMgr::readPageOptimistic
+*/
+struct OptimisticRead
+{
+	/**
+   * Frame holding the page; may be kept as a hint for the next read of the
+   * same page
+	 */
+  const Page* page;
+
+	/**
+   * Version of the frame when the read started
+	 */
+  std::uint64_t version;
+
+	/**
+   * Constructor of OptimisticRead class, without a hint
+	 */
+  OptimisticRead() : page(NULL), version(0) {}
+};
+
+
+/**
+* @brief Sequential access detection state of one file
+*/
+struct ReadAheadState
+{
+	/**
+   * Page last read through readPage
+	 */
+  PageId last;
+
+	/**
+   * Last page already queued for read-ahead
+	 */
+  PageId ahead;
+
+	/**
+   * Constructor of ReadAheadState class
+	 */
+  ReadAheadState()
+    : last(0), ahead(0)
+  {
+  }
+};
+
+
+/**
+* @brief One partition of the page table, with its own lock
+*/
+struct BufShard
+{
+	/**
+   * Protects the hash table of this shard and the pin counts of the frames it maps
+	 */
+  std::mutex latch;
+
+	/**
+   * Hash table mapping (File, page) to frame for the pages of this shard
+	 */
+  BufHashTbl *hashTable;
+
+	/**
+   * Usage of the pool by each file, for the pages of this shard
+	 */
+  std::unordered_map<const File*, FileStats> fileStats;
+};
+
+
+/**
+* @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+*
+* The page table is partitioned into shards which are locked independently, so
+* buffer hits on different shards never contend on a shared lock.  Lock order
+* is: frame latch, then shard latch.  A shard latch may be held while trying
+* (never blocking) to acquire a frame latch or another shard latch.  No disk
+* I/O is done under a shard latch: a page is read in or written out holding
+* only its frame latch, marked BufState::IO.  Files lock their own header and
+* allocation bitmap, so page reads and writes of any number of files run
+* concurrently.
+*/
+class BufMgr 
+{
+ private:
+	/**
+   * Number of frames in the buffer pool.  Frames from numBufs on hold no page
+	 */
+  std::atomic<std::uint32_t> numBufs;
+
+	/**
+   * Number of frames the replacement policy may hand out; below numBufs while
+   * resize is emptying the frames it gives up
+	 */
+  std::atomic<std::uint32_t> activeBufs;
+
+	/**
+   * Number of frames the arena has room for, the most resize can grow to
+	 */
+  std::uint32_t maxBufs;
+
+	/**
+   * Serializes resize calls
+	 */
+  std::mutex resizeMutex;
+
+	/**
+   * Number of shards the page table is partitioned into
+	 */
+  std::uint32_t numShards;
+	
+	/**
+   * Page table shards mapping (File, page) to frame
+	 */
+  BufShard *shards;
+
+	/**
+   * Protects unsyncedFiles
+	 */
+  std::mutex unsyncedLatch;
+
+	/**
+   * Protects the lists of frames of each file, so that flushFile visits only
+   * the frames of its file.  Taken after the latches of a frame and its shard
+   * when a frame is mapped or emptied, and alone otherwise.
+	 */
+  std::mutex fileFramesLatch;
+
+	/**
+   * First frame in the list of each file with pages in the pool, linked
+   * through BufDesc::nextInFile
+	 */
+  std::unordered_map<FileId, FrameId> fileFrames;
+
+	/**
+   * Number of page writes to any file that have completed, counted after each
+   * completes.  A page read while it was not mapped is current for as long as
+   * this is unchanged.
+	 */
+  std::atomic<std::uint64_t> fileVersion;
+
+	/**
+   * Files written since the last checkpoint, under unsyncedLatch
+	 */
+  std::unordered_set<File*> unsyncedFiles;
+
+	/**
+   * Protects the checkpoint round counters and is waited on by checkpoint callers
+	 */
+  std::mutex checkpointMutex;
+
+	/**
+   * Signalled when a checkpoint round ends
+	 */
+  std::condition_variable checkpointDone;
+
+	/**
+   * Number of checkpoint rounds started, and the last round that succeeded
+	 */
+  std::uint64_t checkpointsStarted;
+  std::uint64_t checkpointsCompleted;
+
+	/**
+   * Whether a checkpoint round is running
+	 */
+  bool checkpointRunning;
+
+	/**
+   * Most pages a checkpoint round writes per second, 0 for no limit
+	 */
+  std::uint32_t checkpointPagesPerSec;
+
+	/**
+   * Whether checkpoint rounds append a marker record to the log
+	 */
+  bool logCheckpoints;
+
+	/**
+   * Redo LSN of the last checkpoint round that succeeded
+	 */
+  std::atomic<Lsn> checkpointRedo;
+
+	/**
+   * Policy choosing the frames allocBuf reuses
+	 */
+  ReplacementPolicy *policy;
+
+	/**
+   * Memory holding bufPool, bufStateTable and bufDescTable
+	 */
+  BufferArena *arena;
+
+	/**
+   * State words of the frames, the hot part of their descriptors
+	 */
+  std::atomic<std::uint32_t> *bufStateTable;
+
+	/**
+   * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
+	 */
+  BufDesc *bufDescTable;
+
+	/**
+   * Maintains Buffer pool usage statistics 
+	 */
+  BufStats bufStats;
+
+	/**
+   * Milliseconds between background writer rounds, 0 if there is no writer
+	 */
+  std::uint32_t bgWriterDelayMs;
+
+	/**
+   * Number of clean victims the background writer keeps ready
+	 */
+  std::uint32_t bgWriterCleanTarget;
+
+	/**
+   * Maximum number of pages the background writer writes back per round
+	 */
+  std::uint32_t bgWriterMaxPages;
+
+	/**
+   * File the resident pages are saved to, or empty
+	 */
+  std::string warmupFile;
+
+	/**
+   * Milliseconds between saves of the resident pages, 0 if only saved on
+   * shutdown
+	 */
+  std::uint32_t warmupSaveMs;
+
+	/**
+   * Protects warmupStop and is waited on by the warm-up saver
+	 */
+  std::mutex warmupMutex;
+
+	/**
+   * Wakes the warm-up saver on shutdown
+	 */
+  std::condition_variable warmupWake;
+
+	/**
+   * Set by the destructor to stop the warm-up saver
+	 */
+  bool warmupStop;
+
+	/**
+   * Thread saving the resident pages every warmupSaveMs, if there is one
+	 */
+  std::thread warmupSaver;
+
+	/**
+   * Protects bgWriterStop and is waited on by the background writer
+	 */
+  std::mutex bgWriterMutex;
+
+	/**
+   * Wakes the background writer early, on an eviction that did I/O or on shutdown
+	 */
+  std::condition_variable bgWriterWake;
+
+	/**
+   * Set by the destructor to stop the background writer
+	 */
+  bool bgWriterStop;
+
+	/**
+   * Thread writing dirty pages back ahead of the replacement policy
+	 */
+  std::thread bgWriter;
+
+	/**
+   * Number of pages read ahead on sequential access, 0 if disabled
+	 */
+  std::uint32_t readAheadPages;
+
+	/**
+   * Backend of the I/O engines of the background threads and readPages
+	 */
+  IoEngineType ioEngineType;
+
+	/**
+   * Maximum number of I/Os in flight per engine
+	 */
+  std::uint32_t ioQueueDepth;
+
+	/**
+   * Write-ahead log flushed ahead of page writes, or NULL
+	 */
+  LogManager* log;
+
+	/**
+   * Tier below the pool holding clean pages it evicted, or NULL.  Pages are
+   * put and taken under the latch of their shard, so it never holds a copy of
+   * a resident page
+	 */
+  SecondaryCache* secondaryCache;
+
+	/**
+   * Recorder the operations on pages are traced to, or NULL
+	 */
+  std::atomic<TraceRecorder*> tracer;
+
+	/**
+   * Protects the prefetch queue, the read-ahead state and the prefetcher thread
+	 */
+  std::mutex prefetchMutex;
+
+	/**
+   * Wakes the prefetcher when a request is queued or on shutdown
+	 */
+  std::condition_variable prefetchWake;
+
+	/**
+   * Signalled whenever the prefetcher finishes a request
+	 */
+  std::condition_variable prefetchDone;
+
+	/**
+   * Runs of pages waiting to be prefetched
+	 */
+  std::deque<PrefetchRequest> prefetchQueue;
+
+	/**
+   * Sequential access detection state per file
+	 */
+  std::unordered_map<const File*, ReadAheadState> readAheadState;
+
+	/**
+   * File of the request the prefetcher is working on, or NULL
+	 */
+  const File* prefetchBusy;
+
+	/**
+   * Set by the destructor to stop the prefetcher
+	 */
+  bool prefetchStop;
+
+	/**
+   * Thread loading queued pages, started by the first prefetch request
+	 */
+  std::thread prefetcher;
+
+	/**
+	 * Returns the page table shard responsible for the given page.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			Shard holding the mapping of the page
+	 */
+  BufShard& shardOf(const File* file, const PageId pageNo);
+
+	/**
+	 * FrameClaimer handed to the replacement policy by allocBuf
+	 */
+  class Claimer;
+
+	/**
+	 * I/O engine with a page-aligned staging page per request slot
+	 */
+  class AsyncIo;
+
+	/**
+	 * Tries to take over a frame offered by the replacement policy: the frame
+	 * must be unpinned and its latch and shard latch must be free.  The page in
+	 * the frame is written out, see writeOut(), and unmapped.  Never blocks on a
+	 * latch, as the policy may hold its own.
+	 *
+	 * @param frame   	Candidate frame
+	 * @param latch   Returns holding the latch of the frame if it was claimed
+	 * @return  			True if the frame is now empty and owned by the caller
+	 */
+  bool claimFrame(const FrameId frame, std::unique_lock<std::mutex>& latch);
+
+	/**
+	 * Writes back the page of a frame about to be emptied if it is dirty, and
+	 * keeps a copy in the secondary cache, before its mapping goes.  The caller
+	 * holds the frame latch and, in <shardLatch>, the latch of the shard mapping
+	 * the page, which is unpinned.  The shard latch is let go during the I/O
+	 * and taken again after it; the page is marked BufState::IO meanwhile, so
+	 * that nobody pins it.
+	 *
+	 * @param frame   	Frame whose page is evicted
+	 * @param shardLatch  Lock on the latch of the shard mapping the page
+	 * @param wait    Whether to block for the shard latch, or only try it
+	 * @return  			False if the shard latch could not be taken again; the
+	 *                page is then left mapped, and clean
+	 */
+  bool writeOut(const FrameId frame, std::unique_lock<std::mutex>& shardLatch, const bool wait);
+
+	/**
+	 * Called on finding a page marked BufState::IO, with <guard> holding the
+	 * latch of <shard>: releases it, waits until the holder of the frame latch
+	 * is done with the page, and takes the shard latch again for the caller to
+	 * look the page up again.
+	 */
+  void waitForIo(BufShard& shard, const FrameId frame, std::unique_lock<std::mutex>& guard);
+
+	/**
+	 * Empties a frame that resize gives up, writing back its page if dirty.
+	 * Blocks on the latches of the frame and its shard.
+	 *
+	 * @param frame   	Frame to empty
+	 * @return  			False if the page in it is pinned
+	 */
+  bool retireFrame(const FrameId frame);
+
+	/**
+	 * Reads a page that is not mapped into a newly allocated frame and maps it
+	 * there, pinned.  Called with <guard> holding the latch of <shard>, which
+	 * is let go while a frame is claimed, since that may write back its page.
+	 * If the page has been mapped by someone else meanwhile, returns false with
+	 * the shard latch held, for the caller to look the page up again.
+	 * Otherwise the page is mapped marked BufState::IO and the shard latch
+	 * released before the page is read, so no disk I/O is done under it, and
+	 * this returns true without the shard latch.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file to be read
+	 * @param shard   Shard responsible for the page
+	 * @param guard   Lock on the latch of <shard>
+	 * @param id      Returns the frame holding the page
+	 * @param strategy  Optional access strategy confining the page to its ring of frames
+	 * @param contents  Copy of the page read while fileVersion was <version>, or
+	 *                  NULL to read it
+	 * @param version   Value of fileVersion when <contents> was read
+	 * @return  			False if the page was mapped by someone else meanwhile
+	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 */
+  bool loadPage(File* file, const PageId pageNo, BufShard& shard, std::unique_lock<std::mutex>& guard,
+                FrameId& id, BufAccessStrategy* strategy, const Page* contents = NULL,
+                const std::uint64_t version = 0);
+
+	/**
+	 * Assigns a frame to a page and adds it to the list of its file.  The
+	 * caller holds the latches of the frame and of the page's shard.  If
+	 * <loading>, the page is marked BufState::IO until it has been read in.
+	 */
+  void mapFrame(const FrameId frame, File* file, const PageId pageNo, const bool loading = false);
+
+	/**
+	 * Empties a frame, taking it off the list of its file if it holds a page.
+	 * The caller holds the latch of the frame, and that of its shard if it
+	 * holds a page.
+	 */
+  void clearFrame(BufDesc& entry);
+
+	/**
+	 * Cancels queued prefetches of a file and waits for a running one, before
+	 * its pages leave the pool.
+	 */
+  void cancelPrefetches(const File* file);
+
+	/**
+	 * Appends the page numbers and frames on the list of a file to <frames>.
+	 */
+  void framesOf(const FileId fileId, std::vector<std::pair<PageId, FrameId> >& frames);
+
+	/**
+	 * Forgets a file whose pages have left the pool, so that it can be closed.
+	 */
+  void releaseFile(const File* file);
+
+	/**
+	 * Writes a page back to its file.
+	 */
+  void writeBack(File* file, const Page& page);
+
+	/**
+	 * Locks the latch of a shard into <guard>, counting the time spent waiting
+	 * for another thread to release it as pinWaitNanos.
+	 */
+  void lockShard(BufShard& shard, std::unique_lock<std::mutex>& guard);
+
+	/**
+	 * Returns the usage counters of a file in a shard, creating them on first
+	 * use.  The caller must hold the shard latch.
+	 */
+  FileStats& fileStatsOf(BufShard& shard, const File* file);
+
+	/**
+	 * Makes the log durable up to <lsn> before pages stamped with it are
+	 * written; does nothing without a log.
+	 */
+  void forceLog(const Lsn lsn);
+
+	/**
+	 * Records a write to a file, once it has completed.
+	 */
+  void fileWritten(File* file);
+
+	/**
+	 * Writes back the pages dirty when the round starts, in page order, and
+	 * syncs every file written since the last round.
+	 */
+  void checkpointRound();
+
+	/**
+	 * Main loop of the warm-up saver thread: saves the resident pages every
+	 * warmupSaveMs until warmupStop is set.
+	 */
+  void warmupSaverLoop();
+
+	/**
+	 * Queues a run of pages for the prefetcher, starting it if necessary.  The
+	 * caller must hold prefetchMutex.
+	 */
+  void queuePrefetch(File* file, const PageId first, const PageId count);
+
+	/**
+	 * Records a readPage of the given page and queues the next readAheadPages
+	 * pages once the file is being read sequentially.
+	 */
+  void noteRead(File* file, const PageId pageNo);
+
+	/**
+	 * Reads pages of a file into the staging pages of <io>, keeping as many
+	 * reads in flight as it allows, and hands each page to <done> as its read
+	 * completes.  All reads have completed when this returns, even if <done>
+	 * throws.
+	 *
+	 * @param io   		Engine to read with
+	 * @param file   	File object
+	 * @param pageNos Page numbers to read
+	 * @param done    Called with the index in <pageNos>, the page or NULL if it
+	 *                could not be read this way, and the value of fileVersion
+	 *                when the read was started; returns false to stop reading
+	 */
+  void readAsync(AsyncIo& io, File* file, const std::vector<PageId>& pageNos,
+                 const std::function<bool(std::size_t, const Page*, std::uint64_t)>& done);
+
+	/**
+	 * Main loop of the prefetcher thread.
+	 */
+  void prefetchLoop();
+
+	/**
+	 * Loads a queued run of pages, keeping up to ioQueueDepth reads in flight.
+	 */
+  void prefetchRun(const PrefetchRequest& request, AsyncIo& io);
+
+	/**
+	 * Loads a page unpinned unless it is already in the buffer pool.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file to be loaded
+	 * @param contents  Copy of the page read while fileVersion was <version>, or NULL
+	 * @param version   Value of fileVersion when <contents> was read
+	 * @return  			False if the page does not exist or no frame could be allocated
+	 */
+  bool prefetchPage(File* file, const PageId pageNo, const Page* contents,
+                    const std::uint64_t version);
+
+	/**
+	 * Pins a page, loading it from <contents> if it is not in the buffer pool.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param contents  Copy of the page read while fileVersion was <version>, or NULL
+	 * @param version   Value of fileVersion when <contents> was read
+	 * @return  			Frame holding the page
+	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 */
+  FrameId pinPage(File* file, const PageId pageNo, const Page* contents,
+                  const std::uint64_t version);
+
+	/**
+	 * Main loop of the background writer thread: one round per bgWriterDelayMs,
+	 * or sooner when woken, until bgWriterStop is set.
+	 */
+  void bgWriterLoop();
+
+	/**
+	 * Writes back dirty, unpinned pages among the next victims of the policy
+	 * until bgWriterCleanTarget of them are clean or bgWriterMaxPages have been
+	 * written, up to ioQueueDepth at a time.
+	 */
+  void bgWriterRound(AsyncIo& io);
+
+	/**
+	 * Copies the page in a frame into a staging page of <io> if it is dirty and
+	 * unpinned, leaving it cached and marking it clean.  The frame stays
+	 * latched, in <latches>, until writeBatch has written the copy.  Busy
+	 * frames are skipped unless <wait> is set; the caller must then take frame
+	 * latches in ascending frame order.
+	 *
+	 * @param frame   	Frame to clean
+	 * @param io   		Engine whose staging page receives the copy
+	 * @param latches   Receives the latch of the frame if the page was copied
+	 * @param batch     Receives the frame and the staging slot of the copy
+	 * @param wait   	Whether to wait for the frame latch
+	 * @param fileId  If valid, the frame is left alone unless it still holds
+	 *                page <pageNo> of this file
+	 * @param pageNo  Page expected in the frame
+	 * @return  			True if the frame is now empty, holds a clean, unpinned page
+	 *                or no longer holds the expected page
+	 */
+  bool cleanFrame(const FrameId frame, AsyncIo& io,
+                  std::vector<std::unique_lock<std::mutex> >& latches,
+                  std::vector<std::pair<FrameId, std::size_t> >& batch,
+                  const bool wait = false, const FileId fileId = File::INVALID_ID,
+                  const PageId pageNo = 0);
+
+	/**
+	 * Writes the pages copied by cleanFrame, all in flight at once, and
+	 * releases their frames and staging slots.  Pages whose write failed are
+	 * marked dirty again.
+	 *
+	 * @param written   Statistic counting the pages written
+	 */
+  void writeBatch(AsyncIo& io, std::vector<std::unique_lock<std::mutex> >& latches,
+                  std::vector<std::pair<FrameId, std::size_t> >& batch,
+                  std::atomic<std::uint64_t>& written);
+
+	/**
+	 * Allocate a free frame.  The caller must hold no shard latch, since the
+	 * page evicted from the frame may have to be written back; frames are only
+	 * evicted if their shard latch can be taken without blocking.
+	 *
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param latch   Returns holding the latch of the allocated frame
+	 * @param file   	File of the page the frame is needed for
+	 * @param pageNo  Page the frame is needed for
+	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 */
+  void allocBuf(FrameId & frame, std::unique_lock<std::mutex>& latch,
+                const File* file, const PageId pageNo);
+
+	/**
+	 * Allocate a frame from the ring of <strategy>, falling back to allocBuf
+	 * when the frame of the current ring slot cannot be reused.
+	 *
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param latch   Returns holding the latch of the allocated frame
+	 * @param file   	File of the page the frame is needed for
+	 * @param pageNo  Page the frame is needed for
+	 * @param strategy  Ring to allocate from
+	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 */
+  void allocRingBuf(FrameId & frame, std::unique_lock<std::mutex>& latch,
+                    const File* file, const PageId pageNo, BufAccessStrategy& strategy);
+
+ public:
+	/**
+   * Actual buffer pool from which frames are allocated, one contiguous array
+   * aligned to Page::SIZE at the start of the arena
+	 */
+  Page* bufPool;
+
+	/**
+   * Constructor of BufMgr class
+	 *
+	 * @param bufs   	Number of frames in the buffer pool
+	 * @param options Page table sharding, replacement policy, background writer and read-ahead
+	 */
+  BufMgr(std::uint32_t bufs, const BufMgrOptions& options = BufMgrOptions());
+	
+	/**
+   * Destructor of BufMgr class
+	 */
+  ~BufMgr();
+
+	/**
+	 * Reads the given page from the file into a frame and returns the pointer to page.
+	 * If the requested page is already present in the buffer pool pointer to that frame is returned
+	 * otherwise a new frame is allocated from the buffer pool for reading the page.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @param strategy  Optional access strategy confining misses to its ring of frames
+	 * @throws CorruptPageException If the page read from the file does not match its checksum
+	 */
+  void readPage(File* file, const PageId PageNo, Page*& page, BufAccessStrategy* strategy = NULL);
+
+	/**
+	 * Reads the given page like readPage above and returns a guard that unpins
+	 * it when it goes out of scope.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param strategy  Optional access strategy confining misses to its ring of frames
+	 * @return  			Guard holding the pinned page
+	 */
+  PageGuard readPage(File* file, const PageId PageNo, BufAccessStrategy* strategy = NULL);
+
+	/**
+	 * Pins several pages of a file like readPage, reading the pages that are
+	 * not in the buffer pool with up to ioQueueDepth reads in flight.  Each
+	 * page is mapped and pinned as soon as its read completes.  If an exception
+	 * is thrown, no page is left pinned.
+	 *
+	 * @param file   	File object
+	 * @param pageNos Page numbers to read
+	 * @param count   Number of pages to read
+	 * @param pages   Array of <count> page pointers receiving the pages
+	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 */
+  void readPages(File* file, const PageId* pageNos, const std::size_t count, Page** pages);
+
+	/**
+	 * Starts reading a cached page without pinning it.  Nothing stops the page
+	 * from being evicted or changed meanwhile, so whatever is read from
+	 * <read.page> must be checked with validateRead before it is used.  Only
+	 * pages whose writers bracket their changes with beginPageWrite and
+	 * endPageWrite may be read this way.
+	 *
+	 * If <read.page> still holds the frame of an earlier read of the same page
+	 * it is tried first without taking any latch; otherwise the page is looked
+	 * up under its shard latch.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file to be read
+	 * @param read    Receives the frame and its version
+	 * @return  			False if the page is not in the buffer pool or is being written;
+	 *                readPage has to be used then
+	 */
+  bool readPageOptimistic(File* file, const PageId pageNo, OptimisticRead& read);
+
+	/**
+	 * Returns true if the page of an optimistic read has neither been replaced
+	 * nor written since readPageOptimistic, so that what was read is consistent.
+	 */
+  bool validateRead(const OptimisticRead& read) const;
+
+	/**
+	 * Marks a pinned page as being written, failing concurrent and later
+	 * optimistic reads of it until endPageWrite.  Waits for any other writer
+	 * of the page to finish first.
+	 *
+	 * @param page  	Page returned by readPage or allocPage, still pinned
+	 */
+  void beginPageWrite(const Page* page);
+
+	/**
+	 * Ends the write started by beginPageWrite.
+	 *
+	 * @param page  	Page passed to beginPageWrite
+	 */
+  void endPageWrite(const Page* page);
+
+	/**
+	 * Asks for pages to be loaded into the buffer pool in the background, so
+	 * that later readPage calls on them are hits.  Pages are loaded unpinned;
+	 * pages past the end of the file are ignored.
+	 *
+	 * @param file   	File object
+	 * @param first   First page number to load
+	 * @param count   Number of consecutive pages to load
+	 */
+  void prefetch(File* file, const PageId first, const PageId count);
+
+	/**
+	 * Saves the file name, page number and hotness of every page in the buffer
+	 * pool to <path>, for prewarm to reload after a restart.  Hotness is the
+	 * position of the frame in the eviction order of the replacement policy,
+	 * raised by the pool size if the frame was referenced since the last
+	 * sweep; higher is hotter.  The list is written to a temporary file that
+	 * then replaces <path>, so a crash leaves the previous list intact.
+	 *
+	 * @param path   	File to save the list to, one "hotness page name" line per page
+	 * @throws  FileIOException If the list cannot be written
+	 */
+  void saveResidentPages(const std::string& path);
+
+	/**
+	 * Reloads the pages listed by saveResidentPages in <path> that belong to
+	 * <files>, matched by file name.  At most as many pages as the pool has
+	 * frames are loaded, the hottest first; they are sorted into runs of
+	 * consecutive pages, hottest run first, and loaded unpinned by the
+	 * prefetcher with batched reads.  Pages no longer in their file are
+	 * skipped.
+	 *
+	 * @param path   	File the list was saved to; a missing file lists no pages
+	 * @param files  	Open files to reload pages of
+	 * @param wait   	Whether to return only once the pages are loaded, so that
+	 *              	the caller can start serving with a warm pool
+	 * @return  			Number of pages queued to be reloaded
+	 */
+  std::size_t prewarm(const std::string& path, const std::vector<File*>& files, const bool wait = false);
+
+	/**
+	 * Unpin a page from memory since it is no longer required for it to remain in memory.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number
+	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
+   * @throws  PageNotPinnedException If the page is not already pinned
+	 */
+  void unPinPage(File* file, const PageId PageNo, const bool dirty);
+
+	/**
+	 * Unpins a page given the pointer readPage or allocPage returned for it,
+	 * without looking it up or taking any latch.
+	 *
+	 * @param page  	Page to unpin
+	 * @param dirty		True if the page to be unpinned needs to be marked dirty
+   * @throws  PageNotPinnedException If the page is not already pinned
+   * @throws  BadBufferException If <page> is not a frame of the buffer pool
+	 */
+  void unPinPage(const Page* page, const bool dirty);
+
+	/**
+	 * Allocates a new, empty page in the file and returns the Page object.
+	 * The newly allocated page is also assigned a frame in the buffer pool.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
+	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+	 * @param strategy  Optional access strategy confining the new page to its ring of frames
+	 */
+  void allocPage(File* file, PageId &PageNo, Page*& page, BufAccessStrategy* strategy = NULL); 
+
+	/**
+	 * Allocates a new page like allocPage above and returns a guard that unpins
+	 * it when it goes out of scope.  The page is marked dirty by the guard.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
+	 * @param strategy  Optional access strategy confining the new page to its ring of frames
+	 * @return  			Guard holding the pinned page
+	 */
+  PageGuard allocPage(File* file, PageId &PageNo, BufAccessStrategy* strategy = NULL);
+
+	/**
+	 * Returns an access strategy for the given kind of access.  Sequential scans
+	 * get a ring of 32 frames and bulk writes one of 2048, both capped at an
+	 * eighth of the buffer pool.
+	 *
+	 * @param type   	How the pages are going to be used
+	 * @return  			Strategy to pass to readPage and allocPage
+	 */
+  BufAccessStrategy getAccessStrategy(const BufferAccessType type) const;
+
+	/**
+	 * Makes the buffer pool durable: writes back every page that is dirty when
+	 * the round starts and not pinned when it is reached, keeping it cached,
+	 * then syncs each file written by this buffer manager since the last
+	 * checkpoint once.  Pages make it to the files without being synced
+	 * otherwise.
+	 *
+	 * The checkpoint is fuzzy: it works from a snapshot of the dirty frames,
+	 * taken without stopping other threads, and writes them file by file in
+	 * page order, at most checkpointPagesPerSec of them per second.  Pages
+	 * dirtied after the snapshot are left to the next round, and pinned pages
+	 * are skipped and counted in checkpointSkips rather than failing the round.
+	 *
+	 * With a log, the round ends by computing its redo LSN: the end of the log
+	 * when the snapshot was taken, or the redo LSN of the previous round if a
+	 * page was skipped.  Every change logged before it is in the files.  With
+	 * logCheckpoints set the round also appends a marker record holding it,
+	 * see parseCheckpointRecord, and makes the log durable up to the marker.
+	 *
+	 * Concurrent calls are committed as a group: a call waits for the next
+	 * round to start after it, and all calls waiting meanwhile share that
+	 * round.
+	 *
+   * @throws  FileIOException If a page, a file or the marker could not be written
+	 */
+  void checkpoint();
+
+	/**
+	 * Returns the redo LSN of the last checkpoint that succeeded: recovery need
+	 * only redo the changes logged from there on.  0 before the first one.
+	 */
+  Lsn checkpointRedoLsn() const { return checkpointRedo.load(std::memory_order_acquire); }
+
+	/**
+	 * Reads the redo LSN out of a record appended to the log by checkpoint.
+	 *
+	 * @param record  Bytes of a log record
+	 * @param redoLsn Receives the redo LSN if it is a checkpoint record
+	 * @return  			True if <record> is a checkpoint record
+	 */
+  static bool parseCheckpointRecord(const std::string& record, Lsn& redoLsn);
+
+	/**
+	 * Writes out all dirty pages of the file to disk.
+	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
+	 * Otherwise Error returned.  Prefetches of the file that have not started are cancelled.
+	 * The file is not synced and later checkpoints leave it alone, so that it can be closed;
+	 * call File::sync to make its writes durable.  Only the frames holding pages of the
+	 * file are visited, from its list, and they are written back in page order.
+	 *
+	 * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool 
+   * @throws BadBufferException If any frame allocated to the file is found to be invalid
+	 */
+  void flushFile(const File* file);
+
+	/**
+	 * Discards every page of the file from the buffer pool without writing any
+	 * back, e.g. before a temporary file is closed.  Changes not yet written
+	 * are lost.  Prefetches of the file that have not started are cancelled.
+	 *
+	 * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool,
+   *          in which case no page is discarded
+	 */
+  void dropFile(const File* file);
+
+	/**
+	 * Delete page from file and also from buffer pool if present.
+	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number
+	 */
+  void disposePage(File* file, const PageId PageNo);
+
+	/**
+	 * Grows or shrinks the buffer pool online to <newBufs> frames, up to
+	 * BufMgrOptions::maxBufs.  Pages stay where they are: growing adds empty
+	 * frames, and shrinking empties the frames at the end of the pool, writing
+	 * back dirty pages, and gives their memory back to the system.  Shrinking
+	 * stops early at a frame whose page is pinned, as pinned pages never move;
+	 * the pool then keeps that frame and all below it.  Each shard of the page
+	 * table is then resized for the new size under its own latch, one at a
+	 * time, so lookups elsewhere carry on meanwhile.
+	 *
+	 * @param newBufs	Number of frames wanted
+	 * @return  			Number of frames the pool has now
+	 * @throws  BufferExceededException If newBufs is 0 or above maxBufs
+	 */
+  std::uint32_t resize(const std::uint32_t newBufs);
+
+	/**
+	 * Returns the number of frames in the buffer pool
+	 */
+  std::uint32_t getNumBufs() const
+  {
+		return numBufs;
+  }
+
+	/**
+	 * Returns the numbers of the used pages of a file in order, from its
+	 * allocation bitmap, without reading the pages.  Safe while other threads
+	 * use the file through this buffer manager.
+	 *
+	 * @param file   	File object
+	 * @return  			Numbers of the used pages
+	 */
+  std::vector<PageId> usedPages(File* file);
+
+	/**
+   * Print member variable values. 
+	 */
+  void  printSelf();
+
+	/**
+   * Get the memory the frames and their descriptors are in
+	 */
+  const BufferArena & getArena() const
+  {
+		return *arena;
+  }
+
+	/**
+   * Get buffer pool usage statistics
+	 */
+  BufStats & getBufStats()
+  {
+		return bufStats;
+  }
+
+	/**
+   * Trace every readPage, unPinPage, allocPage, disposePage and eviction to a
+   * recorder from now on, or stop tracing if it is NULL.  The recorder must
+   * outlive the calls made meanwhile; calls compiled with BADGERDB_TRACE=0
+   * are never traced
+	 */
+  void setTracer(TraceRecorder* recorder)
+  {
+		tracer = recorder;
+  }
+
+	/**
+   * Get a copy of the buffer pool usage statistics, with the usage per file
+	 */
+  BufStatsSnapshot getStatsSnapshot();
+
+	/**
+   * Clear buffer pool usage statistics, including those per file
+	 */
+  void clearBufStats();
+};
+
 }
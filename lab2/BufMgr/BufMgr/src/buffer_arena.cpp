@@ -0,0 +1,199 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "buffer_arena.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace badgerdb {
+
+namespace {
+
+// Memory policies of mbind(2), from <linux/mempolicy.h>; the system call is
+// made directly so that the build does not depend on libnuma.
+const int MPOL_BIND_MODE = 2;
+const int MPOL_INTERLEAVE_MODE = 3;
+
+// Page sizes are encoded in the mmap flags as their log2, shifted.
+const int HUGE_SHIFT = 26;
+
+const std::size_t HUGE_2MB = std::size_t(1) << 21;
+const std::size_t HUGE_1GB = std::size_t(1) << 30;
+
+std::size_t roundUp(const std::size_t n, const std::size_t multiple) {
+  return (n + multiple - 1) / multiple * multiple;
+}
+
+// Returns the nodes with memory, from a list such as "0-3,5" in sysfs.
+std::vector<std::uint32_t> memoryNodes() {
+  std::vector<std::uint32_t> nodes;
+  std::ifstream list("/sys/devices/system/node/has_memory");
+  std::string text;
+  if (list && std::getline(list, text)) {
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+      std::size_t end = text.find(',', pos);
+      if (end == std::string::npos) {
+        end = text.size();
+      }
+      const std::string range = text.substr(pos, end - pos);
+      const std::size_t dash = range.find('-');
+      const std::uint32_t first = std::stoul(range.substr(0, dash));
+      const std::uint32_t last = dash == std::string::npos
+                                     ? first
+                                     : std::stoul(range.substr(dash + 1));
+      for (std::uint32_t node = first; node <= last; ++node) {
+        nodes.push_back(node);
+      }
+      pos = end + 1;
+    }
+  }
+  if (nodes.empty()) {
+    nodes.push_back(0);
+  }
+  return nodes;
+}
+
+bool mbind(void* addr, const std::size_t length, const int mode,
+           const std::vector<std::uint32_t>& nodes) {
+#ifdef SYS_mbind
+  const std::size_t bits = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> mask(*std::max_element(nodes.begin(), nodes.end()) / bits + 1);
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    mask[nodes[i] / bits] |= 1UL << (nodes[i] % bits);
+  }
+  return syscall(SYS_mbind, addr, length, mode, mask.data(),
+                 mask.size() * bits + 1, 0) == 0;
+#else
+  return false;
+#endif
+}
+
+}
+
+BufferArena::BufferArena(const std::size_t frames, const std::size_t frame_size,
+                         const std::vector<std::size_t>& entry_sizes,
+                         const HugePageMode huge_pages,
+                         const NumaPlacement placement)
+    : frames_(frames), frame_size_(frame_size), entry_sizes_(entry_sizes),
+      base_(NULL), mapped_(MAP_FAILED), mapped_length_(0), page_size_(0),
+      num_nodes_(1) {
+  const std::size_t base_page = sysconf(_SC_PAGESIZE);
+
+  // Every array starts on a base page of its own, so that its node can be
+  // chosen apart from those of its neighbours.
+  bool mapped = false;
+#ifdef MAP_HUGETLB
+  const std::size_t huge[2] = {HUGE_1GB, HUGE_2MB};
+  for (int i = huge_pages == HUGE_PAGES_1GB ? 0 : 1;
+       i < 2 && !mapped && huge_pages >= HUGE_PAGES_2MB; ++i) {
+    const int log2 = huge[i] == HUGE_1GB ? 30 : 21;
+    mapped = map(huge[i], huge[i], base_page,
+                 MAP_HUGETLB | (log2 << HUGE_SHIFT));
+  }
+#endif
+  if (!mapped) {
+    // Align to a huge page anyway, so that transparent huge pages can back
+    // the whole pool.
+    const std::size_t alignment = std::max(
+        frame_size, huge_pages == HUGE_PAGES_NONE ? base_page : HUGE_2MB);
+    if (!map(base_page, alignment, base_page, 0)) {
+      throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge_pages != HUGE_PAGES_NONE) {
+      madvise(base_, offsets_.back(), MADV_HUGEPAGE);
+    }
+#endif
+  }
+
+  const std::vector<std::uint32_t> nodes = memoryNodes();
+  if (placement == NUMA_DEFAULT || nodes.size() < 2) {
+    return;
+  }
+  if (placement == NUMA_INTERLEAVE) {
+    if (mbind(base_, offsets_.back(), MPOL_INTERLEAVE_MODE, nodes)) {
+      num_nodes_ = nodes.size();
+    }
+    return;
+  }
+  num_nodes_ = std::min<std::size_t>(nodes.size(), std::max<std::size_t>(frames, 1));
+  bool bound = false;
+  for (std::uint32_t k = 0; k < num_nodes_; ++k) {
+    bound |= bind(frameBegin(k) * frame_size, frameBegin(k + 1) * frame_size,
+                  nodes[k]);
+    for (std::size_t i = 0; i < entry_sizes_.size(); ++i) {
+      bound |= bind(offsets_[i] + frameBegin(k) * entry_sizes_[i],
+                    offsets_[i] + frameBegin(k + 1) * entry_sizes_[i], nodes[k]);
+    }
+  }
+  if (!bound) {
+    num_nodes_ = 1;
+  }
+}
+
+BufferArena::~BufferArena() {
+  munmap(mapped_, mapped_length_);
+}
+
+void BufferArena::discard(const std::size_t begin, const std::size_t end) {
+  const std::size_t first = roundUp(begin * frame_size_, page_size_);
+  const std::size_t last = end * frame_size_ / page_size_ * page_size_;
+  if (first < last) {
+    madvise(base_ + first, last - first, MADV_DONTNEED);
+  }
+}
+
+std::uint32_t BufferArena::systemNodes() {
+  return memoryNodes().size();
+}
+
+bool BufferArena::map(const std::size_t page_size, const std::size_t alignment,
+                      const std::size_t array_alignment, const int flags) {
+  offsets_.clear();
+  std::size_t length = roundUp(std::max<std::size_t>(frames_ * frame_size_, 1),
+                               array_alignment);
+  for (std::size_t i = 0; i < entry_sizes_.size(); ++i) {
+    offsets_.push_back(length);
+    length = roundUp(length + frames_ * entry_sizes_[i], array_alignment);
+  }
+  offsets_.push_back(length);
+  length = roundUp(length, page_size);
+
+  // Mappings of huge pages are aligned to them; others are mapped with room to
+  // spare and aligned within it.
+  const std::size_t slack = alignment > page_size ? alignment - page_size : 0;
+  void* memory = mmap(NULL, length + slack, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+  if (memory == MAP_FAILED) {
+    return false;
+  }
+  mapped_ = memory;
+  mapped_length_ = length + slack;
+  base_ = reinterpret_cast<char*>(
+      roundUp(reinterpret_cast<std::uintptr_t>(memory), alignment));
+  page_size_ = page_size;
+  return true;
+}
+
+bool BufferArena::bind(std::size_t begin, std::size_t end,
+                       const std::uint32_t node) {
+  begin = roundUp(begin, page_size_);
+  end = end / page_size_ * page_size_;
+  return begin < end && mbind(base_ + begin, end - begin, MPOL_BIND_MODE,
+                              std::vector<std::uint32_t>(1, node));
+}
+
+}
@@ -0,0 +1,203 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * @brief Pages the buffer pool memory can be backed by.
+ */
+enum HugePageMode {
+  /**
+   * Base pages of the system, usually 4 KB.
+   */
+  HUGE_PAGES_NONE,
+
+  /**
+   * Base pages, with the kernel asked to back them by transparent huge pages
+   * where it can.
+   */
+  HUGE_PAGES_TRANSPARENT,
+
+  /**
+   * 2 MB pages reserved in the huge page pool of the kernel.  Falls back to
+   * transparent huge pages if not enough are reserved.
+   */
+  HUGE_PAGES_2MB,
+
+  /**
+   * 1 GB pages reserved in the huge page pool of the kernel.  Falls back to
+   * 2 MB pages, then to transparent huge pages.
+   */
+  HUGE_PAGES_1GB
+};
+
+/**
+ * @brief How the buffer pool memory is spread over the NUMA nodes.
+ */
+enum NumaPlacement {
+  /**
+   * Wherever the kernel places it, usually on the node of the thread that
+   * first touches it.
+   */
+  NUMA_DEFAULT,
+
+  /**
+   * Interleaved page by page over all nodes, so that no node's memory
+   * bandwidth is the bottleneck.
+   */
+  NUMA_INTERLEAVE,
+
+  /**
+   * Split into one contiguous range of frames per node, so that frames can be
+   * handed out by node.
+   */
+  NUMA_PARTITION
+};
+
+/**
+ * @brief One memory mapping holding the frames of a buffer pool and the arrays
+ *        of per-frame data beside them, such as their descriptors.
+ *
+ * The frames come first, aligned to the page size of the mapping, followed by
+ * each array on pages of its own.  The memory is placed on the NUMA nodes
+ * before it is first touched; with NUMA_PARTITION, node k holds frames
+ * [frameBegin(k), frameBegin(k + 1)) and their entries of every array, up to
+ * the granularity of the mapping at the edges.  Placement is a hint: on kernels or machines without
+ * NUMA the memory simply stays where it is.
+ *
+ * The arena hands out raw, zeroed memory; constructing and destroying the
+ * objects in it is up to the caller.
+ */
+class BufferArena {
+ public:
+  /**
+   * Maps memory for <frames> frames of <frame_size> bytes, and for one array
+   * of <frames> entries per element of <entry_sizes>, of that many bytes each.
+   *
+   * @param frames        Number of frames.
+   * @param frame_size    Bytes per frame; frames are aligned to it.
+   * @param entry_sizes   Bytes per entry of each array.
+   * @param huge_pages    Pages to back the memory by.
+   * @param placement     How to spread the memory over the NUMA nodes.
+   * @throws  std::bad_alloc  If the memory cannot be mapped.
+   */
+  BufferArena(const std::size_t frames, const std::size_t frame_size,
+              const std::vector<std::size_t>& entry_sizes,
+              const HugePageMode huge_pages, const NumaPlacement placement);
+
+  /**
+   * Unmaps the memory.
+   */
+  ~BufferArena();
+
+  BufferArena(const BufferArena&) = delete;
+  BufferArena& operator=(const BufferArena&) = delete;
+
+  /**
+   * Returns the memory of the first frame.
+   */
+  void* frames() const { return base_; }
+
+  /**
+   * Returns the memory of the first entry of array <i>.
+   */
+  void* array(const std::size_t i) const { return base_ + offsets_[i]; }
+
+  /**
+   * Returns the size of the pages that back the memory: the base page size,
+   * or that of the reserved huge pages it got.  Transparent huge pages are not
+   * counted, as the kernel may back any part of the memory by base pages.
+   */
+  std::size_t pageSize() const { return page_size_; }
+
+  /**
+   * Returns the number of NUMA nodes the memory is spread over, 1 unless the
+   * placement is NUMA_INTERLEAVE or NUMA_PARTITION on a NUMA machine.
+   */
+  std::uint32_t numNodes() const { return num_nodes_; }
+
+  /**
+   * Returns the first frame placed on <node>; frameBegin(numNodes()) is the
+   * number of frames.
+   */
+  std::size_t frameBegin(const std::uint32_t node) const {
+    return frames_ * node / num_nodes_;
+  }
+
+  /**
+   * Gives the memory of frames [<begin>, <end>) back to the system, rounded
+   * inwards to whole pages of the mapping.  The frames read as zeroes when
+   * next touched, on the nodes they were placed on.
+   */
+  void discard(const std::size_t begin, const std::size_t end);
+
+  /**
+   * Returns the number of NUMA nodes the system has memory on.
+   */
+  static std::uint32_t systemNodes();
+
+ private:
+  /**
+   * Maps memory backed by pages of <page_size>, aligned to <alignment>, and
+   * sets <offsets_>, <base_>, <mapped_> and <mapped_length_>.  Each array
+   * starts at a multiple of <array_alignment>.  Returns false if the pages
+   * are not available.
+   */
+  bool map(const std::size_t page_size, const std::size_t alignment,
+           const std::size_t array_alignment, const int flags);
+
+  /**
+   * Binds [<begin>, <end>) of the memory to <node>, rounded inwards to whole
+   * pages of the mapping.  Returns false if no memory was bound.
+   */
+  bool bind(std::size_t begin, std::size_t end, const std::uint32_t node);
+
+  /**
+   * Number of frames.
+   */
+  std::size_t frames_;
+
+  /**
+   * Bytes per frame, and per entry of each array.
+   */
+  std::size_t frame_size_;
+  std::vector<std::size_t> entry_sizes_;
+
+  /**
+   * Offset of each array from the first frame, and of the end of the last.
+   */
+  std::vector<std::size_t> offsets_;
+
+  /**
+   * First frame, aligned as asked.
+   */
+  char* base_;
+
+  /**
+   * Start and length of the whole mapping, which may begin before <base_>.
+   */
+  void* mapped_;
+  std::size_t mapped_length_;
+
+  /**
+   * Size of the pages backing the mapping.
+   */
+  std::size_t page_size_;
+
+  /**
+   * Number of NUMA nodes the memory is spread over.
+   */
+  std::uint32_t num_nodes_;
+};
+
+}
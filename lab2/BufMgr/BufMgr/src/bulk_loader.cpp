@@ -0,0 +1,72 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "bulk_loader.h"
+
+#include "exceptions/invalid_page_exception.h"
+#include "file.h"
+
+namespace badgerdb {
+
+PageAppender::PageAppender(File* file, const std::size_t batch_pages)
+    : file_(file), pages_(batch_pages == 0 ? 1 : batch_pages), count_(0),
+      next_page_number_(file->readHeader().num_pages) {}
+
+Page& PageAppender::newPage(PageId& page_number) {
+  if (count_ == pages_.size()) {
+    flush();
+  }
+  Page& page = pages_[count_++];
+  page.initialize();
+  page.set_page_number(next_page_number_);
+  page_number = next_page_number_++;
+  return page;
+}
+
+void PageAppender::flush() {
+  if (count_ == 0) {
+    return;
+  }
+  const PageId expected = next_page_number_ - static_cast<PageId>(count_);
+  const PageId first = file_->readHeader().num_pages;
+  if (first != expected) {
+    throw InvalidPageException(expected, file_->filename());
+  }
+  file_->appendPages(&pages_[0], count_);
+  count_ = 0;
+}
+
+HeapLoader::HeapLoader(File* file, const double fill_factor,
+                       const std::size_t batch_pages)
+    : appender_(file, batch_pages),
+      fill_bytes_(static_cast<std::size_t>(
+          (fill_factor <= 0 || fill_factor > 1 ? 1.0 : fill_factor) *
+          Page::DATA_SIZE)),
+      page_(NULL), num_pages_(0) {}
+
+RecordId HeapLoader::insertRecord(const std::string& record_data) {
+  if (page_ != NULL) {
+    // A record may need a new slot as well as its bytes.
+    const std::size_t used = Page::DATA_SIZE - page_->getFreeSpace() +
+                             record_data.length() + sizeof(PageSlot);
+    if (used <= fill_bytes_ && page_->hasSpaceForRecord(record_data)) {
+      return page_->insertRecord(record_data);
+    }
+  }
+  // An empty page takes any record that fits.
+  PageId page_number;
+  page_ = &appender_.newPage(page_number);
+  ++num_pages_;
+  return page_->insertRecord(record_data);
+}
+
+void HeapLoader::finish() {
+  appender_.flush();
+  page_ = NULL;
+}
+
+}
@@ -0,0 +1,151 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class File;
+
+/**
+ * @brief Builds new pages in memory and appends them to the end of a file in
+ *        batches with File::appendPages, bypassing any BufMgr.
+ *
+ * Pages are numbered as they are started, so their numbers can be used, e.g.
+ * in record IDs or links between pages, before they are written.  This needs
+ * the appender to be the only writer of the file while it is in use.
+ */
+class PageAppender {
+ public:
+  /**
+   * Starts appending to <file>, writing every <batch_pages> pages.
+   *
+   * @param file        File to append to; must outlive the appender.
+   * @param batch_pages Number of pages built in memory before they are
+   *                    written.
+   */
+  explicit PageAppender(File* file, const std::size_t batch_pages = 64);
+
+  PageAppender(const PageAppender&) = delete;
+  PageAppender& operator=(const PageAppender&) = delete;
+
+  /**
+   * Starts an empty page at the end of the file.  The page may be changed
+   * until the next call, when it may be written.
+   *
+   * @param page_number   Receives the number of the page.
+   * @return  The page.
+   * @throws  InvalidPageException  If the file was extended by someone else.
+   */
+  Page& newPage(PageId& page_number);
+
+  /**
+   * Returns the number the next page started will get.
+   */
+  PageId nextPageNumber() const { return next_page_number_; }
+
+  /**
+   * Writes the pages started so far.
+   *
+   * @throws  InvalidPageException  If the file was extended by someone else.
+   */
+  void flush();
+
+ private:
+  /**
+   * File appended to.
+   */
+  File* file_;
+
+  /**
+   * Pages started but not yet written.
+   */
+  std::vector<Page> pages_;
+
+  /**
+   * Number of pages in <pages_> that have been started.
+   */
+  std::size_t count_;
+
+  /**
+   * Number of the next page to be started.
+   */
+  PageId next_page_number_;
+};
+
+/**
+ * @brief Loads records into a new run of pages at the end of a file, filling
+ *        each page to a target fill factor before starting the next.
+ *
+ * The loaded pages are read like any others, e.g. through a HeapFile opened
+ * on the file once loading has finished.
+ */
+class HeapLoader {
+ public:
+  /**
+   * Starts loading into <file>.
+   *
+   * @param file          File to load into; must outlive the loader, and may
+   *                      not be written by anyone else until finish().
+   * @param fill_factor   Fraction of each page's data area filled before
+   *                      records go to the next page, in (0, 1].
+   * @param batch_pages   Number of pages built in memory before they are
+   *                      written.
+   */
+  explicit HeapLoader(File* file, const double fill_factor = 1.0,
+                      const std::size_t batch_pages = 64);
+
+  /**
+   * Adds a record.
+   *
+   * @param record_data  Bytes that compose the record.
+   * @return  ID of the record.
+   * @throws  InsufficientSpaceException  If the record does not fit in an
+   *                                      empty page.
+   */
+  RecordId insertRecord(const std::string& record_data);
+
+  /**
+   * Writes the pages still in memory.  The loader can go on loading after.
+   */
+  void finish();
+
+  /**
+   * Returns the number of pages started.
+   */
+  std::size_t numPages() const { return num_pages_; }
+
+ private:
+  /**
+   * Pages being built.
+   */
+  PageAppender appender_;
+
+  /**
+   * Most bytes of a page's data area used before moving on.
+   */
+  const std::size_t fill_bytes_;
+
+  /**
+   * Page records are being added to, or NULL.
+   */
+  Page* page_;
+
+  /**
+   * Number of pages started.
+   */
+  std::size_t num_pages_;
+};
+
+}
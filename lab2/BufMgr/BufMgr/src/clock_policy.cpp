@@ -0,0 +1,119 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "clock_policy.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+const std::uint32_t ClockPolicy::SWEEP_FRAMES;
+
+ClockPolicy::ClockPolicy(std::atomic<std::uint32_t>* bufStateTable, const std::uint32_t numBufs)
+  : bufStateTable(bufStateTable), numBufs(numBufs) {
+  clockHand = numBufs - 1;
+}
+
+std::uint32_t ClockPolicy::firstReclaimable(const std::uint32_t* words, const std::uint32_t count)
+{
+  const std::uint32_t busy = BufState::REF | BufState::PIN_MASK;
+  std::uint32_t i = 0;
+#ifdef __SSE2__
+  // four frames per compare.
+  const __m128i mask = _mm_set1_epi32(busy);
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 4 <= count; i += 4) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+    const int idle = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(v, mask), zero)));
+    if (idle != 0)
+      return i + __builtin_ctz(idle);
+  }
+#endif
+  for (; i < count; ++i) {
+    if ((words[i] & busy) == 0)
+      return i;
+  }
+  return count;
+}
+
+void ClockPolicy::recordAccess(const FrameId frame)
+{
+  // BufMgr sets the reference bit on every hit.
+}
+
+void ClockPolicy::recordLoad(const FrameId frame, const File* file, const PageId pageNo)
+{
+  // BufDesc::Set already sets the reference bit of a newly loaded page.
+}
+
+void ClockPolicy::recordRemove(const FrameId frame)
+{
+  // an empty frame is found by the sweep like any other.
+}
+
+void ClockPolicy::resize(const std::uint32_t numBufs)
+{
+  // a hand past the last frame wraps to the first on its next move.
+  this->numBufs = numBufs;
+}
+
+bool ClockPolicy::selectVictim(const File* file, const PageId pageNo,
+                               FrameClaimer& claimer, FrameId& frame)
+{
+  std::uint32_t words[SWEEP_FRAMES];
+  std::uint32_t count = 0;
+  const std::uint32_t frames = numBufs.load();
+  std::uint32_t trylimit = frames * 2;
+  while (count <= trylimit) {
+    // copy the state words of the next run of frames, up to the end of the
+    // pool, and find the first the hand would stop at.
+    FrameId hand = clockHand.load();
+    const FrameId first = hand >= frames - 1 ? 0 : hand + 1;
+    const std::uint32_t n = std::min(SWEEP_FRAMES, frames - first);
+    for (std::uint32_t i = 0; i < n; ++i)
+      words[i] = bufStateTable[first + i].load(std::memory_order_relaxed);
+    const std::uint32_t stop = firstReclaimable(words, n);
+    const FrameId last = first + (stop < n ? stop : n - 1);
+    if (!clockHand.compare_exchange_weak(hand, last))
+      continue;  // another sweep moved the hand meanwhile
+
+    // the frames passed over lose their reference bit, as with a sweep of one
+    // frame at a time.
+    for (std::uint32_t i = 0; i < stop && i < n; ++i) {
+      if (words[i] & BufState::REF)
+        bufStateTable[first + i].fetch_and(~BufState::REF, std::memory_order_relaxed);
+    }
+    count += last - first + 1;
+    if (stop < n && claimer.claim(last)) {
+      frame = last;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ClockPolicy::nextVictims(const std::uint32_t count, std::vector<FrameId>& frames)
+{
+  // the frames the hand reaches next, whatever their reference bit: a set bit
+  // only buys a frame one more trip round the clock.  Empty frames are listed
+  // too; the caller checks them under their latch.
+  frames.clear();
+  const std::uint32_t size = numBufs.load();
+  FrameId hand = clockHand.load();
+  for (std::uint32_t i = 0; i < count && i < size; ++i) {
+    hand = hand >= size - 1 ? 0 : hand + 1;
+    frames.push_back(hand);
+  }
+}
+
+}
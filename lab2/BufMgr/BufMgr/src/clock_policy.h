@@ -0,0 +1,70 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Clock replacement: the hand sweeps the frames, clearing reference
+ *        bits, and reuses the first unpinned frame whose bit is already clear.
+ *
+ * The reference bits live in the state words of the frames, where BufMgr sets
+ * them on every hit, and the hand is advanced atomically, so this policy takes
+ * no lock on hits.  The hand reads the packed state words a run of frames at
+ * a time and skips to the first one that is neither referenced nor pinned.
+ */
+class ClockPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructs a clock over the given frame state words.
+   */
+  ClockPolicy(std::atomic<std::uint32_t>* bufStateTable, const std::uint32_t numBufs);
+
+  const char* name() const { return "clock"; }
+  void recordAccess(const FrameId frame);
+  void recordLoad(const FrameId frame, const File* file, const PageId pageNo);
+  void recordRemove(const FrameId frame);
+  void resize(const std::uint32_t numBufs);
+  bool selectVictim(const File* file, const PageId pageNo,
+                    FrameClaimer& claimer, FrameId& frame);
+  void nextVictims(const std::uint32_t count, std::vector<FrameId>& frames);
+
+ private:
+	/**
+   * Most frames the hand looks at before it moves
+	 */
+  static const std::uint32_t SWEEP_FRAMES = 64;
+
+	/**
+   * Returns the index of the first of <count> state words that is neither
+   * referenced nor pinned, or <count> if there is none
+	 */
+  static std::uint32_t firstReclaimable(const std::uint32_t* words, const std::uint32_t count);
+
+	/**
+   * State words of the frames, holding the reference bits and pin counts
+	 */
+  std::atomic<std::uint32_t>* bufStateTable;
+
+	/**
+   * Number of frames in use in the buffer pool
+	 */
+  std::atomic<std::uint32_t> numBufs;
+
+	/**
+   * Current position of clockhand in our buffer pool
+	 */
+  std::atomic<FrameId> clockHand;
+};
+
+}
@@ -0,0 +1,114 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "compressed_cache.h"
+
+#include <cstring>
+#include <utility>
+
+#include "compression.h"
+#include "page.h"
+
+namespace badgerdb {
+
+CompressedCache::CompressedCache(const std::size_t capacity)
+    : capacity_(capacity), bytes_(0) {}
+
+void CompressedCache::put(const File* file, const Page& page) {
+  // Compress before taking the latch, so that threads evicting at once do not
+  // wait on each other's compression.
+  Entry entry;
+  entry.key.file = file->id();
+  entry.key.pageNo = page.page_number();
+  entry.bytes.resize(Page::SIZE);
+  const char* raw = reinterpret_cast<const char*>(&page);
+  const std::size_t length =
+      compressBlock(raw, Page::SIZE, &entry.bytes[0], Page::SIZE - 1);
+  entry.compressed = length != 0;
+  if (entry.compressed) {
+    entry.bytes.resize(length);
+    entry.bytes.shrink_to_fit();
+  } else {
+    std::memcpy(&entry.bytes[0], raw, Page::SIZE);
+  }
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  std::unordered_map<PageKey, EntryList::iterator, PageKeyHash>::iterator old =
+      index_.find(entry.key);
+  if (old != index_.end()) {
+    erase(old->second);
+  }
+  if (entry.bytes.size() > capacity_) {
+    return;
+  }
+  while (bytes_ + entry.bytes.size() > capacity_) {
+    erase(--order_.end());
+  }
+  bytes_ += entry.bytes.size();
+  order_.push_front(std::move(entry));
+  index_[order_.front().key] = order_.begin();
+}
+
+bool CompressedCache::take(const File* file, const PageId pageNo, Page& page) {
+  Entry entry;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    const PageKey key = {file->id(), pageNo};
+    std::unordered_map<PageKey, EntryList::iterator, PageKeyHash>::iterator it =
+        index_.find(key);
+    if (it == index_.end()) {
+      return false;
+    }
+    entry.bytes.swap(it->second->bytes);
+    entry.compressed = it->second->compressed;
+    bytes_ -= entry.bytes.size();
+    order_.erase(it->second);
+    index_.erase(it);
+  }
+  char* raw = reinterpret_cast<char*>(&page);
+  if (!entry.compressed) {
+    std::memcpy(raw, entry.bytes.data(), Page::SIZE);
+    return true;
+  }
+  // A block this cache compressed cannot be malformed, short of a bug; let
+  // the page be read from its file anyway.
+  return decompressBlock(entry.bytes.data(), entry.bytes.size(), raw,
+                         Page::SIZE);
+}
+
+void CompressedCache::remove(const File* file, const PageId pageNo) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  const PageKey key = {file->id(), pageNo};
+  std::unordered_map<PageKey, EntryList::iterator, PageKeyHash>::iterator it =
+      index_.find(key);
+  if (it != index_.end()) {
+    erase(it->second);
+  }
+}
+
+void CompressedCache::removeFile(const File* file) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (EntryList::iterator it = order_.begin(); it != order_.end();) {
+    const EntryList::iterator entry = it++;
+    if (entry->key.file == file->id()) {
+      erase(entry);
+    }
+  }
+}
+
+std::size_t CompressedCache::size() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return index_.size();
+}
+
+void CompressedCache::erase(const EntryList::iterator entry) {
+  bytes_ -= entry->bytes.size();
+  index_.erase(entry->key);
+  order_.erase(entry);
+}
+
+}
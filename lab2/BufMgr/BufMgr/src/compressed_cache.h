@@ -0,0 +1,81 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "replacement_policy.h"
+#include "secondary_cache.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Cache of evicted pages in memory, each compressed with
+ *        compressBlock(), so that memory too small to hold them as frames
+ *        still saves their reads.
+ *
+ * Pages that do not compress are kept as they are.  When the compressed bytes
+ * pass the capacity, the least recently stored pages are dropped.
+ */
+class CompressedCache : public SecondaryCache {
+ public:
+  /**
+   * Creates an empty cache keeping up to <capacity> bytes of pages.
+   */
+  explicit CompressedCache(const std::size_t capacity);
+
+  const char* name() const { return "compressed"; }
+  void put(const File* file, const Page& page);
+  bool take(const File* file, const PageId pageNo, Page& page);
+  void remove(const File* file, const PageId pageNo);
+  void removeFile(const File* file);
+  std::size_t size() const;
+
+ private:
+  /**
+   * A page held, with its stored bytes.
+   */
+  struct Entry {
+    PageKey key;
+    std::string bytes;
+    bool compressed;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  /**
+   * Drops an entry; the caller holds <mutex_>.
+   */
+  void erase(const EntryList::iterator entry);
+
+  /**
+   * Protects everything below.
+   */
+  mutable std::mutex mutex_;
+
+  /**
+   * Most bytes the entries may hold, and the bytes they hold.
+   */
+  std::size_t capacity_;
+  std::size_t bytes_;
+
+  /**
+   * Entries from most (front) to least (back) recently stored.
+   */
+  EntryList order_;
+
+  /**
+   * Position of every page in <order_>.
+   */
+  std::unordered_map<PageKey, EntryList::iterator, PageKeyHash> index_;
+};
+
+}
@@ -0,0 +1,217 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "compression.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Shortest match worth encoding; match lengths are stored less this.
+ */
+const std::size_t MIN_MATCH = 4;
+
+/**
+ * The format requires the last bytes of a block to be literals, and the last
+ * match to start this far before the end.
+ */
+const std::size_t LAST_LITERALS = 5;
+const std::size_t MATCH_LIMIT = 12;
+
+/**
+ * Farthest back a match may be.
+ */
+const std::size_t MAX_OFFSET = 65535;
+
+/**
+ * log2 of the number of entries in the match finder's hash table.
+ */
+const int HASH_BITS = 12;
+
+std::uint32_t read32(const unsigned char* p) {
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+std::uint32_t hash(const std::uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ * Returns the number of bytes needed to extend a 4-bit length field to hold
+ * <length>.
+ */
+std::size_t extensionBytes(const std::size_t length) {
+  return length < 15 ? 0 : (length - 15) / 255 + 1;
+}
+
+/**
+ * Writes the bytes extending a 4-bit length field that holds 15.
+ */
+unsigned char* writeExtension(unsigned char* op, std::size_t length) {
+  for (length -= 15; length >= 255; length -= 255) {
+    *op++ = 255;
+  }
+  *op++ = static_cast<unsigned char>(length);
+  return op;
+}
+
+/**
+ * Reads the bytes extending a 4-bit length field that holds 15, adding them to
+ * <length>.  Returns false if the block ends first or the length passes
+ * <limit>.
+ */
+bool readExtension(const unsigned char*& ip, const unsigned char* end,
+                   std::size_t& length, const std::size_t limit) {
+  unsigned char byte;
+  do {
+    if (ip == end) {
+      return false;
+    }
+    byte = *ip++;
+    length += byte;
+    if (length > limit) {
+      return false;
+    }
+  } while (byte == 255);
+  return true;
+}
+
+}
+
+std::size_t compressBlock(const char* in, const std::size_t length, char* out,
+                          const std::size_t capacity) {
+  const unsigned char* const base = reinterpret_cast<const unsigned char*>(in);
+  const unsigned char* const end = base + length;
+  unsigned char* op = reinterpret_cast<unsigned char*>(out);
+  unsigned char* const op_end = op + capacity;
+  const unsigned char* ip = base;
+  const unsigned char* anchor = base;
+
+  if (length > MATCH_LIMIT) {
+    // Positions of the last sequence seen with each hash.  Stale or colliding
+    // entries are harmless, as every candidate is compared before use.
+    std::uint32_t table[1 << HASH_BITS] = {0};
+    const unsigned char* const match_limit = end - MATCH_LIMIT;
+    const unsigned char* const copy_limit = end - LAST_LITERALS;
+    while (ip < match_limit) {
+      const std::uint32_t sequence = read32(ip);
+      const std::uint32_t h = hash(sequence);
+      const unsigned char* candidate = base + table[h];
+      table[h] = static_cast<std::uint32_t>(ip - base);
+      if (candidate >= ip ||
+          static_cast<std::size_t>(ip - candidate) > MAX_OFFSET ||
+          read32(candidate) != sequence) {
+        ++ip;
+        continue;
+      }
+      const unsigned char* match_end = ip + MIN_MATCH;
+      const unsigned char* from = candidate + MIN_MATCH;
+      while (match_end < copy_limit && *match_end == *from) {
+        ++match_end;
+        ++from;
+      }
+
+      const std::size_t literals = ip - anchor;
+      const std::size_t match = (match_end - ip) - MIN_MATCH;
+      const std::size_t needed = 1 + extensionBytes(literals) + literals + 2 +
+                                 extensionBytes(match);
+      if (needed > static_cast<std::size_t>(op_end - op)) {
+        return 0;
+      }
+      *op++ = static_cast<unsigned char>(
+          ((literals < 15 ? literals : 15) << 4) | (match < 15 ? match : 15));
+      if (literals >= 15) {
+        op = writeExtension(op, literals);
+      }
+      std::memcpy(op, anchor, literals);
+      op += literals;
+      const std::size_t offset = ip - candidate;
+      *op++ = static_cast<unsigned char>(offset & 0xff);
+      *op++ = static_cast<unsigned char>(offset >> 8);
+      if (match >= 15) {
+        op = writeExtension(op, match);
+      }
+      ip = match_end;
+      anchor = ip;
+    }
+  }
+
+  // The rest of the input goes out as the literals of a last sequence.
+  const std::size_t literals = end - anchor;
+  if (1 + extensionBytes(literals) + literals >
+      static_cast<std::size_t>(op_end - op)) {
+    return 0;
+  }
+  *op++ = static_cast<unsigned char>((literals < 15 ? literals : 15) << 4);
+  if (literals >= 15) {
+    op = writeExtension(op, literals);
+  }
+  std::memcpy(op, anchor, literals);
+  op += literals;
+  return op - reinterpret_cast<unsigned char*>(out);
+}
+
+bool decompressBlock(const char* in, const std::size_t length, char* out,
+                     const std::size_t size) {
+  const unsigned char* ip = reinterpret_cast<const unsigned char*>(in);
+  const unsigned char* const end = ip + length;
+  unsigned char* const base = reinterpret_cast<unsigned char*>(out);
+  unsigned char* op = base;
+  unsigned char* const op_end = base + size;
+  for (;;) {
+    if (ip == end) {
+      return false;
+    }
+    const unsigned char token = *ip++;
+    std::size_t literals = token >> 4;
+    if (literals == 15 && !readExtension(ip, end, literals, size)) {
+      return false;
+    }
+    if (literals > static_cast<std::size_t>(end - ip) ||
+        literals > static_cast<std::size_t>(op_end - op)) {
+      return false;
+    }
+    std::memcpy(op, ip, literals);
+    ip += literals;
+    op += literals;
+    if (ip == end) {
+      // The last sequence has no match.
+      return op == op_end;
+    }
+
+    if (end - ip < 2) {
+      return false;
+    }
+    const std::size_t offset = ip[0] | (static_cast<std::size_t>(ip[1]) << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<std::size_t>(op - base)) {
+      return false;
+    }
+    std::size_t match = token & 15;
+    if (match == 15 && !readExtension(ip, end, match, size)) {
+      return false;
+    }
+    match += MIN_MATCH;
+    if (match > static_cast<std::size_t>(op_end - op)) {
+      return false;
+    }
+    // Byte by byte, as a match may overlap the bytes it produces.
+    const unsigned char* from = op - offset;
+    for (std::size_t i = 0; i < match; ++i) {
+      op[i] = from[i];
+    }
+    op += match;
+  }
+}
+
+}
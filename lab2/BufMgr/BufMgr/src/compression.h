@@ -0,0 +1,45 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * Compresses <length> bytes at <in> into <out> in the LZ4 block format: runs
+ * of literal bytes, each followed by a copy of earlier output given as an
+ * offset and a length.  Matches are found greedily through a hash table of
+ * four-byte sequences, which favours speed over ratio, as pages are compressed
+ * on every write.
+ *
+ * @param in        Bytes to compress.
+ * @param length    Number of bytes to compress.
+ * @param out       Buffer receiving the compressed bytes.
+ * @param capacity  Size of <out> in bytes.
+ * @return  Number of compressed bytes, or 0 if they would not fit in <out>.
+ */
+std::size_t compressBlock(const char* in, const std::size_t length, char* out,
+                          const std::size_t capacity);
+
+/**
+ * Decompresses a block written by compressBlock(), checking every length and
+ * offset in it against the buffers, so that a damaged block cannot write
+ * outside <out>.
+ *
+ * @param in        Compressed bytes.
+ * @param length    Number of compressed bytes.
+ * @param out       Buffer receiving the original bytes.
+ * @param size      Number of original bytes.
+ * @return  False if the block is malformed or does not decompress to exactly
+ *          <size> bytes.
+ */
+bool decompressBlock(const char* in, const std::size_t length, char* out,
+                     const std::size_t size);
+
+}
@@ -0,0 +1,280 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * CRC-32C polynomial, bit-reversed.
+ */
+const std::uint32_t POLYNOMIAL = 0x82f63b78;
+
+/**
+ * Bytes each of the three interleaved streams of the hardware loop covers per
+ * round, in long rounds and then in short ones for the rest.  The instruction
+ * has a latency of three cycles but a throughput of one, so three independent
+ * streams keep it busy; joining them costs a few table lookups per round.
+ */
+const std::size_t LONG_STREAM_BYTES = 2048;
+const std::size_t SHORT_STREAM_BYTES = 256;
+
+/**
+ * Returns the product of a 32x32 matrix over GF(2) and a vector.
+ */
+std::uint32_t multiply(const std::uint32_t* matrix, std::uint32_t vector) {
+  std::uint32_t sum = 0;
+  for (; vector != 0; vector >>= 1, ++matrix) {
+    if (vector & 1) {
+      sum ^= *matrix;
+    }
+  }
+  return sum;
+}
+
+/**
+ * Sets <square> to <matrix> times itself.
+ */
+void square(std::uint32_t* square, const std::uint32_t* matrix) {
+  for (int n = 0; n < 32; ++n) {
+    square[n] = multiply(matrix, matrix[n]);
+  }
+}
+
+/**
+ * Lookup tables, built once.
+ */
+struct Tables {
+  /**
+   * slice[k][b] is the CRC of byte b followed by k zero bytes, for the table
+   * loop, which takes eight bytes per step.
+   */
+  std::uint32_t slice[8][256];
+
+  /**
+   * long_shift[k][b] is the CRC of byte b, shifted up by 8 * k bits, followed
+   * by LONG_STREAM_BYTES zero bytes, and short_shift[k][b] the same for
+   * SHORT_STREAM_BYTES.  Looking up the four bytes of a CRC extends it over
+   * that many zero bytes in four steps, which is how the streams of the
+   * hardware loop are joined.
+   */
+  std::uint32_t long_shift[4][256];
+  std::uint32_t short_shift[4][256];
+
+  Tables() {
+    for (std::uint32_t b = 0; b < 256; ++b) {
+      std::uint32_t crc = b;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (POLYNOMIAL & (0u - (crc & 1)));
+      }
+      slice[0][b] = crc;
+    }
+    for (std::uint32_t b = 0; b < 256; ++b) {
+      for (int k = 1; k < 8; ++k) {
+        const std::uint32_t crc = slice[k - 1][b];
+        slice[k][b] = (crc >> 8) ^ slice[0][crc & 0xff];
+      }
+    }
+    zeroes(LONG_STREAM_BYTES, long_shift);
+    zeroes(SHORT_STREAM_BYTES, short_shift);
+  }
+
+  /**
+   * Fills <shift> with the operator extending a CRC over <bytes> zero bytes,
+   * a power of two.
+   */
+  static void zeroes(const std::size_t bytes, std::uint32_t shift[4][256]) {
+    // Operator for one zero bit, squared up to one for <bytes> zero bytes.
+    std::uint32_t op[32];
+    std::uint32_t next[32];
+    op[0] = POLYNOMIAL;
+    for (int n = 1; n < 32; ++n) {
+      op[n] = std::uint32_t(1) << (n - 1);
+    }
+    for (std::size_t bits = 1; bits < bytes * 8; bits *= 2) {
+      square(next, op);
+      std::memcpy(op, next, sizeof(op));
+    }
+    for (std::uint32_t b = 0; b < 256; ++b) {
+      for (int k = 0; k < 4; ++k) {
+        shift[k][b] = multiply(op, b << (8 * k));
+      }
+    }
+  }
+};
+
+const Tables& tables() {
+  static const Tables tables;
+  return tables;
+}
+
+std::uint32_t crc32cTable(std::uint32_t crc, const unsigned char* p,
+                          std::size_t length) {
+  const Tables& t = tables();
+  crc = ~crc;
+  for (; length >= 8; length -= 8, p += 8) {
+    std::uint32_t low;
+    std::uint32_t high;
+    std::memcpy(&low, p, 4);
+    std::memcpy(&high, p + 4, 4);
+    low ^= crc;
+    crc = t.slice[7][low & 0xff] ^ t.slice[6][(low >> 8) & 0xff] ^
+          t.slice[5][(low >> 16) & 0xff] ^ t.slice[4][low >> 24] ^
+          t.slice[3][high & 0xff] ^ t.slice[2][(high >> 8) & 0xff] ^
+          t.slice[1][(high >> 16) & 0xff] ^ t.slice[0][high >> 24];
+  }
+  for (; length > 0; --length, ++p) {
+    crc = (crc >> 8) ^ t.slice[0][(crc ^ *p) & 0xff];
+  }
+  return ~crc;
+}
+
+#if defined(__x86_64__) || (defined(__aarch64__) && defined(__linux__))
+
+#if defined(__x86_64__)
+
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+
+CRC32C_TARGET inline std::uint32_t step8(const std::uint32_t crc,
+                                         const unsigned char* p) {
+  std::uint64_t word;
+  std::memcpy(&word, p, 8);
+  return static_cast<std::uint32_t>(_mm_crc32_u64(crc, word));
+}
+
+CRC32C_TARGET inline std::uint32_t step1(const std::uint32_t crc,
+                                         const unsigned char* p) {
+  return _mm_crc32_u8(crc, *p);
+}
+
+bool cpuHasCrc32c() {
+  // Also run before main(), so initialize the CPU model first.
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+}
+
+#else
+
+#define CRC32C_TARGET
+
+inline std::uint32_t step8(std::uint32_t crc, const unsigned char* p) {
+  std::uint64_t word;
+  std::memcpy(&word, p, 8);
+  __asm__(".arch_extension crc\n\tcrc32cx %w0, %w0, %x1"
+          : "+r"(crc) : "r"(word));
+  return crc;
+}
+
+inline std::uint32_t step1(std::uint32_t crc, const unsigned char* p) {
+  const std::uint32_t byte = *p;
+  __asm__(".arch_extension crc\n\tcrc32cb %w0, %w0, %w1"
+          : "+r"(crc) : "r"(byte));
+  return crc;
+}
+
+bool cpuHasCrc32c() {
+  // HWCAP_CRC32 in <asm/hwcap.h>.
+  return (getauxval(AT_HWCAP) & (1 << 7)) != 0;
+}
+
+#endif
+
+/**
+ * Extends a CRC, before its final inversion, over the zero bytes of <shift>.
+ */
+inline std::uint32_t extend(const std::uint32_t shift[4][256],
+                            const std::uint32_t crc) {
+  return shift[0][crc & 0xff] ^ shift[1][(crc >> 8) & 0xff] ^
+         shift[2][(crc >> 16) & 0xff] ^ shift[3][crc >> 24];
+}
+
+/**
+ * Runs rounds of three interleaved streams of <stream> bytes each while the
+ * input lasts, advancing <p> and <length>.  Returns the CRC before its final
+ * inversion.
+ */
+CRC32C_TARGET inline std::uint32_t interleave(
+    std::uint32_t crc, const unsigned char*& p, std::size_t& length,
+    const std::size_t stream, const std::uint32_t shift[4][256]) {
+  while (length >= 3 * stream) {
+    // CRC of A B C is that of A extended over |B| zeroes, XOR that of B from
+    // zero, and so on; the extension is linear, hence the shift tables.
+    std::uint32_t crc1 = 0;
+    std::uint32_t crc2 = 0;
+    const unsigned char* end = p + stream;
+    for (; p < end; p += 8) {
+      crc = step8(crc, p);
+      crc1 = step8(crc1, p + stream);
+      crc2 = step8(crc2, p + 2 * stream);
+    }
+    crc = extend(shift, crc) ^ crc1;
+    crc = extend(shift, crc) ^ crc2;
+    p += 2 * stream;
+    length -= 3 * stream;
+  }
+  return crc;
+}
+
+CRC32C_TARGET std::uint32_t crc32cInstructions(std::uint32_t crc,
+                                               const unsigned char* p,
+                                               std::size_t length) {
+  const Tables& t = tables();
+  crc = interleave(~crc, p, length, LONG_STREAM_BYTES, t.long_shift);
+  crc = interleave(crc, p, length, SHORT_STREAM_BYTES, t.short_shift);
+  for (; length >= 8; length -= 8, p += 8) {
+    crc = step8(crc, p);
+  }
+  for (; length > 0; --length, ++p) {
+    crc = step1(crc, p);
+  }
+  return ~crc;
+}
+
+#undef CRC32C_TARGET
+
+typedef std::uint32_t (*Crc32cFunction)(std::uint32_t, const unsigned char*,
+                                        std::size_t);
+
+Crc32cFunction chooseCrc32c() {
+  return cpuHasCrc32c() ? crc32cInstructions : crc32cTable;
+}
+
+#else
+
+typedef std::uint32_t (*Crc32cFunction)(std::uint32_t, const unsigned char*,
+                                        std::size_t);
+
+Crc32cFunction chooseCrc32c() {
+  return crc32cTable;
+}
+
+#endif
+
+const Crc32cFunction implementation = chooseCrc32c();
+
+}
+
+std::uint32_t crc32c(const std::uint32_t crc, const void* data,
+                     const std::size_t length) {
+  return implementation(crc, static_cast<const unsigned char*>(data), length);
+}
+
+bool crc32cHardware() {
+  return implementation != crc32cTable;
+}
+
+}
@@ -0,0 +1,36 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * Returns the CRC-32C (Castagnoli) of <length> bytes at <data>.  <crc> is the
+ * CRC of the bytes before them, so that a CRC can be computed in pieces; it is
+ * 0 for the first piece.
+ *
+ * Uses the CRC32 instructions of SSE4.2 or ARMv8 when the CPU has them, and a
+ * table otherwise; the result is the same either way.
+ *
+ * @param crc     CRC of the preceding bytes.
+ * @param data    Bytes to checksum.
+ * @param length  Number of bytes.
+ * @return  CRC of the preceding bytes followed by these.
+ */
+std::uint32_t crc32c(const std::uint32_t crc, const void* data,
+                     const std::size_t length);
+
+/**
+ * Returns true if crc32c() runs on the CPU's CRC32 instructions.
+ */
+bool crc32cHardware();
+
+}
@@ -0,0 +1,256 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "external_sort.h"
+
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+
+namespace badgerdb {
+
+namespace {
+
+// numbers the temporary files of every sort in the process, whose names must
+// differ while they are open.
+std::atomic<std::uint64_t> next_file(0);
+
+bool lessBytes(const RecordView& a, const RecordView& b) {
+  return a.compare(b) < 0;
+}
+
+}
+
+ExternalSort::ExternalSort(BufMgr* buf_mgr, const std::size_t frames,
+                           const Less& less)
+    : buf_mgr_(buf_mgr), less_(less ? less : Less(lessBytes)),
+      runs_written_(0) {
+  const std::size_t budget = std::max<std::size_t>(frames, 3);
+  // one frame is kept for the page of the run being written.
+  workspace_pages_ = budget - 1;
+  // every run being merged pins one page and has the next one prefetched.
+  fan_in_ = std::max<std::size_t>((budget - 1) / 2, 2);
+  workspace_file_ = createFile(false /* spill */);
+}
+
+ExternalSort::~ExternalSort() {
+  try {
+    readers_.clear();
+    output_.release();
+    clearWorkspace();
+    buf_mgr_->dropFile(workspace_file_.get());
+    for (std::size_t i = 0; i < runs_.size(); ++i) {
+      dropRun(runs_[i]);
+    }
+  } catch (...) {
+  }
+}
+
+void ExternalSort::add(const RecordView& record) {
+  if (workspace_.empty() || !workspace_.back()->hasSpaceForRecord(record)) {
+    if (workspace_.size() == workspace_pages_) {
+      spill();
+    }
+    PageId page_number;
+    workspace_.push_back(buf_mgr_->allocPage(workspace_file_.get(), page_number));
+  }
+  const RecordId record_id = workspace_.back()->insertRecord(record);
+  records_.push_back(std::make_pair(workspace_.size() - 1, record_id));
+}
+
+void ExternalSort::finish(
+    const std::function<void(const RecordView&)>& emit) {
+  if (runs_.empty()) {
+    // everything fits in the workspace; no run is written.
+    const std::vector<RecordView> sorted = sortWorkspace();
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+      emit(sorted[i]);
+    }
+    clearWorkspace();
+    return;
+  }
+  if (!records_.empty()) {
+    spill();
+  }
+  clearWorkspace();
+
+  // merge consecutive runs into longer ones until a single pass is left;
+  // keeping them in order keeps the sort stable.
+  while (runs_.size() > fan_in_) {
+    std::vector<Run> merged;
+    for (std::size_t first = 0; first < runs_.size(); first += fan_in_) {
+      const std::size_t count = std::min(fan_in_, runs_.size() - first);
+      if (count == 1) {
+        merged.push_back(std::move(runs_[first]));
+        continue;
+      }
+      Run run = createRun();
+      merge(first, count,
+            [this, &run](const RecordView& record) { writeRecord(run, record); });
+      output_.release();
+      for (std::size_t i = first; i < first + count; ++i) {
+        dropRun(runs_[i]);
+      }
+      merged.push_back(std::move(run));
+    }
+    runs_.swap(merged);
+  }
+  merge(0, runs_.size(), emit);
+  for (std::size_t i = 0; i < runs_.size(); ++i) {
+    dropRun(runs_[i]);
+  }
+  runs_.clear();
+}
+
+std::unique_ptr<File> ExternalSort::createFile(const bool spill) {
+  std::ostringstream name;
+  name << "badgerdb.sort." << next_file++;
+  return std::unique_ptr<File>(new File(
+      spill ? File::createSpill(name.str()) : File::createTemporary(name.str())));
+}
+
+ExternalSort::Run ExternalSort::createRun() {
+  Run run;
+  run.file = createFile(true /* spill */);
+  ++runs_written_;
+  return run;
+}
+
+std::vector<RecordView> ExternalSort::sortWorkspace() {
+  std::vector<RecordView> sorted;
+  sorted.reserve(records_.size());
+  for (std::size_t i = 0; i < records_.size(); ++i) {
+    sorted.push_back(
+        workspace_[records_[i].first]->getRecordView(records_[i].second));
+  }
+  std::stable_sort(sorted.begin(), sorted.end(), less_);
+  return sorted;
+}
+
+void ExternalSort::clearWorkspace() {
+  for (std::size_t i = 0; i < workspace_.size(); ++i) {
+    const PageId page_number = workspace_[i]->page_number();
+    workspace_[i].release();
+    buf_mgr_->disposePage(workspace_file_.get(), page_number);
+  }
+  workspace_.clear();
+  records_.clear();
+}
+
+void ExternalSort::spill() {
+  const std::vector<RecordView> sorted = sortWorkspace();
+  Run run = createRun();
+  for (std::size_t i = 0; i < sorted.size(); ++i) {
+    writeRecord(run, sorted[i]);
+  }
+  output_.release();
+  runs_.push_back(std::move(run));
+  clearWorkspace();
+}
+
+void ExternalSort::merge(const std::size_t first, const std::size_t count,
+                         const std::function<void(const RecordView&)>& emit) {
+  readers_.clear();
+  readers_.resize(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    RunReader& reader = readers_[i];
+    reader.run = &runs_[first + i];
+    reader.next_page = 0;
+    reader.done = false;
+    nextPage(reader);
+  }
+
+  // leaf i of the tree is node count + i, and node n plays the winners of
+  // nodes 2n and 2n + 1 against each other.
+  tree_.assign(count, 0);
+  std::vector<std::size_t> winners(2 * count);
+  for (std::size_t i = 0; i < count; ++i) {
+    winners[count + i] = i;
+  }
+  for (std::size_t node = count - 1; node > 0; --node) {
+    const std::size_t left = winners[2 * node];
+    const std::size_t right = winners[2 * node + 1];
+    const bool left_wins = before(left, right);
+    winners[node] = left_wins ? left : right;
+    tree_[node] = left_wins ? right : left;
+  }
+  tree_[0] = winners[1];
+
+  while (!readers_[tree_[0]].done) {
+    std::size_t winner = tree_[0];
+    emit(readers_[winner].current);
+    advance(readers_[winner]);
+    // replay the matches on the way from the winner's leaf to the root.
+    for (std::size_t node = (count + winner) / 2; node > 0; node /= 2) {
+      if (before(tree_[node], winner)) {
+        std::swap(tree_[node], winner);
+      }
+    }
+    tree_[0] = winner;
+  }
+  readers_.clear();
+}
+
+void ExternalSort::nextPage(RunReader& reader) {
+  reader.page.release();
+  const std::vector<PageId>& pages = reader.run->pages;
+  while (reader.next_page < pages.size()) {
+    reader.page = buf_mgr_->readPage(reader.run->file.get(),
+                                     pages[reader.next_page++]);
+    if (reader.next_page < pages.size()) {
+      buf_mgr_->prefetch(reader.run->file.get(), pages[reader.next_page], 1);
+    }
+    reader.record = reader.page->begin();
+    if (reader.record != reader.page->end()) {
+      reader.current = reader.record.view();
+      return;
+    }
+    reader.page.release();
+  }
+  reader.done = true;
+}
+
+void ExternalSort::advance(RunReader& reader) {
+  ++reader.record;
+  if (reader.record != reader.page->end()) {
+    reader.current = reader.record.view();
+  } else {
+    nextPage(reader);
+  }
+}
+
+bool ExternalSort::before(const std::size_t a, const std::size_t b) const {
+  const RunReader& x = readers_[a];
+  const RunReader& y = readers_[b];
+  if (x.done || y.done) {
+    return !x.done || (y.done && a < b);
+  }
+  if (less_(x.current, y.current)) {
+    return true;
+  }
+  return !less_(y.current, x.current) && a < b;
+}
+
+void ExternalSort::writeRecord(Run& run, const RecordView& record) {
+  if (!output_ || !output_->hasSpaceForRecord(record)) {
+    // a page is unpinned as soon as it is full, so the pool may spill it.
+    output_.release();
+    PageId page_number;
+    output_ = buf_mgr_->allocPage(run.file.get(), page_number);
+    run.pages.push_back(page_number);
+  }
+  output_->insertRecord(record);
+}
+
+void ExternalSort::dropRun(Run& run) {
+  if (run.file) {
+    buf_mgr_->dropFile(run.file.get());
+    run.file.reset();
+  }
+}
+
+}
@@ -0,0 +1,249 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "page_iterator.h"
+#include "record_view.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Sort of a stream of records larger than memory, spilling sorted runs
+ *        to temporary files through a BufMgr.
+ *
+ * Records added are inserted into a workspace of pages pinned in the buffer
+ * pool.  When the workspace is full its records are sorted and written out as
+ * a run: a temporary file whose pages hold the records in order.  finish()
+ * then merges the runs, as many at a time as the frame budget allows, with a
+ * loser tree, so that picking the next record costs log2 of the fan-in
+ * comparisons.  Each run being merged keeps its current page pinned and has
+ * its next one prefetched, so reading a run overlaps with merging.  Input
+ * that fits in the workspace is sorted without writing any run.
+ *
+ * The sort never pins more than its budget of frames; pages of runs that are
+ * not pinned stay in the pool until it needs the frames, and are written to
+ * disk when it does, see File::createSpill, so memory use stays bounded by the
+ * pool however large the input.  Runs are dropped without being written back
+ * once merged.
+ *
+ * Records equal under the ordering come out in the order they were added.
+ * A sort is used by one thread at a time.
+ */
+class ExternalSort {
+ public:
+  /**
+   * Ordering of records: returns true if the first sorts before the second.
+   */
+  typedef std::function<bool(const RecordView&, const RecordView&)> Less;
+
+  /**
+   * Sets up an empty sort.
+   *
+   * @param buf_mgr   Buffer manager the workspace and runs are kept in; must
+   *                  outlive the sort.
+   * @param frames    Most frames the sort pins at once; at least 3 are used.
+   * @param less      Ordering of the records; by default their bytes are
+   *                  compared like strings.
+   */
+  ExternalSort(BufMgr* buf_mgr, const std::size_t frames,
+               const Less& less = Less());
+
+  /**
+   * Unpins the workspace and drops every run.
+   */
+  ~ExternalSort();
+
+  ExternalSort(const ExternalSort&) = delete;
+  ExternalSort& operator=(const ExternalSort&) = delete;
+
+  /**
+   * Adds a record to the sort, writing out a run if the workspace is full.
+   *
+   * @param record  Bytes of the record; copied.
+   * @throws  InsufficientSpaceException  If the record does not fit in an
+   *                                      empty page.
+   */
+  void add(const RecordView& record);
+
+  /**
+   * Calls <emit> with every record added, in order, and leaves the sort
+   * empty for more records.  The view passed to <emit> is only valid during
+   * the call.
+   *
+   * @param emit  Function called for each record.
+   */
+  void finish(const std::function<void(const RecordView&)>& emit);
+
+  /**
+   * Returns the number of runs written since the sort was created, including
+   * those written by merge passes before the last.
+   */
+  std::uint64_t runsWritten() const { return runs_written_; }
+
+  /**
+   * Returns the number of runs merged at most at once.
+   */
+  std::size_t fanIn() const { return fan_in_; }
+
+ private:
+  /**
+   * Sorted records in the pages of a temporary file.
+   */
+  struct Run {
+    std::unique_ptr<File> file;
+    std::vector<PageId> pages;
+  };
+
+  /**
+   * Position of the merge in one run.
+   */
+  struct RunReader {
+    Run* run;
+    std::size_t next_page;
+    PageGuard page;
+    PageIterator record;
+    RecordView current;
+    bool done;
+  };
+
+  /**
+   * Returns a new, empty temporary file.
+   *
+   * @param spill   Whether the file's pages are kept on disk rather than in
+   *                memory; see File::createSpill.
+   */
+  std::unique_ptr<File> createFile(const bool spill);
+
+  /**
+   * Returns the records in the workspace sorted, as views into its pages.
+   */
+  std::vector<RecordView> sortWorkspace();
+
+  /**
+   * Unpins the pages of the workspace and gives them back to its file.
+   */
+  void clearWorkspace();
+
+  /**
+   * Sorts the workspace into a new run and empties it.
+   */
+  void spill();
+
+  /**
+   * Merges <count> runs starting at runs_[first], calling <emit> with each
+   * record in order.
+   */
+  void merge(const std::size_t first, const std::size_t count,
+             const std::function<void(const RecordView&)>& emit);
+
+  /**
+   * Pins the next page of a run into its reader, prefetching the one after,
+   * or marks the reader done at the end of the run.
+   */
+  void nextPage(RunReader& reader);
+
+  /**
+   * Moves a reader to its next record.
+   */
+  void advance(RunReader& reader);
+
+  /**
+   * Returns true if the current record of reader <a> is output before that of
+   * reader <b>.  Exhausted readers come last; ties go to the earlier run.
+   */
+  bool before(const std::size_t a, const std::size_t b) const;
+
+  /**
+   * Returns a new, empty run.
+   */
+  Run createRun();
+
+  /**
+   * Appends a record to <run>, whose last page is kept pinned in <output_>
+   * until it is full or released.
+   */
+  void writeRecord(Run& run, const RecordView& record);
+
+  /**
+   * Drops a run's pages from the buffer pool and closes its file.
+   */
+  void dropRun(Run& run);
+
+  /**
+   * Buffer manager the workspace and runs are kept in.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * Ordering of the records.
+   */
+  Less less_;
+
+  /**
+   * Number of pages in a full workspace.
+   */
+  std::size_t workspace_pages_;
+
+  /**
+   * Most runs merged at once.
+   */
+  std::size_t fan_in_;
+
+  /**
+   * File the workspace pages are allocated in.
+   */
+  std::unique_ptr<File> workspace_file_;
+
+  /**
+   * Pinned pages holding the records added since the last run.
+   */
+  std::vector<PageGuard> workspace_;
+
+  /**
+   * IDs of the records in the workspace, in the order they were added.
+   */
+  std::vector<std::pair<std::size_t, RecordId> > records_;
+
+  /**
+   * Runs not merged yet, oldest first.
+   */
+  std::vector<Run> runs_;
+
+  /**
+   * Last page of the run being written, if it is not full.
+   */
+  PageGuard output_;
+
+  /**
+   * Readers of the runs being merged.
+   */
+  std::vector<RunReader> readers_;
+
+  /**
+   * Loser tree over <readers_>: tree_[0] is the reader with the next record
+   * and each other node the reader that lost the match there.
+   */
+  std::vector<std::size_t> tree_;
+
+  /**
+   * Number of runs written.
+   */
+  std::uint64_t runs_written_;
+};
+
+}
@@ -7,14 +7,32 @@
 
 #include "file.h"
 
-#include <fstream>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <cstdio>
 #include <cassert>
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <cstring>
+#include <vector>
 
+#include "compression.h"
+#include "crc32c.h"
+#include "exceptions/badgerdb_exception.h"
+#include "exceptions/corrupt_page_exception.h"
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
@@ -23,15 +41,116 @@
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
-File::CountMap File::open_counts_;
+namespace {
+
+/**
+ * Set in the free_space_upper_bound of a stored page header when the page's
+ * data is stored compressed.  The bound itself never exceeds Page::DATA_SIZE.
+ */
+const std::uint16_t STORED_COMPRESSED = 0x8000;
+
+static_assert(Page::DATA_SIZE < STORED_COMPRESSED,
+              "Free space bounds must leave the top bit free.");
+
+/**
+ * Holds the layout latch of a file exclusively for its lifetime.
+ */
+class LayoutChange {
+ public:
+  explicit LayoutChange(FileHandle& handle) : handle_(handle) {
+    pthread_rwlock_wrlock(&handle_.layout_latch);
+  }
+  ~LayoutChange() { pthread_rwlock_unlock(&handle_.layout_latch); }
+
+  LayoutChange(const LayoutChange&) = delete;
+  LayoutChange& operator=(const LayoutChange&) = delete;
+
+ private:
+  FileHandle& handle_;
+};
+
+/**
+ * Aligned buffer staging one direct transfer of unaligned buffers; each
+ * transfer has its own, so that transfers can run concurrently.
+ */
+class BounceBuffer {
+ public:
+  explicit BounceBuffer(const std::size_t size) {
+    void* buffer = NULL;
+    if (posix_memalign(&buffer, File::DIRECT_ALIGNMENT, size) != 0) {
+      throw std::bad_alloc();
+    }
+    data_ = static_cast<char*>(buffer);
+  }
+  ~BounceBuffer() { free(data_); }
+
+  BounceBuffer(const BounceBuffer&) = delete;
+  BounceBuffer& operator=(const BounceBuffer&) = delete;
+
+  char* data() const { return data_; }
+
+ private:
+  char* data_;
+};
+
+}
+
+const std::size_t File::DIRECT_ALIGNMENT;
+const std::uint32_t File::FORMAT_VERSION;
+const PageId File::PAGES_PER_BITMAP;
+const FileId File::INVALID_ID;
+
+File::HandleMap File::open_handles_;
+std::deque<FileId> File::free_ids_;
+FileId File::next_id_ = 0;
+
+FileHandle::FileHandle(const int fd, const bool direct)
+    : fd(fd), direct(direct), bitmap_loaded(false), map(NULL), map_size(0), header_loaded(false),
+      header_dirty(false), verify_checksums(true), id(File::INVALID_ID),
+      open_count(0), temporary(false) {
+  pthread_rwlock_init(&layout_latch, NULL);
+}
+
+FileHandle::~FileHandle() {
+  if (map != NULL) {
+    munmap(const_cast<char*>(map), map_size);
+  }
+  ::close(fd);
+  pthread_rwlock_destroy(&layout_latch);
+}
+
+File::WriteScope::WriteScope(const File& file) : handle_(file.handle_) {
+  pthread_rwlock_rdlock(&handle_->layout_latch);
+}
+
+File::WriteScope::~WriteScope() {
+  pthread_rwlock_unlock(&handle_->layout_latch);
+}
+
+File File::create(const std::string& filename, const bool direct,
+                  const bool compressed) {
+  return File(filename, true /* create_new */, direct, false /* mapped */,
+              compressed);
+}
+
+File File::open(const std::string& filename, const bool direct) {
+  return File(filename, false /* create_new */, direct);
+}
+
+File File::openMapped(const std::string& filename) {
+  return File(filename, false /* create_new */, false /* direct */,
+              true /* mapped */);
+}
 
-File File::create(const std::string& filename) {
-  return File(filename, true /* create_new */);
+File File::createTemporary(const std::string& filename) {
+  return File(filename, true /* create_new */, false /* direct */,
+              false /* mapped */, false /* compressed */, true /* temporary */);
 }
 
-File File::open(const std::string& filename) {
-  return File(filename, false /* create_new */);
+File File::createSpill(const std::string& filename) {
+  return File(filename, true /* create_new */, false /* direct */,
+              false /* mapped */, false /* compressed */, true /* temporary */,
+              true /* spill */);
 }
 
 void File::remove(const std::string& filename) {
@@ -45,35 +164,35 @@ void File::remove(const std::string& filename) {
 }
 
 bool File::isOpen(const std::string& filename) {
-  if (!exists(filename)) {
-    return false;
-  }
-  return open_counts_.find(filename) != open_counts_.end();
+  // temporary files are open without existing.
+  return open_handles_.find(filename) != open_handles_.end();
 }
 
 bool File::exists(const std::string& filename) {
-	std::fstream file(filename);
-	if(file)
-	{
-		file.close();
-		return true;
-	}
-
-	return false;
+  return access(filename.c_str(), F_OK) == 0;
 }
 
 File::File(const File& other)
   : filename_(other.filename_),
-    stream_(open_streams_[filename_]) {
-  ++open_counts_[filename_];
+    handle_(other.handle_) {
+  ++handle_->open_count;
 }
 
 File& File::operator=(const File& rhs) {
   // This accounts for self-assignment and assignment of a File object for the
   // same file.
+  if (handle_ == rhs.handle_) {
+    return *this;
+  }
+  // Take the new reference before the old one is released, like the copy
+  // constructor does.
+  const std::shared_ptr<FileHandle> handle = rhs.handle_;
+  if (handle) {
+    ++handle->open_count;
+  }
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
-  openIfNeeded(false /* create_new */);
+  handle_ = handle;
   return *this;
 }
 
@@ -82,132 +201,353 @@ File::~File() {
 }
 
 Page File::allocatePage() {
-  FileHeader header = readHeader();
   Page new_page;
-  Page existing_page;
+  allocatePage(new_page);
+  return new_page;
+}
+
+void File::allocatePage(Page& new_page) {
+  checkWritable();
+  const LayoutChange change(*handle_);
+  FileHeader header = readHeader();
+  loadBitmap(header);
+  PageId page_number;
   if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
-    new_page.set_page_number(header.first_free_page);
-    header.first_free_page = new_page.next_page_number();
+    // Reuse the lowest free page, which keeps the file dense.
+    page_number = header.first_free_page;
     --header.num_free_pages;
-
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page later
-      // than the one we just allocated, so add the new page to the head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
-    } else {
-      // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
-    }
-
-    assert((header.num_free_pages == 0) ==
-           (header.first_free_page == Page::INVALID_NUMBER));
+    header.first_free_page =
+        header.num_free_pages == 0
+            ? static_cast<PageId>(Page::INVALID_NUMBER)
+            : findPage(page_number + 1, header.num_pages, false /* used */);
   } else {
-    new_page.set_page_number(header.num_pages);
-    if (header.first_used_page == Page::INVALID_NUMBER) {
-      header.first_used_page = new_page.page_number();
-    } else {
-      // If we have pages allocated, we need to add the new page to the tail
-      // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
-    }
+    page_number = header.num_pages;
     ++header.num_pages;
   }
-  writePage(new_page.page_number(), new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page);
+  assert((header.num_free_pages == 0) ==
+         (header.first_free_page == Page::INVALID_NUMBER));
+
+  // Link the page into the used list between its neighbours in the bitmap.
+  const PageId previous = page_number > header.last_used_page
+                              ? header.last_used_page
+                              : findPreviousUsedPage(page_number);
+  const PageId next = page_number > header.last_used_page
+                          ? static_cast<PageId>(Page::INVALID_NUMBER)
+                          : findPage(page_number + 1, header.num_pages,
+                                     true /* used */);
+  new_page.initialize();
+  new_page.set_page_number(page_number);
+  new_page.set_next_page_number(next);
+  if (previous == Page::INVALID_NUMBER) {
+    header.first_used_page = page_number;
+  } else {
+    writeNextPageNumber(previous, page_number);
+  }
+  if (next == Page::INVALID_NUMBER) {
+    header.last_used_page = page_number;
   }
-  writeHeader(header);
 
-  return new_page;
+  setPageUsed(page_number, true);
+  writePage(page_number, new_page);
+  writeHeader(header);
 }
 
 Page File::readPage(const PageId page_number) const {
+  Page page;
+  readPage(page_number, page);
+  return page;
+}
+
+void File::readPage(const PageId page_number, Page& page) const {
   FileHeader header = readHeader();
   if (page_number >= header.num_pages) {
     throw InvalidPageException(page_number, filename_);
   }
-  return readPage(page_number, false /* allow_free */);
+  readPage(page_number, false /* allow_free */, page);
 }
 
 Page File::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(page.header_));
-  stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
+  readPage(page_number, allow_free, page);
+  return page;
+}
+
+void File::readPage(const PageId page_number, const bool allow_free,
+                    Page& page) const {
+  struct iovec iov = {&page, Page::SIZE};
+  readAt(pagePosition(page_number), &iov, 1);
+  decodePage(page_number, page);
+  verifyChecksum(page_number, page);
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
+}
 
-  return page;
+void File::readPages(const PageId first, const PageId count, Page* out) const {
+  if (count == 0) {
+    return;
+  }
+  FileHeader header = readHeader();
+  if (first == Page::INVALID_NUMBER || first >= header.num_pages) {
+    throw InvalidPageException(first, filename_);
+  }
+  if (count > header.num_pages - first) {
+    throw InvalidPageException(header.num_pages, filename_);
+  }
+  for (PageId done = 0; done < count; ) {
+    // A run is contiguous on disk up to the next bitmap page.
+    const PageId page = first + done;
+    const PageId run = std::min(count - done, lastPageOfGroup(page) - page + 1);
+    struct iovec iov = {out + done, run * Page::SIZE};
+    readAt(pagePosition(page), &iov, 1);
+    done += run;
+  }
+  for (PageId i = 0; i < count; ++i) {
+    Page& page = out[i];
+    decodePage(first + i, page);
+    verifyChecksum(first + i, page);
+    if (!page.isUsed()) {
+      throw InvalidPageException(first + i, filename_);
+    }
+  }
+}
+
+namespace {
+
+/**
+ * Orders indices into an array of pages by page number.
+ */
+struct ByPageNumber {
+  const Page* pages;
+  bool operator()(const std::size_t lhs, const std::size_t rhs) const {
+    return pages[lhs].page_number() < pages[rhs].page_number();
+  }
+};
+
+}
+
+void File::writePages(const Page* pages, const std::size_t n) {
+  checkWritable();
+  const WriteScope scope(*this);
+  std::vector<std::size_t> order(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    order[i] = i;
+  }
+  ByPageNumber by_page_number = {pages};
+  std::sort(order.begin(), order.end(), by_page_number);
+
+  std::vector<char> buffer;
+  std::size_t begin = 0;
+  while (begin < n) {
+    // Find the run of adjacent page numbers starting at <begin>.
+    const PageId first = pages[order[begin]].page_number();
+    std::size_t end = begin + 1;
+    while (end < n && pages[order[end]].page_number() ==
+                          first + static_cast<PageId>(end - begin) &&
+           pages[order[end]].page_number() <= lastPageOfGroup(first)) {
+      ++end;
+    }
+    const std::size_t count = end - begin;
+
+    buffer.resize(count * Page::SIZE);
+    struct iovec iov = {&buffer[0], buffer.size()};
+    for (std::size_t i = 0; i < count; ++i) {
+      const Page& page = pages[order[begin + i]];
+      char* raw = &buffer[i * Page::SIZE];
+      PageHeader header = page.header_;
+      header.next_page_number = nextPageForWrite(page.page_number());
+      header.checksum = checksum(header, page.data_);
+      std::memcpy(raw, &header, sizeof(header));
+      std::memcpy(raw + sizeof(header), page.data_, Page::DATA_SIZE);
+    }
+    if (isCompressed()) {
+      // Stored pages vary in size, so each is written on its own.
+      for (std::size_t i = 0; i < count; ++i) {
+        writeStored(first + static_cast<PageId>(i),
+                    *reinterpret_cast<const Page*>(&buffer[i * Page::SIZE]));
+      }
+    } else {
+      writeAt(pagePosition(first), &iov, 1);
+    }
+    begin = end;
+  }
+}
+
+PageId File::appendPages(Page* pages, const std::size_t n) {
+  checkWritable();
+  const LayoutChange change(*handle_);
+  FileHeader header = readHeader();
+  loadBitmap(header);
+  const PageId first = header.num_pages;
+  if (n == 0) {
+    return first;
+  }
+  const PageId last = first + static_cast<PageId>(n) - 1;
+  for (std::size_t i = 0; i < n; ++i) {
+    pages[i].set_page_number(first + static_cast<PageId>(i));
+    pages[i].set_next_page_number(
+        i + 1 < n ? first + static_cast<PageId>(i) + 1
+                  : static_cast<PageId>(Page::INVALID_NUMBER));
+    pages[i].header_.checksum = checksum(pages[i].header_, pages[i].data_);
+  }
+
+  if (isCompressed()) {
+    for (std::size_t i = 0; i < n; ++i) {
+      writeStored(first + static_cast<PageId>(i), pages[i]);
+    }
+  }
+  for (PageId done = 0; done < n && !isCompressed(); ) {
+    const PageId page = first + done;
+    const PageId run =
+        std::min(static_cast<PageId>(n) - done, lastPageOfGroup(page) - page + 1);
+    struct iovec iov = {pages + done, run * Page::SIZE};
+    writeAt(pagePosition(page), &iov, 1);
+    done += run;
+  }
+
+  // Set the bits of the whole run, then write each bitmap page touched once.
+  std::vector<std::uint64_t>& bitmap = handle_->bitmap;
+  const std::size_t words_per_group = PAGES_PER_BITMAP / 64;
+  const PageId last_group = (last - 1) / PAGES_PER_BITMAP;
+  if (bitmap.size() < (last_group + 1) * words_per_group) {
+    bitmap.resize((last_group + 1) * words_per_group, 0);
+  }
+  for (PageId page = first; page <= last; ++page) {
+    bitmap[(page - 1) / 64] |= std::uint64_t(1) << ((page - 1) % 64);
+  }
+  for (PageId group = (first - 1) / PAGES_PER_BITMAP; group <= last_group;
+       ++group) {
+    struct iovec iov = {&bitmap[group * words_per_group], Page::SIZE};
+    writeAt(bitmapPosition(group), &iov, 1);
+  }
+
+  if (header.last_used_page == Page::INVALID_NUMBER) {
+    header.first_used_page = first;
+  } else {
+    writeNextPageNumber(header.last_used_page, first);
+  }
+  header.last_used_page = last;
+  header.num_pages = last + 1;
+  writeHeader(header);
+  return first;
+}
+
+std::vector<PageId> File::usedPages() const {
+  const WriteScope scope(*this);  // keeps the bitmap from changing
+  FileHeader header = readHeader();
+  loadBitmap(header);
+  std::vector<PageId> pages;
+  PageId page = findPage(1, header.num_pages, true /* used */);
+  while (page != Page::INVALID_NUMBER) {
+    pages.push_back(page);
+    page = findPage(page + 1, header.num_pages, true /* used */);
+  }
+  return pages;
+}
+
+void File::prepareRead(const PageId page_number, Page& page,
+                       IoRequest& request) const {
+  FileHeader header = readHeader();
+  if (page_number == Page::INVALID_NUMBER || page_number >= header.num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  request.write = false;
+  request.fd = handle_->fd;
+  request.offset = pagePosition(page_number);
+  request.iov.iov_base = &page;
+  request.iov.iov_len = Page::SIZE;
+  request.result = 0;
+}
+
+void File::finishRead(const PageId page_number, Page& page,
+                      const IoRequest& request) const {
+  if (request.result != static_cast<ssize_t>(Page::SIZE)) {
+    // An error, end of file or a short read; the synchronous path tells them
+    // apart.
+    readPage(page_number, false /* allow_free */, page);
+    return;
+  }
+  decodePage(page_number, page);
+  verifyChecksum(page_number, page);
+  if (!page.isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+}
+
+void File::prepareWrite(const Page& new_page, Page& staging,
+                        IoRequest& request) {
+  checkWritable();
+  const PageId page_number = new_page.page_number();
+  staging = new_page;
+  staging.header_.next_page_number = nextPageForWrite(page_number);
+  staging.header_.checksum = checksum(staging.header_, staging.data_);
+  std::size_t stored_size = Page::SIZE;
+  if (isCompressed()) {
+    const Page page = staging;
+    stored_size = encodePage(page, staging);
+  }
+  request.write = true;
+  request.fd = handle_->fd;
+  request.offset = pagePosition(page_number);
+  request.iov.iov_base = &staging;
+  request.iov.iov_len = stored_size;
+  request.result = 0;
+}
+
+void File::finishWrite(const Page& staging, const IoRequest& request) {
+  if (request.result != static_cast<ssize_t>(request.iov.iov_len)) {
+    struct iovec iov = {const_cast<Page*>(&staging), request.iov.iov_len};
+    writeAt(request.offset, &iov, 1);
+  }
+  if (request.iov.iov_len < Page::SIZE) {
+    releaseTail(request.offset, request.iov.iov_len);
+  }
 }
 
 void File::writePage(const Page& new_page) {
-  PageHeader header = readPageHeader(new_page.page_number());
-  if (header.current_page_number == Page::INVALID_NUMBER) {
-    // Page has been deleted since it was read.
-    throw InvalidPageException(new_page.page_number(), filename_);
-  }
-  // Page on disk may have had its next page pointer updated since it was read;
-  // we don't modify that, but we do keep all the other modifications to the
-  // page header.
-  const PageId next_page_number = header.next_page_number;
-  header = new_page.header_;
-  header.next_page_number = next_page_number;
+  checkWritable();
+  const WriteScope scope(*this);
+  // The next page pointer may have changed since the page was read; it is
+  // taken from the bitmap, and all the other modifications to the page header
+  // are kept.
+  PageHeader header = new_page.header_;
+  header.next_page_number = nextPageForWrite(new_page.page_number());
   writePage(new_page.page_number(), header, new_page);
 }
 
 void File::deletePage(const PageId page_number) {
+  checkWritable();
+  const LayoutChange change(*handle_);
   FileHeader header = readHeader();
-  Page existing_page = readPage(page_number);
-  Page previous_page;
-  // If this page is the head of the used list, update the header to point to
-  // the next page in line.
-  if (page_number == header.first_used_page) {
-    header.first_used_page = existing_page.next_page_number();
+  if (page_number == Page::INVALID_NUMBER || page_number >= header.num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const PageHeader existing_header = readPageHeader(page_number);
+  if (existing_header.current_page_number == Page::INVALID_NUMBER) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  loadBitmap(header);
+
+  // Unlink the page from the used list; its predecessor comes from the bitmap.
+  const PageId previous = findPreviousUsedPage(page_number);
+  const PageId next = existing_header.next_page_number;
+  if (previous == Page::INVALID_NUMBER) {
+    header.first_used_page = next;
   } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
-        break;
-      }
-    }
+    writeNextPageNumber(previous, next);
   }
-  // Clear the page and add it to the head of the free list.
-  existing_page.initialize();
-  existing_page.set_next_page_number(header.first_free_page);
-  header.first_free_page = page_number;
-  ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page);
+  if (page_number == header.last_used_page) {
+    header.last_used_page = previous;
   }
-  writePage(page_number, existing_page);
+
+  // Clear the page and mark it free.
+  Page free_page;
+  writePage(page_number, free_page);
+  setPageUsed(page_number, false);
+  if (header.num_free_pages == 0 || page_number < header.first_free_page) {
+    header.first_free_page = page_number;
+  }
+  ++header.num_free_pages;
   writeHeader(header);
 }
 
@@ -220,51 +560,157 @@ FileIterator File::end() {
   return FileIterator(this, Page::INVALID_NUMBER);
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
-  openIfNeeded(create_new);
+File::File(const std::string& name, const bool create_new, const bool direct,
+           const bool mapped, const bool compressed, const bool temporary,
+           const bool spill)
+    : filename_(name) {
+  openIfNeeded(create_new, direct, mapped, temporary, spill);
 
   if (create_new) {
     // File starts with 1 page (the header).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         0 /* last_used_page */,
+                         compressed ? 1u : 0u /* compressed */,
+                         static_cast<std::uint32_t>(Page::SIZE),
+                         FORMAT_VERSION};
     writeHeader(header);
+    // Write the header right away so the file is valid even if it is never
+    // closed cleanly.
+    flushHeader();
+  } else {
+    const FileHeader header = readHeader();
+    if (header.page_size != Page::SIZE ||
+        header.format_version != FORMAT_VERSION) {
+      close();
+      std::stringstream ss;
+      ss << "File '" << name << "' has pages of " << header.page_size
+         << " bytes in format " << header.format_version
+         << ", but this build uses " << Page::SIZE << " byte pages in format "
+         << FORMAT_VERSION;
+      throw BadgerDbException(ss.str());
+    }
   }
 }
 
-void File::openIfNeeded(const bool create_new) {
-  if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
-    ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+void File::openIfNeeded(const bool create_new, const bool direct,
+                        const bool mapped, const bool temporary,
+                        const bool spill) {
+  const HandleMap::iterator open = open_handles_.find(filename_);
+  if (open != open_handles_.end()) {	//exists an entry already
+    if (temporary) {
+      throw FileExistsException(filename_);
+    }
+    if (mapped && open->second->map == NULL) {
+      // The file may be written through the existing descriptor.
+      throw FileOpenException(filename_);
+    }
+    handle_ = open->second;
+    ++handle_->open_count;
+    return;
+  }
+  if (temporary) {
+    const int fd = spill ? createUnlinked("badgerdb.spill.") : createAnonymous();
+    handle_.reset(new FileHandle(fd, false /* direct */));
+    handle_->temporary = true;
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
+    int flags = mapped ? O_RDONLY : O_RDWR;
     const bool already_exists = exists(filename_);
     if (create_new) {
       // Error if we try to overwrite an existing file.
       if (already_exists) {
         throw FileExistsException(filename_);
       }
-      // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
+      flags |= O_CREAT | O_EXCL;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
         throw FileNotFoundException(filename_);
       }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
-    open_counts_[filename_] = 1;
+    int fd = -1;
+    bool opened_direct = false;
+#ifdef O_DIRECT
+    if (direct && !mapped) {
+      fd = ::open(filename_.c_str(), flags | O_DIRECT, 0644);
+      opened_direct = fd >= 0;
+      if (fd < 0 && errno != EINVAL) {
+        throw FileIOException(filename_, "open", errno);
+      }
+    }
+#endif
+    if (fd < 0) {
+      // Direct I/O was not asked for or the filesystem does not support it.
+      fd = ::open(filename_.c_str(), flags, 0644);
+      if (fd < 0) {
+        throw FileIOException(filename_, "open", errno);
+      }
+    }
+    handle_.reset(new FileHandle(fd, opened_direct));
+    if (mapped) {
+      struct stat st;
+      if (fstat(fd, &st) != 0) {
+        throw FileIOException(filename_, "stat", errno);
+      }
+      void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (map == MAP_FAILED) {
+        throw FileIOException(filename_, "map", errno);
+      }
+      handle_->map = static_cast<const char*>(map);
+      handle_->map_size = st.st_size;
+    }
   }
+  if (free_ids_.empty()) {
+    handle_->id = next_id_++;
+  } else {
+    handle_->id = free_ids_.front();
+    free_ids_.pop_front();
+  }
+  handle_->open_count = 1;
+  open_handles_[filename_] = handle_;
+}
+
+int File::createAnonymous() const {
+#ifdef SYS_memfd_create
+  const int memfd = syscall(SYS_memfd_create, filename_.c_str(), 0);
+  if (memfd >= 0) {
+    return memfd;
+  }
+  if (errno != ENOSYS) {
+    throw FileIOException(filename_, "create", errno);
+  }
+#endif
+  // Without memfd_create, fall back to a file in the OS temporary directory.
+  return createUnlinked("badgerdb.");
+}
+
+int File::createUnlinked(const std::string& prefix) const {
+  // The file is removed at once so that it never outlives its descriptor.
+  const char* dir = getenv("TMPDIR");
+  std::string path =
+      std::string(dir != NULL ? dir : "/tmp") + "/" + prefix + "XXXXXX";
+  const int fd = mkstemp(&path[0]);
+  if (fd < 0) {
+    throw FileIOException(filename_, "create", errno);
+  }
+  unlink(path.c_str());
+  return fd;
 }
 
 void File::close() {
-  --open_counts_[filename_];
-  stream_.reset();
-  if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
-    open_counts_.erase(filename_);
+  if (!handle_) {
+    return;
+  }
+  if (handle_->open_count == 1) {
+    flushHeader();
+  }
+  if (--handle_->open_count == 0) {
+    open_handles_.erase(filename_);
+    // reused last, so that stale references to the id are unlikely to meet
+    // another file.
+    free_ids_.push_back(handle_->id);
   }
+  handle_.reset();
 }
 
 void File::writePage(const PageId page_number, const Page& new_page) {
@@ -273,31 +719,412 @@ void File::writePage(const PageId page_number, const Page& new_page) {
 
 void File::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->write(reinterpret_cast<const char*>(&new_page.data_[0]),
-                 Page::DATA_SIZE);
-  stream_->flush();
+  PageHeader stamped = header;
+  stamped.checksum = checksum(header, new_page.data_);
+  if (isCompressed()) {
+    Page page;
+    page.header_ = stamped;
+    std::memcpy(page.data_, new_page.data_, Page::DATA_SIZE);
+    writeStored(page_number, page);
+    return;
+  }
+  struct iovec iov[2] = {
+      {&stamped, sizeof(stamped)},
+      {const_cast<char*>(new_page.data_), Page::DATA_SIZE}};
+  writeAt(pagePosition(page_number), iov, 2);
 }
 
-FileHeader File::readHeader() const {
-  FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+void File::transfer(const bool write, const off_t offset,
+                    const struct iovec* iov, const int iovcnt) const {
+  std::size_t total = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    total += iov[i].iov_len;
+  }
+  std::vector<struct iovec> rest(iov, iov + iovcnt);
+  std::size_t first = 0;
+  std::size_t done = 0;
+  while (done < total) {
+    const ssize_t n =
+        write ? pwritev(handle_->fd, &rest[first], iovcnt - first, offset + done)
+              : preadv(handle_->fd, &rest[first], iovcnt - first, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, write ? "write" : "read", errno);
+    }
+    if (n == 0) {
+      if (write) {
+        throw FileIOException(filename_, "write", EIO);
+      }
+      // End of file; the rest reads as zeroes.
+      for (std::size_t i = first; i < rest.size(); ++i) {
+        std::memset(rest[i].iov_base, 0, rest[i].iov_len);
+      }
+      return;
+    }
+    // Skip the buffers that are done and trim the one that is partly done.
+    done += n;
+    std::size_t left = n;
+    while (first < rest.size() && left >= rest[first].iov_len) {
+      left -= rest[first].iov_len;
+      ++first;
+    }
+    if (left > 0) {
+      rest[first].iov_base = static_cast<char*>(rest[first].iov_base) + left;
+      rest[first].iov_len -= left;
+    }
+    if (!write && handle_->direct && done < total) {
+      // Direct reads only come up short at the end of the file, and cannot be
+      // resumed at an unaligned offset; the rest reads as zeroes.
+      for (std::size_t i = first; i < rest.size(); ++i) {
+        std::memset(rest[i].iov_base, 0, rest[i].iov_len);
+      }
+      return;
+    }
+  }
+}
 
-  return header;
+bool File::isAligned(const off_t offset, const struct iovec* iov,
+                     const int iovcnt) {
+  if (offset % DIRECT_ALIGNMENT != 0) {
+    return false;
+  }
+  for (int i = 0; i < iovcnt; ++i) {
+    if (reinterpret_cast<std::uintptr_t>(iov[i].iov_base) % DIRECT_ALIGNMENT != 0 ||
+        iov[i].iov_len % DIRECT_ALIGNMENT != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void File::readAt(const off_t offset, const struct iovec* iov,
+                  const int iovcnt) const {
+  if (handle_->map != NULL) {
+    // Copy out of the mapping; the part past the end reads as zeroes.
+    std::size_t pos = offset;
+    for (int i = 0; i < iovcnt; ++i) {
+      char* to = static_cast<char*>(iov[i].iov_base);
+      const std::size_t avail =
+          pos < handle_->map_size
+              ? std::min(iov[i].iov_len, handle_->map_size - pos) : 0;
+      std::memcpy(to, handle_->map + pos, avail);
+      std::memset(to + avail, 0, iov[i].iov_len - avail);
+      pos += iov[i].iov_len;
+    }
+    return;
+  }
+  if (!handle_->direct || isAligned(offset, iov, iovcnt)) {
+    transfer(false /* write */, offset, iov, iovcnt);
+    return;
+  }
+  // Read the aligned blocks covering the range and copy out of them.
+  std::size_t total = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    total += iov[i].iov_len;
+  }
+  const off_t begin = offset / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+  const off_t end = (offset + total + DIRECT_ALIGNMENT - 1) /
+                    DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+  const BounceBuffer bounce(end - begin);
+  char* buffer = bounce.data();
+  struct iovec block = {buffer, static_cast<std::size_t>(end - begin)};
+  transfer(false /* write */, begin, &block, 1);
+  const char* from = buffer + (offset - begin);
+  for (int i = 0; i < iovcnt; ++i) {
+    std::memcpy(iov[i].iov_base, from, iov[i].iov_len);
+    from += iov[i].iov_len;
+  }
+}
+
+void File::writeAt(const off_t offset, const struct iovec* iov,
+                   const int iovcnt) {
+  if (!handle_->direct || isAligned(offset, iov, iovcnt)) {
+    transfer(true /* write */, offset, iov, iovcnt);
+    return;
+  }
+  // Write whole aligned blocks, reading the parts of the first and last block
+  // that lie outside the range first.
+  std::size_t total = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    total += iov[i].iov_len;
+  }
+  const off_t begin = offset / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+  const off_t end = (offset + total + DIRECT_ALIGNMENT - 1) /
+                    DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+  const BounceBuffer bounce(end - begin);
+  char* buffer = bounce.data();
+  struct iovec block = {buffer, static_cast<std::size_t>(end - begin)};
+  if (begin != offset || end != static_cast<off_t>(offset + total)) {
+    transfer(false /* write */, begin, &block, 1);
+  }
+  char* to = buffer + (offset - begin);
+  for (int i = 0; i < iovcnt; ++i) {
+    std::memcpy(to, iov[i].iov_base, iov[i].iov_len);
+    to += iov[i].iov_len;
+  }
+  transfer(true /* write */, begin, &block, 1);
+}
+
+void File::loadBitmap(const FileHeader& header) const {
+  FileHandle& handle = *handle_;
+  std::lock_guard<std::mutex> guard(handle.header_latch);
+  if (handle.bitmap_loaded) {
+    return;
+  }
+  const std::size_t words_per_group = PAGES_PER_BITMAP / 64;
+  const PageId groups =
+      (header.num_pages - 1 + PAGES_PER_BITMAP - 1) / PAGES_PER_BITMAP;
+  handle.bitmap.assign(groups * words_per_group, 0);
+  for (PageId group = 0; group < groups; ++group) {
+    struct iovec iov = {&handle.bitmap[group * words_per_group], Page::SIZE};
+    readAt(bitmapPosition(group), &iov, 1);
+  }
+  handle.bitmap_loaded = true;
+}
+
+void File::setPageUsed(const PageId page_number, const bool used) {
+  std::vector<std::uint64_t>& bitmap = handle_->bitmap;
+  const std::size_t words_per_group = PAGES_PER_BITMAP / 64;
+  const PageId bit = page_number - 1;
+  const PageId group = bit / PAGES_PER_BITMAP;
+  if (bitmap.size() < (group + 1) * words_per_group) {
+    bitmap.resize((group + 1) * words_per_group, 0);
+  }
+  const std::uint64_t mask = std::uint64_t(1) << (bit % 64);
+  if (used) {
+    bitmap[bit / 64] |= mask;
+  } else {
+    bitmap[bit / 64] &= ~mask;
+  }
+  struct iovec iov = {&bitmap[group * words_per_group], Page::SIZE};
+  writeAt(bitmapPosition(group), &iov, 1);
+}
+
+PageId File::findPage(const PageId from, const PageId limit,
+                      const bool used) const {
+  const std::vector<std::uint64_t>& bitmap = handle_->bitmap;
+  PageId page = from;
+  while (page < limit) {
+    const PageId bit = page - 1;
+    std::uint64_t word = used ? bitmap[bit / 64] : ~bitmap[bit / 64];
+    word &= ~std::uint64_t(0) << (bit % 64);
+    if (word != 0) {
+      const PageId found = bit / 64 * 64 + __builtin_ctzll(word) + 1;
+      return found < limit ? found : static_cast<PageId>(Page::INVALID_NUMBER);
+    }
+    page = (bit / 64 + 1) * 64 + 1;
+  }
+  return Page::INVALID_NUMBER;
+}
+
+PageId File::findPreviousUsedPage(const PageId before) const {
+  const std::vector<std::uint64_t>& bitmap = handle_->bitmap;
+  if (before <= 1) {
+    return Page::INVALID_NUMBER;
+  }
+  PageId bit = before - 2;
+  for (;;) {
+    const std::uint64_t word =
+        bitmap[bit / 64] & (~std::uint64_t(0) >> (63 - bit % 64));
+    if (word != 0) {
+      return bit / 64 * 64 + (63 - __builtin_clzll(word)) + 1;
+    }
+    if (bit < 64) {
+      return Page::INVALID_NUMBER;
+    }
+    bit = bit / 64 * 64 - 1;
+  }
+}
+
+PageId File::nextPageForWrite(const PageId page_number) const {
+  const FileHeader header = readHeader();
+  if (page_number == Page::INVALID_NUMBER || page_number >= header.num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  loadBitmap(header);
+  const PageId bit = page_number - 1;
+  if ((handle_->bitmap[bit / 64] & (std::uint64_t(1) << (bit % 64))) == 0) {
+    // Page has been deleted since it was read.
+    throw InvalidPageException(page_number, filename_);
+  }
+  // The next page pointer on disk always names the next used page.
+  return findPage(page_number + 1, header.num_pages, true /* used */);
+}
+
+std::uint32_t File::checksum(const PageHeader& header, const char* data) {
+  PageHeader covered = header;
+  covered.next_page_number = 0;
+  covered.checksum = 0;
+  return crc32c(crc32c(0, &covered, sizeof(covered)), data, Page::DATA_SIZE);
+}
+
+void File::verifyChecksum(const PageId page_number, const Page& page) const {
+  if (handle_->verify_checksums.load(std::memory_order_relaxed) &&
+      checksum(page.header_, page.data_) != page.header_.checksum) {
+    throw CorruptPageException(page_number, filename_);
+  }
+}
+
+bool File::isCompressed() const {
+  return readHeader().compressed != 0;
+}
+
+std::size_t File::encodePage(const Page& page, Page& stored) const {
+  // Room for the header, the compressed length and at least one block less
+  // than the page takes uncompressed.
+  const std::size_t capacity =
+      Page::SIZE - DIRECT_ALIGNMENT - sizeof(PageHeader) - sizeof(std::uint16_t);
+  char* length = stored.data_;
+  std::size_t compressed = 0;
+  if (Page::SIZE > DIRECT_ALIGNMENT && isCompressed()) {
+    compressed = compressBlock(page.data_, Page::DATA_SIZE,
+                               length + sizeof(std::uint16_t), capacity);
+  }
+  if (compressed == 0) {
+    stored = page;
+    return Page::SIZE;
+  }
+  const std::uint16_t n = static_cast<std::uint16_t>(compressed);
+  std::memcpy(length, &n, sizeof(n));
+  stored.header_ = page.header_;
+  stored.header_.free_space_upper_bound |= STORED_COMPRESSED;
+  const std::size_t used = sizeof(PageHeader) + sizeof(n) + compressed;
+  const std::size_t size =
+      (used + DIRECT_ALIGNMENT - 1) / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+  std::memset(reinterpret_cast<char*>(&stored) + used, 0, size - used);
+  return size;
+}
+
+void File::decodePage(const PageId page_number, Page& page) const {
+  if ((page.header_.free_space_upper_bound & STORED_COMPRESSED) == 0 ||
+      !isCompressed()) {
+    return;
+  }
+  page.header_.free_space_upper_bound &= ~STORED_COMPRESSED;
+  std::uint16_t n;
+  std::memcpy(&n, page.data_, sizeof(n));
+  char compressed[Page::DATA_SIZE];
+  if (n > Page::DATA_SIZE - sizeof(n)) {
+    throw CorruptPageException(page_number, filename_);
+  }
+  std::memcpy(compressed, page.data_ + sizeof(n), n);
+  if (!decompressBlock(compressed, n, page.data_, Page::DATA_SIZE)) {
+    throw CorruptPageException(page_number, filename_);
+  }
+}
+
+void File::writeStored(const PageId page_number, const Page& page) {
+  Page stored;
+  const std::size_t size = encodePage(page, stored);
+  struct iovec iov = {&stored, size};
+  writeAt(pagePosition(page_number), &iov, 1);
+  if (size < Page::SIZE) {
+    releaseTail(pagePosition(page_number), size);
+  }
+}
+
+void File::releaseTail(const off_t offset, const std::size_t stored) {
+#ifdef FALLOC_FL_PUNCH_HOLE
+  if (fallocate(handle_->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                offset + stored, Page::SIZE - stored) == 0 ||
+      errno == EOPNOTSUPP || errno == ENOSYS) {
+    // Without hole punching the old bytes stay; they are never decoded.
+    return;
+  }
+  throw FileIOException(filename_, "punch", errno);
+#else
+  (void)offset;
+  (void)stored;
+#endif
+}
+
+void File::writeNextPageNumber(const PageId page_number,
+                               const PageId next_page_number) {
+  struct iovec iov = {const_cast<PageId*>(&next_page_number),
+                      sizeof(next_page_number)};
+  writeAt(pagePosition(page_number) + offsetof(PageHeader, next_page_number),
+          &iov, 1);
+}
+
+const Page* File::mappedPage(const PageId page_number) const {
+  if (handle_->map == NULL || isCompressed()) {
+    throw FileIOException(filename_, "view", EINVAL);
+  }
+  FileHeader header = readHeader();
+  if (page_number == Page::INVALID_NUMBER || page_number >= header.num_pages ||
+      static_cast<std::size_t>(pagePosition(page_number)) + Page::SIZE >
+          handle_->map_size) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const Page* page =
+      reinterpret_cast<const Page*>(handle_->map + pagePosition(page_number));
+  verifyChecksum(page_number, *page);
+  if (!page->isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return page;
+}
+
+void File::checkWritable() const {
+  if (handle_->map != NULL) {
+    throw FileIOException(filename_, "write", EROFS);
+  }
+}
+
+FileHeader File::readHeader() const {
+  FileHandle& handle = *handle_;
+  std::lock_guard<std::mutex> guard(handle.header_latch);
+  if (!handle.header_loaded) {
+    struct iovec iov = {&handle.header, sizeof(handle.header)};
+    readAt(0 /* pos */, &iov, 1);
+    handle.header_loaded = true;
+  }
+  return handle.header;
 }
 
 void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->flush();
+  std::lock_guard<std::mutex> guard(handle_->header_latch);
+  handle_->header = header;
+  handle_->header_loaded = true;
+  handle_->header_dirty = true;
+}
+
+void File::sync() {
+  if (handle_->map != NULL) {
+    return;
+  }
+  flushHeader();
+  syncData();
+}
+
+void File::syncData() const {
+  if (handle_->map != NULL || handle_->temporary) {
+    return;
+  }
+  if (fdatasync(handle_->fd) != 0) {
+    throw FileIOException(filename_, "sync", errno);
+  }
+}
+
+void File::flushHeader() {
+  FileHandle& handle = *handle_;
+  // held across the write, so that an older copy never lands after a newer.
+  std::lock_guard<std::mutex> guard(handle.header_latch);
+  // the header of a temporary file only lives in memory.
+  if (handle.header_dirty && !handle.temporary) {
+    struct iovec iov = {&handle.header, sizeof(handle.header)};
+    writeAt(0 /* pos */, &iov, 1);
+    handle.header_dirty = false;
+  }
 }
 
 PageHeader File::readPageHeader(PageId page_number) const {
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+  struct iovec iov = {&header, sizeof(header)};
+  readAt(pagePosition(page_number), &iov, 1);
+  header.free_space_upper_bound &= ~STORED_COMPRESSED;
 
   return header;
 }
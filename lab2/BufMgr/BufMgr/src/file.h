@@ -7,11 +7,21 @@
 
 #pragma once
 
-#include <fstream>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
 #include <string>
-#include <map>
+#include <unordered_map>
 #include <memory>
+#include <vector>
 
+#include "io_engine.h"
 #include "page.h"
 
 namespace badgerdb {
@@ -38,10 +48,33 @@ struct FileHeader {
   PageId num_free_pages;
 
   /**
-   * Page number of the first free (allocated but unused) page in the file.
+   * Page number of the lowest-numbered free (allocated but unused) page in
+   * the file.
    */
   PageId first_free_page;
 
+  /**
+   * Page number of the last used page in the file, i.e. the tail of the used
+   * list.
+   */
+  PageId last_used_page;
+
+  /**
+   * Nonzero if pages are stored compressed; fixed when the file is created.
+   */
+  std::uint32_t compressed;
+
+  /**
+   * Page::SIZE of the build that created the file.
+   */
+  std::uint32_t page_size;
+
+  /**
+   * Version of the layout of the file's pages, File::FORMAT_VERSION of the
+   * build that created the file.
+   */
+  std::uint32_t format_version;
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -52,45 +85,280 @@ struct FileHeader {
     return num_pages == rhs.num_pages &&
         num_free_pages == rhs.num_free_pages &&
         first_used_page == rhs.first_used_page &&
-        first_free_page == rhs.first_free_page;
+        first_free_page == rhs.first_free_page &&
+        last_used_page == rhs.last_used_page &&
+        compressed == rhs.compressed &&
+        page_size == rhs.page_size &&
+        format_version == rhs.format_version;
   }
 };
 
+/**
+ * @brief Open file descriptor shared by all File objects for the same file.
+ */
+struct FileHandle {
+  /**
+   * Takes ownership of an open file descriptor.
+   *
+   * @param fd      File descriptor.
+   * @param direct  Whether the descriptor was opened with O_DIRECT.
+   */
+  FileHandle(const int fd, const bool direct);
+
+  /**
+   * Unmaps the file if it is mapped and closes the file descriptor.
+   */
+  ~FileHandle();
+
+  FileHandle(const FileHandle&) = delete;
+  FileHandle& operator=(const FileHandle&) = delete;
+
+  /**
+   * File descriptor of the open file.
+   */
+  int fd;
+
+  /**
+   * Whether transfers bypass the OS page cache, in which case their buffers,
+   * offsets and lengths must be aligned to DIRECT_ALIGNMENT.
+   */
+  bool direct;
+
+  /**
+   * Taken shared by page writes and exclusively by the calls that change the
+   * layout of the file: allocating, deleting and appending pages.  A page is
+   * then never written with a next page pointer that is being changed, while
+   * page writes run concurrently with each other.  Page reads take no latch.
+   */
+  pthread_rwlock_t layout_latch;
+
+  /**
+   * Protects <header>, <header_loaded>, <header_dirty> and the loading of
+   * <bitmap>, which is only changed under an exclusive <layout_latch>.
+   */
+  std::mutex header_latch;
+
+  /**
+   * In-memory copy of the allocation bitmap pages; bit (n - 1) is set if page
+   * n is used.
+   */
+  std::vector<std::uint64_t> bitmap;
+
+  /**
+   * Whether <bitmap> has been read from disk.
+   */
+  bool bitmap_loaded;
+
+  /**
+   * Read-only mapping of the whole file if it was opened with
+   * File::openMapped(), otherwise NULL.
+   */
+  const char* map;
+
+  /**
+   * Length of <map> in bytes.
+   */
+  std::size_t map_size;
+
+  /**
+   * In-memory copy of the file header, authoritative while the file is open.
+   */
+  FileHeader header;
+
+  /**
+   * Whether <header> has been read from disk.
+   */
+  bool header_loaded;
+
+  /**
+   * Whether <header> has changed since it was last written to disk.
+   */
+  bool header_dirty;
+
+  /**
+   * Whether pages read are checked against their checksums.
+   */
+  std::atomic<bool> verify_checksums;
+
+  /**
+   * Id of the file while it is open.
+   */
+  FileId id;
+
+  /**
+   * Number of File objects for the file.
+   */
+  int open_count;
+
+  /**
+   * Whether the file was created by File::createTemporary or
+   * File::createSpill.
+   */
+  bool temporary;
+};
+
 /**
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * The File class wraps a file descriptor of an underlying file on disk and
+ * transfers pages with positional reads and writes, so there is no shared file
+ * position.  Files contain fixed-sized pages, and they never deallocate space
+ * (though they do reuse deleted pages if possible).  Page 0 holds the file
+ * header, so every page starts at a multiple of Page::SIZE.  Every
+ * PAGES_PER_BITMAP pages are preceded on disk by an allocation bitmap page,
+ * which has no page number of its own; the bitmap is cached in memory so that
+ * allocating and deleting a page take a constant number of I/Os.  Every page
+ * is written with a CRC-32C of its contents and checked against it when read
+ * back, so that corruption on the device is caught.
+ *
+ * A file may be created compressed, for data that is read far more than it is
+ * written.  Each page then stays at its position but is stored compressed at
+ * the start of it, padded to a whole number of DIRECT_ALIGNMENT blocks, and
+ * the rest of its place is punched out of the file, so that it takes neither
+ * disk space nor read bandwidth; reads of the hole return zeroes without
+ * touching the device.  The stored header stays uncompressed so that it can be
+ * read and updated in place.  Pages that would not save a block are stored as
+ * they are.  If multiple File
+ * objects refer to the same underlying file, they will share the descriptor.
  * If a file that has already been opened (possibly by another query), then the File class
- * detects this (by looking in the open_streams_ map) and just returns a file object with
- * the already created stream for the file without actually opening the UNIX file again. 
+ * detects this (by looking in the open_handles_ map) and just returns a file object with
+ * the already created descriptor for the file without actually opening the UNIX file again. 
+ * Every open file gets a small FileId, which identifies it to the buffer
+ * manager; the name is only looked up when a file is opened by it, and copies
+ * share the descriptor and its count without any lookup.
+ *
+ * Pages of one file may be read, written, allocated and deleted from several
+ * threads at once; only the header and the allocation bitmap are updated
+ * under a lock, and page transfers run concurrently.
  *
- * @warning This class is not threadsafe.
+ * @warning Opening, copying and closing File objects is not threadsafe.
  */
 class File {
  public:
+  /**
+   * Alignment of buffers, offsets and lengths of transfers on files opened
+   * for direct I/O.
+   */
+  static const std::size_t DIRECT_ALIGNMENT = 4096;
+
+  /**
+   * Version of the on-disk page layout written by this build: the PageHeader
+   * fields at fixed offsets and 4-byte slots with the used flag in the offset.
+   * Raised whenever either layout changes.
+   */
+  static const std::uint32_t FORMAT_VERSION = 1;
+
+  /**
+   * Number of pages whose allocation state is kept in one bitmap page.
+   */
+  static const PageId PAGES_PER_BITMAP = Page::SIZE * 8;
+
+  /**
+   * FileId no open file has.
+   */
+  static const FileId INVALID_ID = 0xffffffff;
+
+  /**
+   * @brief Holds off changes to the layout of a file while pages are written
+   *        to it through an IoEngine, as writePage() does for its own write.
+   *
+   * prepareWrite() and finishWrite() must be called within a scope on the
+   * file.  Scopes on the same file do not exclude each other.
+   */
+  class WriteScope {
+   public:
+    /**
+     * Waits for any allocation, deletion or append on <file> to finish.
+     */
+    explicit WriteScope(const File& file);
+
+    /**
+     * Lets the layout of the file change again.
+     */
+    ~WriteScope();
+
+    WriteScope(const WriteScope&) = delete;
+    WriteScope& operator=(const WriteScope&) = delete;
+
+   private:
+    /**
+     * Handle of the file, kept alive for the scope.
+     */
+    std::shared_ptr<FileHandle> handle_;
+  };
+
   /**
    * Creates a new file.
    *
    * @param filename  Name of the file.
+   * @param direct    Whether to bypass the OS page cache with O_DIRECT.  Falls
+   *                  back to buffered I/O if the filesystem does not support it.
+   * @param compressed  Whether to store pages compressed.  Saves space only on
+   *                    filesystems that can punch holes in files.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static File create(const std::string& filename);
+  static File create(const std::string& filename, const bool direct = false,
+                     const bool compressed = false);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
-	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
-	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * It first checks if the file is already open. If so, then the new File object created uses the same file descriptor to read to or write fom
+	 * that already open file. Reference count (open_count of the shared FileHandle) is incremented whenever an already open file is
+	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the descriptor associated with this File object are inserted into the
+	 * open_handles_ map, and the file is given a FileId.
    *
    * @param filename  Name of the file.
+   * @param direct    Whether to bypass the OS page cache with O_DIRECT, if the
+   *                  file is not open yet.  Falls back to buffered I/O if the
+   *                  filesystem does not support it.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  BadgerDbException       If the file was created with another page
+   *                                  size or page format.
+   */
+  static File open(const std::string& filename, const bool direct = false);
+
+  /**
+   * Opens an existing file read-only and maps it into memory.  Pages can then
+   * be viewed in place with mappedPage(), and readPage() copies out of the
+   * mapping instead of reading from the file.  Operations that modify the file
+   * throw FileIOException.  The file must not change size or be written by
+   * anyone else while it is mapped.  Opening the file again with File::open()
+   * while it is mapped shares the mapping.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  FileOpenException       If the file is already open unmapped.
+   */
+  static File openMapped(const std::string& filename);
+
+  /**
+   * Creates a temporary file, for data that need not outlive the process,
+   * such as spills of a query.  Its pages are kept in anonymous memory, which
+   * the OS only writes to swap under memory pressure, and its header is
+   * never written, so syncing it and checkpoints cost nothing.  The file is
+   * known by <filename> to File::open and isOpen while it is open but has no
+   * entry in the filesystem, and it is gone once its last File object is
+   * closed.  Use BufMgr::dropFile to discard its pages from a buffer pool
+   * without writing them back.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileExistsException     If a file of that name is already open.
+   * @throws  FileIOException         If the memory cannot be created.
+   */
+  static File createTemporary(const std::string& filename);
+
+  /**
+   * Creates a temporary file like createTemporary, but with its pages kept in
+   * a file on disk in the OS temporary directory ($TMPDIR, else /tmp), so that
+   * spills larger than memory cost disk space rather than memory or swap.
+   * The file is removed from the directory as soon as it is created.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileExistsException     If a file of that name is already open.
+   * @throws  FileIOException         If the file cannot be created.
    */
-  static File open(const std::string& filename);
+  static File createSpill(const std::string& filename);
 
   /**
    * Deletes an existing file.
@@ -145,6 +413,13 @@ class File {
    */
   Page allocatePage();
 
+  /**
+   * Allocates a new page in the file, building it in place in <new_page>.
+   *
+   * @param new_page  Receives the new page.
+   */
+  void allocatePage(Page& new_page);
+
   /**
    * Reads an existing page from the file.
    *
@@ -152,9 +427,22 @@ class File {
    * @return  The page.
    * @throws  InvalidPageException  If the page doesn't exist in the file or is
    *                                not currently used.
+   * @throws  CorruptPageException  If the page does not match its checksum.
    */
   Page readPage(const PageId page_number) const;
 
+  /**
+   * Reads an existing page from the file into the given page, without an
+   * intermediate copy.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Receives the page; undefined if an exception is thrown.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  CorruptPageException  If the page does not match its checksum.
+   */
+  void readPage(const PageId page_number, Page& page) const;
+
   /**
    * Writes a page into the file, replacing any existing contents.  The page
    * must have been already allocated in this file by a call to allocatePage().
@@ -164,6 +452,131 @@ class File {
    */
   void writePage(const Page& new_page);
 
+  /**
+   * Reads <count> consecutive pages starting at <first> with a single read
+   * from the file.
+   *
+   * @param first   Number of first page to read.
+   * @param count   Number of pages to read.
+   * @param out     Array of at least <count> pages receiving the pages.
+   * @throws  InvalidPageException  If any of the pages doesn't exist in the
+   *                                file or is not currently used.
+   * @throws  CorruptPageException  If any of the pages does not match its
+   *                                checksum.
+   */
+  void readPages(const PageId first, const PageId count, Page* out) const;
+
+  /**
+   * Writes several pages into the file like writePage(), coalescing pages
+   * with adjacent page numbers into one write.  The pages may be given in any
+   * order.
+   *
+   * @see writePage()
+   * @param pages   Array of pages to write.
+   * @param n       Number of pages in the array.
+   * @throws  InvalidPageException  If any of the pages has been deleted; no
+   *                                page of its run is written then.
+   */
+  void writePages(const Page* pages, const std::size_t n);
+
+  /**
+   * Adds pages at the end of the file with their contents already in place,
+   * bypassing the free list.  The pages are numbered in order from the end of
+   * the file and linked after the last used page; their data is written with
+   * one write per run up to the next bitmap page, and the bitmap and file
+   * header once for the whole batch.
+   *
+   * @param pages   Array of pages to append; receives their page numbers and
+   *                next page pointers.
+   * @param n       Number of pages in the array.
+   * @return  Number of the first page appended.
+   */
+  PageId appendPages(Page* pages, const std::size_t n);
+
+  /**
+   * Returns the numbers of the used pages in the file, in order, from the
+   * allocation bitmap and without reading any page.
+   *
+   * @return  Numbers of the used pages.
+   */
+  std::vector<PageId> usedPages() const;
+
+  /**
+   * Fills in <request> to read an existing page into <page> through an
+   * IoEngine.  The read itself may run concurrently with other calls on this
+   * file.  On a file opened for direct I/O, <page> must be aligned to
+   * DIRECT_ALIGNMENT.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Buffer receiving the page.
+   * @param request       Request to fill in.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  void prepareRead(const PageId page_number, Page& page,
+                   IoRequest& request) const;
+
+  /**
+   * Completes a read prepared by prepareRead(), reading the page again
+   * synchronously if the engine transferred less than a whole page.
+   *
+   * @param page_number   Number of page that was read.
+   * @param page          Buffer the page was read into.
+   * @param request       Completed request.
+   * @throws  InvalidPageException  If the page is not currently used.
+   * @throws  CorruptPageException  If the page does not match its checksum.
+   */
+  void finishRead(const PageId page_number, Page& page,
+                  const IoRequest& request) const;
+
+  /**
+   * Fills in <request> to write a page through an IoEngine, like writePage().
+   * The page is copied into <staging> with its next page pointer taken from
+   * the allocation bitmap, so no read is needed.  The caller must hold a
+   * WriteScope on this file from here until finishWrite() returns.  On a file
+   * opened for direct I/O, <staging> must be aligned to DIRECT_ALIGNMENT.
+   *
+   * @param new_page  Page to write.
+   * @param staging   Buffer holding the data to write until completion.
+   * @param request   Request to fill in.
+   * @throws  InvalidPageException  If the page has been deleted.
+   */
+  void prepareWrite(const Page& new_page, Page& staging, IoRequest& request);
+
+  /**
+   * Completes a write prepared by prepareWrite(), writing the page again
+   * synchronously if the engine transferred less than a whole page.
+   *
+   * @param staging   Buffer the page was written from.
+   * @param request   Completed request.
+   */
+  void finishWrite(const Page& staging, const IoRequest& request);
+
+  /**
+   * Makes every write to the file so far durable: writes the cached header
+   * back and flushes the file's data to the device with fdatasync.  Page and
+   * header writes are otherwise only handed to the OS, so that one sync can
+   * cover a whole batch of them.  Does nothing on a mapped file.
+   *
+   * @throws  FileIOException   If the header or the data could not be written.
+   */
+  void sync();
+
+  /**
+   * Writes the in-memory header to disk if it has changed, without syncing
+   * it.  Called by sync() and when the last File object for the file is
+   * closed.
+   */
+  void flushHeader();
+
+  /**
+   * Flushes the data already written to the file to the device, without
+   * writing the cached header.  It takes no latch, so a sync holds off no
+   * other call on the file while it waits for the device.
+   *
+   * @throws  FileIOException   If the data could not be written.
+   */
+  void syncData() const;
+
   /**
    * Deletes a page from the file.
    *
@@ -178,6 +591,65 @@ class File {
    */
   const std::string& filename() const { return filename_; }
 
+  /**
+   * Returns the id of the file, the same for every File object for it while
+   * it is open.
+   */
+  FileId id() const { return handle_->id; }
+
+  /**
+   * Returns true if transfers on this file bypass the OS page cache.
+   */
+  bool isDirect() const { return handle_->direct; }
+
+  /**
+   * Returns true if the file was created by createTemporary or createSpill.
+   */
+  bool isTemporary() const { return handle_->temporary; }
+
+  /**
+   * Sets whether pages read from the file are checked against the checksum
+   * they were written with, which is the default.  Pages are given checksums
+   * when written either way.  Applies to every File object for the file.
+   *
+   * @param verify  Whether to check pages.
+   */
+  void setVerifyChecksums(const bool verify) {
+    handle_->verify_checksums = verify;
+  }
+
+  /**
+   * Returns true if pages read from the file are checked against their
+   * checksums.
+   */
+  bool verifiesChecksums() const { return handle_->verify_checksums; }
+
+  /**
+   * Returns true if the file stores its pages compressed.
+   */
+  bool isCompressed() const;
+
+  /**
+   * Returns true if the file was opened read-only with File::openMapped().
+   */
+  bool isMapped() const { return handle_->map != NULL; }
+
+  /**
+   * Returns a view of an existing page in the mapping of the file, without
+   * copying it.  The view is valid until the last File object for the file
+   * is closed.
+   *
+   * @param page_number   Number of page to view.
+   * @return  The page.
+   * @throws  FileIOException       If the file is not mapped, or is compressed
+   *                                so that its pages cannot be viewed in
+   *                                place.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  CorruptPageException  If the page does not match its checksum.
+   */
+  const Page* mappedPage(const PageId page_number) const;
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -201,8 +673,33 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  static off_t pagePosition(const PageId page_number) {
+    if (page_number == 0) {
+      return 0;
+    }
+    // One bitmap page before every PAGES_PER_BITMAP pages.
+    return (static_cast<off_t>(page_number) +
+            (page_number - 1) / PAGES_PER_BITMAP + 1) * Page::SIZE;
+  }
+
+  /**
+   * Returns the position of the given allocation bitmap page in the file.
+   *
+   * @param group   Number of bitmap page; it covers pages
+   *                group * PAGES_PER_BITMAP + 1 and up.
+   * @return  Position of bitmap page in file.
+   */
+  static off_t bitmapPosition(const PageId group) {
+    return (1 + static_cast<off_t>(group) * (PAGES_PER_BITMAP + 1)) *
+           Page::SIZE;
+  }
+
+  /**
+   * Returns the last page stored contiguously on disk with <page_number>,
+   * i.e. the last page covered by the same bitmap page.
+   */
+  static PageId lastPageOfGroup(const PageId page_number) {
+    return ((page_number - 1) / PAGES_PER_BITMAP + 1) * PAGES_PER_BITMAP;
   }
 
   /**
@@ -214,28 +711,60 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param direct      Whether to open the file for direct I/O.
+   * @param mapped      Whether to open the file read-only and map it.
+   * @param compressed  Whether a new file stores its pages compressed.
+   * @param temporary   Whether to create a temporary file in memory.
+   * @param spill       Whether a temporary file is kept on disk instead.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new, const bool direct,
+       const bool mapped = false, const bool compressed = false,
+       const bool temporary = false, const bool spill = false);
 
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing descriptor.
    *
    * @param create_new  Whether to create a new file.
+   * @param direct      Whether to open the file for direct I/O.
+   * @param mapped      Whether to open the file read-only and map it.
+   * @param temporary   Whether to create a temporary file in memory.
+   * @param spill       Whether a temporary file is kept on disk instead.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileOpenException       If mapped is set and the file is already
+   *                                  open unmapped.
+   */
+  void openIfNeeded(const bool create_new, const bool direct,
+                    const bool mapped, const bool temporary = false,
+                    const bool spill = false);
+
+  /**
+   * Returns a descriptor of an anonymous file in memory, named <filename_>
+   * for diagnostics only.
+   */
+  int createAnonymous() const;
+
+  /**
+   * Returns a descriptor of a new file in the OS temporary directory, already
+   * removed from it, whose name starts with <prefix>.
+   */
+  int createUnlinked(const std::string& prefix) const;
+
+  /**
+   * Throws FileIOException if the file is mapped, and hence read-only.
    */
-  void openIfNeeded(const bool create_new);
+  void checkWritable() const;
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Closes the underlying file descriptor in <handle_>.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
@@ -245,8 +774,8 @@ class File {
    * Reads a page from the file.  If <allow_free> is not set, an exception
    * will be thrown if the page read from disk is not currently in use.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * No bounds checking is performed; a page past the end of the file reads
+   * as zeroes.
    *
    * @param page_number   Number of page to read.
    * @param allow_free    Whether to allow reading a free (unused) page.
@@ -256,6 +785,19 @@ class File {
    */
   Page readPage(const PageId page_number, const bool allow_free) const;
 
+  /**
+   * Reads a page from the file into the given page, like
+   * readPage(page_number, allow_free).
+   *
+   * @param page_number   Number of page to read.
+   * @param allow_free    Whether to allow reading a free (unused) page.
+   * @param page          Receives the page.
+   * @throws  InvalidPageException  If the page is free (unused) and
+   *                                allow_free is false.
+   */
+  void readPage(const PageId page_number, const bool allow_free,
+                Page& page) const;
+
   /**
    * Writes a page into the file at the given page number.  This does not
    * update ensure that the number in the header equals the position on disk.
@@ -279,14 +821,156 @@ class File {
                  const Page& new_page);
 
   /**
-   * Reads the header for this file from disk.
+   * Reads <iovcnt> buffers from the file starting at <offset>, retrying short
+   * transfers.  Bytes past the end of the file read as zeroes.
+   *
+   * @param offset  Position in the file.
+   * @param iov     Buffers to fill, in file order.
+   * @param iovcnt  Number of buffers.
+   * @throws  FileIOException  If the read fails.
+   */
+  void readAt(const off_t offset, const struct iovec* iov,
+              const int iovcnt) const;
+
+  /**
+   * Writes <iovcnt> buffers to the file starting at <offset>, retrying short
+   * transfers.
+   *
+   * @param offset  Position in the file.
+   * @param iov     Buffers to write, in file order.
+   * @param iovcnt  Number of buffers.
+   * @throws  FileIOException  If the write fails.
+   */
+  void writeAt(const off_t offset, const struct iovec* iov, const int iovcnt);
+
+  /**
+   * Returns true if a transfer of the buffers at <offset> can be done with
+   * direct I/O as is, without going through a bounce buffer.
+   */
+  static bool isAligned(const off_t offset, const struct iovec* iov,
+                        const int iovcnt);
+
+  /**
+   * Transfers buffers to or from the file descriptor exactly as given, with
+   * preadv/pwritev.  Used directly for buffered files and through an aligned
+   * bounce buffer, allocated for the call, for direct ones.
+   */
+  void transfer(const bool write, const off_t offset, const struct iovec* iov,
+                const int iovcnt) const;
+
+  /**
+   * Reads the allocation bitmap from disk into the shared handle, unless
+   * another File object for the same file has already done so.
+   *
+   * @param header  Current header of the file.
+   */
+  void loadBitmap(const FileHeader& header) const;
+
+  /**
+   * Marks a page used or free in the allocation bitmap and writes the bitmap
+   * page covering it.
+   *
+   * @param page_number   Number of page.
+   * @param used          Whether the page is now used.
+   */
+  void setPageUsed(const PageId page_number, const bool used);
+
+  /**
+   * Returns the lowest page number in [<from>, <limit>) that is used (or free,
+   * if <used> is false), or Page::INVALID_NUMBER if there is none.
+   */
+  PageId findPage(const PageId from, const PageId limit, const bool used) const;
+
+  /**
+   * Returns the highest used page number below <before>, or
+   * Page::INVALID_NUMBER if there is none.
+   */
+  PageId findPreviousUsedPage(const PageId before) const;
+
+  /**
+   * Returns the next page pointer a used page is written with: the next used
+   * page, from the allocation bitmap, so that writing a page never needs the
+   * copy on disk.
+   *
+   * @param page_number   Number of page to be written.
+   * @throws  InvalidPageException  If the page is not a used page of the file.
+   */
+  PageId nextPageForWrite(const PageId page_number) const;
+
+  /**
+   * Returns the checksum of a page with the given header and data.
+   */
+  static std::uint32_t checksum(const PageHeader& header, const char* data);
+
+  /**
+   * Checks a page just read against the checksum in its header, if the file
+   * verifies checksums.
+   *
+   * @param page_number   Number the page was read from.
+   * @param page          Page read.
+   * @throws  CorruptPageException  If the page does not match its checksum.
+   */
+  void verifyChecksum(const PageId page_number, const Page& page) const;
+
+  /**
+   * Returns the stored form of <page>, whose header is final, in <stored>: the
+   * page compressed if the file is compressed and that saves space, else the
+   * page as it is.
+   *
+   * @return  Number of bytes of <stored> to write, a multiple of
+   *          DIRECT_ALIGNMENT.
+   */
+  std::size_t encodePage(const Page& page, Page& stored) const;
+
+  /**
+   * Turns a page just read from a compressed file back into its original
+   * form, in place.
+   *
+   * @param page_number   Number the page was read from.
+   * @param page          Page read.
+   * @throws  CorruptPageException  If the page does not decompress.
+   */
+  void decodePage(const PageId page_number, Page& page) const;
+
+  /**
+   * Writes <page>, whose header is final, in its stored form.
+   *
+   * @param page_number   Number of the page.
+   * @param page          Page to write.
+   */
+  void writeStored(const PageId page_number, const Page& page);
+
+  /**
+   * Punches the part of a page's place past its first <stored> bytes out of
+   * the file, if the filesystem can.
+   *
+   * @param offset  Position of the page in the file.
+   * @param stored  Number of bytes the page is stored in.
+   */
+  void releaseTail(const off_t offset, const std::size_t stored);
+
+  /**
+   * Writes only the next page pointer in the header of the given page to
+   * disk.  The rest of the header, its checksum included, is left as it is;
+   * the checksum does not cover the pointer.  No bounds checking is performed.
+   *
+   * @param page_number   Number of page whose header is to be updated.
+   * @param next_page_number  New next page pointer.
+   */
+  void writeNextPageNumber(const PageId page_number,
+                           const PageId next_page_number);
+
+  /**
+   * Returns the header for this file.  The header is read from disk on first
+   * use and served from memory afterwards.
    *
    * @return  The file header.
    */
   FileHeader readHeader() const;
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Replaces the header for this file.  Only the in-memory copy is updated;
+   * it reaches the disk through flushHeader.
    *
    * @param header  File header to write.
    */
@@ -294,26 +978,27 @@ class File {
 
   /**
    * Reads only the header of the given page from disk (not the record data
-   * or slot table).  No bounds checking is performed.
+   * or slot table), as it was before the page was stored.  No bounds checking
+   * is performed.
    *
    * @param page_number   Number of page whose header is to be read.
    * @return  Header of page.
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
-  typedef std::map<std::string,
-                   std::shared_ptr<std::fstream> > StreamMap;
-  typedef std::map<std::string, int> CountMap;
+  typedef std::unordered_map<std::string,
+                             std::shared_ptr<FileHandle> > HandleMap;
 
   /**
-   * Streams for opened files.
+   * Descriptors of opened files, by name.
    */
-  static StreamMap open_streams_;
+  static HandleMap open_handles_;
 
   /**
-   * Counts for opened files.
+   * Ids of closed files, reused oldest first, and the lowest id never used.
    */
-  static CountMap open_counts_;
+  static std::deque<FileId> free_ids_;
+  static FileId next_id_;
 
   /**
    * Name of the file this object represents.
@@ -321,11 +1006,13 @@ class File {
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Descriptor of underlying filesystem object.
    */
-  std::shared_ptr<std::fstream> stream_;
+  std::shared_ptr<FileHandle> handle_;
 
   friend class FileIterator;
+  friend class HeapFile;
+  friend class PageAppender;
   friend class FileTest;
 };
 
@@ -27,6 +27,7 @@ class FileIterator {
    */
   FileIterator()
       : file_(NULL),
+        file_id_(File::INVALID_ID),
         current_page_number_(Page::INVALID_NUMBER) {
   }
 
@@ -37,7 +38,8 @@ class FileIterator {
    * @param file  File to iterate over.
    */
   FileIterator(File* file)
-      : file_(file) {
+      : file_(file),
+        file_id_(file->id()) {
     assert(file_ != NULL);
     const FileHeader& header = file_->readHeader();
     current_page_number_ = header.first_used_page;
@@ -52,6 +54,7 @@ class FileIterator {
    */
   FileIterator(File* file, PageId page_number)
       : file_(file),
+        file_id_(file->id()),
         current_page_number_(page_number) {
   }
 
@@ -85,12 +88,12 @@ class FileIterator {
    * @return    True if other iterator is equal to this one.
    */
 	inline bool operator==(const FileIterator& rhs) const {
-    return file_->filename() == rhs.file_->filename() &&
+    return file_id_ == rhs.file_id_ &&
         current_page_number_ == rhs.current_page_number_;
   }
 
 	inline bool operator!=(const FileIterator& rhs) const {
-    return (file_->filename() != rhs.file_->filename()) ||
+    return (file_id_ != rhs.file_id_) ||
         (current_page_number_ != rhs.current_page_number_);
   }
 
@@ -109,6 +112,11 @@ class FileIterator {
    */
   File* file_;
 
+  /**
+   * Id of <file_>, compared instead of its name.
+   */
+  FileId file_id_;
+
   /**
    * Number of page in file iterator is currently pointing to.
    */
@@ -0,0 +1,183 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "flash_cache.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "exceptions/file_io_exception.h"
+#include "file.h"
+#include "page.h"
+
+namespace badgerdb {
+
+FlashCache::FlashCache(const std::string& path, const std::size_t capacity)
+    : path_(path), fd_(-1), direct_(false) {
+  const int flags = O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+  fd_ = ::open(path_.c_str(), flags | O_DIRECT, 0600);
+  direct_ = fd_ >= 0;
+  if (fd_ < 0 && errno != EINVAL) {
+    throw FileIOException(path_, "open", errno);
+  }
+#endif
+  if (fd_ < 0) {
+    // The filesystem does not support direct I/O, e.g. tmpfs.
+    fd_ = ::open(path_.c_str(), flags, 0600);
+    if (fd_ < 0) {
+      throw FileIOException(path_, "open", errno);
+    }
+  }
+  // Unlinked, the file's space is freed when it is closed, even by a crash.
+  ::unlink(path_.c_str());
+
+  const std::uint32_t slots = capacity / Page::SIZE;
+  keys_.resize(slots);
+  positions_.resize(slots, order_.end());
+  free_.reserve(slots);
+  for (std::uint32_t i = slots; i > 0; --i) {
+    free_.push_back(i - 1);
+  }
+}
+
+FlashCache::~FlashCache() {
+  ::close(fd_);
+}
+
+void FlashCache::put(const File* file, const Page& page) {
+  const PageKey key = {file->id(), page.page_number()};
+  std::uint32_t slot;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::unordered_map<PageKey, std::uint32_t, PageKeyHash>::iterator old =
+        index_.find(key);
+    if (old != index_.end()) {
+      release(old->second);
+    }
+    if (free_.empty()) {
+      if (order_.empty()) {
+        // Every slot is being read or written.
+        return;
+      }
+      release(order_.back());
+    }
+    slot = free_.back();
+    free_.pop_back();
+  }
+
+  // The page is only read when writing.  Losing it is harmless, as it is
+  // clean; give the slot back.
+  const bool written = transfer(slot, const_cast<Page&>(page), true);
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (!written) {
+    free_.push_back(slot);
+    return;
+  }
+  keys_[slot] = key;
+  order_.push_front(slot);
+  positions_[slot] = order_.begin();
+  index_[key] = slot;
+}
+
+bool FlashCache::take(const File* file, const PageId pageNo, Page& page) {
+  const PageKey key = {file->id(), pageNo};
+  std::uint32_t slot;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::unordered_map<PageKey, std::uint32_t, PageKeyHash>::iterator it =
+        index_.find(key);
+    if (it == index_.end()) {
+      return false;
+    }
+    slot = it->second;
+    order_.erase(positions_[slot]);
+    positions_[slot] = order_.end();
+    index_.erase(it);
+  }
+
+  const bool read = transfer(slot, page, false);
+  std::lock_guard<std::mutex> guard(mutex_);
+  free_.push_back(slot);
+  return read;
+}
+
+void FlashCache::remove(const File* file, const PageId pageNo) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  const PageKey key = {file->id(), pageNo};
+  std::unordered_map<PageKey, std::uint32_t, PageKeyHash>::iterator it =
+      index_.find(key);
+  if (it != index_.end()) {
+    release(it->second);
+  }
+}
+
+void FlashCache::removeFile(const File* file) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (SlotList::iterator it = order_.begin(); it != order_.end();) {
+    const std::uint32_t slot = *it++;
+    if (keys_[slot].file == file->id()) {
+      release(slot);
+    }
+  }
+}
+
+std::size_t FlashCache::size() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return index_.size();
+}
+
+bool FlashCache::transfer(const std::uint32_t slot, Page& page,
+                          const bool write) {
+  char* buffer = reinterpret_cast<char*>(&page);
+  char* bounce = NULL;
+  if (direct_ &&
+      reinterpret_cast<std::uintptr_t>(buffer) % File::DIRECT_ALIGNMENT != 0) {
+    void* aligned = NULL;
+    if (posix_memalign(&aligned, File::DIRECT_ALIGNMENT, Page::SIZE) != 0) {
+      return false;
+    }
+    bounce = static_cast<char*>(aligned);
+    if (write) {
+      std::memcpy(bounce, buffer, Page::SIZE);
+    }
+  }
+  char* io = bounce != NULL ? bounce : buffer;
+  const off_t offset = static_cast<off_t>(slot) * Page::SIZE;
+  std::size_t done = 0;
+  while (done < Page::SIZE) {
+    const ssize_t n = write ? pwrite(fd_, io + done, Page::SIZE - done, offset + done)
+                            : pread(fd_, io + done, Page::SIZE - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    done += n;
+  }
+  if (bounce != NULL) {
+    if (!write && done == Page::SIZE) {
+      std::memcpy(buffer, bounce, Page::SIZE);
+    }
+    free(bounce);
+  }
+  return done == Page::SIZE;
+}
+
+void FlashCache::release(const std::uint32_t slot) {
+  index_.erase(keys_[slot]);
+  order_.erase(positions_[slot]);
+  positions_[slot] = order_.end();
+  free_.push_back(slot);
+}
+
+}
@@ -0,0 +1,109 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "replacement_policy.h"
+#include "secondary_cache.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Cache of evicted pages in a file of page-sized slots, meant for a
+ *        local SSD in front of slower storage holding the database files.
+ *
+ * The file is opened for direct I/O where the filesystem allows it, so that
+ * the pages do not also fill the kernel's page cache, and removed as soon as
+ * it is open: its contents are never used across restarts.  Reads and writes
+ * of slots are made outside the latch; a slot being read or written is in
+ * neither the free list nor the LRU list, so it cannot be handed out again
+ * until its I/O is done.
+ */
+class FlashCache : public SecondaryCache {
+ public:
+  /**
+   * Creates the file <path> holding up to <capacity> bytes of pages.
+   *
+   * @throws  FileIOException  If the file cannot be created.
+   */
+  FlashCache(const std::string& path, const std::size_t capacity);
+
+  /**
+   * Closes the file, freeing its space.
+   */
+  ~FlashCache();
+
+  FlashCache(const FlashCache&) = delete;
+  FlashCache& operator=(const FlashCache&) = delete;
+
+  const char* name() const { return "flash"; }
+  void put(const File* file, const Page& page);
+  bool take(const File* file, const PageId pageNo, Page& page);
+  void remove(const File* file, const PageId pageNo);
+  void removeFile(const File* file);
+  std::size_t size() const;
+
+ private:
+  typedef std::list<std::uint32_t> SlotList;
+
+  /**
+   * Reads or writes a whole slot, through an aligned buffer if <page> is not
+   * aligned for direct I/O.  Returns false on any error.
+   */
+  bool transfer(const std::uint32_t slot, Page& page, const bool write);
+
+  /**
+   * Moves an occupied slot to the free list; the caller holds <mutex_>.
+   */
+  void release(const std::uint32_t slot);
+
+  /**
+   * Name of the file, for errors.
+   */
+  std::string path_;
+
+  /**
+   * Descriptor of the file, and whether it was opened for direct I/O.
+   */
+  int fd_;
+  bool direct_;
+
+  /**
+   * Protects everything below.
+   */
+  mutable std::mutex mutex_;
+
+  /**
+   * Occupied slots from most (front) to least (back) recently stored.
+   */
+  SlotList order_;
+
+  /**
+   * Page held by each slot, and its position in <order_> while occupied.
+   */
+  std::vector<PageKey> keys_;
+  std::vector<SlotList::iterator> positions_;
+
+  /**
+   * Slot of every page held.
+   */
+  std::unordered_map<PageKey, std::uint32_t, PageKeyHash> index_;
+
+  /**
+   * Slots holding no page.
+   */
+  std::vector<std::uint32_t> free_;
+};
+
+}
@@ -0,0 +1,135 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "heap_file.h"
+
+#include "buffer.h"
+#include "file.h"
+
+namespace badgerdb {
+
+const std::size_t HeapFile::NUM_BUCKETS;
+const std::size_t HeapFile::BUCKET_BYTES;
+
+HeapFile::HeapFile(BufMgr* buf_mgr, File* file)
+    : buf_mgr_(buf_mgr), file_(file), buckets_(NUM_BUCKETS), non_empty_(0),
+      last_page_(Page::INVALID_NUMBER) {
+  // The headers are enough to learn the free space of every page.
+  PageId page_number = file_->readHeader().first_used_page;
+  while (page_number != Page::INVALID_NUMBER) {
+    const PageHeader header = file_->readPageHeader(page_number);
+    this->file(page_number, header.free_space_upper_bound -
+                                header.free_space_lower_bound +
+                                header.fragmented_bytes);
+    page_number = header.next_page_number;
+  }
+}
+
+RecordId HeapFile::insertRecord(const std::string& record_data) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  // A page may need a new slot for the record.
+  const std::size_t bytes = record_data.length() + sizeof(PageSlot);
+  for (;;) {
+    const PageId page_number = findPage(bytes);
+    if (page_number == Page::INVALID_NUMBER) {
+      break;
+    }
+    PageGuard page = buf_mgr_->readPage(file_, page_number);
+    if (page->hasSpaceForRecord(record_data)) {
+      const RecordId record_id = page->insertRecord(record_data);
+      page.markDirty();
+      file(page_number, page->getFreeSpace());
+      last_page_ = page_number;
+      return record_id;
+    }
+    // The page changed behind the directory's back; file it where it belongs
+    // and look again.
+    file(page_number, page->getFreeSpace());
+  }
+
+  PageId page_number;
+  PageGuard page = buf_mgr_->allocPage(file_, page_number);
+  // File the page first, so that it is reused if the record does not fit.
+  file(page_number, page->getFreeSpace());
+  const RecordId record_id = page->insertRecord(record_data);
+  page.markDirty();
+  file(page_number, page->getFreeSpace());
+  last_page_ = page_number;
+  return record_id;
+}
+
+std::string HeapFile::getRecord(const RecordId& record_id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  PageGuard page = buf_mgr_->readPage(file_, record_id.page_number);
+  return page->getRecord(record_id);
+}
+
+void HeapFile::updateRecord(const RecordId& record_id,
+                            const std::string& record_data) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  PageGuard page = buf_mgr_->readPage(file_, record_id.page_number);
+  page->updateRecord(record_id, record_data);
+  page.markDirty();
+  file(record_id.page_number, page->getFreeSpace());
+}
+
+void HeapFile::deleteRecord(const RecordId& record_id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  PageGuard page = buf_mgr_->readPage(file_, record_id.page_number);
+  page->deleteRecord(record_id);
+  page.markDirty();
+  file(record_id.page_number, page->getFreeSpace());
+}
+
+std::size_t HeapFile::numPages() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return free_space_.size();
+}
+
+std::uint16_t HeapFile::freeSpace(const PageId page_number) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  std::unordered_map<PageId, std::uint16_t>::const_iterator it =
+      free_space_.find(page_number);
+  return it == free_space_.end() ? 0 : it->second;
+}
+
+void HeapFile::file(const PageId page_number, const std::uint16_t free_space) {
+  std::unordered_map<PageId, std::uint16_t>::iterator it =
+      free_space_.find(page_number);
+  if (it != free_space_.end()) {
+    const std::size_t old_bucket = it->second / BUCKET_BYTES;
+    buckets_[old_bucket].erase(page_number);
+    if (buckets_[old_bucket].empty()) {
+      non_empty_ &= ~(std::uint64_t(1) << old_bucket);
+    }
+    it->second = free_space;
+  } else {
+    free_space_[page_number] = free_space;
+  }
+  const std::size_t bucket = free_space / BUCKET_BYTES;
+  buckets_[bucket].insert(page_number);
+  non_empty_ |= std::uint64_t(1) << bucket;
+}
+
+PageId HeapFile::findPage(const std::size_t bytes) const {
+  if (last_page_ != Page::INVALID_NUMBER &&
+      free_space_.find(last_page_)->second >= bytes) {
+    return last_page_;
+  }
+  // Every page in bucket b has at least b * BUCKET_BYTES bytes free.
+  const std::size_t first = (bytes + BUCKET_BYTES - 1) / BUCKET_BYTES;
+  if (first >= NUM_BUCKETS) {
+    return Page::INVALID_NUMBER;
+  }
+  const std::uint64_t candidates = non_empty_ & (~std::uint64_t(0) << first);
+  if (candidates == 0) {
+    return Page::INVALID_NUMBER;
+  }
+  return *buckets_[__builtin_ctzll(candidates)].begin();
+}
+
+}
@@ -0,0 +1,173 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class BufMgr;
+class File;
+
+/**
+ * @brief Unordered collection of records stored in the pages of a file, read
+ *        and written through a BufMgr.
+ *
+ * Inserts are routed to a page with room for the record by a free-space
+ * directory kept in memory: the pages of the file are grouped in buckets by
+ * their free space, and a bitmap of the non-empty buckets gives the first
+ * bucket whose pages all have room in constant time.  A new page is only
+ * allocated when no such page exists.  Bucketing is coarse, so the page the
+ * last record went to is tried first; that way pages filled by a run of inserts
+ * are packed to the last byte.
+ *
+ * The directory is built from the page headers on disk when the heap file is
+ * opened, so the file's pages should not be cached dirty in a BufMgr at that
+ * time.  It may drift from the pages if they are changed other than through
+ * this class; pages are checked for room before a record is placed on them
+ * and re-filed under their actual free space.
+ *
+ * Operations on one heap file are serialized, so a heap file may be shared by
+ * threads.
+ */
+class HeapFile {
+ public:
+  /**
+   * Number of buckets the pages are grouped in by free space.
+   */
+  static const std::size_t NUM_BUCKETS = 64;
+
+  /**
+   * Opens a heap file on the pages of <file>, read and written through
+   * <buf_mgr>.  Both must outlive the heap file.
+   *
+   * @param buf_mgr   Buffer manager the pages are pinned in.
+   * @param file      File holding the pages.
+   */
+  HeapFile(BufMgr* buf_mgr, File* file);
+
+  HeapFile(const HeapFile&) = delete;
+  HeapFile& operator=(const HeapFile&) = delete;
+
+  /**
+   * Inserts a record into a page with room for it, allocating a new page if
+   * no page has room.
+   *
+   * @param record_data  Bytes that compose the record.
+   * @return  ID of the newly inserted record.
+   * @throws  InsufficientSpaceException  If the record does not fit in an
+   *                                      empty page.
+   */
+  RecordId insertRecord(const std::string& record_data);
+
+  /**
+   * Returns a copy of the record with the given ID.
+   *
+   * @param record_id  ID of the record to return.
+   * @return  The record.
+   * @throws  InvalidRecordException  If there is no such record.
+   */
+  std::string getRecord(const RecordId& record_id);
+
+  /**
+   * Replaces the record with the given ID, keeping its ID.
+   *
+   * @param record_id   ID of record to update.
+   * @param record_data Updated bytes that compose the record.
+   * @throws  InsufficientSpaceException  If the new record does not fit on
+   *                                      the record's page.
+   */
+  void updateRecord(const RecordId& record_id, const std::string& record_data);
+
+  /**
+   * Deletes the record with the given ID.  Its page keeps the freed space for
+   * later inserts.
+   *
+   * @param record_id   ID of the record to delete.
+   */
+  void deleteRecord(const RecordId& record_id);
+
+  /**
+   * Returns the number of pages in the heap file.
+   */
+  std::size_t numPages() const;
+
+  /**
+   * Returns the free space the directory holds for a page, or 0 if the page
+   * is not in the heap file.
+   *
+   * @param page_number   Number of the page.
+   */
+  std::uint16_t freeSpace(const PageId page_number) const;
+
+ private:
+  /**
+   * Bytes of free space per bucket.
+   */
+  static const std::size_t BUCKET_BYTES = Page::DATA_SIZE / NUM_BUCKETS + 1;
+
+  /**
+   * Files a page under the bucket of its free space, replacing any earlier
+   * entry for it.  The caller must hold <mutex_>.
+   */
+  void file(const PageId page_number, const std::uint16_t free_space);
+
+  /**
+   * Returns a page whose free space is at least <bytes>, or
+   * Page::INVALID_NUMBER if there is none.  The caller must hold <mutex_>.
+   */
+  PageId findPage(const std::size_t bytes) const;
+
+  /**
+   * Buffer manager the pages are pinned in.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * File holding the pages.
+   */
+  File* file_;
+
+  /**
+   * Serializes the operations on the heap file.
+   */
+  mutable std::mutex mutex_;
+
+  /**
+   * Pages by bucket of their free space.
+   */
+  std::vector<std::unordered_set<PageId> > buckets_;
+
+  /**
+   * Bit b is set iff bucket b holds a page.
+   */
+  std::uint64_t non_empty_;
+
+  /**
+   * Free space of every page of the heap file, as last seen.
+   */
+  std::unordered_map<PageId, std::uint16_t> free_space_;
+
+  /**
+   * Page the last record was inserted into, or Page::INVALID_NUMBER.
+   */
+  PageId last_page_;
+};
+
+static_assert(HeapFile::NUM_BUCKETS <= 64,
+              "Non-empty buckets must fit in one 64-bit word.");
+
+}
@@ -0,0 +1,26 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "io_engine.h"
+
+#include "thread_io_engine.h"
+#include "uring_io_engine.h"
+
+namespace badgerdb {
+
+IoEngine* IoEngine::create(const IoEngineType type, const std::uint32_t depth) {
+  if (type != IO_ENGINE_THREADS) {
+    IoEngine* engine = UringIoEngine::open(depth);
+    if (engine != NULL) {
+      return engine;
+    }
+  }
+  // Blocking calls do not gain much past a few requests per device.
+  return new ThreadIoEngine(depth, depth < 8 ? depth : 8);
+}
+
+}
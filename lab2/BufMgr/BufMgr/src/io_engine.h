@@ -0,0 +1,127 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * @brief Asynchronous I/O backends that can be chosen when constructing a
+ *        BufMgr.
+ */
+enum IoEngineType {
+  /**
+   * io_uring if the kernel supports it, a thread pool otherwise.
+   */
+  IO_ENGINE_AUTO,
+
+  /**
+   * Linux io_uring, set up with raw system calls.  Falls back to a thread
+   * pool if the kernel does not support it.
+   */
+  IO_ENGINE_URING,
+
+  /**
+   * A small pool of threads that each issue blocking reads and writes.
+   */
+  IO_ENGINE_THREADS
+};
+
+/**
+ * @brief One positional read or write of a single buffer.
+ *
+ * Requests are prepared by File::prepareRead() and File::prepareWrite(),
+ * which fill in everything but <tag>, and completed by File::finishRead() and
+ * File::finishWrite().
+ */
+struct IoRequest {
+  /**
+   * Whether the request writes <iov> to the file rather than reading it.
+   */
+  bool write;
+
+  /**
+   * File descriptor to transfer on.
+   */
+  int fd;
+
+  /**
+   * Position in the file where the transfer starts.
+   */
+  off_t offset;
+
+  /**
+   * Buffer to transfer.
+   */
+  struct iovec iov;
+
+  /**
+   * Set on completion to the number of bytes transferred, or to -errno.  A
+   * short transfer is not retried by the engine.
+   */
+  ssize_t result;
+
+  /**
+   * Left alone by the engine, for the caller to match completions.
+   */
+  std::size_t tag;
+};
+
+/**
+ * @brief Interface of an engine that keeps many reads and writes in flight at
+ *        once.
+ *
+ * Requests are queued with submit() and handed back, in completion order, by
+ * wait().  Every submitted request must be waited for before the engine is
+ * destroyed.  An engine is meant to be used by one thread at a time.
+ */
+class IoEngine {
+ public:
+  /**
+   * Creates an engine of the given type.
+   *
+   * @param type    Backend to create.
+   * @param depth   Maximum number of requests in flight.
+   * @return  Newly allocated engine, owned by the caller.
+   */
+  static IoEngine* create(const IoEngineType type, const std::uint32_t depth);
+
+  virtual ~IoEngine() {}
+
+  /**
+   * Returns a short name of the backend actually in use.
+   */
+  virtual const char* name() const = 0;
+
+  /**
+   * Returns the maximum number of requests in flight.
+   */
+  virtual std::uint32_t depth() const = 0;
+
+  /**
+   * Queues a request.  The request must stay alive and untouched until wait()
+   * returns it, and at most depth() requests may be in flight.
+   *
+   * @param request   Request to start.
+   */
+  virtual void submit(IoRequest& request) = 0;
+
+  /**
+   * Starts all queued requests and blocks until one of them completes.
+   *
+   * @return  The completed request, with <result> set.
+   */
+  virtual IoRequest& wait() = 0;
+};
+
+}
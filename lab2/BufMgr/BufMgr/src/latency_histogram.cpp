@@ -0,0 +1,79 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "latency_histogram.h"
+
+#include <cmath>
+
+namespace badgerdb {
+
+const std::size_t LatencyHistogram::BUCKETS;
+
+LatencyHistogram::LatencyHistogram() : total_nanos(0) {
+  for (std::size_t i = 0; i < BUCKETS; ++i) {
+    counts[i] = 0;
+  }
+}
+
+std::size_t LatencyHistogram::bucketOf(const std::uint64_t nanos) {
+  if (nanos < 2) {
+    return 0;
+  }
+  const std::size_t bucket = 63 - __builtin_clzll(nanos);
+  return bucket < BUCKETS ? bucket : BUCKETS - 1;
+}
+
+std::uint64_t LatencyHistogram::count() const {
+  std::uint64_t total = 0;
+  for (std::size_t i = 0; i < BUCKETS; ++i) {
+    total += counts[i];
+  }
+  return total;
+}
+
+double LatencyHistogram::meanNanos() const {
+  const std::uint64_t n = count();
+  return n == 0 ? 0.0 : static_cast<double>(total_nanos) / n;
+}
+
+std::uint64_t LatencyHistogram::percentileNanos(const double fraction) const {
+  const std::uint64_t n = count();
+  if (n == 0) {
+    return 0;
+  }
+  // The latency of rank ceil(fraction * n), counting from 1.
+  std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(fraction * n));
+  if (rank == 0) {
+    rank = 1;
+  }
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < BUCKETS; ++i) {
+    seen += counts[i];
+    if (seen >= rank) {
+      return (std::uint64_t(2) << i) - 1;
+    }
+  }
+  return (std::uint64_t(2) << (BUCKETS - 1)) - 1;
+}
+
+void LatencyRecorder::clear() {
+  for (std::size_t i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+    counts_[i].store(0, std::memory_order_relaxed);
+  }
+  total_nanos_.store(0, std::memory_order_relaxed);
+}
+
+LatencyHistogram LatencyRecorder::snapshot() const {
+  LatencyHistogram histogram;
+  for (std::size_t i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+    histogram.counts[i] = counts_[i].load(std::memory_order_relaxed);
+  }
+  histogram.total_nanos = total_nanos_.load(std::memory_order_relaxed);
+  return histogram;
+}
+
+}
@@ -0,0 +1,111 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * @brief Counts of latencies in power-of-two buckets of nanoseconds, as copied
+ *        out of a LatencyRecorder.
+ *
+ * Bucket 0 counts latencies under 2 ns and bucket i > 0 those in
+ * [2^i, 2^(i+1)) ns; the last bucket also counts everything longer.
+ * Percentiles are therefore accurate to a factor of two, which is enough to
+ * tell a page cache hit from a device read from a queue behind other I/O.
+ */
+struct LatencyHistogram {
+  /**
+   * Number of buckets, enough for latencies of up to a minute.
+   */
+  static const std::size_t BUCKETS = 36;
+
+  /**
+   * Creates an empty histogram.
+   */
+  LatencyHistogram();
+
+  /**
+   * Returns the bucket a latency of <nanos> falls in.
+   */
+  static std::size_t bucketOf(const std::uint64_t nanos);
+
+  /**
+   * Returns the number of latencies counted.
+   */
+  std::uint64_t count() const;
+
+  /**
+   * Returns the mean latency in nanoseconds, or 0 if none was counted.
+   */
+  double meanNanos() const;
+
+  /**
+   * Returns the upper bound, in nanoseconds, of the bucket holding the
+   * latency below which <fraction> of the latencies fall, e.g. 0.99 for the
+   * 99th percentile; 0 if none was counted.
+   */
+  std::uint64_t percentileNanos(const double fraction) const;
+
+  /**
+   * Latencies counted per bucket.
+   */
+  std::uint64_t counts[BUCKETS];
+
+  /**
+   * Sum of the latencies counted.
+   */
+  std::uint64_t total_nanos;
+};
+
+/**
+ * @brief Histogram of latencies that any number of threads can record into at
+ *        once, with one relaxed atomic increment per bucket and total.
+ */
+class LatencyRecorder {
+ public:
+  /**
+   * Creates an empty recorder.
+   */
+  LatencyRecorder() { clear(); }
+
+  LatencyRecorder(const LatencyRecorder&) = delete;
+  LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+  /**
+   * Counts one latency of <nanos> nanoseconds.
+   */
+  void record(const std::uint64_t nanos) {
+    counts_[LatencyHistogram::bucketOf(nanos)].fetch_add(
+        1, std::memory_order_relaxed);
+    total_nanos_.fetch_add(nanos, std::memory_order_relaxed);
+  }
+
+  /**
+   * Forgets every latency counted.
+   */
+  void clear();
+
+  /**
+   * Returns a copy of the counts.  Latencies recorded meanwhile may be in
+   * some buckets and not yet in the total.
+   */
+  LatencyHistogram snapshot() const;
+
+ private:
+  /**
+   * Latencies counted per bucket, and their sum.
+   */
+  std::atomic<std::uint64_t> counts_[LatencyHistogram::BUCKETS];
+  std::atomic<std::uint64_t> total_nanos_;
+};
+
+}
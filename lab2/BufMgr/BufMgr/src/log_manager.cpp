@@ -0,0 +1,218 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "log_manager.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+LogManager::LogManager(const std::string& filename,
+                       const std::size_t buffer_size)
+    : filename_(filename), fd_(-1), buffer_size_(buffer_size), end_(0),
+      writing_(false), durable_(0), syncs_(0) {
+  fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    throw FileIOException(filename_, "open", errno);
+  }
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    const int error = errno;
+    ::close(fd_);
+    throw FileIOException(filename_, "open", error);
+  }
+
+  // Find the end of the last intact record and drop whatever follows it.
+  const Lsn size = st.st_size;
+  Lsn end = 0;
+  std::string record;
+  try {
+    while (readRecord(end, size, record)) {
+      end += sizeof(RecordHeader) + record.size();
+    }
+  } catch (...) {
+    ::close(fd_);
+    throw;
+  }
+  if (end != size && ftruncate(fd_, end) != 0) {
+    const int error = errno;
+    ::close(fd_);
+    throw FileIOException(filename_, "truncate", error);
+  }
+  end_ = end;
+  durable_ = end;
+  buffer_.reserve(buffer_size_);
+}
+
+LogManager::~LogManager() {
+  try {
+    flush();
+  } catch (...) {
+    // Nothing to report the error to; the records are lost as in a crash.
+  }
+  ::close(fd_);
+}
+
+Lsn LogManager::append(const void* data, const std::size_t length) {
+  RecordHeader header;
+  header.length = static_cast<std::uint32_t>(length);
+  header.checksum = checksum(static_cast<const char*>(data), length);
+
+  std::unique_lock<std::mutex> guard(mutex_);
+  if (!writing_ && !buffer_.empty() &&
+      buffer_.size() + sizeof(header) + length > buffer_size_) {
+    // Records appended while another thread writes the log go out with the
+    // next write, so the buffer may outgrow its size until then.
+    writeBuffer(guard);
+  }
+  const char* bytes = reinterpret_cast<const char*>(&header);
+  buffer_.insert(buffer_.end(), bytes, bytes + sizeof(header));
+  buffer_.insert(buffer_.end(), static_cast<const char*>(data),
+                 static_cast<const char*>(data) + length);
+  end_ += sizeof(header) + length;
+  return end_;
+}
+
+void LogManager::flush(const Lsn lsn) {
+  if (durableLsn() >= lsn) {
+    return;
+  }
+  std::unique_lock<std::mutex> guard(mutex_);
+  const Lsn target = lsn < end_ ? lsn : end_;
+  while (durableLsn() < target) {
+    if (writing_) {
+      // The write in progress may cover <target>; if not, the next one will
+      // also take everything appended meanwhile.
+      written_.wait(guard);
+    } else {
+      writeBuffer(guard);
+    }
+  }
+}
+
+Lsn LogManager::endLsn() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return end_;
+}
+
+void LogManager::scan(
+    const std::function<void(Lsn, const std::string&)>& visit) const {
+  const Lsn limit = durableLsn();
+  Lsn offset = 0;
+  std::string record;
+  while (readRecord(offset, limit, record)) {
+    offset += sizeof(RecordHeader) + record.size();
+    visit(offset, record);
+  }
+}
+
+std::uint32_t LogManager::checksum(const char* data, const std::size_t length) {
+  // FNV-1a over the length and the bytes, enough to tell a torn record from an
+  // intact one.
+  std::uint32_t hash = 2166136261u;
+  const std::uint32_t n = static_cast<std::uint32_t>(length);
+  const char* size = reinterpret_cast<const char*>(&n);
+  for (std::size_t i = 0; i < sizeof(n); ++i) {
+    hash = (hash ^ static_cast<unsigned char>(size[i])) * 16777619u;
+  }
+  for (std::size_t i = 0; i < length; ++i) {
+    hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+  }
+  return hash;
+}
+
+bool LogManager::readRecord(const Lsn offset, const Lsn limit,
+                            std::string& record) const {
+  RecordHeader header;
+  if (offset + sizeof(header) > limit) {
+    return false;
+  }
+  ssize_t n;
+  do {
+    n = pread(fd_, &header, sizeof(header), offset);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    throw FileIOException(filename_, "read", errno);
+  }
+  if (n != static_cast<ssize_t>(sizeof(header)) ||
+      offset + sizeof(header) + header.length > limit) {
+    return false;
+  }
+  record.resize(header.length);
+  std::size_t done = 0;
+  while (done < header.length) {
+    n = pread(fd_, &record[done], header.length - done,
+              offset + sizeof(header) + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, "read", errno);
+    }
+    if (n == 0) {
+      return false;
+    }
+    done += n;
+  }
+  return checksum(record.data(), record.size()) == header.checksum;
+}
+
+void LogManager::writeBuffer(std::unique_lock<std::mutex>& guard) {
+  while (writing_) {
+    written_.wait(guard);
+  }
+  if (buffer_.empty()) {
+    return;
+  }
+  std::vector<char> out;
+  out.swap(buffer_);
+  buffer_.reserve(buffer_size_);
+  const Lsn start = end_ - out.size();
+  writing_ = true;
+  guard.unlock();
+
+  // Appends carry on into the fresh buffer while this one is written.
+  int error = 0;
+  const char* operation = "write";
+  std::size_t done = 0;
+  while (done < out.size()) {
+    const ssize_t n = pwrite(fd_, &out[done], out.size() - done, start + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      error = errno;
+      break;
+    }
+    done += n;
+  }
+  if (error == 0 && fdatasync(fd_) != 0) {
+    error = errno;
+    operation = "sync";
+  }
+
+  guard.lock();
+  writing_ = false;
+  if (error != 0) {
+    // Keep the records, so that a later flush writes them again.
+    buffer_.insert(buffer_.begin(), out.begin(), out.end());
+    written_.notify_all();
+    throw FileIOException(filename_, operation, error);
+  }
+  durable_.store(start + out.size(), std::memory_order_release);
+  syncs_.fetch_add(1, std::memory_order_relaxed);
+  written_.notify_all();
+}
+
+}
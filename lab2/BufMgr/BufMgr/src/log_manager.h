@@ -0,0 +1,212 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Write-ahead log: an append-only file of records, each describing a
+ *        change to one or more pages.
+ *
+ * Records are appended to an in-memory buffer and reach the file, in order,
+ * when a caller needs them durable.  The LSN returned for a record is its end
+ * position in the log, so the log is durable up to an LSN once that many bytes
+ * of it have been synced.  A caller changing a page logs the change, stamps the
+ * page with the record's LSN and marks it dirty; BufMgr then flushes the log up
+ * to the page's LSN before it writes the page, which makes it safe to write
+ * dirty pages back at any time and to never force them at commit.
+ *
+ * Callers that need records durable while another thread is already writing
+ * the log wait for that write and then write everything appended meanwhile in
+ * one go, so concurrent commits share syncs.
+ *
+ * On disk each record is a length, a checksum of the record and the record
+ * bytes.  Opening a log drops a partly written record left at its end by a
+ * crash.
+ *
+ * The contents of records are up to the caller; recovery scans the log and
+ * redoes the changes whose LSN is newer than that of the page on disk.
+ */
+class LogManager {
+ public:
+  /**
+   * Opens the log in the named file, creating it if it does not exist.
+   *
+   * @param filename    Name of the log file.
+   * @param buffer_size Number of bytes buffered before an append writes them
+   *                    to the file without being asked to.
+   * @throws  FileIOException  If the file cannot be opened, read or truncated.
+   */
+  explicit LogManager(const std::string& filename,
+                      const std::size_t buffer_size = 1 << 20);
+
+  /**
+   * Writes out and syncs any buffered records and closes the file.
+   */
+  ~LogManager();
+
+  LogManager(const LogManager&) = delete;
+  LogManager& operator=(const LogManager&) = delete;
+
+  /**
+   * Appends a record to the log.  The record is not durable until the log is
+   * flushed up to the returned LSN.
+   *
+   * @param data    Bytes of the record.
+   * @param length  Number of bytes in the record.
+   * @return  LSN of the record.
+   * @throws  FileIOException  If the buffer was full and could not be written.
+   */
+  Lsn append(const void* data, const std::size_t length);
+
+  /**
+   * Appends a record to the log.
+   *
+   * @param record  Bytes of the record.
+   * @return  LSN of the record.
+   */
+  Lsn append(const std::string& record) {
+    return append(record.data(), record.size());
+  }
+
+  /**
+   * Makes the log durable up to the given LSN.  Returns at once if it already
+   * is.
+   *
+   * @param lsn   LSN the log must be durable up to.
+   * @throws  FileIOException  If the log could not be written or synced.
+   */
+  void flush(const Lsn lsn);
+
+  /**
+   * Makes every record appended so far durable.
+   */
+  void flush() { flush(endLsn()); }
+
+  /**
+   * Returns the LSN of the last record appended, or of the end of the log
+   * found on open.
+   */
+  Lsn endLsn() const;
+
+  /**
+   * Returns the LSN the log is durable up to.
+   */
+  Lsn durableLsn() const { return durable_.load(std::memory_order_acquire); }
+
+  /**
+   * Returns the number of times the log was synced.
+   */
+  std::uint64_t syncs() const { return syncs_.load(std::memory_order_relaxed); }
+
+  /**
+   * Calls <visit> with the LSN and bytes of every record written to the file,
+   * oldest first.  Records still only buffered are not visited.
+   *
+   * @param visit   Function called for each record.
+   * @throws  FileIOException  If the file cannot be read.
+   */
+  void scan(const std::function<void(Lsn, const std::string&)>& visit) const;
+
+  /**
+   * Returns the name of the log file.
+   */
+  const std::string& filename() const { return filename_; }
+
+ private:
+  /**
+   * Bytes written before the bytes of each record.
+   */
+  struct RecordHeader {
+    std::uint32_t length;
+    std::uint32_t checksum;
+  };
+
+  /**
+   * Returns the checksum stored for a record.
+   */
+  static std::uint32_t checksum(const char* data, const std::size_t length);
+
+  /**
+   * Reads the record starting at <offset> in the file into <record>.
+   *
+   * @param offset  Position of the record in the file.
+   * @param limit   Position the record must end by.
+   * @return  False if there is no complete, intact record at <offset>.
+   */
+  bool readRecord(const Lsn offset, const Lsn limit, std::string& record) const;
+
+  /**
+   * Writes out and syncs everything buffered, waiting first for another
+   * thread's write if needed.  Called and returns with <mutex_> held.
+   */
+  void writeBuffer(std::unique_lock<std::mutex>& guard);
+
+  /**
+   * Name of the log file.
+   */
+  const std::string filename_;
+
+  /**
+   * Descriptor of the log file.
+   */
+  int fd_;
+
+  /**
+   * Number of bytes buffered before an append writes them out.
+   */
+  const std::size_t buffer_size_;
+
+  /**
+   * Protects everything below except <durable_> and <syncs_>.
+   */
+  mutable std::mutex mutex_;
+
+  /**
+   * Signalled when a write of the log completes.
+   */
+  std::condition_variable written_;
+
+  /**
+   * Records appended but not yet handed to a write.
+   */
+  std::vector<char> buffer_;
+
+  /**
+   * LSN of the end of the log, including <buffer_>.
+   */
+  Lsn end_;
+
+  /**
+   * Whether a thread is writing the log with <mutex_> released.
+   */
+  bool writing_;
+
+  /**
+   * LSN the log is durable up to.
+   */
+  std::atomic<Lsn> durable_;
+
+  /**
+   * Number of times the log was synced.
+   */
+  std::atomic<std::uint64_t> syncs_;
+};
+
+}
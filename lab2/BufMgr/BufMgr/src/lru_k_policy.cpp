@@ -0,0 +1,150 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "lru_k_policy.h"
+
+namespace badgerdb {
+
+LruKPolicy::LruKPolicy(const std::uint32_t numBufs, const std::uint32_t k)
+    : k(k == 0 ? 1 : k),
+      numBufs(numBufs),
+      now(0),
+      resident(numBufs, false),
+      pages(numBufs),
+      histories(numBufs),
+      keys(numBufs, 0),
+      freeFrames(numBufs, 1) {
+  // hand out frames in ascending order while the pool fills up.
+  for (FrameId i = 0; i < numBufs; ++i) {
+    freeFrames.pushFront(0, i);
+  }
+}
+
+std::uint64_t LruKPolicy::evictionKey(const History& history) const {
+  // pages with fewer than K accesses sort before all others, by last access.
+  const std::uint64_t full = static_cast<std::uint64_t>(1) << 63;
+  if (history.size() < k) {
+    return history.empty() ? 0 : history.front();
+  }
+  return full | history.back();
+}
+
+void LruKPolicy::touch(const FrameId frame) {
+  History& history = histories[frame];
+  history.insert(history.begin(), ++now);
+  if (history.size() > k) {
+    history.pop_back();
+  }
+  order.erase(std::make_pair(keys[frame], frame));
+  keys[frame] = evictionKey(history);
+  order.insert(std::make_pair(keys[frame], frame));
+}
+
+void LruKPolicy::recordAccess(const FrameId frame) {
+  std::lock_guard<std::mutex> guard(mutex);
+  if (resident[frame]) {
+    touch(frame);
+  }
+}
+
+void LruKPolicy::recordLoad(const FrameId frame, const File* file,
+                            const PageId pageNo) {
+  std::lock_guard<std::mutex> guard(mutex);
+  if (resident[frame]) {
+    order.erase(std::make_pair(keys[frame], frame));
+  }
+  freeFrames.remove(frame);
+  const PageKey key = {file->id(), pageNo};
+  auto it = retained.find(key);
+  histories[frame].clear();
+  if (it != retained.end()) {
+    histories[frame].swap(it->second.history);
+    retainedOrder.erase(it->second.position);
+    retained.erase(it);
+  }
+  resident[frame] = true;
+  pages[frame] = key;
+  keys[frame] = evictionKey(histories[frame]);
+  order.insert(std::make_pair(keys[frame], frame));
+  touch(frame);
+}
+
+void LruKPolicy::recordRemove(const FrameId frame) {
+  std::lock_guard<std::mutex> guard(mutex);
+  if (resident[frame]) {
+    order.erase(std::make_pair(keys[frame], frame));
+    resident[frame] = false;
+    histories[frame].clear();
+  }
+  if (freeFrames.listOf(frame) == FrameLists::NONE) {
+    freeFrames.pushFront(0, frame);
+  }
+}
+
+void LruKPolicy::resize(const std::uint32_t numBufs) {
+  std::lock_guard<std::mutex> guard(mutex);
+  for (FrameId frame = numBufs; frame < this->numBufs; ++frame) {
+    if (resident[frame]) {
+      order.erase(std::make_pair(keys[frame], frame));
+      resident[frame] = false;
+      histories[frame].clear();
+    }
+    freeFrames.remove(frame);
+  }
+  for (FrameId frame = this->numBufs; frame < numBufs; ++frame) {
+    freeFrames.pushFront(0, frame);
+  }
+  this->numBufs = numBufs;
+}
+
+bool LruKPolicy::selectVictim(const File* file, const PageId pageNo,
+                              FrameClaimer& claimer, FrameId& frame) {
+  std::lock_guard<std::mutex> guard(mutex);
+  for (FrameId candidate = freeFrames.back(0); candidate != freeFrames.end();
+       candidate = freeFrames.towardsFront(candidate)) {
+    if (claimer.claim(candidate)) {
+      freeFrames.remove(candidate);
+      frame = candidate;
+      return true;
+    }
+  }
+  for (auto it = order.begin(); it != order.end(); ++it) {
+    const FrameId candidate = it->second;
+    if (!claimer.claim(candidate)) {
+      continue;
+    }
+    order.erase(it);
+    resident[candidate] = false;
+    // remember the history of the evicted page for a while.
+    if (retained.size() >= numBufs && !retainedOrder.empty()) {
+      retained.erase(retainedOrder.back());
+      retainedOrder.pop_back();
+    }
+    if (retained.count(pages[candidate]) == 0) {
+      retainedOrder.push_front(pages[candidate]);
+      Retained& entry = retained[pages[candidate]];
+      entry.history.swap(histories[candidate]);
+      entry.position = retainedOrder.begin();
+    }
+    histories[candidate].clear();
+    frame = candidate;
+    return true;
+  }
+  return false;
+}
+
+void LruKPolicy::nextVictims(const std::uint32_t count,
+                             std::vector<FrameId>& frames) {
+  std::lock_guard<std::mutex> guard(mutex);
+  frames.clear();
+  for (auto it = order.begin(); it != order.end() && frames.size() < count;
+       ++it) {
+    frames.push_back(it->second);
+  }
+}
+
+}
@@ -0,0 +1,134 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief LRU-K replacement (O'Neil, O'Neil and Weikum).
+ *
+ * Evicts the page with the largest backward K-distance, i.e. whose K-th most
+ * recent access is the oldest.  Pages with fewer than K accesses have an
+ * infinite distance and are evicted first, least recently used first.  The
+ * access history of evicted pages is retained for up to numBufs pages, so a
+ * page that comes back shortly after eviction keeps its history.
+ */
+class LruKPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructs an LRU-K policy for <numBufs> frames.
+   */
+  LruKPolicy(const std::uint32_t numBufs, const std::uint32_t k);
+
+  const char* name() const { return "lru-k"; }
+  void recordAccess(const FrameId frame);
+  void recordLoad(const FrameId frame, const File* file, const PageId pageNo);
+  void recordRemove(const FrameId frame);
+  void resize(const std::uint32_t numBufs);
+  bool selectVictim(const File* file, const PageId pageNo,
+                    FrameClaimer& claimer, FrameId& frame);
+  void nextVictims(const std::uint32_t count, std::vector<FrameId>& frames);
+
+ private:
+  /**
+   * Most recent access times of a page, newest first, at most K entries.
+   */
+  typedef std::vector<std::uint64_t> History;
+
+  /**
+   * Eviction order key of a frame with the given history; smaller keys are
+   * evicted first.
+   */
+  std::uint64_t evictionKey(const History& history) const;
+
+  /**
+   * Records an access at the current time in the frame's history and
+   * reorders the frame.
+   */
+  void touch(const FrameId frame);
+
+  /**
+   * Serializes all calls.
+   */
+  std::mutex mutex;
+
+  /**
+   * Number of accesses kept per page.
+   */
+  std::uint32_t k;
+
+  /**
+   * Number of frames in use, which is also the bound on retained histories.
+   */
+  std::uint32_t numBufs;
+
+  /**
+   * Logical clock, advanced on every access.
+   */
+  std::uint64_t now;
+
+  /**
+   * Whether each frame currently holds a page.
+   */
+  std::vector<bool> resident;
+
+  /**
+   * Page held by each resident frame.
+   */
+  std::vector<PageKey> pages;
+
+  /**
+   * Access history of each resident frame.
+   */
+  std::vector<History> histories;
+
+  /**
+   * Eviction key each resident frame is filed under in <order>.
+   */
+  std::vector<std::uint64_t> keys;
+
+  /**
+   * Resident frames ordered by eviction key.
+   */
+  std::set<std::pair<std::uint64_t, FrameId> > order;
+
+  /**
+   * Frames holding no page, in list 0.  Frames claimed by selectVictim are in
+   * no list and not resident until they are loaded or removed.
+   */
+  FrameLists freeFrames;
+
+  /**
+   * Evicted pages, most recently evicted first.
+   */
+  std::list<PageKey> retainedOrder;
+
+  /**
+   * History of an evicted page and its position in retainedOrder.
+   */
+  struct Retained {
+    History history;
+    std::list<PageKey>::iterator position;
+  };
+
+  /**
+   * Histories of evicted pages.
+   */
+  std::unordered_map<PageKey, Retained, PageKeyHash> retained;
+};
+
+}
@@ -1,17 +1,44 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <stdlib.h>
 //#include <stdio.h>
 #include <cstring>
+#include <fstream>
 #include <memory>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "page.h"
 #include "buffer.h"
+#include "bulk_loader.h"
+#include "btree_index.h"
+#include "crc32c.h"
+#include "external_sort.h"
 #include "file_iterator.h"
+#include "heap_file.h"
+#include "log_manager.h"
 #include "page_iterator.h"
+#include "parallel_scan.h"
+#include "record_batch.h"
+#include "trace_replayer.h"
+#include "exceptions/file_exists_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
+#include "exceptions/file_open_exception.h"
+#include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/invalid_record_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/corrupt_page_exception.h"
+#include "exceptions/badgerdb_exception.h"
 
 #define PRINT_ERROR(str) \
 { \
@@ -36,6 +63,45 @@ void test3();
 void test4();
 void test5();
 void test6();
+void test7();
+void test8();
+void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+void test31();
+void test32();
+void test33();
+void test34();
+void test35();
+void test36();
+void test37();
+void test38();
+void test39();
+void test40();
+void test41();
+void test42();
+void test43();
+void test44();
+void test45();
 void testBufMgr();
 
 int main() 
@@ -146,6 +212,45 @@ void testBufMgr()
 	test4();
 	test5();
 	test6();
+	test7();
+	test8();
+	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
+	test27();
+	test28();
+	test29();
+	test30();
+	test31();
+	test32();
+	test33();
+	test34();
+	test35();
+	test36();
+	test37();
+	test38();
+	test39();
+	test40();
+	test41();
+	test42();
+	test43();
+	test44();
+	test45();
 
 	//Close files before deleting them
 	file1.~File();
@@ -331,3 +436,3195 @@ void test6()
 		bufMgr->unPinPage(file1ptr, i, true);
 	bufMgr->flushFile(file1ptr);
 }
+
+void test7()
+{
+	//Concurrent readers hitting and missing on the same file through the sharded page table
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++)
+	{
+		threads.push_back(std::thread([t]() {
+			char buf[100];
+			Page* p;
+			for (int round = 0; round < 5; round++)
+			{
+				for (PageId j = 1; j <= num; j++)
+				{
+					PageId pageNo = (j * (t + 1) + round) % num + 1;
+					bufMgr->readPage(file1ptr, pageNo, p);
+					sprintf(buf, "test.1 Page %d %7.1f", pageNo, (float)pageNo);
+					if(strncmp(p->getRecord({pageNo, 1}).c_str(), buf, strlen(buf)) != 0)
+					{
+						PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+					}
+					bufMgr->unPinPage(file1ptr, pageNo, false);
+				}
+			}
+		}));
+	}
+	for (std::size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+
+	//Pages of one file written from several threads while another allocates and
+	//deletes pages after them; the used list must come out intact
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename, true /* direct */);
+		const PageId pages = 64;
+		for (PageId j = 0; j < pages; j++)
+			file6.allocatePage();
+
+		std::vector<std::thread> writers;
+		for (int t = 0; t < 4; t++)
+		{
+			writers.push_back(std::thread([&file6, t, pages]() {
+				char buf[100];
+				for (int round = 0; round < 20; round++)
+				{
+					for (PageId j = 1 + t; j <= pages; j += 4)
+					{
+						Page p = file6.readPage(j);
+						sprintf(buf, "test.6 Page %d round %d", j, round);
+						if (round == 0)
+							p.insertRecord(buf);
+						else
+							p.updateRecord({j, 1}, buf);
+						file6.writePage(p);
+					}
+				}
+			}));
+		}
+		std::thread allocator([&file6]() {
+			for (int round = 0; round < 100; round++)
+			{
+				const PageId first = file6.allocatePage().page_number();
+				const PageId second = file6.allocatePage().page_number();
+				file6.deletePage(first);
+				file6.deletePage(second);
+			}
+		});
+		for (std::size_t t = 0; t < writers.size(); t++)
+			writers[t].join();
+		allocator.join();
+
+		char buf[100];
+		PageId expected = 1;
+		for (FileIterator iter = file6.begin(); iter != file6.end(); ++iter)
+		{
+			Page p = *iter;
+			sprintf(buf, "test.6 Page %d round %d", expected, 19);
+			if (p.page_number() != expected || p.getRecord({expected, 1}) != buf)
+			{
+				PRINT_ERROR("ERROR :: USED LIST BROKEN BY CONCURRENT WRITES");
+			}
+			expected++;
+		}
+		if (expected != pages + 1)
+		{
+			PRINT_ERROR("ERROR :: USED LIST BROKEN BY CONCURRENT WRITES");
+		}
+	}
+	File::remove(filename);
+
+	//Threads missing on the same pages of a pool small enough that every miss
+	//evicts, and most evictions write back a page dirtied by another thread
+	{
+		File file6 = File::create(filename);
+		BufMgr* mgr = new BufMgr(8);
+		const PageId shared = 16, owned = 16;
+		for (PageId j = 0; j < shared + owned; j++)
+		{
+			mgr->allocPage(&file6, pageno1, page);
+			sprintf((char*)tmpbuf, "test.6 Page %d round %d", pageno1, 0);
+			page->insertRecord(tmpbuf);
+			mgr->unPinPage(&file6, pageno1, true);
+		}
+
+		std::vector<std::thread> workers;
+		for (int t = 0; t < 4; t++)
+		{
+			workers.push_back(std::thread([mgr, &file6, t, shared, owned]() {
+				char buf[100];
+				Page* p;
+				for (int round = 1; round <= 20; round++)
+				{
+					for (PageId j = 1; j <= shared; j++)
+					{
+						mgr->readPage(&file6, j, p);
+						sprintf(buf, "test.6 Page %d round %d", j, 0);
+						if (p->getRecord({j, 1}) != buf)
+						{
+							PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+						}
+						mgr->unPinPage(&file6, j, false);
+
+						// the owned pages whose index is t modulo 4 are only written by this thread.
+						const PageId mine = shared + 1 + (j * 4 + t) % owned;
+						mgr->readPage(&file6, mine, p);
+						sprintf(buf, "test.6 Page %d round %d", mine, round);
+						p->updateRecord({mine, 1}, buf);
+						mgr->unPinPage(&file6, mine, true);
+					}
+				}
+			}));
+		}
+		for (std::size_t t = 0; t < workers.size(); t++)
+			workers[t].join();
+
+		//No pin may be left behind by a miss that lost a race
+		mgr->flushFile(&file6);
+		for (PageId j = shared + 1; j <= shared + owned; j++)
+		{
+			sprintf((char*)tmpbuf, "test.6 Page %d round %d", j, 20);
+			if (file6.readPage(j).getRecord({j, 1}) != (char*)tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: DIRTY PAGE LOST ON EVICTION");
+			}
+		}
+		delete mgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 7 passed" << "\n";
+}
+
+void test8()
+{
+	//Every replacement policy keeps page contents correct, reports its statistics and
+	//still detects a pool that is completely pinned
+	const std::string& filename = "test.6";
+	const ReplacementPolicyType policies[] = {POLICY_CLOCK, POLICY_LRU_K, POLICY_2Q, POLICY_ARC};
+	const char* names[] = {"clock", "lru-k", "2q", "arc"};
+	const PageId bufs = 10, pages = 30;
+
+	for (int k = 0; k < 4; k++)
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException&)
+		{
+		}
+
+		{
+			File file6 = File::create(filename);
+			BufMgrOptions options;
+			options.policy = policies[k];
+			options.numShards = 4;
+			BufMgr* mgr = new BufMgr(bufs, options);
+
+			for (i = 0; i < pages; i++)
+			{
+				mgr->allocPage(&file6, pageno1, page);
+				sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", pageno1, (float)pageno1);
+				page->insertRecord(tmpbuf);
+				mgr->unPinPage(&file6, pageno1, true);
+			}
+
+			//Hot pages 1-4 interleaved with repeated scans over the other pages
+			std::uint64_t reads = 0;
+			for (int round = 0; round < 3; round++)
+			{
+				for (PageId scan = 5; scan <= pages; scan++)
+				{
+					const PageId touched[] = {scan % 4 + 1, scan};
+					for (int t = 0; t < 2; t++)
+					{
+						mgr->readPage(&file6, touched[t], page);
+						sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", touched[t], (float)touched[t]);
+						if(strncmp(page->getRecord({touched[t], 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+						{
+							PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+						}
+						mgr->unPinPage(&file6, touched[t], false);
+						reads++;
+					}
+				}
+			}
+
+			BufStats& stats = mgr->getBufStats();
+			if (stats.hits + stats.misses != reads || strcmp(stats.policy, names[k]) != 0 ||
+					stats.hitRate() <= 0.0 || stats.hitRate() >= 1.0)
+			{
+				PRINT_ERROR("ERROR :: BUFFER STATISTICS ARE INCONSISTENT");
+			}
+
+			for (i = 1; i <= bufs; i++)
+				mgr->readPage(&file6, i, page);
+			try
+			{
+				mgr->readPage(&file6, bufs + 1, page);
+				PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown before execution reaches this point.");
+			}
+			catch(const BufferExceededException& e)
+			{
+			}
+			for (i = 1; i <= bufs; i++)
+				mgr->unPinPage(&file6, i, false);
+
+			delete mgr;
+		}
+		File::remove(filename);
+	}
+
+	std::cout << "Test 8 passed" << "\n";
+}
+
+void test9()
+{
+	//A sequential scan and a bulk load through access strategies stay inside their rings
+	//and leave the hot pages of the pool resident
+	const std::string& filename = "test.6";
+	const PageId bufs = 40, hot = 5, pages = 120;
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		BufMgr* mgr = new BufMgr(bufs);
+
+		for (i = 0; i < pages; i++)
+		{
+			mgr->allocPage(&file6, pageno1, page);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", pageno1, (float)pageno1);
+			page->insertRecord(tmpbuf);
+			mgr->unPinPage(&file6, pageno1, true);
+		}
+		mgr->flushFile(&file6);
+
+		for (int round = 0; round < 2; round++)
+		{
+			for (i = 1; i <= hot; i++)
+			{
+				mgr->readPage(&file6, i, page);
+				mgr->unPinPage(&file6, i, false);
+			}
+		}
+
+		BufAccessStrategy scan = mgr->getAccessStrategy(ACCESS_SEQUENTIAL_SCAN);
+		for (i = hot + 1; i <= pages; i++)
+		{
+			mgr->readPage(&file6, i, page, &scan);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", i, (float)i);
+			if(strncmp(page->getRecord({i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			mgr->unPinPage(&file6, i, false);
+		}
+
+		BufAccessStrategy load = mgr->getAccessStrategy(ACCESS_BULK_WRITE);
+		for (i = 0; i < pages; i++)
+		{
+			mgr->allocPage(&file6, pageno1, page, &load);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", pageno1, (float)pageno1);
+			page->insertRecord(tmpbuf);
+			mgr->unPinPage(&file6, pageno1, true);
+		}
+
+		mgr->clearBufStats();
+		for (i = 1; i <= hot; i++)
+		{
+			mgr->readPage(&file6, i, page);
+			mgr->unPinPage(&file6, i, false);
+		}
+		if (mgr->getBufStats().hits != hot)
+		{
+			PRINT_ERROR("ERROR :: SCAN EVICTED HOT PAGES");
+		}
+
+		//Pages written through the bulk ring must have reached the file
+		for (i = pages + 1; i <= 2 * pages; i++)
+		{
+			mgr->readPage(&file6, i, page, &scan);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", i, (float)i);
+			if(strncmp(page->getRecord({i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			mgr->unPinPage(&file6, i, false);
+		}
+
+		delete mgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 9 passed" << "\n";
+}
+
+void test10()
+{
+	//The background writer cleans dirty unpinned pages, so evicting them needs no I/O
+	const std::string& filename = "test.6";
+	const PageId bufs = 20;
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		BufMgrOptions options;
+		options.bgWriterDelayMs = 1;
+		options.bgWriterCleanTarget = bufs;
+		BufMgr* mgr = new BufMgr(bufs, options);
+
+		for (i = 0; i < bufs; i++)
+		{
+			mgr->allocPage(&file6, pageno1, page);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", pageno1, (float)pageno1);
+			page->insertRecord(tmpbuf);
+			mgr->unPinPage(&file6, pageno1, true);
+		}
+
+		for (int wait = 0; mgr->getBufStats().backgroundWrites < bufs; wait++)
+		{
+			if (wait == 5000)
+			{
+				PRINT_ERROR("ERROR :: BACKGROUND WRITER DID NOT CLEAN THE POOL");
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		//Every victim is now clean
+		mgr->clearBufStats();
+		for (i = 0; i < bufs; i++)
+		{
+			mgr->allocPage(&file6, pageno1, page);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", pageno1, (float)pageno1);
+			page->insertRecord(tmpbuf);
+			mgr->unPinPage(&file6, pageno1, true);
+		}
+		if (mgr->getBufStats().evictionWrites != 0)
+		{
+			PRINT_ERROR("ERROR :: EVICTION HAD TO WRITE BACK A PAGE");
+		}
+
+		for (i = 1; i <= 2 * bufs; i++)
+		{
+			mgr->readPage(&file6, i, page);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", i, (float)i);
+			if(strncmp(page->getRecord({i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			mgr->unPinPage(&file6, i, false);
+		}
+
+		delete mgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 10 passed" << "\n";
+}
+
+void test11()
+{
+	//Explicit prefetches and sequential read-ahead load pages before they are read
+	const std::string& filename = "test.6";
+	const PageId bufs = 40, pages = 30, window = 8;
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		BufMgrOptions options;
+		options.readAheadPages = window;
+		BufMgr* mgr = new BufMgr(bufs, options);
+
+		for (i = 0; i < pages; i++)
+		{
+			mgr->allocPage(&file6, pageno1, page);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", pageno1, (float)pageno1);
+			page->insertRecord(tmpbuf);
+			mgr->unPinPage(&file6, pageno1, true);
+		}
+		mgr->flushFile(&file6);
+
+		//Pages past the end of the file are ignored
+		mgr->prefetch(&file6, 1, pages + 10);
+		for (int wait = 0; mgr->getBufStats().prefetches < pages; wait++)
+		{
+			if (wait == 5000)
+			{
+				PRINT_ERROR("ERROR :: PREFETCH DID NOT LOAD THE PAGES");
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		for (i = 1; i <= pages; i++)
+		{
+			mgr->readPage(&file6, i, page);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", i, (float)i);
+			if(strncmp(page->getRecord({i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			mgr->unPinPage(&file6, i, false);
+		}
+		if (mgr->getBufStats().misses != 0)
+		{
+			PRINT_ERROR("ERROR :: PREFETCHED PAGES WERE READ AGAIN");
+		}
+
+		//Reading page 1 of an empty pool queues the next window
+		mgr->flushFile(&file6);
+		mgr->clearBufStats();
+		mgr->readPage(&file6, 1, page);
+		mgr->unPinPage(&file6, 1, false);
+		for (int wait = 0; mgr->getBufStats().prefetches < window; wait++)
+		{
+			if (wait == 5000)
+			{
+				PRINT_ERROR("ERROR :: SEQUENTIAL READ WAS NOT DETECTED");
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		for (i = 2; i <= window + 1; i++)
+		{
+			mgr->readPage(&file6, i, page);
+			mgr->unPinPage(&file6, i, false);
+		}
+		if (mgr->getBufStats().hits != window)
+		{
+			PRINT_ERROR("ERROR :: READ-AHEAD PAGES WERE NOT RESIDENT");
+		}
+
+		mgr->flushFile(&file6);
+		delete mgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 11 passed" << "\n";
+}
+
+void test12()
+{
+	//Batched reads and writes of runs of pages keep the used list of the file intact
+	const std::string& filename = "test.6";
+	const PageId pages = 10;
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		for (i = 0; i < pages; i++)
+		{
+			Page new_page = file6.allocatePage();
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", new_page.page_number(), (float)new_page.page_number());
+			new_page.insertRecord(tmpbuf);
+			file6.writePage(new_page);
+		}
+
+		std::vector<Page> run(pages);
+		file6.readPages(1, pages, &run[0]);
+		for (i = 0; i < pages; i++)
+		{
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", i + 1, (float)(i + 1));
+			if(run[i].page_number() != i + 1 ||
+					strncmp(run[i].getRecord({i + 1, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+
+		//Two runs of adjacent pages, given out of order
+		const PageId changed[] = {9, 5, 3, 4, 2};
+		std::vector<Page> updates;
+		for (i = 0; i < 5; i++)
+		{
+			updates.push_back(run[changed[i] - 1]);
+			updates.back().insertRecord("updated");
+		}
+		file6.writePages(&updates[0], updates.size());
+
+		PageId used = 0;
+		for (FileIterator iter = file6.begin(); iter != file6.end(); ++iter)
+		{
+			const bool updated = std::find(changed, changed + 5, (*iter).page_number()) != changed + 5;
+			if (updated && (*iter).getRecord({(*iter).page_number(), 2}) != "updated")
+			{
+				PRINT_ERROR("ERROR :: BATCHED WRITE WAS LOST");
+			}
+			used++;
+		}
+		if (used != pages)
+		{
+			PRINT_ERROR("ERROR :: BATCHED WRITE BROKE THE USED PAGE LIST");
+		}
+
+		try
+		{
+			file6.readPages(pages - 1, 3, &run[0]);
+			PRINT_ERROR("ERROR :: Run reaches past the end of the file. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(InvalidPageException&)
+		{
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 12 passed" << "\n";
+}
+
+void test13()
+{
+	//A file opened for direct I/O works through the buffer pool like any other, and
+	//pages written with it can be read back after reopening it buffered
+	const std::string& filename = "test.6";
+	const PageId bufs = 10, pages = 25;
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename, true /* direct */);
+		BufMgr* mgr = new BufMgr(bufs);
+		for (i = 0; i < pages; i++)
+		{
+			mgr->allocPage(&file6, pageno1, page);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", pageno1, (float)pageno1);
+			page->insertRecord(tmpbuf);
+			mgr->unPinPage(&file6, pageno1, true);
+		}
+		mgr->flushFile(&file6);
+		delete mgr;
+	}
+
+	{
+		File file6 = File::open(filename);
+		if (file6.isDirect())
+		{
+			PRINT_ERROR("ERROR :: FILE WAS REOPENED FOR DIRECT I/O");
+		}
+		PageId used = 0;
+		for (FileIterator iter = file6.begin(); iter != file6.end(); ++iter)
+		{
+			used++;
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", used, (float)used);
+			if ((*iter).page_number() != used ||
+					strncmp((*iter).getRecord({used, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		if (used != pages)
+		{
+			PRINT_ERROR("ERROR :: DIRECT WRITES WERE LOST");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 13 passed" << "\n";
+}
+
+void test14()
+{
+	//Deleting pages anywhere in the file and allocating again reuses the lowest free pages
+	//and keeps the used pages in order
+	const std::string& filename = "test.6";
+	const PageId pages = 200;
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		std::set<PageId> used;
+		for (i = 0; i < pages; i++)
+		{
+			if (file6.allocatePage().page_number() != i + 1)
+			{
+				PRINT_ERROR("ERROR :: PAGES WERE NOT ALLOCATED IN ORDER");
+			}
+			used.insert(i + 1);
+		}
+
+		for (i = 1; i <= pages; i += 7)
+		{
+			file6.deletePage(i);
+			used.erase(i);
+		}
+		file6.deletePage(pages);
+		used.erase(pages);
+		try
+		{
+			file6.deletePage(1);
+			PRINT_ERROR("ERROR :: Page is already deleted. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(InvalidPageException&)
+		{
+		}
+
+		const PageId expected[] = {1, 8, 15};
+		for (i = 0; i < 3; i++)
+		{
+			Page new_page = file6.allocatePage();
+			if (new_page.page_number() != expected[i])
+			{
+				PRINT_ERROR("ERROR :: FREE PAGES WERE NOT REUSED LOWEST FIRST");
+			}
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", new_page.page_number(), (float)new_page.page_number());
+			new_page.insertRecord(tmpbuf);
+			file6.writePage(new_page);
+			used.insert(expected[i]);
+		}
+
+		std::set<PageId>::const_iterator next = used.begin();
+		for (FileIterator iter = file6.begin(); iter != file6.end(); ++iter, ++next)
+		{
+			if (next == used.end() || (*iter).page_number() != *next)
+			{
+				PRINT_ERROR("ERROR :: USED PAGE LIST IS OUT OF ORDER");
+			}
+		}
+		if (next != used.end())
+		{
+			PRINT_ERROR("ERROR :: USED PAGE LIST IS INCOMPLETE");
+		}
+		sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", 8, 8.0);
+		if (file6.readPage(8).getRecord({8, 1}) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+
+	//The allocation bitmap survives reopening the file
+	{
+		File file6 = File::open(filename);
+		if (file6.allocatePage().page_number() != 22)
+		{
+			PRINT_ERROR("ERROR :: FREE PAGES WERE LOST ON REOPEN");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 14 passed" << "\n";
+}
+
+void test15()
+{
+	//All File objects of a file share one cached header, which is written back when the
+	//last of them is closed
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		File other = File::open(filename);
+		BufMgr* bufMgr6 = new BufMgr(num);
+		for (i = 0; i < num; i++)
+		{
+			bufMgr6->allocPage(&file6, pid[i], page);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", pid[i], (float)pid[i]);
+			page->insertRecord(tmpbuf);
+			bufMgr6->unPinPage(&file6, pid[i], true);
+		}
+		if (other.allocatePage().page_number() != (PageId)num + 1)
+		{
+			PRINT_ERROR("ERROR :: HEADER WAS NOT SHARED BETWEEN FILE OBJECTS");
+		}
+		other.deletePage(num + 1);
+		bufMgr6->flushFile(&file6);
+		delete bufMgr6;
+	}
+
+	{
+		File file6 = File::open(filename);
+		i = 0;
+		for (FileIterator iter = file6.begin(); iter != file6.end(); ++iter)
+		{
+			i++;
+			Page page6 = *iter;
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", page6.page_number(), (float)page6.page_number());
+			if (page6.getRecord({page6.page_number(), 1}) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		if (i != num)
+		{
+			PRINT_ERROR("ERROR :: HEADER WAS NOT WRITTEN BACK ON CLOSE");
+		}
+		if (file6.allocatePage().page_number() != (PageId)num + 1)
+		{
+			PRINT_ERROR("ERROR :: FREE PAGE WAS LOST ON REOPEN");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 15 passed" << "\n";
+}
+
+void test16()
+{
+	//A mapped file serves pages in place and through the buffer manager, and cannot be modified
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		for (i = 0; i < num; i++)
+		{
+			Page new_page = file6.allocatePage();
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", new_page.page_number(), (float)new_page.page_number());
+			new_page.insertRecord(tmpbuf);
+			file6.writePage(new_page);
+		}
+		try
+		{
+			File mapped = File::openMapped(filename);
+			PRINT_ERROR("ERROR :: File is open for writing. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(FileOpenException&)
+		{
+		}
+	}
+
+	{
+		File file6 = File::openMapped(filename);
+		if (!file6.isMapped())
+		{
+			PRINT_ERROR("ERROR :: FILE WAS NOT MAPPED");
+		}
+		for (i = 1; i <= num; i++)
+		{
+			const Page* view = file6.mappedPage(i);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", i, (float)i);
+			if (view->page_number() != (PageId)i || view->getRecord({(PageId)i, 1}) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		try
+		{
+			file6.mappedPage(num + 1);
+			PRINT_ERROR("ERROR :: Page does not exist. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(InvalidPageException&)
+		{
+		}
+
+		BufMgr* bufMgr6 = new BufMgr(num / 2);
+		for (i = 1; i <= num; i++)
+		{
+			bufMgr6->readPage(&file6, i, page);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", i, (float)i);
+			if (page->getRecord({(PageId)i, 1}) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			bufMgr6->unPinPage(&file6, i, false);
+		}
+		delete bufMgr6;
+
+		try
+		{
+			file6.allocatePage();
+			PRINT_ERROR("ERROR :: File is read-only. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(FileIOException&)
+		{
+		}
+		try
+		{
+			file6.deletePage(1);
+			PRINT_ERROR("ERROR :: File is read-only. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(FileIOException&)
+		{
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 16 passed" << "\n";
+}
+
+void test17()
+{
+	//readPages pins a batch of pages with their misses read concurrently, through either
+	//I/O engine, and leaves nothing pinned when it fails
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		for (i = 0; i < num; i++)
+		{
+			Page new_page = file6.allocatePage();
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", new_page.page_number(), (float)new_page.page_number());
+			new_page.insertRecord(tmpbuf);
+			file6.writePage(new_page);
+		}
+		file6.deletePage(num / 2);
+
+		const IoEngineType engines[] = {IO_ENGINE_URING, IO_ENGINE_THREADS};
+		for (int e = 0; e < 2; e++)
+		{
+			BufMgrOptions options;
+			options.ioEngine = engines[e];
+			options.ioQueueDepth = 8;
+			BufMgr* bufMgr6 = new BufMgr(num, options);
+
+			//Half the pages are hits, in reverse order
+			std::vector<PageId> pageNos;
+			std::vector<Page*> pages(num);
+			for (i = 1; i < num / 2; i += 2)
+			{
+				bufMgr6->readPage(&file6, i, page);
+				bufMgr6->unPinPage(&file6, i, false);
+			}
+			for (i = num; i >= 1; i--)
+			{
+				if (i != num / 2)
+					pageNos.push_back(i);
+			}
+			bufMgr6->readPages(&file6, &pageNos[0], pageNos.size(), &pages[0]);
+			for (std::size_t j = 0; j < pageNos.size(); j++)
+			{
+				sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", pageNos[j], (float)pageNos[j]);
+				if (pages[j]->getRecord({pageNos[j], 1}) != tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				bufMgr6->unPinPage(&file6, pageNos[j], false);
+			}
+
+			//A deleted page fails the whole batch
+			pageNos.push_back(num / 2);
+			try
+			{
+				bufMgr6->readPages(&file6, &pageNos[0], pageNos.size(), &pages[0]);
+				PRINT_ERROR("ERROR :: Page is deleted. Exception should have been thrown before execution reaches this point.");
+			}
+			catch(InvalidPageException&)
+			{
+			}
+			bufMgr6->flushFile(&file6);
+			delete bufMgr6;
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 17 passed" << "\n";
+}
+
+void test18()
+{
+	//Pages can be unpinned by pointer and read without a pin, as long as writers bracket
+	//their changes
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		BufMgr* bufMgr6 = new BufMgr(8);
+		PageId pageNo6;
+		bufMgr6->allocPage(&file6, pageNo6, page);
+		const std::string record(64, 'a');
+		const RecordId rid6 = page->insertRecord(record);
+		bufMgr6->unPinPage(page, true);
+		try
+		{
+			bufMgr6->unPinPage(page, false);
+			PRINT_ERROR("ERROR :: Page is not pinned. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(PageNotPinnedException&)
+		{
+		}
+
+		OptimisticRead read;
+		if (!bufMgr6->readPageOptimistic(&file6, pageNo6, read))
+		{
+			PRINT_ERROR("ERROR :: CACHED PAGE COULD NOT BE READ OPTIMISTICALLY");
+		}
+		if (read.page->getRecord(rid6) != record || !bufMgr6->validateRead(read))
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+
+		//A write fails reads that overlap it
+		bufMgr6->readPage(&file6, pageNo6, page);
+		bufMgr6->beginPageWrite(page);
+		OptimisticRead during = read;
+		if (bufMgr6->readPageOptimistic(&file6, pageNo6, during))
+		{
+			PRINT_ERROR("ERROR :: READ STARTED DURING A WRITE");
+		}
+		page->updateRecord(rid6, std::string(64, 'b'));
+		bufMgr6->endPageWrite(page);
+		bufMgr6->unPinPage(page, true);
+		if (bufMgr6->validateRead(read))
+		{
+			PRINT_ERROR("ERROR :: READ WAS NOT INVALIDATED BY A WRITE");
+		}
+
+		//Reads that validate never see a half-written record
+		std::atomic<bool> stop(false);
+		std::thread writer([&]() {
+			Page* page6;
+			bufMgr6->readPage(&file6, pageNo6, page6);
+			for (int k = 0; k < 20000; k++)
+			{
+				bufMgr6->beginPageWrite(page6);
+				page6->updateRecord(rid6, std::string(64, 'a' + k % 26));
+				bufMgr6->endPageWrite(page6);
+			}
+			bufMgr6->unPinPage(page6, true);
+			stop = true;
+		});
+		int validated = 0;
+		while (!stop || validated == 0)
+		{
+			if (!bufMgr6->readPageOptimistic(&file6, pageNo6, read))
+				continue;
+			std::string got;
+			try
+			{
+				got = read.page->getRecord(rid6);
+			}
+			catch(InvalidRecordException&)
+			{
+				// the slot was being rewritten; validation fails below.
+			}
+			if (!bufMgr6->validateRead(read))
+				continue;
+			validated++;
+			if (got != std::string(64, got[0]))
+			{
+				PRINT_ERROR("ERROR :: OPTIMISTIC READ SAW A HALF-WRITTEN RECORD");
+			}
+		}
+		writer.join();
+
+		//Evicting the page fails reads of it
+		for (i = 0; i < 8; i++)
+		{
+			PageId other;
+			bufMgr6->allocPage(&file6, other, page);
+			bufMgr6->unPinPage(page, false);
+		}
+		if (bufMgr6->validateRead(read) || bufMgr6->readPageOptimistic(&file6, pageNo6, read))
+		{
+			PRINT_ERROR("ERROR :: READ OF AN EVICTED PAGE WAS NOT FAILED");
+		}
+		bufMgr6->flushFile(&file6);
+		delete bufMgr6;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 18 passed" << "\n";
+}
+
+void test19()
+{
+	//PageGuards unpin their pages when they go out of scope, so more pages than there are
+	//frames can be used one after another
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		BufMgr* bufMgr6 = new BufMgr(num / 10);
+		for (i = 0; i < num; i++)
+		{
+			PageId pageNo6;
+			PageGuard guard = bufMgr6->allocPage(&file6, pageNo6);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", pageNo6, (float)pageNo6);
+			guard->insertRecord(tmpbuf);
+		}
+
+		for (i = 1; i <= num; i++)
+		{
+			PageGuard guard = bufMgr6->readPage(&file6, i);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", i, (float)i);
+			if (guard->getRecord({(PageId)i, 1}) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+
+		//Moving a guard moves the pin; releasing it early unpins once
+		{
+			PageGuard first = bufMgr6->readPage(&file6, 1);
+			PageGuard second(std::move(first));
+			if (first || !second || second->page_number() != 1)
+			{
+				PRINT_ERROR("ERROR :: PIN WAS NOT MOVED");
+			}
+			first = bufMgr6->readPage(&file6, 2);
+			first = std::move(second);
+			first.release();
+			first.release();
+		}
+
+		//Guards unpin when an exception unwinds the stack
+		try
+		{
+			PageGuard guard = bufMgr6->readPage(&file6, 3);
+			guard.markDirty();
+			guard->getRecord({3, 2});
+			PRINT_ERROR("ERROR :: Record does not exist. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(InvalidRecordException&)
+		{
+		}
+		bufMgr6->flushFile(&file6);
+		delete bufMgr6;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 19 passed" << "\n";
+}
+
+void test20()
+{
+	//checkpoint writes dirty pages back without evicting them, and concurrent checkpoints
+	//share rounds
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		BufMgr* bufMgr6 = new BufMgr(num);
+		for (i = 0; i < num; i++)
+		{
+			PageId pageNo6;
+			PageGuard guard = bufMgr6->allocPage(&file6, pageNo6);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", pageNo6, (float)pageNo6);
+			guard->insertRecord(tmpbuf);
+		}
+		bufMgr6->checkpoint();
+		if (bufMgr6->getBufStats().checkpointWrites != (std::uint64_t)num ||
+		    bufMgr6->getBufStats().checkpoints != 1)
+		{
+			PRINT_ERROR("ERROR :: CHECKPOINT DID NOT WRITE EVERY DIRTY PAGE");
+		}
+		for (i = 1; i <= num; i++)
+		{
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", i, (float)i);
+			if (file6.readPage(i).getRecord({(PageId)i, 1}) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		bufMgr6->clearBufStats();
+		for (i = 1; i <= num; i++)
+		{
+			PageGuard guard = bufMgr6->readPage(&file6, i);
+		}
+		if (bufMgr6->getBufStats().hits != (std::uint64_t)num)
+		{
+			PRINT_ERROR("ERROR :: CHECKPOINT EVICTED PAGES");
+		}
+
+		//Every caller's pages are written by a round that started after its call
+		const int threads = 8;
+		std::vector<std::thread> committers;
+		for (int t = 0; t < threads; t++)
+		{
+			committers.push_back(std::thread([&, t]() {
+				for (PageId k = t + 1; k <= num; k += threads)
+				{
+					PageGuard guard = bufMgr6->readPage(&file6, k);
+					guard.markDirty();
+					guard->updateRecord({(PageId)k, 1}, std::string(20, 'a' + t));
+				}
+				bufMgr6->checkpoint();
+			}));
+		}
+		for (int t = 0; t < threads; t++)
+			committers[t].join();
+		if (bufMgr6->getBufStats().checkpoints > (std::uint64_t)threads)
+		{
+			PRINT_ERROR("ERROR :: MORE CHECKPOINT ROUNDS THAN CALLS");
+		}
+		for (i = 1; i <= num; i++)
+		{
+			if (file6.readPage(i).getRecord({(PageId)i, 1}) != std::string(20, 'a' + (i - 1) % threads))
+			{
+				PRINT_ERROR("ERROR :: CHECKPOINT MISSED A PAGE");
+			}
+		}
+		bufMgr6->flushFile(&file6);
+		delete bufMgr6;
+		file6.sync();
+	}
+	File::remove(filename);
+
+	std::cout << "Test 20 passed" << "\n";
+}
+
+void test21()
+{
+	//pages changed under a write-ahead log are only written once their log records are durable
+	const std::string& filename = "test.6";
+	const std::string& logname = "test.6.log";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+	std::remove(logname.c_str());
+
+	Lsn last = 0;
+	{
+		LogManager log(logname);
+		BufMgrOptions options;
+		options.log = &log;
+		File file6 = File::create(filename);
+		BufMgr* bufMgr6 = new BufMgr(num, options);
+		for (i = 0; i < num; i++)
+		{
+			PageId pageNo6;
+			PageGuard guard = bufMgr6->allocPage(&file6, pageNo6);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", pageNo6, (float)pageNo6);
+			guard->insertRecord(tmpbuf);
+			last = log.append(tmpbuf);
+			guard.markDirty(last);
+		}
+		if (log.durableLsn() != 0 || log.endLsn() != last)
+		{
+			PRINT_ERROR("ERROR :: LOG WRITTEN BEFORE ANY PAGE");
+		}
+
+		//evicting a page forces the log up to its LSN, and no further
+		{
+			PageGuard guard = bufMgr6->readPage(&file6, 1);
+			Lsn lsn = log.append(std::string("update"));
+			guard->updateRecord({1, 1}, "updated");
+			guard.markDirty(lsn);
+		}
+		bufMgr6->checkpoint();
+		if (log.durableLsn() != log.endLsn())
+		{
+			PRINT_ERROR("ERROR :: PAGES WRITTEN AHEAD OF THE LOG");
+		}
+		if (file6.readPage(1).lsn() != log.endLsn() || file6.readPage(2).lsn() == 0)
+		{
+			PRINT_ERROR("ERROR :: PAGE LSN NOT WRITTEN");
+		}
+
+		const std::uint64_t syncs = log.syncs();
+		log.flush(last);
+		if (log.syncs() != syncs)
+		{
+			PRINT_ERROR("ERROR :: DURABLE LOG SYNCED AGAIN");
+		}
+
+		//concurrent commits share syncs
+		const int threads = 8;
+		std::vector<std::thread> committers;
+		for (int t = 0; t < threads; t++)
+		{
+			committers.push_back(std::thread([&log]() {
+				for (int k = 0; k < 50; k++)
+					log.flush(log.append(std::string(100, 'c')));
+			}));
+		}
+		for (int t = 0; t < threads; t++)
+			committers[t].join();
+		if (log.syncs() - syncs > (std::uint64_t)threads * 50)
+		{
+			PRINT_ERROR("ERROR :: MORE LOG SYNCS THAN COMMITS");
+		}
+		last = log.endLsn();
+		bufMgr6->flushFile(&file6);
+		delete bufMgr6;
+	}
+	File::remove(filename);
+
+	//records survive reopening, and a torn record at the end is dropped
+	{
+		std::ofstream torn(logname.c_str(), std::ios::binary | std::ios::app);
+		torn.write("\x40\0\0\0garbage", 11);
+	}
+	{
+		LogManager log(logname);
+		if (log.endLsn() != last)
+		{
+			PRINT_ERROR("ERROR :: TORN LOG RECORD KEPT");
+		}
+		int records = 0;
+		log.scan([&](Lsn lsn, const std::string& record) {
+			if (records < (int)num)
+			{
+				sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", records + 1, (float)(records + 1));
+				if (record != tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: LOG RECORD DID NOT MATCH");
+				}
+			}
+			records++;
+		});
+		if (records != (int)num + 1 + 8 * 50)
+		{
+			PRINT_ERROR("ERROR :: LOG RECORDS LOST");
+		}
+	}
+	std::remove(logname.c_str());
+
+	std::cout << "Test 21 passed" << "\n";
+}
+
+void test22()
+{
+	//a heap file fills pages before allocating new ones and reuses freed space
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		BufMgr* bufMgr6 = new BufMgr(num);
+		const std::string record(100, 'h');
+		const std::size_t perPage = Page::DATA_SIZE / (record.size() + sizeof(PageSlot));
+		const int records = perPage * 13;  //every page full
+		std::vector<RecordId> rids;
+		{
+			HeapFile heap(bufMgr6, &file6);
+			for (int k = 0; k < records; k++)
+			{
+				sprintf((char*)tmpbuf, "%05d", k);
+				rids.push_back(heap.insertRecord(std::string(tmpbuf) + record.substr(5)));
+			}
+			if (heap.numPages() != (records + perPage - 1) / perPage)
+			{
+				PRINT_ERROR("ERROR :: HEAP FILE DID NOT FILL ITS PAGES");
+			}
+			for (int k = 0; k < records; k++)
+			{
+				sprintf((char*)tmpbuf, "%05d", k);
+				if (heap.getRecord(rids[k]) != std::string(tmpbuf) + record.substr(5))
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+
+			//space freed on a full page is found again
+			for (int k = 0; k < 10; k++)
+				heap.deleteRecord(rids[k]);
+			for (int k = 0; k < 10; k++)
+			{
+				if (heap.insertRecord(record).page_number != rids[0].page_number)
+				{
+					PRINT_ERROR("ERROR :: FREED SPACE NOT REUSED");
+				}
+			}
+
+			//a record that fits no page leaves the new page for later inserts
+			const std::size_t pages = heap.numPages();
+			try
+			{
+				heap.insertRecord(std::string(Page::DATA_SIZE, 'x'));
+				PRINT_ERROR("ERROR :: Oversized record should have thrown InsufficientSpaceException.");
+			}
+			catch(const InsufficientSpaceException& e)
+			{
+			}
+			heap.insertRecord(std::string(Page::DATA_SIZE / 2, 'x'));
+			if (heap.numPages() != pages + 1)
+			{
+				PRINT_ERROR("ERROR :: EMPTY PAGE NOT REUSED");
+			}
+		}
+		bufMgr6->flushFile(&file6);
+
+		//the directory is rebuilt from the file
+		{
+			HeapFile heap(bufMgr6, &file6);
+			if (heap.numPages() != (records + perPage - 1) / perPage + 1 ||
+			    heap.freeSpace(rids[0].page_number) != Page::DATA_SIZE - perPage * (record.size() + sizeof(PageSlot)))
+			{
+				PRINT_ERROR("ERROR :: FREE SPACE DIRECTORY NOT REBUILT");
+			}
+		}
+		bufMgr6->flushFile(&file6);
+		delete bufMgr6;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 22 passed" << "\n";
+}
+
+void test23()
+{
+	//a B+-tree index finds entries by key and in key order after splits at every level
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		BufMgr* bufMgr6 = new BufMgr(num);
+		//more entries than two full levels hold, whatever the page size
+		const int entries = BTreeIndex::LEAF_CAPACITY * (BTreeIndex::INNER_CAPACITY + 1) + 1;
+		std::vector<int> order(entries);
+		for (int k = 0; k < entries; k++)
+			order[k] = k;
+		std::shuffle(order.begin(), order.end(), std::mt19937(23));
+		{
+			BTreeIndex index(bufMgr6, &file6);
+			for (int k = 0; k < entries; k++)
+			{
+				const RecordId rid6 = {(PageId)(order[k] / 1000 + 1), (SlotId)(order[k] % 1000 + 1)};
+				if (!index.insert(order[k] * 2, rid6))
+				{
+					PRINT_ERROR("ERROR :: ENTRY NOT INSERTED");
+				}
+			}
+			if (index.height() < 3)
+			{
+				PRINT_ERROR("ERROR :: INNER NODES DID NOT SPLIT");
+			}
+			const RecordId rid0 = {1, 1};
+			const RecordId rid1 = {1, 2};
+			if (index.insert(0, rid0) || !index.insert(0, rid1))
+			{
+				PRINT_ERROR("ERROR :: DUPLICATE ENTRY HANDLING WRONG");
+			}
+			std::vector<RecordId> found = index.lookup(0);
+			if (found.size() != 2 || found[0] != rid0 || found[1] != rid1 || !index.lookup(1).empty())
+			{
+				PRINT_ERROR("ERROR :: LOOKUP RETURNED WRONG ENTRIES");
+			}
+
+			//remove every other entry
+			for (int k = 0; k < entries; k += 2)
+			{
+				const RecordId rid6 = {(PageId)(k / 1000 + 1), (SlotId)(k % 1000 + 1)};
+				if (!index.remove(k * 2, rid6))
+				{
+					PRINT_ERROR("ERROR :: ENTRY NOT REMOVED");
+				}
+			}
+			if (index.remove(0, rid0) || !index.remove(0, rid1))
+			{
+				PRINT_ERROR("ERROR :: REMOVE OF MISSING ENTRY SUCCEEDED");
+			}
+		}
+		bufMgr6->flushFile(&file6);
+
+		{
+			BTreeIndex index(bufMgr6, &file6);
+			std::int64_t expected = 2;
+			int visited = 0;
+			index.scan(2, 4 * entries, [&](std::int64_t key, const RecordId& rid6) {
+				const int k = key / 2;
+				const RecordId rid = {(PageId)(k / 1000 + 1), (SlotId)(k % 1000 + 1)};
+				if (key != expected || rid6 != rid)
+				{
+					PRINT_ERROR("ERROR :: SCAN OUT OF ORDER");
+				}
+				expected += 4;
+				visited++;
+				return true;
+			});
+			if (visited != entries / 2)
+			{
+				PRINT_ERROR("ERROR :: SCAN MISSED ENTRIES");
+			}
+			visited = 0;
+			index.scan(1000, 2000, [&](std::int64_t, const RecordId&) { return ++visited < 10; });
+			if (visited != 10 || index.lookup(6).size() != 1 || !index.lookup(4).empty())
+			{
+				PRINT_ERROR("ERROR :: REOPENED INDEX DID NOT MATCH");
+			}
+		}
+		bufMgr6->flushFile(&file6);
+		delete bufMgr6;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 23 passed" << "\n";
+}
+
+void test24()
+{
+	//bulk loading fills pages to the fill factor and builds an index bottom-up
+	const std::string& filename = "test.6";
+	const std::string& indexname = "test.6.idx";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+	try
+	{
+		File::remove(indexname);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		File index6 = File::create(indexname);
+		BufMgr* bufMgr6 = new BufMgr(num);
+		const int records = 20000;
+		const std::string record(100, 'b');
+		const std::size_t perPage = Page::DATA_SIZE / 2 / (record.size() + sizeof(PageSlot));
+		std::vector<RecordId> rids;
+		{
+			HeapLoader loader(&file6, 0.5);
+			for (int k = 0; k < records; k++)
+			{
+				sprintf((char*)tmpbuf, "%05d", k);
+				rids.push_back(loader.insertRecord(std::string(tmpbuf) + record.substr(5)));
+			}
+			loader.finish();
+			if (loader.numPages() != (records + perPage - 1) / perPage)
+			{
+				PRINT_ERROR("ERROR :: LOADER DID NOT KEEP TO THE FILL FACTOR");
+			}
+		}
+		std::size_t pages = 0;
+		for (FileIterator iter = file6.begin(); iter != file6.end(); iter++)
+			pages++;
+		{
+			HeapFile heap(bufMgr6, &file6);
+			if (heap.numPages() != pages || pages != (records + perPage - 1) / perPage)
+			{
+				PRINT_ERROR("ERROR :: LOADED PAGES NOT LINKED INTO THE FILE");
+			}
+			for (int k = 0; k < records; k += 7)
+			{
+				sprintf((char*)tmpbuf, "%05d", k);
+				if (heap.getRecord(rids[k]) != std::string(tmpbuf) + record.substr(5))
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+		}
+
+		//unsorted input is refused
+		{
+			File bad6 = File::create(indexname + ".bad");
+			try
+			{
+				int calls = 0;
+				BTreeIndex::build(&bad6, [&](std::int64_t& key, RecordId& rid6) {
+					key = 10 - calls;
+					rid6 = rids[0];
+					return ++calls < 5;
+				});
+				PRINT_ERROR("ERROR :: Unsorted bulk load should have thrown BadgerDbException.");
+			}
+			catch(const BadgerDbException& e)
+			{
+			}
+		}
+		File::remove(indexname + ".bad");
+
+		int k = 0;
+		BTreeIndex::build(&index6, [&](std::int64_t& key, RecordId& rid6) {
+			if (k == records)
+				return false;
+			key = k * 2;
+			rid6 = rids[k++];
+			return true;
+		});
+		{
+			BTreeIndex index(bufMgr6, &index6);
+			if (index.height() != 2)
+			{
+				PRINT_ERROR("ERROR :: INDEX LEVELS NOT BUILT");
+			}
+			for (k = 0; k < records; k += 13)
+			{
+				std::vector<RecordId> found = index.lookup(k * 2);
+				if (found.size() != 1 || found[0] != rids[k])
+				{
+					PRINT_ERROR("ERROR :: LOADED INDEX LOOKUP FAILED");
+				}
+			}
+			//full leaves split as entries go in between
+			for (k = 0; k < records; k += 3)
+				index.insert(k * 2 + 1, rids[k]);
+			std::int64_t last = -1;
+			int visited = 0;
+			index.scan(0, 2 * records, [&](std::int64_t key, const RecordId&) {
+				if (key <= last)
+				{
+					PRINT_ERROR("ERROR :: SCAN OUT OF ORDER");
+				}
+				last = key;
+				visited++;
+				return true;
+			});
+			if (visited != records + (records + 2) / 3)
+			{
+				PRINT_ERROR("ERROR :: SCAN MISSED ENTRIES");
+			}
+		}
+		bufMgr6->flushFile(&file6);
+		bufMgr6->flushFile(&index6);
+		delete bufMgr6;
+	}
+	File::remove(filename);
+	File::remove(indexname);
+
+	std::cout << "Test 24 passed" << "\n";
+}
+
+void test25()
+{
+	//freed slots are reused and trailing unused slots are given back
+	Page page6;
+	std::vector<RecordId> rids;
+	//as many as fit with room to insert half of them again, up to 500
+	const int n = std::min<int>(500, Page::DATA_SIZE * 2 / 21 / 100 * 100);
+	for (int k = 0; k < n; k++)
+	{
+		sprintf((char*)tmpbuf, "r%03d", k);
+		rids.push_back(page6.insertRecord(tmpbuf));
+	}
+	for (int k = 0; k < n; k += 2)
+		page6.deleteRecord(rids[k]);
+	std::set<SlotId> reused;
+	for (int k = 0; k < n / 2; k++)
+	{
+		const RecordId rid6 = page6.insertRecord("again");
+		if (rid6.slot_number > n || rid6.slot_number % 2 != 1 || !reused.insert(rid6.slot_number).second)
+		{
+			PRINT_ERROR("ERROR :: FREED SLOT NOT REUSED");
+		}
+	}
+
+	//deleting the last records gives their slots back, and the slots freed
+	//before them stay reusable
+	const std::uint16_t freeSpace = page6.getFreeSpace();
+	for (int k = n - 99; k < n; k += 2)
+		page6.deleteRecord(rids[k]);
+	for (SlotId slot = n - 99; slot <= n; slot += 2)
+		page6.deleteRecord({Page::INVALID_NUMBER, slot});
+	if (page6.getFreeSpace() != freeSpace + 100 * sizeof(PageSlot) + 50 * 4 + 50 * 5)
+	{
+		PRINT_ERROR("ERROR :: TRAILING SLOTS NOT GIVEN BACK");
+	}
+	int records = 0;
+	for (PageIterator iter = page6.begin(); iter != page6.end(); iter++)
+		records++;
+	if (records != n - 100 || page6.insertRecord("last").slot_number != n - 99)
+	{
+		PRINT_ERROR("ERROR :: SLOT CHAIN BROKEN");
+	}
+
+	std::cout << "Test 25 passed" << "\n";
+}
+
+void test26()
+{
+	//deletes leave holes that inserts reclaim by compacting the page once
+	Page page6;
+	std::vector<RecordId> rids;
+	while (page6.hasSpaceForRecord(std::string(100, ' ')))
+	{
+		sprintf((char*)tmpbuf, "%03d", (int)rids.size());
+		rids.push_back(page6.insertRecord(std::string(tmpbuf) + std::string(97, 'q')));
+	}
+	//consume the queue from the head, as a queue table would
+	std::uint16_t freeSpace = page6.getFreeSpace();
+	for (int k = 0; k < 10; k++)
+		page6.deleteRecord(rids[k]);
+	if (page6.getFreeSpace() != freeSpace + 10 * 100)
+	{
+		PRINT_ERROR("ERROR :: HOLES NOT COUNTED AS FREE SPACE");
+	}
+	//only compaction makes room for a record this long
+	const RecordId big = page6.insertRecord(std::string(900, 'B'));
+	if (page6.getRecord(big) != std::string(900, 'B'))
+	{
+		PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+	}
+	for (std::size_t k = 10; k < rids.size(); k++)
+	{
+		sprintf((char*)tmpbuf, "%03d", (int)k);
+		if (page6.getRecord(rids[k]) != std::string(tmpbuf) + std::string(97, 'q'))
+		{
+			PRINT_ERROR("ERROR :: RECORD DAMAGED BY COMPACTION");
+		}
+	}
+
+	//shorter versions are written in place, longer ones move
+	freeSpace = page6.getFreeSpace();
+	page6.updateRecord(rids[20], "short");
+	page6.updateRecord(rids[21], std::string(150, 'L'));
+	if (page6.getFreeSpace() != freeSpace + 95 - 50 ||
+	    page6.getRecord(rids[20]) != "short" || page6.getRecord(rids[21]) != std::string(150, 'L'))
+	{
+		PRINT_ERROR("ERROR :: UPDATE DID NOT MATCH");
+	}
+	int records = 0;
+	for (PageIterator iter = page6.begin(); iter != page6.end(); iter++)
+		records++;
+	if (records != (int)rids.size() - 10 + 1)
+	{
+		PRINT_ERROR("ERROR :: RECORDS LOST");
+	}
+
+	std::cout << "Test 26 passed" << "\n";
+}
+
+void test27()
+{
+	//records can be read through views into the pinned frame, without copies
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		BufMgr* bufMgr6 = new BufMgr(num);
+		PageId pageNo6;
+		std::vector<RecordId> rids;
+		{
+			PageGuard guard = bufMgr6->allocPage(&file6, pageNo6);
+			for (int k = 0; k < 50; k++)
+			{
+				sprintf((char*)tmpbuf, "view %02d", k);
+				rids.push_back(guard->insertRecord(RecordView(tmpbuf, strlen(tmpbuf))));
+			}
+			guard->updateRecord(rids[3], std::string("view 3 updated"));
+		}
+
+		PageGuard guard = bufMgr6->readPage(&file6, pageNo6);
+		const RecordView view = guard->getRecordView(rids[3]);
+		if (view != "view 3 updated" || view.data() < (const char*)guard.get() ||
+		    view.data() >= (const char*)guard.get() + Page::SIZE)
+		{
+			PRINT_ERROR("ERROR :: VIEW DOES NOT POINT INTO THE FRAME");
+		}
+		int k = 0;
+		for (PageIterator iter = guard->begin(); iter != guard->end(); iter++, k++)
+		{
+			sprintf((char*)tmpbuf, "view %02d", k);
+			if (k != 3 && (iter.view() != tmpbuf || iter.view().str() != *iter || iter.record_id() != rids[k]))
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		if (k != 50 || !(RecordView("abc") < RecordView("abd")) || !(RecordView("ab") < RecordView("abc")))
+		{
+			PRINT_ERROR("ERROR :: VIEW ORDERING WRONG");
+		}
+		guard.release();
+		bufMgr6->flushFile(&file6);
+		delete bufMgr6;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 27 passed" << "\n";
+}
+
+void test28()
+{
+	//a page's records come out as one batch and filter by prefix without a per-record call
+	Page page6;
+	std::vector<RecordId> rids;
+	rids.push_back(page6.insertRecord("a"));  //at the very end of the page
+	const int n = std::min<int>(200, (Page::DATA_SIZE - 64) / 32 / 10 * 10);
+	for (int k = 0; k < n; k++)
+	{
+		sprintf((char*)tmpbuf, "%s-%03d-long-record-tail", k % 3 == 0 ? "alpha" : (k % 3 == 1 ? "alps" : "beta"), k);
+		rids.push_back(page6.insertRecord(tmpbuf));
+	}
+	rids.push_back(page6.insertRecord("al"));
+	for (int k = 1; k < n; k += 10)
+		page6.deleteRecord(rids[k]);
+
+	RecordBatch* batch = new RecordBatch;
+	page6.scanRecords(*batch);
+	if (batch->count != rids.size() - n / 10)
+	{
+		PRINT_ERROR("ERROR :: BATCH MISSED RECORDS");
+	}
+	std::size_t k = 0;
+	for (PageIterator iter = page6.begin(); iter != page6.end(); iter++, k++)
+	{
+		if (batch->record_id(k) != iter.record_id() || batch->view(k) != iter.view())
+		{
+			PRINT_ERROR("ERROR :: BATCH DID NOT MATCH THE RECORDS");
+		}
+	}
+
+	std::uint16_t selected[RecordBatch::CAPACITY];
+	std::size_t expected[3] = {0, 0, 0};
+	for (k = 0; k < batch->count; k++)
+	{
+		const std::string record = batch->view(k).str();
+		expected[0] += record.compare(0, 2, "al") == 0;
+		expected[1] += record.compare(0, 3, "alp") == 0;
+		expected[2] += record.compare(0, 10, "alpha-003-") == 0;
+	}
+	const char* prefixes[3] = {"al", "alp", "alpha-003-"};
+	for (int p = 0; p < 3; p++)
+	{
+		const std::size_t n = filterByPrefix(*batch, prefixes[p], selected);
+		if (n != expected[p])
+		{
+			PRINT_ERROR("ERROR :: FILTER SELECTED WRONG RECORDS");
+		}
+		for (k = 0; k < n; k++)
+		{
+			if (batch->view(selected[k]).str().compare(0, strlen(prefixes[p]), prefixes[p]) != 0)
+			{
+				PRINT_ERROR("ERROR :: FILTER SELECTED WRONG RECORDS");
+			}
+		}
+	}
+	if (filterByPrefix(*batch, "", selected) != batch->count || expected[2] != 1)
+	{
+		PRINT_ERROR("ERROR :: FILTER SELECTED WRONG RECORDS");
+	}
+	delete batch;
+
+	std::cout << "Test 28 passed" << "\n";
+}
+
+void test29()
+{
+	//a parallel scan visits every used page of a file exactly once
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		BufMgr* bufMgr6 = new BufMgr(num);
+		const int pages = 300;
+		std::vector<PageId> pids;
+		for (int k = 0; k < pages; k++)
+		{
+			PageId pageNo;
+			PageGuard page = bufMgr6->allocPage(&file6, pageNo);
+			sprintf((char*)tmpbuf, "page %d", pageNo);
+			page->insertRecord(tmpbuf);
+			page.markDirty();
+			pids.push_back(pageNo);
+		}
+		for (int k = 0; k < pages; k += 7)
+			bufMgr6->disposePage(&file6, pids[k]);
+
+		std::vector<std::atomic<int> > visits(pids.back() + 1);
+		std::atomic<int> mismatches(0);
+		std::vector<std::atomic<int> > perWorker(4);
+		ParallelScan scan(bufMgr6, &file6, 4, 8);
+		scan.run([&](std::uint32_t worker, const Page& page)
+		{
+			visits[page.page_number()]++;
+			perWorker[worker]++;
+			char expected[32];
+			sprintf(expected, "page %d", page.page_number());
+			if (page.getRecordView({page.page_number(), 1}) != expected)
+				mismatches++;
+		});
+		int visited = 0;
+		for (int k = 0; k < pages; k++)
+		{
+			if (visits[pids[k]] != (k % 7 == 0 ? 0 : 1))
+			{
+				PRINT_ERROR("ERROR :: PAGE NOT VISITED EXACTLY ONCE");
+			}
+			visited += visits[pids[k]];
+		}
+		int byWorkers = 0;
+		for (int w = 0; w < 4; w++)
+			byWorkers += perWorker[w];
+		if (mismatches != 0 || byWorkers != visited || visited != pages - (pages + 6) / 7)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+
+		//an error in one worker stops the scan and reaches the caller
+		try
+		{
+			scan.run([&](std::uint32_t, const Page& page)
+			{
+				if (page.page_number() == pids[pages / 2])
+					throw InvalidPageException(page.page_number(), filename);
+			});
+			PRINT_ERROR("ERROR :: Scan should have thrown InvalidPageException.");
+		}
+		catch(const InvalidPageException& e)
+		{
+		}
+
+		bufMgr6->flushFile(&file6);
+		delete bufMgr6;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 29 passed" << "\n";
+}
+
+void test30()
+{
+	//pages carry a CRC-32C that catches bytes changed on disk
+	if (crc32c(0, "123456789", 9) != 0xe3069283)
+	{
+		PRINT_ERROR("ERROR :: CRC32C OF THE CHECK STRING IS WRONG");
+	}
+	std::vector<char> bytes(3 * Page::SIZE + 5);
+	for (std::size_t k = 0; k < bytes.size(); k++)
+		bytes[k] = static_cast<char>(k * 131 + k / 7);
+	const std::uint32_t whole = crc32c(0, &bytes[0], bytes.size());
+	for (std::size_t split = 0; split < bytes.size(); split += 997)
+	{
+		if (crc32c(crc32c(0, &bytes[0], split), &bytes[split], bytes.size() - split) != whole)
+		{
+			PRINT_ERROR("ERROR :: CRC32C IN PIECES DID NOT MATCH");
+		}
+	}
+
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	PageId pids[3];
+	{
+		File file6 = File::create(filename);
+		for (int k = 0; k < 3; k++)
+		{
+			Page page = file6.allocatePage();
+			page.insertRecord("checked record");
+			file6.writePage(page);
+			pids[k] = page.page_number();
+		}
+		//unlinking a page rewrites its neighbour's next pointer but not its checksum
+		file6.deletePage(pids[1]);
+		if (file6.readPage(pids[0]).next_page_number() != pids[2])
+		{
+			PRINT_ERROR("ERROR :: NEXT POINTER NOT UPDATED");
+		}
+	}
+
+	//flip one byte in the data of the first page
+	{
+		std::fstream raw(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		const std::streamoff offset = 2 * Page::SIZE + Page::SIZE - 10;
+		raw.seekg(offset);
+		const char byte = static_cast<char>(raw.get() ^ 0x20);
+		raw.seekp(offset);
+		raw.put(byte);
+	}
+
+	{
+		File file6 = File::open(filename);
+		try
+		{
+			file6.readPage(pids[0]);
+			PRINT_ERROR("ERROR :: Corrupt page should have thrown CorruptPageException.");
+		}
+		catch(const CorruptPageException& e)
+		{
+		}
+		file6.readPage(pids[2]);
+
+		BufMgr* bufMgr6 = new BufMgr(num);
+		for (int k = 0; k < 2; k++)
+		{
+			try
+			{
+				bufMgr6->readPage(&file6, pids[0]);
+				PRINT_ERROR("ERROR :: Corrupt page should have thrown CorruptPageException.");
+			}
+			catch(const CorruptPageException& e)
+			{
+			}
+		}
+		if (bufMgr6->getBufStats().checksumFailures != 2)
+		{
+			PRINT_ERROR("ERROR :: CHECKSUM FAILURES NOT COUNTED");
+		}
+
+		//with verification off the page reads as it is on disk
+		file6.setVerifyChecksums(false);
+		{
+			PageGuard page = bufMgr6->readPage(&file6, pids[0]);
+			if (page->getRecord({pids[0], 1}) != "checKed record")
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		file6.setVerifyChecksums(true);
+		delete bufMgr6;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 30 passed" << "\n";
+}
+
+void test31()
+{
+	//a compressed file stores text pages in fewer blocks and reads them back unchanged
+	const std::string& plain = "test.6";
+	const std::string& packed = "test.7";
+	for (int f = 0; f < 2; f++)
+	{
+		try
+		{
+			File::remove(f == 0 ? plain : packed);
+		}
+		catch(const FileNotFoundException&)
+		{
+		}
+	}
+
+	const int pages = 40;
+	std::vector<PageId> pids;
+	std::mt19937 random(6);
+	{
+		File file6 = File::create(plain);
+		File file7 = File::create(packed, false, true);
+		if (file6.isCompressed() || !file7.isCompressed())
+		{
+			PRINT_ERROR("ERROR :: COMPRESSION SETTING NOT KEPT");
+		}
+		BufMgr* bufMgr6 = new BufMgr(num);
+		for (int k = 0; k < pages; k++)
+		{
+			PageId pageNo;
+			PageGuard page6 = bufMgr6->allocPage(&file6, pageNo);
+			PageGuard page7 = bufMgr6->allocPage(&file7, pageNo);
+			pids.push_back(pageNo);
+			for (int r = 0; r < 20; r++)
+			{
+				sprintf((char*)tmpbuf, "customer %d ordered item %d of the catalogue", k, r);
+				page6->insertRecord(tmpbuf);
+				page7->insertRecord(tmpbuf);
+			}
+			if (k == pages - 1)
+			{
+				//random bytes do not compress and are stored as they are
+				std::string noise(Page::DATA_SIZE - 2000, ' ');
+				for (std::size_t i = 0; i < noise.size(); i++)
+					noise[i] = static_cast<char>(random());
+				page6->insertRecord(noise);
+				page7->insertRecord(noise);
+			}
+			page6.markDirty();
+			page7.markDirty();
+		}
+		bufMgr6->flushFile(&file6);
+		bufMgr6->flushFile(&file7);
+		//unlinking a page updates its neighbour's stored header in place
+		file7.deletePage(pids[1]);
+		file6.deletePage(pids[1]);
+		delete bufMgr6;
+	}
+
+	struct stat st6;
+	struct stat st7;
+	stat(plain.c_str(), &st6);
+	stat(packed.c_str(), &st7);
+	//a page of one block has no block to save
+	if (Page::SIZE > File::DIRECT_ALIGNMENT && st7.st_blocks * 4 > st6.st_blocks * 3)
+	{
+		PRINT_ERROR("ERROR :: COMPRESSED FILE DID NOT SAVE SPACE");
+	}
+
+	{
+		File file6 = File::open(plain);
+		File file7 = File::open(packed);
+		if (!file7.isCompressed())
+		{
+			PRINT_ERROR("ERROR :: COMPRESSION SETTING NOT KEPT");
+		}
+		if (file7.readPage(pids[0]).next_page_number() != pids[2])
+		{
+			PRINT_ERROR("ERROR :: NEXT POINTER NOT UPDATED");
+		}
+		int seen = 0;
+		for (FileIterator iter = file7.begin(); iter != file7.end(); ++iter, ++seen)
+		{
+			Page page7 = *iter;
+			Page page6 = file6.readPage(page7.page_number());
+			PageIterator it6 = page6.begin();
+			for (PageIterator it7 = page7.begin(); it7 != page7.end(); ++it7, ++it6)
+			{
+				if (it6 == page6.end() || *it6 != *it7)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+			if (page7.getFreeSpace() != page6.getFreeSpace())
+			{
+				PRINT_ERROR("ERROR :: HEADER DID NOT MATCH");
+			}
+		}
+		if (seen != pages - 1)
+		{
+			PRINT_ERROR("ERROR :: FILE ITERATOR MISSED PAGES");
+		}
+
+		//a page rewritten through the buffer manager stays readable
+		BufMgr* bufMgr6 = new BufMgr(num);
+		{
+			PageGuard page = bufMgr6->readPage(&file7, pids[2]);
+			page->insertRecord("late record");
+			page.markDirty();
+		}
+		bufMgr6->flushFile(&file7);
+		delete bufMgr6;
+		Page page = file7.readPage(pids[2]);
+		if (page.getRecord({pids[2], 21}) != "late record")
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+	File::remove(plain);
+	File::remove(packed);
+
+	std::cout << "Test 31 passed" << "\n";
+}
+
+void test32()
+{
+	//a file made with another page size is refused, not misread
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		file6.allocatePage();
+	}
+	//so is one made with another page format
+	const std::size_t fields[2] = {offsetof(FileHeader, page_size), offsetof(FileHeader, format_version)};
+	const std::uint32_t values[2] = {Page::SIZE, File::FORMAT_VERSION};
+	for (int f = 0; f < 2; f++)
+	{
+		std::fstream raw(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		const std::uint32_t other = values[f] * 2;
+		raw.seekp(fields[f]);
+		raw.write(reinterpret_cast<const char*>(&other), sizeof(other));
+		raw.close();
+		try
+		{
+			File file6 = File::open(filename);
+			PRINT_ERROR("ERROR :: File with another page layout should have thrown BadgerDbException.");
+		}
+		catch(const BadgerDbException& e)
+		{
+		}
+		if (File::isOpen(filename))
+		{
+			PRINT_ERROR("ERROR :: REFUSED FILE LEFT OPEN");
+		}
+		raw.open(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		raw.seekp(fields[f]);
+		raw.write(reinterpret_cast<const char*>(&values[f]), sizeof(values[f]));
+	}
+	{
+		File file6 = File::open(filename);
+	}
+	File::remove(filename);
+
+	std::cout << "Test 32 passed" << "\n";
+}
+
+void test33()
+{
+	//slots take four bytes, with the used flag beside offsets at the top of the page
+	Page page6;
+	std::vector<RecordId> rids;
+	while (page6.hasSpaceForRecord("abcd"))
+		rids.push_back(page6.insertRecord("abcd"));
+	if (rids.size() != Page::DATA_SIZE / (4 + sizeof(PageSlot)) || sizeof(PageSlot) != 4)
+	{
+		PRINT_ERROR("ERROR :: PAGE DID NOT HOLD THE RECORDS IT HAS ROOM FOR");
+	}
+	for (std::size_t k = 0; k < rids.size(); k += 2)
+		page6.deleteRecord(rids[k]);
+	std::size_t k = 1;
+	for (PageIterator iter = page6.begin(); iter != page6.end(); iter++, k += 2)
+	{
+		if (k >= rids.size() || iter.record_id() != rids[k] || *iter != "abcd")
+		{
+			PRINT_ERROR("ERROR :: USED FLAGS DID NOT MATCH THE RECORDS");
+		}
+	}
+	//a record at the highest offset keeps its flag through an in-place update
+	page6.updateRecord(rids[1], "xy");
+	if (page6.getRecord(rids[1]) != "xy")
+	{
+		PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+	}
+
+	std::cout << "Test 33 passed" << "\n";
+}
+
+void test34()
+{
+	//every kind of pool memory works, falling back where the machine lacks it
+	const HugePageMode modes[4] = {HUGE_PAGES_NONE, HUGE_PAGES_TRANSPARENT, HUGE_PAGES_2MB, HUGE_PAGES_1GB};
+	const NumaPlacement placements[3] = {NUMA_DEFAULT, NUMA_INTERLEAVE, NUMA_PARTITION};
+	for (int m = 0; m < 4; m++)
+	{
+		for (int n = 0; n < 3; n++)
+		{
+			BufMgrOptions options;
+			options.hugePages = modes[m];
+			options.numaPlacement = placements[n];
+			BufMgr* pool = new BufMgr(50, options);
+			const BufferArena& arena = pool->getArena();
+			if (reinterpret_cast<std::uintptr_t>(pool->bufPool) % Page::SIZE != 0 ||
+					arena.pageSize() < static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) ||
+					arena.numNodes() > BufferArena::systemNodes() ||
+					arena.frameBegin(arena.numNodes()) != 50)
+			{
+				PRINT_ERROR("ERROR :: ARENA LAYOUT DID NOT MATCH");
+			}
+
+			const std::string filename = "test.6";
+			try
+			{
+				File::remove(filename);
+			}
+			catch(const FileNotFoundException& e)
+			{
+			}
+			{
+				File file6 = File::create(filename);
+				for (i = 0; i < 60; i++)
+				{
+					pool->allocPage(&file6, pid[0], page);
+					sprintf((char*)tmpbuf, "test.6 Page %d", pid[0]);
+					page->insertRecord(tmpbuf);
+					pool->unPinPage(&file6, pid[0], true);
+				}
+				for (i = 0; i < 60; i++)
+				{
+					pool->readPage(&file6, i + 1, page);
+					sprintf((char*)tmpbuf, "test.6 Page %d", i + 1);
+					if (page->getRecord(RecordId{PageId(i + 1), 1}) != tmpbuf)
+					{
+						PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+					}
+					pool->unPinPage(&file6, i + 1, false);
+				}
+				delete pool;
+			}
+			File::remove(filename);
+		}
+	}
+
+	std::cout << "Test 34 passed" << "\n";
+}
+
+void test35()
+{
+	//the clock finds the one unpinned frame wherever it is among runs of pinned ones
+	const FrameId holes[5] = {0, 63, 64, 65, 129};
+	for (int h = 0; h < 5; h++)
+	{
+		const std::string filename = "test.6";
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException& e)
+		{
+		}
+		{
+			File file6 = File::create(filename);
+			BufMgr* pool = new BufMgr(130);
+			std::vector<Page*> pinned;
+			for (i = 0; i < 130; i++)
+			{
+				pool->allocPage(&file6, pid[0], page);
+				pinned.push_back(page);
+			}
+			Page* hole = pinned[holes[h]];
+			pool->unPinPage(hole, true);
+			pool->allocPage(&file6, pid[0], page);
+			if (page != hole)
+			{
+				PRINT_ERROR("ERROR :: CLOCK DID NOT REUSE THE UNPINNED FRAME");
+			}
+			try
+			{
+				pool->allocPage(&file6, pid[1], page);
+				PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown.");
+			}
+			catch(const BufferExceededException& e)
+			{
+			}
+			for (i = 0; i < 130; i++)
+				pool->unPinPage(pinned[i], false);
+			delete pool;
+		}
+		File::remove(filename);
+	}
+
+	std::cout << "Test 35 passed" << "\n";
+}
+
+void test36()
+{
+	//the pool grows and shrinks online under every policy, keeping pinned pages in place
+	const ReplacementPolicyType policies[4] = {POLICY_CLOCK, POLICY_LRU_K, POLICY_2Q, POLICY_ARC};
+	for (int p = 0; p < 4; p++)
+	{
+		const std::string filename = "test.6";
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException& e)
+		{
+		}
+		{
+			File file6 = File::create(filename);
+			BufMgrOptions options;
+			options.policy = policies[p];
+			options.maxBufs = 100;
+			BufMgr* pool = new BufMgr(20, options);
+			for (i = 0; i < 20; i++)
+			{
+				pool->allocPage(&file6, pid[0], page);
+				sprintf((char*)tmpbuf, "test.6 Page %d", pid[0]);
+				page->insertRecord(tmpbuf);
+				pool->unPinPage(&file6, pid[0], true);
+			}
+			if (pool->resize(100) != 100 || pool->getNumBufs() != 100)
+			{
+				PRINT_ERROR("ERROR :: POOL DID NOT GROW");
+			}
+			std::vector<Page*> pinned;
+			for (i = 0; i < 100; i++)
+			{
+				if (i < 20)
+					pool->readPage(&file6, i + 1, page);
+				else
+				{
+					pool->allocPage(&file6, pid[0], page);
+					sprintf((char*)tmpbuf, "test.6 Page %d", pid[0]);
+					page->insertRecord(tmpbuf);
+				}
+				pinned.push_back(page);
+			}
+			try
+			{
+				pool->allocPage(&file6, pid[1], page);
+				PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown.");
+			}
+			catch(const BufferExceededException& e)
+			{
+			}
+
+			//a pinned page high in the pool stops the pool from shrinking below it
+			Page* held = NULL;
+			for (i = 0; i < 100; i++)
+			{
+				if (pinned[i] - pool->bufPool >= 50 && held == NULL)
+					held = pinned[i];
+				else
+					pool->unPinPage(pinned[i], true);
+			}
+			const std::uint32_t above = held - pool->bufPool + 1;
+			if (pool->resize(10) != above)
+			{
+				PRINT_ERROR("ERROR :: SHRINK DID NOT STOP AT THE PINNED PAGE");
+			}
+			pool->unPinPage(held, true);
+			if (pool->resize(10) != 10)
+			{
+				PRINT_ERROR("ERROR :: POOL DID NOT SHRINK");
+			}
+			for (i = 0; i < 100; i++)
+			{
+				pool->readPage(&file6, i + 1, page);
+				sprintf((char*)tmpbuf, "test.6 Page %d", i + 1);
+				if (page->getRecord(RecordId{PageId(i + 1), 1}) != tmpbuf || page - pool->bufPool >= 10)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				pool->unPinPage(&file6, i + 1, false);
+			}
+			for (int bad = 0; bad < 2; bad++)
+			{
+				try
+				{
+					pool->resize(bad == 0 ? 0 : 101);
+					PRINT_ERROR("ERROR :: Pool resized past its bounds. Exception should have been thrown.");
+				}
+				catch(const BufferExceededException& e)
+				{
+				}
+			}
+			delete pool;
+		}
+		File::remove(filename);
+	}
+
+	std::cout << "Test 36 passed" << "\n";
+}
+
+void test37()
+{
+	//the pages resident at shutdown are reloaded by the next pool, and are then hits
+	const std::string filename = "test.6";
+	const std::string warmup = "test.7";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+	std::remove(warmup.c_str());
+	{
+		File file6 = File::create(filename);
+		BufMgrOptions options;
+		options.warmupFile = warmup;
+		BufMgr* pool = new BufMgr(30, options);
+		for (i = 0; i < 50; i++)
+		{
+			pool->allocPage(&file6, pid[0], page);
+			sprintf((char*)tmpbuf, "test.6 Page %d", pid[0]);
+			page->insertRecord(tmpbuf);
+			pool->unPinPage(&file6, pid[0], true);
+		}
+		delete pool;
+
+		std::vector<PageId> listed;
+		{
+			std::ifstream in(warmup.c_str());
+			std::uint32_t hotness;
+			PageId pageNo;
+			std::string name;
+			while (in >> hotness >> pageNo >> name)
+			{
+				if (name != filename)
+				{
+					PRINT_ERROR("ERROR :: WARM-UP LIST NAMED ANOTHER FILE");
+				}
+				listed.push_back(pageNo);
+			}
+		}
+		if (listed.size() != 30)
+		{
+			PRINT_ERROR("ERROR :: WARM-UP LIST DID NOT HOLD THE RESIDENT PAGES");
+		}
+
+		pool = new BufMgr(30);
+		std::vector<File*> files(1, &file6);
+		if (pool->prewarm(warmup + ".missing", files) != 0 ||
+				pool->prewarm(warmup, files, true) != listed.size())
+		{
+			PRINT_ERROR("ERROR :: PREWARM DID NOT QUEUE THE LISTED PAGES");
+		}
+		pool->clearBufStats();
+		for (std::size_t k = 0; k < listed.size(); k++)
+		{
+			pool->readPage(&file6, listed[k], page);
+			sprintf((char*)tmpbuf, "test.6 Page %d", listed[k]);
+			if (page->getRecord(RecordId{listed[k], 1}) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			pool->unPinPage(&file6, listed[k], false);
+		}
+		if (pool->getBufStats().hits != listed.size())
+		{
+			PRINT_ERROR("ERROR :: PREWARMED PAGES WERE NOT HITS");
+		}
+		delete pool;
+	}
+	File::remove(filename);
+	std::remove(warmup.c_str());
+
+	std::cout << "Test 37 passed" << "\n";
+}
+
+void test38()
+{
+	//pages evicted from a small pool come back from the second tier, not the file
+	const std::string filename = "test.6";
+	const std::string flash = "test.7";
+	const SecondaryCacheType types[] = {SECONDARY_CACHE_COMPRESSED, SECONDARY_CACHE_FLASH};
+	for (int t = 0; t < 2; t++)
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException& e)
+		{
+		}
+		{
+			File file6 = File::create(filename);
+			BufMgrOptions options;
+			options.secondaryCache = types[t];
+			options.secondaryCacheBytes = 64 * Page::SIZE;
+			options.secondaryCachePath = flash;
+			BufMgr* pool = new BufMgr(10, options);
+			std::vector<PageId> pages;
+			for (i = 0; i < 40; i++)
+			{
+				pool->allocPage(&file6, pid[0], page);
+				sprintf((char*)tmpbuf, "test.6 Page %d", pid[0]);
+				page->insertRecord(tmpbuf);
+				pool->unPinPage(&file6, pid[0], true);
+				pages.push_back(pid[0]);
+			}
+			if (pool->getBufStats().secondaryStores < 30)
+			{
+				PRINT_ERROR("ERROR :: EVICTED PAGES WERE NOT STORED IN THE SECOND TIER");
+			}
+
+			pool->clearBufStats();
+			for (std::size_t k = 0; k < pages.size(); k++)
+			{
+				pool->readPage(&file6, pages[k], page);
+				sprintf((char*)tmpbuf, "test.6 Page %d", pages[k]);
+				if (page->getRecord(RecordId{pages[k], 1}) != tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				pool->unPinPage(&file6, pages[k], false);
+			}
+			if (pool->getBufStats().secondaryHits < 30)
+			{
+				PRINT_ERROR("ERROR :: MISSES WERE NOT SERVED BY THE SECOND TIER");
+			}
+
+			//a flushed file leaves nothing behind in the tier
+			pool->flushFile(&file6);
+			pool->clearBufStats();
+			for (std::size_t k = 0; k < pages.size(); k++)
+			{
+				pool->readPage(&file6, pages[k], page);
+				pool->unPinPage(&file6, pages[k], false);
+			}
+			if (pool->getBufStats().secondaryHits != 0)
+			{
+				PRINT_ERROR("ERROR :: SECOND TIER KEPT PAGES OF A FLUSHED FILE");
+			}
+			delete pool;
+		}
+		File::remove(filename);
+	}
+	std::remove(flash.c_str());
+
+	std::cout << "Test 38 passed" << "\n";
+}
+
+void test39()
+{
+	//the snapshot counts every read, eviction and write, in total and per file
+	const std::string filename6 = "test.6";
+	const std::string filename7 = "test.7";
+	try
+	{
+		File::remove(filename6);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+	try
+	{
+		File::remove(filename7);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+	{
+		File file6 = File::create(filename6);
+		File file7 = File::create(filename7);
+		BufMgr* pool = new BufMgr(10);
+		std::vector<PageId> pages6;
+		std::vector<PageId> pages7;
+		for (i = 0; i < 20; i++)
+		{
+			pool->allocPage(&file6, pid[0], page);
+			pool->unPinPage(&file6, pid[0], true);
+			pages6.push_back(pid[0]);
+		}
+		for (i = 0; i < 5; i++)
+		{
+			pool->allocPage(&file7, pid[0], page);
+			pool->unPinPage(&file7, pid[0], true);
+			pages7.push_back(pid[0]);
+		}
+		pool->flushFile(&file6);
+		pool->flushFile(&file7);
+
+		pool->clearBufStats();
+		for (int round = 0; round < 2; round++)
+		{
+			for (std::size_t k = 0; k < pages6.size(); k++)
+			{
+				pool->readPage(&file6, pages6[k], page);
+				pool->unPinPage(&file6, pages6[k], false);
+			}
+		}
+		for (int round = 0; round < 4; round++)
+		{
+			for (std::size_t k = 0; k < pages7.size(); k++)
+			{
+				pool->readPage(&file7, pages7[k], page);
+				pool->unPinPage(&file7, pages7[k], round == 0);
+			}
+		}
+		BufStatsSnapshot stats = pool->getStatsSnapshot();
+		//20 pages through 10 frames miss every time; the 5 pages of file7 then fit
+		if (stats.misses != 45 || stats.hits != 15 || stats.diskreads != 45 ||
+				stats.readLatency.count() != 45 || stats.allocations != 45 ||
+				stats.evictions != 35 || stats.victimCandidates < stats.allocations)
+		{
+			PRINT_ERROR("ERROR :: READS WERE NOT COUNTED");
+		}
+		if (stats.readLatency.percentileNanos(0.5) > stats.readLatency.percentileNanos(1.0) ||
+				stats.readLatency.percentileNanos(1.0) == 0)
+		{
+			PRINT_ERROR("ERROR :: READ LATENCIES WERE NOT RECORDED");
+		}
+		if (stats.files.size() != 2 || stats.files[0].filename != filename6 ||
+				stats.files[0].misses != 40 || stats.files[0].hits != 0 ||
+				stats.files[0].evictions != 35 ||
+				stats.files[1].filename != filename7 ||
+				stats.files[1].misses != 5 || stats.files[1].hits != 15)
+		{
+			PRINT_ERROR("ERROR :: READS WERE NOT COUNTED PER FILE");
+		}
+
+		//the dirty pages of file7 are written back as they are evicted
+		pool->clearBufStats();
+		for (std::size_t k = 0; k < 10; k++)
+		{
+			pool->readPage(&file6, pages6[k], page);
+			pool->unPinPage(&file6, pages6[k], false);
+		}
+		stats = pool->getStatsSnapshot();
+		if (stats.evictionWrites != 5 || stats.diskwrites != 5 ||
+				stats.writeLatency.count() != 5 || stats.files[1].evictionWrites != 5)
+		{
+			PRINT_ERROR("ERROR :: WRITE-BACKS WERE NOT COUNTED");
+		}
+
+		pool->flushFile(&file7);
+		if (pool->getStatsSnapshot().files.size() != 1)
+		{
+			PRINT_ERROR("ERROR :: FLUSHED FILE KEPT ITS STATISTICS");
+		}
+		delete pool;
+	}
+	File::remove(filename6);
+	File::remove(filename7);
+
+	std::cout << "Test 39 passed" << "\n";
+}
+
+void test40()
+{
+	//a traced workload replayed against a pool like the traced one gets the same hits
+#if !BADGERDB_TRACE
+	std::cout << "Test 40 skipped, tracing is compiled out" << "\n";
+	return;
+#endif
+	const std::string filename = "test.6";
+	const std::string trace = "test.7";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+	{
+		File file6 = File::create(filename);
+		BufMgr* pool = new BufMgr(10);
+		TraceRecorder* recorder = new TraceRecorder(trace);
+		pool->setTracer(recorder);
+		std::vector<PageId> pages;
+		for (i = 0; i < 20; i++)
+		{
+			pool->allocPage(&file6, pid[0], page);
+			pool->unPinPage(&file6, pid[0], true);
+			pages.push_back(pid[0]);
+		}
+		//a hot set of 5 pages read between sweeps over all 20
+		for (int round = 0; round < 50; round++)
+		{
+			const PageId pageNo = round % 3 == 0 ? pages[round % 20] : pages[round % 5];
+			pool->readPage(&file6, pageNo, page);
+			pool->unPinPage(&file6, pageNo, false);
+		}
+		pool->disposePage(&file6, pages[19]);
+		const std::uint64_t hits = pool->getBufStats().hits;
+		pool->setTracer(NULL);
+		if (recorder->recorded() != 20 * 2 + 50 * 2 + 1 + pool->getStatsSnapshot().evictions ||
+				recorder->dropped() != 0)
+		{
+			PRINT_ERROR("ERROR :: OPERATIONS WERE NOT RECORDED");
+		}
+		delete recorder;
+		delete pool;
+
+		std::uint32_t counts[7] = {0};
+		TraceReader reader(trace);
+		TraceRecord record;
+		std::uint64_t last = 0;
+		while (reader.next(record))
+		{
+			if (record.op < 1 || record.op > 5 || record.nanos < last ||
+					reader.filename(record.file_id) != filename)
+			{
+				PRINT_ERROR("ERROR :: TRACE DID NOT READ BACK");
+			}
+			last = record.nanos;
+			counts[record.op]++;
+		}
+		if (counts[TRACE_ALLOC] != 20 || counts[TRACE_READ] != 50 ||
+				counts[TRACE_UNPIN] != 70 || counts[TRACE_DISPOSE] != 1)
+		{
+			PRINT_ERROR("ERROR :: TRACE DID NOT HOLD THE OPERATIONS");
+		}
+
+		TraceReplayer replayer(trace, "test.replay");
+		if (replayer.numFiles() != 1 || replayer.numPages() != 20)
+		{
+			PRINT_ERROR("ERROR :: REPLAY DID NOT CREATE THE TRACED PAGES");
+		}
+		BufMgr* replayed = new BufMgr(10);
+		ReplayResult result = replayer.replay(*replayed);
+		if (result.operations != 20 * 2 + 50 * 2 || result.skipped != 0 ||
+				result.traced_reads != 50 || result.traced_hits != hits ||
+				result.stats.hits != hits || result.stats.misses != 20 + 50 - hits)
+		{
+			PRINT_ERROR("ERROR :: REPLAY DID NOT MATCH THE TRACED POOL");
+		}
+		//a pool holding every page misses only once per page
+		BufMgr* large = new BufMgr(20);
+		result = replayer.replay(*large);
+		if (result.stats.misses != 20)
+		{
+			PRINT_ERROR("ERROR :: REPLAY ON A LARGER POOL DID NOT HIT");
+		}
+		delete large;
+		delete replayed;
+	}
+	File::remove(filename);
+	std::remove(trace.c_str());
+
+	std::cout << "Test 40 passed" << "\n";
+}
+
+void test41()
+{
+	//File objects for one file share its id, and so its pages in the pool
+	const std::string filename6 = "test.6";
+	const std::string filename7 = "test.7";
+	try
+	{
+		File::remove(filename6);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+	try
+	{
+		File::remove(filename7);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+	{
+		File file6 = File::create(filename6);
+		File file7 = File::create(filename7);
+		File copy = File::open(filename6);
+		if (copy.id() != file6.id() || file7.id() == file6.id())
+		{
+			PRINT_ERROR("ERROR :: FILES DID NOT GET IDS OF THEIR OWN");
+		}
+		BufMgr* pool = new BufMgr(10);
+		for (i = 0; i < 5; i++)
+		{
+			pool->allocPage(&file6, pid[i], page);
+			pool->unPinPage(&file6, pid[i], true);
+		}
+		pool->clearBufStats();
+		Page* copied;
+		pool->readPage(&copy, pid[2], copied);
+		pool->readPage(&file6, pid[2], page);
+		if (copied != page || pool->getBufStats().hits != 2 || pool->getBufStats().misses != 0)
+		{
+			PRINT_ERROR("ERROR :: COPY OF A FILE DID NOT SHARE ITS PAGES");
+		}
+		pool->unPinPage(&copy, pid[2], false);
+		pool->unPinPage(&file6, pid[2], false);
+
+		//flushing through the copy writes back and drops pages read through the original
+		pool->flushFile(&copy);
+		pool->readPage(&file6, pid[0], page);
+		if (pool->getBufStats().misses != 1 || page->page_number() != pid[0])
+		{
+			PRINT_ERROR("ERROR :: FLUSH THROUGH A COPY DID NOT DROP THE FILE'S PAGES");
+		}
+		pool->unPinPage(&file6, pid[0], false);
+		pool->flushFile(&file6);
+		delete pool;
+
+		//iterators over one file compare equal whichever File object they came from
+		int pages = 0;
+		for (FileIterator it = file6.begin(); it != copy.end(); ++it)
+			pages++;
+		if (pages != 5)
+		{
+			PRINT_ERROR("ERROR :: ITERATORS OF A COPY DID NOT COMPARE EQUAL");
+		}
+
+		//assignment shares the handle, and assigning the last reference to itself keeps
+		//the file as it was opened
+		copy = file7;
+		if (copy.id() != file7.id() || !File::isOpen(filename6))
+		{
+			PRINT_ERROR("ERROR :: ASSIGNMENT DID NOT SHARE THE HANDLE");
+		}
+		File temp = File::createTemporary("test.8");
+		const File& sameTemp = temp;
+		temp = sameTemp;
+		if (!temp.isTemporary() || !File::isOpen("test.8"))
+		{
+			PRINT_ERROR("ERROR :: SELF-ASSIGNMENT CLOSED A TEMPORARY FILE");
+		}
+		file6 = file7;
+		if (File::isOpen(filename6))
+		{
+			PRINT_ERROR("ERROR :: ASSIGNMENT DID NOT CLOSE THE LAST REFERENCE");
+		}
+		File direct = File::open(filename6, true);
+		const bool wasDirect = direct.isDirect();
+		const File& sameDirect = direct;
+		direct = sameDirect;
+		if (direct.isDirect() != wasDirect || direct.id() == file7.id())
+		{
+			PRINT_ERROR("ERROR :: SELF-ASSIGNMENT REOPENED A DIRECT FILE");
+		}
+	}
+	if (File::isOpen(filename6) || File::isOpen(filename7) || File::isOpen("test.8"))
+	{
+		PRINT_ERROR("ERROR :: FILES STAYED OPEN");
+	}
+	File::remove(filename6);
+	File::remove(filename7);
+
+	std::cout << "Test 41 passed" << "\n";
+}
+
+void test42()
+{
+	//flushFile writes back and drops the pages of its file only, however often frames changed hands
+	const std::string filename6 = "test.6";
+	const std::string filename7 = "test.7";
+	try
+	{
+		File::remove(filename6);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+	try
+	{
+		File::remove(filename7);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+	{
+		File file6 = File::create(filename6);
+		File file7 = File::create(filename7);
+		BufMgr* pool = new BufMgr(20);
+		std::vector<PageId> pages6, pages7;
+		//pages of both files interleaved, more than fit so that frames are reused
+		for (i = 0; i < 30; i++)
+		{
+			pool->allocPage(&file6, pid[0], page);
+			pool->unPinPage(&file6, pid[0], true);
+			pages6.push_back(pid[0]);
+			pool->allocPage(&file7, pid[0], page);
+			pool->unPinPage(&file7, pid[0], true);
+			pages7.push_back(pid[0]);
+		}
+		pool->disposePage(&file6, pages6.back());
+		pages6.pop_back();
+		for (i = 0; i < 5; i++)
+		{
+			pool->readPage(&file6, pages6[i], page);
+			pool->unPinPage(&file6, pages6[i], true);
+		}
+
+		//a pinned page still stops the flush
+		pool->readPage(&file6, pages6[0], page);
+		try
+		{
+			pool->flushFile(&file6);
+			PRINT_ERROR("ERROR :: FLUSH OF A FILE WITH A PINNED PAGE SUCCEEDED");
+		}
+		catch(const PagePinnedException& e)
+		{
+		}
+		pool->unPinPage(&file6, pages6[0], false);
+
+		pool->clearBufStats();
+		pool->flushFile(&file6);
+		//the latest pages of file7 are still resident, newest first
+		for (i = 29; i >= 20; i--)
+		{
+			pool->readPage(&file7, pages7[i], page);
+			pool->unPinPage(&file7, pages7[i], false);
+		}
+		if (pool->getBufStats().hits == 0)
+		{
+			PRINT_ERROR("ERROR :: FLUSH DROPPED PAGES OF ANOTHER FILE");
+		}
+		pool->flushFile(&file7);
+		pool->clearBufStats();
+		for (i = 0; i < 5; i++)
+		{
+			pool->readPage(&file6, pages6[i], page);
+			pool->unPinPage(&file6, pages6[i], false);
+		}
+		if (pool->getBufStats().hits != 0 || pool->getBufStats().misses != 5)
+		{
+			PRINT_ERROR("ERROR :: FLUSH LEFT PAGES OF ITS FILE");
+		}
+		pool->flushFile(&file6);
+		pool->flushFile(&file6);
+		delete pool;
+	}
+	File::remove(filename6);
+	File::remove(filename7);
+
+	std::cout << "Test 42 passed" << "\n";
+}
+
+void test43()
+{
+	//a temporary file spills to memory under pressure and is dropped without writing back
+	const std::string filename = "test.6";
+	{
+		File temp = File::createTemporary(filename);
+		if (!temp.isTemporary() || File::exists(filename) || !File::isOpen(filename))
+		{
+			PRINT_ERROR("ERROR :: TEMPORARY FILE WAS NOT CREATED IN MEMORY");
+		}
+		try
+		{
+			File::createTemporary(filename);
+			PRINT_ERROR("ERROR :: TEMPORARY FILE WAS CREATED TWICE");
+		}
+		catch(const FileExistsException& e)
+		{
+		}
+		BufMgr* pool = new BufMgr(5);
+		std::vector<PageId> pages;
+		std::vector<RecordId> records;
+		for (i = 0; i < 20; i++)
+		{
+			pool->allocPage(&temp, pid[0], page);
+			sprintf((char*)tmpbuf, "temp.%d", i);
+			records.push_back(page->insertRecord(tmpbuf));
+			pool->unPinPage(&temp, pid[0], true);
+			pages.push_back(pid[0]);
+		}
+		//pages evicted to make room come back intact
+		for (i = 0; i < 20; i++)
+		{
+			pool->readPage(&temp, pages[i], page);
+			sprintf((char*)tmpbuf, "temp.%d", i);
+			if (page->getRecord(records[i]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: TEMPORARY PAGE DID NOT READ BACK");
+			}
+			pool->unPinPage(&temp, pages[i], true);
+		}
+		pool->checkpoint();
+		temp.sync();
+		const std::uint64_t writes = pool->getBufStats().diskwrites;
+		pool->dropFile(&temp);
+		if (pool->getBufStats().diskwrites != writes || pool->getStatsSnapshot().checkpointWrites != 0)
+		{
+			PRINT_ERROR("ERROR :: TEMPORARY PAGES WERE WRITTEN WITHOUT MEMORY PRESSURE");
+		}
+		delete pool;
+	}
+	if (File::isOpen(filename) || File::exists(filename))
+	{
+		PRINT_ERROR("ERROR :: TEMPORARY FILE OUTLIVED ITS LAST OBJECT");
+	}
+
+	std::cout << "Test 43 passed" << "\n";
+}
+
+void test44()
+{
+	//a checkpoint writes the pages dirty when it starts while others stay pinned, paces
+	//its writes and logs its redo LSN
+	const std::string& filename = "test.6";
+	const std::string& logname = "test.6.log";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+	std::remove(logname.c_str());
+
+	{
+		LogManager log(logname);
+		BufMgrOptions options;
+		options.log = &log;
+		options.logCheckpoints = true;
+		options.checkpointPagesPerSec = 200;
+		File file6 = File::create(filename);
+		BufMgr* pool = new BufMgr(num, options);
+		for (i = 0; i < 40; i++)
+		{
+			PageId pageNo6;
+			PageGuard guard = pool->allocPage(&file6, pageNo6);
+			sprintf((char*)tmpbuf, "test.6 Page %d", pageNo6);
+			guard->insertRecord(tmpbuf);
+			guard.markDirty(log.append(tmpbuf));
+		}
+
+		//a pinned page is skipped, and the redo LSN stays where nothing is missed
+		const Lsn start = log.endLsn();
+		{
+			PageGuard pinned = pool->readPage(&file6, 1);
+			const std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+			pool->checkpoint();
+			if (std::chrono::steady_clock::now() - before < std::chrono::milliseconds(150))
+			{
+				PRINT_ERROR("ERROR :: CHECKPOINT WRITES WERE NOT PACED");
+			}
+		}
+		if (pool->getBufStats().checkpointWrites != 39 || pool->getBufStats().checkpointSkips != 1 ||
+		    pool->checkpointRedoLsn() != 0)
+		{
+			PRINT_ERROR("ERROR :: CHECKPOINT DID NOT SKIP THE PINNED PAGE");
+		}
+		sprintf((char*)tmpbuf, "test.6 Page %d", 40);
+		if (file6.readPage(40).getRecord({40, 1}) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+
+		//once nothing is skipped, the redo LSN moves up to the snapshot
+		pool->checkpoint();
+		if (pool->getBufStats().checkpointWrites != 40 || pool->checkpointRedoLsn() <= start)
+		{
+			PRINT_ERROR("ERROR :: CHECKPOINT DID NOT ADVANCE ITS REDO LSN");
+		}
+		if (log.durableLsn() != log.endLsn())
+		{
+			PRINT_ERROR("ERROR :: CHECKPOINT MARKER NOT DURABLE");
+		}
+		const Lsn redo = pool->checkpointRedoLsn();
+		pool->flushFile(&file6);
+		delete pool;
+
+		std::vector<Lsn> markers;
+		log.scan([&](Lsn, const std::string& record) {
+			Lsn redoLsn;
+			if (BufMgr::parseCheckpointRecord(record, redoLsn))
+				markers.push_back(redoLsn);
+		});
+		if (markers.size() != 2 || markers[0] != 0 || markers[1] != redo)
+		{
+			PRINT_ERROR("ERROR :: CHECKPOINT MARKERS NOT LOGGED");
+		}
+	}
+	File::remove(filename);
+	std::remove(logname.c_str());
+
+	std::cout << "Test 44 passed" << "\n";
+}
+
+void test45()
+{
+	//an external sort spills runs through a small budget of frames and merges them in order
+	BufMgr* pool = new BufMgr(num);
+	//records of about 48 bytes for twice as many pages as the pool has frames, far past the
+	//budget of the sort whatever the page size
+	const int records = (int)(Page::DATA_SIZE / 48 * 2 * num);
+	std::vector<std::string> expected;
+	{
+		//records are ordered by their first 8 bytes only, so ties show whether the sort is stable
+		ExternalSort sort(pool, 7, [](const RecordView& a, const RecordView& b) {
+			return std::memcmp(a.data(), b.data(), 8) < 0;
+		});
+		std::mt19937 random(45);
+		for (i = 0; i < records; i++)
+		{
+			sprintf((char*)tmpbuf, "%08u record %d padding to fill pages", (unsigned)(random() % 5000), i);
+			expected.push_back(tmpbuf);
+			sort.add(tmpbuf);
+		}
+		std::stable_sort(expected.begin(), expected.end(), [](const std::string& a, const std::string& b) {
+			return a.compare(0, 8, b, 0, 8) < 0;
+		});
+		if (sort.runsWritten() < 2 * sort.fanIn())
+		{
+			PRINT_ERROR("ERROR :: EXTERNAL SORT DID NOT SPILL RUNS");
+		}
+		//runs are kept in files on disk, so that a large sort does not fill memory or swap;
+		//every open run is a removed file in the temporary directory, not one in memory
+		std::size_t on_disk = 0;
+		std::size_t in_memory = 0;
+		DIR* fds = opendir("/proc/self/fd");
+		if (fds != NULL)
+		{
+			for (struct dirent* entry = readdir(fds); entry != NULL; entry = readdir(fds))
+			{
+				char target[4096];
+				const ssize_t length = readlink((std::string("/proc/self/fd/") + entry->d_name).c_str(), target, sizeof(target) - 1);
+				if (length <= 0)
+					continue;
+				target[length] = '\0';
+				if (std::strstr(target, "/badgerdb.spill.") != NULL)
+					on_disk++;
+				else if (std::strstr(target, "badgerdb.sort.") != NULL)
+					in_memory++;
+			}
+			closedir(fds);
+			if (on_disk == 0 || in_memory > 1)
+			{
+				PRINT_ERROR("ERROR :: EXTERNAL SORT RUNS NOT KEPT ON DISK");
+			}
+		}
+		std::size_t emitted = 0;
+		bool ordered = true;
+		sort.finish([&](const RecordView& record) {
+			if (emitted >= expected.size() || record.str() != expected[emitted])
+				ordered = false;
+			emitted++;
+		});
+		if (!ordered || emitted != expected.size())
+		{
+			PRINT_ERROR("ERROR :: EXTERNAL SORT OUTPUT NOT IN ORDER");
+		}
+
+		//a sort that fits in its workspace writes no run, and the sort can be reused
+		const std::uint64_t runs = sort.runsWritten();
+		sort.add("00000002 b");
+		sort.add("00000001 a");
+		std::vector<std::string> small;
+		sort.finish([&](const RecordView& record) { small.push_back(record.str()); });
+		if (sort.runsWritten() != runs || small.size() != 2 || small[0] != "00000001 a")
+		{
+			PRINT_ERROR("ERROR :: SMALL SORT WROTE A RUN");
+		}
+	}
+	delete pool;
+
+	std::cout << "Test 45 passed" << "\n";
+}
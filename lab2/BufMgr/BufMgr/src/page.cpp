@@ -5,13 +5,17 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <vector>
 
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
 #include "exceptions/invalid_slot_exception.h"
 #include "exceptions/slot_in_use_exception.h"
 #include "page_iterator.h"
+#include "record_batch.h"
 #include "page.h"
 
 namespace badgerdb {
@@ -21,16 +25,20 @@ Page::Page() {
 }
 
 void Page::initialize() {
+  header_.lsn = 0;
   header_.free_space_lower_bound = 0;
   header_.free_space_upper_bound = DATA_SIZE;
   header_.num_slots = 0;
   header_.num_free_slots = 0;
+  header_.first_free_slot = INVALID_SLOT;
+  header_.fragmented_bytes = 0;
   header_.current_page_number = INVALID_NUMBER;
   header_.next_page_number = INVALID_NUMBER;
-  data_.assign(DATA_SIZE, char());
+  header_.checksum = 0;
+  std::memset(data_, 0, DATA_SIZE);
 }
 
-RecordId Page::insertRecord(const std::string& record_data) {
+RecordId Page::insertRecord(const RecordView& record_data) {
   if (!hasSpaceForRecord(record_data)) {
     throw InsufficientSpaceException(
         page_number(), record_data.length(), getFreeSpace());
@@ -43,15 +51,48 @@ RecordId Page::insertRecord(const std::string& record_data) {
 std::string Page::getRecord(const RecordId& record_id) const {
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
-  return data_.substr(slot.item_offset, slot.item_length);
+  return std::string(data_ + slot.item_offset(), slot.item_length());
+}
+
+RecordView Page::getRecordView(const RecordId& record_id) const {
+  validateRecordId(record_id);
+  const PageSlot& slot = getSlot(record_id.slot_number);
+  return RecordView(data_ + slot.item_offset(), slot.item_length());
+}
+
+void Page::scanRecords(RecordBatch& batch) const {
+  batch.page_number = page_number();
+  batch.data = data_;
+  std::size_t n = 0;
+  const PageSlot* slots = reinterpret_cast<const PageSlot*>(data_);
+  for (SlotId i = 0; i < header_.num_slots; ++i) {
+    const PageSlot& slot = slots[i];
+    // Always write the entry and only keep it if the slot is used, so that
+    // the loop has no branch to mispredict.
+    batch.offsets[n] = slot.offset_ & ~PageSlot::USED;
+    batch.lengths[n] = slot.length_;
+    batch.slots[n] = i + 1;
+    n += slot.offset_ >> 15;
+  }
+  batch.count = n;
 }
 
 void Page::updateRecord(const RecordId& record_id,
-                        const std::string& record_data) {
+                        const RecordView& record_data) {
   validateRecordId(record_id);
-  const PageSlot* slot = getSlot(record_id.slot_number);
+  PageSlot* slot = getSlot(record_id.slot_number);
+  if (record_data.length() <= slot->item_length()) {
+    // Overwrite the old version; the bytes it no longer needs become a hole.
+    const std::uint16_t unused = slot->item_length() - record_data.length();
+    std::memmove(data_ + slot->item_offset(), record_data.data(),
+                 record_data.length());
+    std::memset(data_ + slot->item_offset() + record_data.length(), 0, unused);
+    slot->set_item_length(record_data.length());
+    header_.fragmented_bytes += unused;
+    return;
+  }
   const std::size_t free_space_after_delete =
-      getFreeSpace() + slot->item_length;
+      getFreeSpace() + slot->item_length();
   if (record_data.length() > free_space_after_delete) {
     throw InsufficientSpaceException(
         page_number(), record_data.length(), free_space_after_delete);
@@ -71,58 +112,35 @@ void Page::deleteRecord(const RecordId& record_id,
                         const bool allow_slot_compaction) {
   validateRecordId(record_id);
   PageSlot* slot = getSlot(record_id.slot_number);
-  data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
+  std::memset(data_ + slot->item_offset(), 0, slot->item_length());
 
-  // Compact the data by removing the hole left by this record (if necessary).
-  std::uint16_t move_offset = slot->item_offset; 
-  std::size_t move_bytes = 0;
-  for (SlotId i = 1; i <= header_.num_slots; ++i) {
-    PageSlot* other_slot = getSlot(i);
-    if (other_slot->used && other_slot->item_offset < slot->item_offset) {
-      if (other_slot->item_offset < move_offset) {
-        move_offset = other_slot->item_offset;
-      }
-      move_bytes += other_slot->item_length;
-      // Update the slot for the other data to reflect the soon-to-be-new
-      // location.
-      other_slot->item_offset += slot->item_length;
-    }
-  }
-  // If we have data to move, shift it to the right.
-  if (move_bytes > 0) {
-    const std::string& data_to_move = data_.substr(move_offset, move_bytes);
-    data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+  // Leave the hole for compact(), unless the record is the lowest on the page
+  // and its bytes simply rejoin the free space.
+  if (slot->item_offset() == header_.free_space_upper_bound) {
+    header_.free_space_upper_bound += slot->item_length();
+  } else {
+    header_.fragmented_bytes += slot->item_length();
   }
-  header_.free_space_upper_bound += slot->item_length;
 
   // Mark slot as unused.
-  slot->used = false;
-  slot->item_offset = 0;
-  slot->item_length = 0;
+  slot->set_used(false);
   ++header_.num_free_slots;
+  linkFreeSlot(record_id.slot_number);
 
   if (allow_slot_compaction && record_id.slot_number == header_.num_slots) {
     // Last slot in the list, so we need to free any unused slots that are at
-    // the end of the slot list.
-    int num_slots_to_delete = 1;
-    for (SlotId i = 1; i < header_.num_slots; ++i) {
-      // Traverse list backwards, looking for unused slots.
-      const PageSlot* other_slot = getSlot(header_.num_slots - i);
-      if (!other_slot->used) {
-        ++num_slots_to_delete;
-      } else {
-        // Stop at the first used slot we find, since we can't move used slots
-        // without affecting record IDs.
-        break;
-      }
+    // the end of the slot list.  Stop at the first used slot we find, since we
+    // can't move used slots without affecting record IDs.
+    while (header_.num_slots > 0 && !getSlot(header_.num_slots)->used()) {
+      unlinkFreeSlot(header_.num_slots);
+      --header_.num_slots;
+      --header_.num_free_slots;
     }
-    header_.num_slots -= num_slots_to_delete;
-    header_.num_free_slots -= num_slots_to_delete;
-    header_.free_space_lower_bound -= sizeof(PageSlot) * num_slots_to_delete;
+    header_.free_space_lower_bound = sizeof(PageSlot) * header_.num_slots;
   }
 }
 
-bool Page::hasSpaceForRecord(const std::string& record_data) const {
+bool Page::hasSpaceForRecord(const RecordView& record_data) const {
   std::size_t record_size = record_data.length();
   if (header_.num_free_slots == 0) {
     record_size += sizeof(PageSlot);
@@ -130,6 +148,38 @@ bool Page::hasSpaceForRecord(const std::string& record_data) const {
   return record_size <= getFreeSpace();
 }
 
+void Page::compact() {
+  if (header_.fragmented_bytes == 0) {
+    return;
+  }
+  std::vector<SlotId> used;
+  used.reserve(header_.num_slots - header_.num_free_slots);
+  for (SlotId i = 1; i <= header_.num_slots; ++i) {
+    if (getSlot(i)->used()) {
+      used.push_back(i);
+    }
+  }
+  // Move the highest record first, so that no record is overwritten before it
+  // has moved.
+  std::sort(used.begin(), used.end(), [this](SlotId lhs, SlotId rhs) {
+    return getSlot(lhs)->item_offset() > getSlot(rhs)->item_offset();
+  });
+  std::uint16_t top = DATA_SIZE;
+  for (std::size_t i = 0; i < used.size(); ++i) {
+    PageSlot* slot = getSlot(used[i]);
+    top -= slot->item_length();
+    if (slot->item_offset() != top) {
+      std::memmove(data_ + top, data_ + slot->item_offset(),
+                   slot->item_length());
+      slot->set_item_offset(top);
+    }
+  }
+  std::memset(data_ + header_.free_space_lower_bound, 0,
+              top - header_.free_space_lower_bound);
+  header_.free_space_upper_bound = top;
+  header_.fragmented_bytes = 0;
+}
+
 PageSlot* Page::getSlot(const SlotId slot_number) {
   return reinterpret_cast<PageSlot*>(
       &data_[(slot_number - 1) * sizeof(PageSlot)]);
@@ -140,47 +190,76 @@ const PageSlot& Page::getSlot(const SlotId slot_number) const {
       &data_[(slot_number - 1) * sizeof(PageSlot)]);
 }
 
+void Page::linkFreeSlot(const SlotId slot_number) {
+  PageSlot* slot = getSlot(slot_number);
+  slot->set_item_offset(header_.first_free_slot);
+  slot->set_item_length(INVALID_SLOT);
+  if (header_.first_free_slot != INVALID_SLOT) {
+    getSlot(header_.first_free_slot)->set_item_length(slot_number);
+  }
+  header_.first_free_slot = slot_number;
+}
+
+void Page::unlinkFreeSlot(const SlotId slot_number) {
+  const PageSlot* slot = getSlot(slot_number);
+  const SlotId next = slot->item_offset();
+  const SlotId previous = slot->item_length();
+  if (previous == INVALID_SLOT) {
+    header_.first_free_slot = next;
+  } else {
+    getSlot(previous)->set_item_offset(next);
+  }
+  if (next != INVALID_SLOT) {
+    getSlot(next)->set_item_length(previous);
+  }
+}
+
 SlotId Page::getAvailableSlot() {
   SlotId slot_number = INVALID_SLOT;
   if (header_.num_free_slots > 0) {
-    // Have an allocated but unused slot that we can reuse.
-    for (SlotId i = 1; i <= header_.num_slots; ++i) {
-      const PageSlot* slot = getSlot(i);
-      if (!slot->used) {
-        // We don't decrement the number of free slots until someone actually
-        // puts data in the slot.
-        slot_number = i;
-        break;
-      }
-    }
+    // Have an allocated but unused slot that we can reuse.  We don't take it
+    // off the chain until someone actually puts data in the slot.
+    slot_number = header_.first_free_slot;
   } else {
-    // Have to allocate a new slot.
+    // Have to allocate a new slot, out of the space between the bounds.
+    if (header_.free_space_upper_bound - header_.free_space_lower_bound <
+        static_cast<int>(sizeof(PageSlot))) {
+      compact();
+    }
     slot_number = header_.num_slots + 1;
     ++header_.num_slots;
     ++header_.num_free_slots;
     header_.free_space_lower_bound = sizeof(PageSlot) * header_.num_slots;
+    getSlot(slot_number)->set_used(false);
+    linkFreeSlot(slot_number);
   }
   assert(slot_number != INVALID_SLOT);
   return static_cast<SlotId>(slot_number);
 }
 
 void Page::insertRecordInSlot(const SlotId slot_number,
-                              const std::string& record_data) {
+                              const RecordView& record_data) {
   if (slot_number > header_.num_slots ||
       slot_number == INVALID_SLOT) {
     throw InvalidSlotException(page_number(), slot_number);
   }
   PageSlot* slot = getSlot(slot_number);
-  if (slot->used) {
+  if (slot->used()) {
     throw SlotInUseException(page_number(), slot_number);
   }
+  unlinkFreeSlot(slot_number);
   const int record_length = record_data.length();
-  slot->used = true;
-  slot->item_length = record_length;
-  slot->item_offset = header_.free_space_upper_bound - record_length;
-  header_.free_space_upper_bound = slot->item_offset;
+  if (header_.free_space_upper_bound - header_.free_space_lower_bound <
+      record_length) {
+    compact();
+  }
+  slot->set_used(true);
+  slot->set_item_length(record_length);
+  slot->set_item_offset(header_.free_space_upper_bound - record_length);
+  header_.free_space_upper_bound = slot->item_offset();
   --header_.num_free_slots;
-  data_.replace(slot->item_offset, slot->item_length, record_data);
+  std::memcpy(data_ + slot->item_offset(), record_data.data(),
+              slot->item_length());
 }
 
 void Page::validateRecordId(const RecordId& record_id) const {
@@ -188,7 +267,7 @@ void Page::validateRecordId(const RecordId& record_id) const {
     throw InvalidRecordException(record_id, page_number());
   }
   const PageSlot& slot = getSlot(record_id.slot_number);
-  if (!slot.used) {
+  if (!slot.used()) {
     throw InvalidRecordException(record_id, page_number());
   }
 }
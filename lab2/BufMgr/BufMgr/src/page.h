@@ -11,9 +11,15 @@
 #include <stdint.h>
 #include <memory>
 #include <string>
+#include <type_traits>
 
+#include "record_view.h"
 #include "types.h"
 
+#ifndef BADGERDB_PAGE_SIZE
+#define BADGERDB_PAGE_SIZE 8192
+#endif
+
 namespace badgerdb {
 
 /**
@@ -23,6 +29,12 @@ namespace badgerdb {
  * contains a pointer to the next page in the file.
  */
 struct PageHeader {
+  /**
+   * LSN of the last log record describing a change to this page.  The page may
+   * only be written to its file once the log is durable up to this LSN.
+   */
+  Lsn lsn;
+
   /**
    * Lower bound of the free space.  This is the offset of the first unused byte
    * after the slot array.
@@ -47,6 +59,19 @@ struct PageHeader {
    */
   SlotId num_free_slots;
 
+  /**
+   * First slot of the chain of slots allocated but not in use, or
+   * Page::INVALID_SLOT if there are none.
+   */
+  SlotId first_free_slot;
+
+  /**
+   * Number of bytes in holes left between records by deletes and updates.
+   * They count as free space, and are merged into the space between the
+   * bounds by compaction once an insert needs them.
+   */
+  std::uint16_t fragmented_bytes;
+
   /**
    * Number of the page within the file.
    */
@@ -57,6 +82,13 @@ struct PageHeader {
    */
   PageId next_page_number;
 
+  /**
+   * CRC-32C of the page as last written to its file, computed over the whole
+   * page but this field and <next_page_number>, which the file updates in
+   * place.
+   */
+  std::uint32_t checksum;
+
   /**
    * Returns true if this page header is equal to the other.
    *
@@ -73,26 +105,60 @@ struct PageHeader {
 
 /**
  * @brief Slot metadata that tracks where a record is in the data space.
+ *
+ * Packed into two 16-bit words, with the used flag in the top bit of the
+ * offset; offsets in a page never reach it.
  */
 struct PageSlot {
   /**
-   * Whether the slot currently holds data.  May be false if this slot's
-   * record has been deleted after insertion.
+   * Set in <offset_> while the slot holds data.
+   */
+  static const std::uint16_t USED = 0x8000;
+
+  /**
+   * Returns whether the slot currently holds data.  May be false if this
+   * slot's record has been deleted after insertion.
    */
-  bool used;
+  bool used() const { return (offset_ & USED) != 0; }
 
   /**
-   * Offset of the data item in the page.
+   * Returns the offset of the data item in the page.  In an unused slot, the
+   * number of the next slot in the page's chain of unused slots.
    */
-  std::uint16_t item_offset;
+  std::uint16_t item_offset() const { return offset_ & ~USED; }
 
   /**
-   * Length of the data item in this slot.
+   * Returns the length of the data item in this slot.  In an unused slot, the
+   * number of the previous slot in the page's chain of unused slots.
    */
-  std::uint16_t item_length;
+  std::uint16_t item_length() const { return length_; }
+
+  void set_used(const bool used) {
+    offset_ = used ? (offset_ | USED) : (offset_ & ~USED);
+  }
+
+  void set_item_offset(const std::uint16_t offset) {
+    offset_ = (offset_ & USED) | offset;
+  }
+
+  void set_item_length(const std::uint16_t length) { length_ = length; }
+
+ private:
+  /**
+   * Offset of the data item, and the used flag in its top bit.
+   */
+  std::uint16_t offset_;
+
+  /**
+   * Length of the data item.
+   */
+  std::uint16_t length_;
+
+  friend class Page;
 };
 
 class PageIterator;
+struct RecordBatch;
 
 /**
  * @brief Class which represents a fixed-size database page containing records.
@@ -102,15 +168,19 @@ class PageIterator;
  * slots and identified by a RecordId.  Although a record's actual contents may
  * be moved on the page, accessing a record by its slot is consistent.
  *
+ * A Page holds its header and data inline and is trivially copyable, so pages
+ * can be copied with memcpy and transferred to and from disk in place.
+ *
  * @warning This class is not threadsafe.
  */
 class Page {
  public:
   /**
-   * Page size in bytes.  If this is changed, database files created with a
-   * different page size value will be unreadable by the resulting binaries.
+   * Page size in bytes, set at build time with BADGERDB_PAGE_SIZE (make
+   * PAGE_SIZE=...).  Files record the page size they were created with, and
+   * binaries built with another size refuse to open them.
    */
-  static const std::size_t SIZE = 8192;
+  static const std::size_t SIZE = BADGERDB_PAGE_SIZE;
 
   /**
    * Size of page free space area in bytes.
@@ -138,7 +208,7 @@ class Page {
    * @param record_data  Bytes that compose the record.
    * @return  ID of the newly inserted record.
    */
-  RecordId insertRecord(const std::string& record_data);
+  RecordId insertRecord(const RecordView& record_data);
 
   /**
    * Returns the record with the given ID.  Returned data is a copy of what is
@@ -150,20 +220,39 @@ class Page {
    */
   std::string getRecord(const RecordId& record_id) const;
 
+  /**
+   * Returns a view of the record with the given ID in the page, without
+   * copying it.  The view is valid until the page is changed or unpinned.
+   *
+   * @param record_id  ID of the record to return.
+   * @return  View of the record.
+   */
+  RecordView getRecordView(const RecordId& record_id) const;
+
+  /**
+   * Fills <batch> with the position of every record on the page, in slot
+   * order, in one pass over the slot directory.
+   *
+   * @param batch   Receives the records.
+   */
+  void scanRecords(RecordBatch& batch) const;
+
   /**
    * Updates the record with the given ID, replacing its data with a new
    * version.  This is equivalent to deleting the old record and inserting a
-   * new one, with the exception that the record ID will not change.
+   * new one, with the exception that the record ID will not change.  A new
+   * version no longer than the old one is written in place.
    *
    * @param record_id   ID of record to update.
    * @param record_data Updated bytes that compose the record.
    */
-  void updateRecord(const RecordId& record_id, const std::string& record_data);
+  void updateRecord(const RecordId& record_id, const RecordView& record_data);
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array.
+   * Deletes the record with the given ID.  The record's bytes are left as a
+   * hole, so no other record moves; the page is compacted once an insert
+   * needs the space.  Slot array is compacted if the slot deleted is at the
+   * end of the slot array.
    *
    * @param record_id   ID of the record to delete.
    */
@@ -175,15 +264,17 @@ class Page {
    * @param record_data Bytes that compose the record.
    * @return  Whether the page can hold the data.
    */
-  bool hasSpaceForRecord(const std::string& record_data) const;
+  bool hasSpaceForRecord(const RecordView& record_data) const;
 
   /**
-   * Returns this page's free space in bytes.
+   * Returns this page's free space in bytes, including the holes that
+   * compaction would reclaim.
    *
    * @return  Free space in bytes.
    */
   std::uint16_t getFreeSpace() const { return header_.free_space_upper_bound -
-                                              header_.free_space_lower_bound; }
+                                              header_.free_space_lower_bound +
+                                              header_.fragmented_bytes; }
 
   /**
    * Returns this page's number in its file.
@@ -199,6 +290,20 @@ class Page {
    */
   PageId next_page_number() const { return header_.next_page_number; }
 
+  /**
+   * Returns the LSN of the last log record describing a change to this page.
+   *
+   * @return  LSN of the page, or 0 if no change to it was logged.
+   */
+  Lsn lsn() const { return header_.lsn; }
+
+  /**
+   * Sets the LSN of the page after logging a change to it.
+   *
+   * @param new_lsn   LSN returned by LogManager::append for the change.
+   */
+  void set_lsn(const Lsn new_lsn) { header_.lsn = new_lsn; }
+
   /**
    * Returns an iterator at the first record in the page.
    *
@@ -239,9 +344,8 @@ class Page {
   }
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array and
+   * Deletes the record with the given ID, leaving its bytes as a hole.  Slot
+   * array is compacted if the slot deleted is at the end of the slot array and
    * <allow_slot_compaction> is set.
    *
    * @param record_id             ID of the record to delete.
@@ -251,6 +355,13 @@ class Page {
   void deleteRecord(const RecordId& record_id,
                     const bool allow_slot_compaction);
 
+  /**
+   * Moves the records to the end of the data area, merging the holes between
+   * them into the free space between the bounds.  Does nothing if there are
+   * no holes.
+   */
+  void compact();
+
   /**
    * Returns the slot with the given number.  This method will return
    * unallocated slots if requested; it is up to the caller to ensure they
@@ -272,8 +383,23 @@ class Page {
   const PageSlot& getSlot(const SlotId slot_number) const;
 
   /**
-   * Returns the slot number of an available slot.  If no slots are available
-   * to be reused, allocates a new slot.  Updates available slot count in the
+   * Adds an unused slot to the head of the chain of unused slots.
+   *
+   * @param slot_number   Number of slot.
+   */
+  void linkFreeSlot(const SlotId slot_number);
+
+  /**
+   * Removes an unused slot from the chain of unused slots.
+   *
+   * @param slot_number   Number of slot.
+   */
+  void unlinkFreeSlot(const SlotId slot_number);
+
+  /**
+   * Returns the slot number of an available slot, taken from the chain of
+   * unused slots in constant time.  If no slots are available to be reused,
+   * allocates a new slot.  Updates available slot count in the
    * header metadata, but does not mark returned slot as used.  If a new slot is
    * allocated, updates the free space lower bound.
    *
@@ -301,7 +427,7 @@ class Page {
    * @throws  SlotInUseException  Thrown when given slot is in use.
    */
   void insertRecordInSlot(const SlotId slot_number,
-                          const std::string& record_data);
+                          const RecordView& record_data);
 
   /**
    * Throws an exception if the given record ID is not valid for this page
@@ -327,20 +453,49 @@ class Page {
 
   /**
    * Data stored on the page.  Includes bookkeeping information about slots as
-   * well as actual content.
+   * well as actual content.  Stored inline, so a page is one flat block of
+   * SIZE bytes with the same layout as on disk.
    */
+  char data_[DATA_SIZE];
 
-  std::string data_;
-
+  friend class BTreeIndex;
   friend class File;
+  friend class PageAppender;
   friend class PageIterator;
   friend class PageTest;
   friend class BufferTest;
 };
 
+static_assert(Page::SIZE >= 4096 && Page::SIZE <= 32768 &&
+                  (Page::SIZE & (Page::SIZE - 1)) == 0,
+              "Page size must be a power of two from 4 KB to 32 KB, so that "
+              "pages align for direct I/O and offsets in a page fit in 15 "
+              "bits.");
 static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0,
               "Page must have some space to hold data.");
+static_assert(sizeof(PageHeader) == 32,
+              "Page header must have no padding, as its checksum covers it.");
+static_assert(offsetof(PageHeader, lsn) == 0 &&
+                  offsetof(PageHeader, free_space_lower_bound) == 8 &&
+                  offsetof(PageHeader, free_space_upper_bound) == 10 &&
+                  offsetof(PageHeader, num_slots) == 12 &&
+                  offsetof(PageHeader, num_free_slots) == 14 &&
+                  offsetof(PageHeader, first_free_slot) == 16 &&
+                  offsetof(PageHeader, fragmented_bytes) == 18 &&
+                  offsetof(PageHeader, current_page_number) == 20 &&
+                  offsetof(PageHeader, next_page_number) == 24 &&
+                  offsetof(PageHeader, checksum) == 28,
+              "Page header fields must sit where the on-disk format puts "
+              "them.");
+static_assert(sizeof(PageSlot) == 4,
+              "Slots must pack into 4 bytes.");
+static_assert(Page::DATA_SIZE < PageSlot::USED,
+              "Offsets in a page must leave the slot's used bit free.");
+static_assert(sizeof(Page) == Page::SIZE,
+              "Page must be laid out exactly like a page on disk.");
+static_assert(std::is_trivially_copyable<Page>::value,
+              "Page must be copyable with memcpy.");
 
 }
@@ -0,0 +1,83 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "parallel_scan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+ParallelScan::ParallelScan(BufMgr* buf_mgr, File* file,
+                           const std::uint32_t threads,
+                           const std::size_t run_pages)
+    : buf_mgr_(buf_mgr), file_(file), threads_(threads),
+      run_pages_(run_pages == 0 ? 1 : run_pages) {
+  if (threads_ == 0) {
+    threads_ = std::thread::hardware_concurrency();
+  }
+  if (threads_ == 0) {
+    threads_ = 1;
+  }
+}
+
+void ParallelScan::run(
+    const std::function<void(std::uint32_t, const Page&)>& visit) {
+  const std::vector<PageId> pages = buf_mgr_->usedPages(file_);
+  std::atomic<std::size_t> next(0);
+  std::atomic<bool> failed(false);
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  const std::function<void(std::uint32_t)> work =
+      [&](const std::uint32_t worker) {
+        BufAccessStrategy strategy =
+            buf_mgr_->getAccessStrategy(ACCESS_SEQUENTIAL_SCAN);
+        try {
+          for (;;) {
+            const std::size_t begin = next.fetch_add(run_pages_);
+            if (begin >= pages.size()) {
+              return;
+            }
+            const std::size_t end = std::min(begin + run_pages_, pages.size());
+            for (std::size_t i = begin; i < end; ++i) {
+              if (failed.load(std::memory_order_relaxed)) {
+                return;
+              }
+              PageGuard page = buf_mgr_->readPage(file_, pages[i], &strategy);
+              visit(worker, *page);
+            }
+          }
+        } catch (...) {
+          std::lock_guard<std::mutex> guard(error_mutex);
+          if (!error) {
+            error = std::current_exception();
+          }
+          failed = true;
+        }
+      };
+
+  std::vector<std::thread> workers;
+  for (std::uint32_t worker = 1; worker < threads_; ++worker) {
+    workers.push_back(std::thread(work, worker));
+  }
+  work(0);
+  for (std::size_t i = 0; i < workers.size(); ++i) {
+    workers[i].join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+}
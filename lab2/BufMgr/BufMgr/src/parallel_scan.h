@@ -0,0 +1,85 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class BufMgr;
+class File;
+
+/**
+ * @brief Scan of every used page of a file by several threads at once.
+ *
+ * The used pages are listed from the file's allocation bitmap rather than by
+ * following the chain of next page pointers, so free pages are skipped without
+ * being read and the list can be split up front.  Workers then take runs of
+ * consecutive pages from the list until it is used up, reading each page
+ * through the BufMgr with a ring of their own, so a scan does not push the
+ * rest of the pool out.
+ */
+class ParallelScan {
+ public:
+  /**
+   * Sets up a scan of <file>.
+   *
+   * @param buf_mgr       Buffer manager the pages are read through.
+   * @param file          File to scan.
+   * @param threads       Number of threads scanning, including the caller of
+   *                      run(); 0 uses one per core.
+   * @param run_pages     Number of consecutive pages a worker takes at a time.
+   */
+  ParallelScan(BufMgr* buf_mgr, File* file, const std::uint32_t threads = 0,
+               const std::size_t run_pages = 32);
+
+  /**
+   * Calls <visit> with the number of the worker, from 0, and each used page
+   * of the file, pinned.  Pages are visited once each, in no particular order
+   * and from several threads at once.
+   *
+   * If a read or <visit> throws, the other workers stop after their current
+   * page and the first exception is rethrown once they have.
+   *
+   * @param visit   Function called for each page.
+   */
+  void run(const std::function<void(std::uint32_t, const Page&)>& visit);
+
+  /**
+   * Returns the number of threads the scan runs on.
+   */
+  std::uint32_t threads() const { return threads_; }
+
+ private:
+  /**
+   * Buffer manager the pages are read through.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * File scanned.
+   */
+  File* file_;
+
+  /**
+   * Number of threads scanning.
+   */
+  std::uint32_t threads_;
+
+  /**
+   * Number of consecutive pages a worker takes at a time.
+   */
+  std::size_t run_pages_;
+};
+
+}
@@ -0,0 +1,49 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "record_batch.h"
+
+#include <cstring>
+
+namespace badgerdb {
+
+const std::size_t RecordBatch::CAPACITY;
+
+std::size_t filterByPrefix(const RecordBatch& batch, const RecordView& prefix,
+                           std::uint16_t* selected) {
+  const std::size_t width = prefix.size();
+  std::size_t n = 0;
+  if (width > sizeof(std::uint64_t)) {
+    for (std::size_t i = 0; i < batch.count; ++i) {
+      selected[n] = static_cast<std::uint16_t>(i);
+      n += batch.lengths[i] >= width &&
+           std::memcmp(batch.data + batch.offsets[i], prefix.data(), width) == 0;
+    }
+    return n;
+  }
+
+  std::uint64_t key = 0;
+  std::memcpy(&key, prefix.data(), width);
+  // Keep the first <width> bytes of a word as laid out in memory.
+  std::uint64_t mask = 0;
+  std::memset(&mask, 0xff, width);
+  for (std::size_t i = 0; i < batch.count; ++i) {
+    const std::size_t offset = batch.offsets[i];
+    std::uint64_t word = 0;
+    if (offset + sizeof(word) <= Page::DATA_SIZE) {
+      std::memcpy(&word, batch.data + offset, sizeof(word));
+    } else {
+      // A record at the very end of the page; don't read past it.
+      std::memcpy(&word, batch.data + offset, Page::DATA_SIZE - offset);
+    }
+    selected[n] = static_cast<std::uint16_t>(i);
+    n += (batch.lengths[i] >= width) & ((word & mask) == key);
+  }
+  return n;
+}
+
+}
@@ -0,0 +1,86 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "page.h"
+#include "record_view.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Position of every record of a page, gathered in one pass over its
+ *        slot directory by Page::scanRecords.
+ *
+ * The offsets, lengths and slot numbers are kept in separate arrays, so that
+ * operators can work on the records of a page as one batch of columns.  The
+ * offsets are relative to <data>, which points into the page: a batch is only
+ * valid while the page stays pinned and unchanged.
+ */
+struct RecordBatch {
+  /**
+   * Most records a page can hold, one per slot.
+   */
+  static const std::size_t CAPACITY = Page::DATA_SIZE / sizeof(PageSlot);
+
+  /**
+   * Number of the page scanned.
+   */
+  PageId page_number;
+
+  /**
+   * Number of records in the batch.
+   */
+  std::size_t count;
+
+  /**
+   * Data area of the page scanned.
+   */
+  const char* data;
+
+  /**
+   * Offset in <data>, length and slot number of each record, in slot order.
+   */
+  std::uint16_t offsets[CAPACITY];
+  std::uint16_t lengths[CAPACITY];
+  SlotId slots[CAPACITY];
+
+  /**
+   * Returns a view of record <i> of the batch.
+   */
+  RecordView view(const std::size_t i) const {
+    return RecordView(data + offsets[i], lengths[i]);
+  }
+
+  /**
+   * Returns the ID of record <i> of the batch.
+   */
+  RecordId record_id(const std::size_t i) const {
+    const RecordId id = {page_number, slots[i]};
+    return id;
+  }
+};
+
+/**
+ * Selects the records of a batch that start with <prefix>.  Prefixes of up to
+ * 8 bytes are compared as one masked 64-bit word per record, without branches
+ * on the comparison, which compilers turn into vector code.
+ *
+ * @param batch     Records to filter.
+ * @param prefix    Bytes the selected records start with.
+ * @param selected  Receives the index in <batch> of every selected record, in
+ *                  order; must have room for <batch.count> entries.
+ * @return  Number of records selected.
+ */
+std::size_t filterByPrefix(const RecordBatch& batch, const RecordView& prefix,
+                           std::uint16_t* selected);
+
+}
@@ -0,0 +1,103 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace badgerdb {
+
+/**
+ * @brief Read-only view of the bytes of a record, without owning them.
+ *
+ * A view returned by a page points into the page itself and is only valid
+ * while the page stays pinned and the record is not changed, and may not be
+ * passed back to the page to insert or update a record.  Views convert
+ * implicitly from strings, so functions taking a view also take strings
+ * without copying them.
+ */
+class RecordView {
+ public:
+  /**
+   * Constructs an empty view.
+   */
+  RecordView() : data_(""), size_(0) {}
+
+  /**
+   * Constructs a view of <size> bytes at <data>.
+   */
+  RecordView(const char* data, const std::size_t size)
+      : data_(data), size_(size) {}
+
+  /**
+   * Constructs a view of the bytes of a string.
+   */
+  RecordView(const std::string& bytes)
+      : data_(bytes.data()), size_(bytes.size()) {}
+
+  /**
+   * Constructs a view of a null-terminated string, without the terminator.
+   */
+  RecordView(const char* bytes) : data_(bytes), size_(std::strlen(bytes)) {}
+
+  const char* data() const { return data_; }
+  std::size_t size() const { return size_; }
+  std::size_t length() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+  char operator[](const std::size_t i) const { return data_[i]; }
+
+  /**
+   * Returns a copy of the bytes.
+   */
+  std::string str() const { return std::string(data_, size_); }
+
+  /**
+   * Compares the bytes with those of another view, like std::string does.
+   *
+   * @return  Negative, zero or positive as this view orders before, equal to
+   *          or after <rhs>.
+   */
+  int compare(const RecordView& rhs) const {
+    const int prefix = std::memcmp(data_, rhs.data_,
+                                   size_ < rhs.size_ ? size_ : rhs.size_);
+    if (prefix != 0) {
+      return prefix;
+    }
+    return size_ < rhs.size_ ? -1 : (size_ > rhs.size_ ? 1 : 0);
+  }
+
+ private:
+  /**
+   * First byte viewed.
+   */
+  const char* data_;
+
+  /**
+   * Number of bytes viewed.
+   */
+  std::size_t size_;
+};
+
+inline bool operator==(const RecordView& lhs, const RecordView& rhs) {
+  return lhs.size() == rhs.size() &&
+         std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+}
+
+inline bool operator!=(const RecordView& lhs, const RecordView& rhs) {
+  return !(lhs == rhs);
+}
+
+inline bool operator<(const RecordView& lhs, const RecordView& rhs) {
+  return lhs.compare(rhs) < 0;
+}
+
+}
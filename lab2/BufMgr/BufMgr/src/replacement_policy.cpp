@@ -0,0 +1,100 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "replacement_policy.h"
+
+#include "arc_policy.h"
+#include "clock_policy.h"
+#include "lru_k_policy.h"
+#include "two_q_policy.h"
+
+namespace badgerdb {
+
+ReplacementPolicy* ReplacementPolicy::create(const ReplacementPolicyType type,
+                                             std::atomic<std::uint32_t>* bufStateTable,
+                                             const std::uint32_t numBufs,
+                                             const std::uint32_t lruK) {
+  switch (type) {
+    case POLICY_LRU_K:
+      return new LruKPolicy(numBufs, lruK);
+    case POLICY_2Q:
+      return new TwoQPolicy(numBufs);
+    case POLICY_ARC:
+      return new ArcPolicy(numBufs);
+    case POLICY_CLOCK:
+    default:
+      return new ClockPolicy(bufStateTable, numBufs);
+  }
+}
+
+const std::uint8_t FrameLists::NONE;
+
+FrameLists::FrameLists(const std::uint32_t numFrames,
+                       const std::uint8_t numLists)
+    : numFrames_(numFrames),
+      prev_(numFrames + numLists),
+      next_(numFrames + numLists),
+      list_(numFrames, NONE),
+      sizes_(numLists, 0) {
+  for (std::uint8_t list = 0; list < numLists; ++list) {
+    prev_[head(list)] = head(list);
+    next_[head(list)] = head(list);
+  }
+}
+
+void FrameLists::pushFront(const std::uint8_t list, const FrameId frame) {
+  const FrameId sentinel = head(list);
+  const FrameId first = next_[sentinel];
+  next_[frame] = first;
+  prev_[frame] = sentinel;
+  prev_[first] = frame;
+  next_[sentinel] = frame;
+  list_[frame] = list;
+  ++sizes_[list];
+}
+
+void FrameLists::remove(const FrameId frame) {
+  if (list_[frame] == NONE) {
+    return;
+  }
+  next_[prev_[frame]] = next_[frame];
+  prev_[next_[frame]] = prev_[frame];
+  --sizes_[list_[frame]];
+  list_[frame] = NONE;
+}
+
+void GhostList::pushFront(const PageKey& key, const std::size_t capacity) {
+  if (capacity == 0) {
+    return;
+  }
+  remove(key);
+  while (index_.size() >= capacity) {
+    popBack();
+  }
+  order_.push_front(key);
+  index_[key] = order_.begin();
+}
+
+bool GhostList::remove(const PageKey& key) {
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return false;
+  }
+  order_.erase(it->second);
+  index_.erase(it);
+  return true;
+}
+
+void GhostList::popBack() {
+  if (order_.empty()) {
+    return;
+  }
+  index_.erase(order_.back());
+  order_.pop_back();
+}
+
+}
@@ -0,0 +1,322 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "bufHashTbl.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Replacement policies that can be chosen when constructing a BufMgr.
+ */
+enum ReplacementPolicyType {
+  /**
+   * Single clock sweep with one reference bit per frame.
+   */
+  POLICY_CLOCK,
+
+  /**
+   * LRU-K: evicts the page whose K-th most recent access is the oldest.
+   */
+  POLICY_LRU_K,
+
+  /**
+   * 2Q: new pages go through a FIFO before being promoted to an LRU queue.
+   */
+  POLICY_2Q,
+
+  /**
+   * ARC: adaptive balance between recency and frequency lists.
+   */
+  POLICY_ARC
+};
+
+/**
+ * @brief Identifies a page of a file, used by policies that remember pages
+ *        after they have been evicted.
+ */
+struct PageKey {
+  /**
+   * Id of the file the page belongs to, which stays valid to compare after
+   * the File object is gone.
+   */
+  FileId file;
+
+  /**
+   * Number of the page within the file.
+   */
+  PageId pageNo;
+
+  /**
+   * Returns true if this key refers to the same page as the given key.
+   */
+  bool operator==(const PageKey& rhs) const {
+    return file == rhs.file && pageNo == rhs.pageNo;
+  }
+};
+
+/**
+ * @brief Hash functor for PageKey.
+ */
+struct PageKeyHash {
+  std::size_t operator()(const PageKey& key) const {
+    return static_cast<std::size_t>(BufHashTbl::hash(key.file, key.pageNo));
+  }
+};
+
+/**
+ * @brief Callback through which a policy asks the buffer manager to take over
+ *        a frame.
+ */
+class FrameClaimer {
+ public:
+  /**
+   * Tries to make the given frame available for a new page, writing back and
+   * unmapping its current page if necessary.
+   *
+   * @param frame   Candidate frame.
+   * @return  True if the frame was claimed; false if it is pinned or busy.
+   */
+  virtual bool claim(const FrameId frame) = 0;
+
+ protected:
+  ~FrameClaimer() {}
+};
+
+/**
+ * @brief Interface of the policy that picks which frame allocBuf reuses.
+ *
+ * The buffer manager reports every hit, load and removal of a page, and asks
+ * the policy for a victim when it needs a frame.  Implementations other than
+ * clock keep shared queues and serialize these calls on an internal mutex.
+ */
+class ReplacementPolicy {
+ public:
+  /**
+   * Creates a policy of the given type for a pool of up to <numBufs> frames,
+   * all in use until resize() is called.
+   *
+   * @param type          Policy to create.
+   * @param bufStateTable State words of the frames of the buffer pool.
+   * @param numBufs       Number of frames in the buffer pool.
+   * @param lruK          K used by LRU-K.
+   * @return  Newly allocated policy, owned by the caller.
+   */
+  static ReplacementPolicy* create(const ReplacementPolicyType type,
+                                   std::atomic<std::uint32_t>* bufStateTable,
+                                   const std::uint32_t numBufs,
+                                   const std::uint32_t lruK);
+
+  virtual ~ReplacementPolicy() {}
+
+  /**
+   * Returns a short name of the policy, used in BufStats.
+   */
+  virtual const char* name() const = 0;
+
+  /**
+   * Called on every buffer hit on a pinned frame.
+   *
+   * @param frame   Frame that was accessed.
+   */
+  virtual void recordAccess(const FrameId frame) = 0;
+
+  /**
+   * Called after a page has been placed in a pinned frame, either read from
+   * disk or newly allocated.
+   *
+   * @param frame   Frame holding the page.
+   * @param file    File the page belongs to.
+   * @param pageNo  Number of the page.
+   */
+  virtual void recordLoad(const FrameId frame, const File* file,
+                          const PageId pageNo) = 0;
+
+  /**
+   * Called when a frame becomes empty without being chosen by selectVictim,
+   * e.g. by flushFile, disposePage or a failed read.  Must tolerate frames the
+   * policy already considers empty.
+   *
+   * @param frame   Frame that is now empty.
+   */
+  virtual void recordRemove(const FrameId frame) = 0;
+
+  /**
+   * Called when the buffer pool is resized to its first <numBufs> frames, up
+   * to the number the policy was created for.  Frames from <numBufs> on are
+   * empty and must not be offered any more; frames newly below it are empty
+   * and may be.
+   *
+   * @param numBufs Number of frames in use.
+   */
+  virtual void resize(const std::uint32_t numBufs) = 0;
+
+  /**
+   * Offers frames to <claimer> in eviction order until one is claimed.
+   *
+   * @param file    File of the page a frame is needed for.
+   * @param pageNo  Number of the page a frame is needed for.
+   * @param claimer Callback that claims a frame.
+   * @param frame   Returns the claimed frame.
+   * @return  False if no frame could be claimed.
+   */
+  virtual bool selectVictim(const File* file, const PageId pageNo,
+                            FrameClaimer& claimer, FrameId& frame) = 0;
+
+  /**
+   * Lists up to <count> frames in the order selectVictim is
+   * likely to offer them next, without changing any state.  Used by the
+   * background writer to clean frames before they are needed.
+   *
+   * @param count   Maximum number of frames to list.
+   * @param frames  Cleared and filled with the frames.
+   */
+  virtual void nextVictims(const std::uint32_t count,
+                           std::vector<FrameId>& frames) = 0;
+};
+
+/**
+ * @brief A set of intrusive doubly-linked lists of frames.  Every frame is in
+ *        at most one list at a time and no operation allocates.
+ */
+class FrameLists {
+ public:
+  /**
+   * List number of frames that are in no list.
+   */
+  static const std::uint8_t NONE = 0xff;
+
+  /**
+   * Constructs <numLists> empty lists over <numFrames> frames.
+   */
+  FrameLists(const std::uint32_t numFrames, const std::uint8_t numLists);
+
+  /**
+   * Inserts a frame that is in no list at the front (most recent end) of the list.
+   */
+  void pushFront(const std::uint8_t list, const FrameId frame);
+
+  /**
+   * Unlinks the frame from whatever list it is in.
+   */
+  void remove(const FrameId frame);
+
+  /**
+   * Returns the frame at the back (least recent end) of the list, or end().
+   */
+  FrameId back(const std::uint8_t list) const {
+    return prev_[head(list)] < numFrames_ ? prev_[head(list)] : end();
+  }
+
+  /**
+   * Returns the frame before <frame>, walking from back to front, or end().
+   */
+  FrameId towardsFront(const FrameId frame) const {
+    return prev_[frame] < numFrames_ ? prev_[frame] : end();
+  }
+
+  /**
+   * Value returned when there is no such frame.
+   */
+  FrameId end() const { return numFrames_; }
+
+  /**
+   * Returns the list the frame is in, or NONE.
+   */
+  std::uint8_t listOf(const FrameId frame) const { return list_[frame]; }
+
+  /**
+   * Returns the number of frames in the list.
+   */
+  std::uint32_t size(const std::uint8_t list) const { return sizes_[list]; }
+
+ private:
+  /**
+   * Returns the sentinel node of the list.
+   */
+  FrameId head(const std::uint8_t list) const { return numFrames_ + list; }
+
+  /**
+   * Number of frames; nodes numFrames_ and up are the list sentinels.
+   */
+  std::uint32_t numFrames_;
+
+  /**
+   * Link towards the back of the list, per node.
+   */
+  std::vector<FrameId> prev_;
+
+  /**
+   * Link towards the front of the list, per node.
+   */
+  std::vector<FrameId> next_;
+
+  /**
+   * List each frame is in.
+   */
+  std::vector<std::uint8_t> list_;
+
+  /**
+   * Number of frames in each list.
+   */
+  std::vector<std::uint32_t> sizes_;
+};
+
+/**
+ * @brief Bounded FIFO of pages that are no longer resident, with O(1)
+ *        membership tests.
+ */
+class GhostList {
+ public:
+  /**
+   * Adds a page at the front, dropping the oldest page if the list is full.
+   */
+  void pushFront(const PageKey& key, const std::size_t capacity);
+
+  /**
+   * Removes the page if present and returns whether it was present.
+   */
+  bool remove(const PageKey& key);
+
+  /**
+   * Drops the oldest page.
+   */
+  void popBack();
+
+  /**
+   * Returns true if the page is in the list.
+   */
+  bool contains(const PageKey& key) const { return index_.count(key) != 0; }
+
+  /**
+   * Returns the number of pages in the list.
+   */
+  std::size_t size() const { return index_.size(); }
+
+ private:
+  typedef std::list<PageKey> KeyList;
+
+  /**
+   * Pages from newest (front) to oldest (back).
+   */
+  KeyList order_;
+
+  /**
+   * Position of every page in order_.
+   */
+  std::unordered_map<PageKey, KeyList::iterator, PageKeyHash> index_;
+};
+
+}
@@ -0,0 +1,29 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "secondary_cache.h"
+
+#include "compressed_cache.h"
+#include "flash_cache.h"
+
+namespace badgerdb {
+
+SecondaryCache* SecondaryCache::create(const SecondaryCacheType type,
+                                       const std::size_t capacity,
+                                       const std::string& path) {
+  switch (type) {
+    case SECONDARY_CACHE_COMPRESSED:
+      return new CompressedCache(capacity);
+    case SECONDARY_CACHE_FLASH:
+      return new FlashCache(path, capacity);
+    case SECONDARY_CACHE_NONE:
+    default:
+      return NULL;
+  }
+}
+
+}
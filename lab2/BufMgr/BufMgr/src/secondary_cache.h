@@ -0,0 +1,112 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "types.h"
+
+namespace badgerdb {
+
+class File;
+class Page;
+
+/**
+ * @brief Second-tier caches that can be chosen when constructing a BufMgr.
+ */
+enum SecondaryCacheType {
+  /**
+   * No second tier: evicted pages are dropped.
+   */
+  SECONDARY_CACHE_NONE,
+
+  /**
+   * Evicted pages kept in memory, compressed.
+   */
+  SECONDARY_CACHE_COMPRESSED,
+
+  /**
+   * Evicted pages kept in a file on a fast local device.
+   */
+  SECONDARY_CACHE_FLASH
+};
+
+/**
+ * @brief Interface of a cache of pages evicted from the buffer pool, checked
+ *        on a miss before the page is read from its file.
+ *
+ * The cache is exclusive: a page handed back by take() leaves the cache, and
+ * the buffer pool only puts pages it drops.  Pages put are clean, as dirty
+ * pages are written back before they are evicted, so the cache never holds
+ * the only copy of a change and may forget any page at any time.  Calls for
+ * different pages may be made by several threads at once; the buffer pool
+ * makes those for one page under the latch of its shard, so they never
+ * overlap.
+ */
+class SecondaryCache {
+ public:
+  /**
+   * Creates a cache of the given type holding up to <capacity> bytes.
+   *
+   * @param type      Cache to create.
+   * @param capacity  Bytes the cache may use, in memory or on disk.
+   * @param path      File the flash cache keeps pages in; it is created, and
+   *                  removed while open so it is gone once the cache is.
+   * @return  Newly allocated cache, owned by the caller, or NULL for
+   *          SECONDARY_CACHE_NONE.
+   * @throws  FileIOException  If the flash cache file cannot be created.
+   */
+  static SecondaryCache* create(const SecondaryCacheType type,
+                                const std::size_t capacity,
+                                const std::string& path);
+
+  virtual ~SecondaryCache() {}
+
+  /**
+   * Returns a short name of the cache.
+   */
+  virtual const char* name() const = 0;
+
+  /**
+   * Stores a copy of a page dropped from the buffer pool, replacing any copy
+   * already held, and evicting the least recently stored pages if the cache
+   * is full.
+   *
+   * @param file    File the page belongs to.
+   * @param page    Clean page.
+   */
+  virtual void put(const File* file, const Page& page) = 0;
+
+  /**
+   * Moves a page out of the cache.
+   *
+   * @param file    File the page belongs to.
+   * @param pageNo  Number of the page.
+   * @param page    Receives the page if it is held.
+   * @return  False if the cache does not hold the page.
+   */
+  virtual bool take(const File* file, const PageId pageNo, Page& page) = 0;
+
+  /**
+   * Forgets a page, e.g. one deleted from its file.
+   */
+  virtual void remove(const File* file, const PageId pageNo) = 0;
+
+  /**
+   * Forgets every page of a file, e.g. before it is closed.
+   */
+  virtual void removeFile(const File* file) = 0;
+
+  /**
+   * Returns the number of pages held.
+   */
+  virtual std::size_t size() const = 0;
+};
+
+}
@@ -0,0 +1,79 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "thread_io_engine.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+namespace badgerdb {
+
+ThreadIoEngine::ThreadIoEngine(const std::uint32_t depth,
+                               const std::uint32_t threads)
+    : depth_(depth == 0 ? 1 : depth), stop_(false) {
+  for (std::uint32_t i = 0; i < (threads == 0 ? 1 : threads); ++i) {
+    workers_.push_back(std::thread(&ThreadIoEngine::work, this));
+  }
+}
+
+ThreadIoEngine::~ThreadIoEngine() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    stop_ = true;
+  }
+  queued_.notify_all();
+  for (std::size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i].join();
+  }
+}
+
+void ThreadIoEngine::submit(IoRequest& request) {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    pending_.push_back(&request);
+  }
+  queued_.notify_one();
+}
+
+IoRequest& ThreadIoEngine::wait() {
+  std::unique_lock<std::mutex> guard(mutex_);
+  while (done_.empty()) {
+    completed_.wait(guard);
+  }
+  IoRequest* request = done_.front();
+  done_.pop_front();
+  return *request;
+}
+
+void ThreadIoEngine::work() {
+  std::unique_lock<std::mutex> guard(mutex_);
+  for (;;) {
+    while (!stop_ && pending_.empty()) {
+      queued_.wait(guard);
+    }
+    if (stop_) {
+      return;
+    }
+    IoRequest* request = pending_.front();
+    pending_.pop_front();
+    guard.unlock();
+
+    ssize_t n;
+    do {
+      n = request->write
+              ? pwritev(request->fd, &request->iov, 1, request->offset)
+              : preadv(request->fd, &request->iov, 1, request->offset);
+    } while (n < 0 && errno == EINTR);
+    request->result = n < 0 ? -errno : n;
+
+    guard.lock();
+    done_.push_back(request);
+    completed_.notify_one();
+  }
+}
+
+}
@@ -0,0 +1,88 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "io_engine.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Engine that hands requests to a pool of threads issuing blocking
+ *        preadv and pwritev calls, for kernels without io_uring.
+ */
+class ThreadIoEngine : public IoEngine {
+ public:
+  /**
+   * Starts <threads> worker threads for up to <depth> requests in flight.
+   */
+  ThreadIoEngine(const std::uint32_t depth, const std::uint32_t threads);
+
+  /**
+   * Stops the worker threads.
+   */
+  ~ThreadIoEngine();
+
+  const char* name() const { return "threads"; }
+  std::uint32_t depth() const { return depth_; }
+  void submit(IoRequest& request);
+  IoRequest& wait();
+
+ private:
+  /**
+   * Body of a worker thread.
+   */
+  void work();
+
+  /**
+   * Maximum number of requests in flight.
+   */
+  std::uint32_t depth_;
+
+  /**
+   * Protects the queues and <stop_>.
+   */
+  std::mutex mutex_;
+
+  /**
+   * Signalled when a request is queued or the engine stops.
+   */
+  std::condition_variable queued_;
+
+  /**
+   * Signalled when a request completes.
+   */
+  std::condition_variable completed_;
+
+  /**
+   * Requests not yet picked up by a worker.
+   */
+  std::deque<IoRequest*> pending_;
+
+  /**
+   * Requests completed but not yet returned by wait().
+   */
+  std::deque<IoRequest*> done_;
+
+  /**
+   * Set to make the workers exit.
+   */
+  bool stop_;
+
+  /**
+   * The worker threads.
+   */
+  std::vector<std::thread> workers_;
+};
+
+}
@@ -0,0 +1,277 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "exceptions/file_io_exception.h"
+#include "file.h"
+
+namespace badgerdb {
+
+const std::uint8_t TraceRecord::HIT;
+const std::uint8_t TraceRecord::DIRTY;
+const std::uint32_t TraceRecorder::FORMAT_VERSION;
+const std::uint16_t TraceRecorder::NO_FILE;
+
+namespace {
+
+const char MAGIC[8] = {'B', 'D', 'B', 'T', 'R', 'A', 'C', 'E'};
+
+std::atomic<std::uint64_t> recorders(0);
+
+// Ring of the calling thread in the recorder it last recorded to.
+thread_local std::uint64_t cached_recorder = 0;
+thread_local void* cached_ring = NULL;
+
+std::size_t powerOfTwo(const std::size_t n) {
+  std::size_t power = 1;
+  while (power < n) {
+    power <<= 1;
+  }
+  return power;
+}
+
+}
+
+TraceRecorder::TraceRecorder(const std::string& path,
+                             const std::size_t ring_records,
+                             const std::uint32_t flush_ms)
+    : id_(++recorders), ring_records_(powerOfTwo(std::max<std::size_t>(ring_records, 2))),
+      start_(std::chrono::steady_clock::now()), next_file_id_(0),
+      generation_(0), path_(path), written_(0), stop_(false),
+      flush_ms_(flush_ms == 0 ? 1 : flush_ms) {
+  out_.open(path_.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out_) {
+    throw FileIOException(path_, "open", errno);
+  }
+  char header[16];
+  std::memcpy(header, MAGIC, sizeof(MAGIC));
+  const std::uint32_t version = FORMAT_VERSION;
+  const std::uint32_t record_size = sizeof(TraceRecord);
+  std::memcpy(header + 8, &version, 4);
+  std::memcpy(header + 12, &record_size, 4);
+  write(header, sizeof(header));
+  writer_ = std::thread(&TraceRecorder::writerLoop, this);
+}
+
+TraceRecorder::~TraceRecorder() {
+  {
+    std::lock_guard<std::mutex> guard(writer_mutex_);
+    stop_ = true;
+  }
+  writer_wake_.notify_one();
+  writer_.join();
+  try {
+    flush();
+  } catch (...) {
+    // the trace ends early; replay stops at its last whole record.
+  }
+}
+
+void TraceRecorder::record(const TraceOp op, const File* file,
+                           const PageId page_number, const std::uint8_t flags) {
+  Ring& r = ring();
+  TraceRecord record;
+  record.nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start_).count();
+  record.page_number = page_number;
+  record.file_id = fileId(r, file);
+  record.op = op;
+  record.flags = flags;
+
+  // Only this thread writes <head>, and only the writer thread <tail>.
+  const std::uint64_t head = r.head.load(std::memory_order_relaxed);
+  if (head - r.tail.load(std::memory_order_acquire) == ring_records_) {
+    r.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  r.records[head & (ring_records_ - 1)] = record;
+  r.head.store(head + 1, std::memory_order_release);
+}
+
+void TraceRecorder::forgetFile(const File* file) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (file_ids_.erase(file) != 0) {
+    generation_.fetch_add(1, std::memory_order_release);
+  }
+}
+
+void TraceRecorder::flush() {
+  std::vector<Ring*> rings;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (std::size_t i = 0; i < rings_.size(); ++i) {
+      rings.push_back(rings_[i].get());
+    }
+  }
+  std::lock_guard<std::mutex> guard(write_mutex_);
+  std::vector<TraceRecord> records;
+  for (std::size_t i = 0; i < rings.size(); ++i) {
+    Ring& r = *rings[i];
+    const std::uint64_t tail = r.tail.load(std::memory_order_relaxed);
+    const std::uint64_t head = r.head.load(std::memory_order_acquire);
+    for (std::uint64_t k = tail; k != head; ++k) {
+      records.push_back(r.records[k & (ring_records_ - 1)]);
+    }
+    r.tail.store(head, std::memory_order_release);
+  }
+  std::stable_sort(records.begin(), records.end(),
+                   [](const TraceRecord& lhs, const TraceRecord& rhs) {
+                     return lhs.nanos < rhs.nanos;
+                   });
+  if (!records.empty()) {
+    write(&records[0], records.size() * sizeof(TraceRecord));
+  }
+  written_ += records.size();
+  out_.flush();
+  if (!out_) {
+    throw FileIOException(path_, "write", errno);
+  }
+}
+
+std::uint64_t TraceRecorder::recorded() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  std::uint64_t total = 0;
+  for (std::size_t i = 0; i < rings_.size(); ++i) {
+    total += rings_[i]->head.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+std::uint64_t TraceRecorder::dropped() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  std::uint64_t total = 0;
+  for (std::size_t i = 0; i < rings_.size(); ++i) {
+    total += rings_[i]->dropped.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+TraceRecorder::Ring& TraceRecorder::ring() {
+  if (cached_recorder == id_) {
+    return *static_cast<Ring*>(cached_ring);
+  }
+  std::lock_guard<std::mutex> guard(mutex_);
+  Ring*& ring = threads_[std::this_thread::get_id()];
+  if (ring == NULL) {
+    rings_.push_back(std::unique_ptr<Ring>(new Ring(ring_records_)));
+    ring = rings_.back().get();
+  }
+  cached_recorder = id_;
+  cached_ring = ring;
+  return *ring;
+}
+
+std::uint16_t TraceRecorder::fileId(Ring& ring, const File* file) {
+  const std::uint64_t generation = generation_.load(std::memory_order_acquire);
+  if (ring.generation != generation) {
+    ring.file_ids.clear();
+    ring.generation = generation;
+  }
+  std::unordered_map<const File*, std::uint16_t>::const_iterator cached =
+      ring.file_ids.find(file);
+  if (cached != ring.file_ids.end()) {
+    return cached->second;
+  }
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  std::unordered_map<const File*, std::uint16_t>::iterator it =
+      file_ids_.find(file);
+  std::uint16_t id = NO_FILE;
+  if (it != file_ids_.end()) {
+    id = it->second;
+  } else if (next_file_id_ < NO_FILE) {
+    id = next_file_id_++;
+    file_ids_[file] = id;
+    // Written before any record using the id can be drained.
+    const std::string& name = file->filename();
+    TraceRecord intro;
+    std::memset(&intro, 0, sizeof(intro));
+    intro.page_number = name.size();
+    intro.file_id = id;
+    intro.op = TRACE_FILE;
+    std::string padded = name;
+    padded.resize((name.size() + sizeof(TraceRecord) - 1) / sizeof(TraceRecord) *
+                  sizeof(TraceRecord), '\0');
+    std::lock_guard<std::mutex> io(write_mutex_);
+    write(&intro, sizeof(intro));
+    write(padded.data(), padded.size());
+  }
+  ring.file_ids[file] = id;
+  return id;
+}
+
+void TraceRecorder::write(const void* data, const std::size_t length) {
+  out_.write(static_cast<const char*>(data), length);
+}
+
+void TraceRecorder::writerLoop() {
+  std::unique_lock<std::mutex> guard(writer_mutex_);
+  while (!stop_) {
+    writer_wake_.wait_for(guard, std::chrono::milliseconds(flush_ms_));
+    if (stop_) {
+      break;
+    }
+    guard.unlock();
+    try {
+      flush();
+    } catch (...) {
+      // keep buffering; the destructor makes a last attempt.
+    }
+    guard.lock();
+  }
+}
+
+TraceReader::TraceReader(const std::string& path)
+    : path_(path), in_(path.c_str(), std::ios::binary) {
+  if (!in_) {
+    throw FileIOException(path_, "open", errno);
+  }
+  char header[16];
+  std::uint32_t version = 0;
+  std::uint32_t record_size = 0;
+  in_.read(header, sizeof(header));
+  std::memcpy(&version, header + 8, 4);
+  std::memcpy(&record_size, header + 12, 4);
+  if (!in_ || std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0 ||
+      version != TraceRecorder::FORMAT_VERSION ||
+      record_size != sizeof(TraceRecord)) {
+    throw FileIOException(path_, "read", EINVAL);
+  }
+}
+
+bool TraceReader::next(TraceRecord& record) {
+  while (in_.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+    if (record.op != TRACE_FILE) {
+      return true;
+    }
+    const std::size_t padded =
+        (record.page_number + sizeof(TraceRecord) - 1) / sizeof(TraceRecord) *
+        sizeof(TraceRecord);
+    std::string name(padded, '\0');
+    if (padded != 0 && !in_.read(&name[0], padded)) {
+      return false;
+    }
+    name.resize(record.page_number);
+    if (filenames_.size() <= record.file_id) {
+      filenames_.resize(record.file_id + 1);
+    }
+    filenames_[record.file_id] = name;
+  }
+  return false;
+}
+
+const std::string& TraceReader::filename(const std::uint16_t file_id) const {
+  static const std::string none;
+  return file_id < filenames_.size() ? filenames_[file_id] : none;
+}
+
+}
@@ -0,0 +1,318 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+// Tracing hooks are compiled into BufMgr unless this is set to 0 (make
+// TRACE=0).  Compiled in, a hook costs one load and branch while no recorder
+// is attached.
+#ifndef BADGERDB_TRACE
+#define BADGERDB_TRACE 1
+#endif
+
+namespace badgerdb {
+
+class File;
+
+/**
+ * @brief Buffer pool operations a trace records.
+ */
+enum TraceOp {
+  /**
+   * readPage; TraceRecord::HIT is set if the page was resident.
+   */
+  TRACE_READ = 1,
+
+  /**
+   * unPinPage; TraceRecord::DIRTY is set if the caller modified the page.
+   */
+  TRACE_UNPIN = 2,
+
+  /**
+   * allocPage of a new page, which is left pinned.
+   */
+  TRACE_ALLOC = 3,
+
+  /**
+   * disposePage.
+   */
+  TRACE_DISPOSE = 4,
+
+  /**
+   * Eviction of a resident page to free its frame; TraceRecord::DIRTY is set
+   * if it had to be written back first.
+   */
+  TRACE_EVICT = 5,
+
+  /**
+   * Introduces a file id: the record is followed by the file's name, of
+   * page_number bytes, padded with zeroes to a whole number of records.
+   */
+  TRACE_FILE = 6
+};
+
+/**
+ * @brief One operation in a trace, as stored in the trace file.
+ */
+struct TraceRecord {
+  /**
+   * Flags of TRACE_READ and TRACE_UNPIN / TRACE_EVICT.
+   */
+  static const std::uint8_t HIT = 1;
+  static const std::uint8_t DIRTY = 2;
+
+  /**
+   * Nanoseconds since the recorder was created.
+   */
+  std::uint64_t nanos;
+
+  /**
+   * Page operated on.
+   */
+  std::uint32_t page_number;
+
+  /**
+   * Id of the file of the page, introduced by an earlier TRACE_FILE record.
+   */
+  std::uint16_t file_id;
+
+  /**
+   * A TraceOp.
+   */
+  std::uint8_t op;
+
+  /**
+   * HIT or DIRTY, depending on <op>.
+   */
+  std::uint8_t flags;
+};
+
+static_assert(sizeof(TraceRecord) == 16, "trace records are 16 bytes");
+
+/**
+ * @brief Writes the operations of buffer pools to a binary trace file, for
+ *        replay against other pool sizes and policies with TraceReplayer.
+ *
+ * Every thread that records gets a ring buffer of its own, which only it
+ * writes and only the writer thread of the recorder reads, so recording takes
+ * no lock and threads recording at once never contend.  If a ring is full the
+ * record is dropped and counted rather than making the caller wait.  The
+ * writer thread drains the rings every flush interval and writes the records
+ * of a round sorted by time; the trace is in order within each thread, and
+ * across threads to within one interval.
+ *
+ * The trace file starts with a 16-byte header, "BDBTRACE" and two 32-bit
+ * numbers, the trace format version and the record size, followed by the
+ * records, all in host byte order.  Files are known by 16-bit ids, assigned
+ * on first sight and introduced by TRACE_FILE records; operations on pages of
+ * files past the 65535th are recorded with id NO_FILE.
+ */
+class TraceRecorder {
+ public:
+  /**
+   * Version of the trace format written.
+   */
+  static const std::uint32_t FORMAT_VERSION = 1;
+
+  /**
+   * Id of files that got none.
+   */
+  static const std::uint16_t NO_FILE = 0xffff;
+
+  /**
+   * Creates the trace file <path> and starts the writer thread.
+   *
+   * @param path            Trace file, replaced if it exists.
+   * @param ring_records    Records per thread buffered between drains,
+   *                        rounded up to a power of two.
+   * @param flush_ms        Milliseconds between drains.
+   * @throws  FileIOException  If the file cannot be created.
+   */
+  TraceRecorder(const std::string& path, const std::size_t ring_records = 4096,
+                const std::uint32_t flush_ms = 10);
+
+  /**
+   * Stops the writer thread and writes every record still buffered.  No
+   * thread may be recording any more.
+   */
+  ~TraceRecorder();
+
+  TraceRecorder(const TraceRecorder&) = delete;
+  TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+  /**
+   * Records an operation on a page; lock-free, except on the first record of
+   * a thread and the first record of a file.
+   *
+   * @param op            Operation.
+   * @param file          File of the page.
+   * @param page_number   Page operated on.
+   * @param flags         TraceRecord::HIT or DIRTY, depending on <op>.
+   */
+  void record(const TraceOp op, const File* file, const PageId page_number,
+              const std::uint8_t flags);
+
+  /**
+   * Forgets the id of a file about to be closed, so that a file opened later
+   * at the same address gets an id of its own.
+   */
+  void forgetFile(const File* file);
+
+  /**
+   * Writes everything recorded so far to the trace file.
+   *
+   * @throws  FileIOException  If the trace cannot be written.
+   */
+  void flush();
+
+  /**
+   * Returns the number of operations recorded and dropped so far.
+   */
+  std::uint64_t recorded() const;
+  std::uint64_t dropped() const;
+
+ private:
+  /**
+   * Records of one thread, from the oldest not yet drained (<tail>) to the
+   * next to be written (<head>).
+   */
+  struct Ring {
+    explicit Ring(const std::size_t capacity) : records(capacity), head(0),
+        tail(0), dropped(0), generation(0) {}
+
+    std::vector<TraceRecord> records;
+    std::atomic<std::uint64_t> head;
+    std::atomic<std::uint64_t> tail;
+    std::atomic<std::uint64_t> dropped;
+
+    /**
+     * Ids of files this thread has seen, valid while <generation> matches
+     * that of the recorder; only used by the thread of the ring.
+     */
+    std::unordered_map<const File*, std::uint16_t> file_ids;
+    std::uint64_t generation;
+  };
+
+  /**
+   * Returns the ring of the calling thread, creating it on its first call.
+   */
+  Ring& ring();
+
+  /**
+   * Returns the id of a file, assigning one and writing its TRACE_FILE record
+   * on first sight.
+   */
+  std::uint16_t fileId(Ring& ring, const File* file);
+
+  /**
+   * Appends bytes to the trace file; the caller holds <write_mutex_>.
+   */
+  void write(const void* data, const std::size_t length);
+
+  /**
+   * Body of the writer thread.
+   */
+  void writerLoop();
+
+  /**
+   * Unique number of this recorder, so that a thread's cached ring is never
+   * taken for that of a later recorder at the same address.
+   */
+  const std::uint64_t id_;
+
+  /**
+   * Records per ring, a power of two.
+   */
+  const std::size_t ring_records_;
+
+  /**
+   * Time the trace starts at.
+   */
+  const std::chrono::steady_clock::time_point start_;
+
+  /**
+   * Protects <rings_>, <threads_>, <file_ids_> and <next_file_id_>.  Never
+   * taken while <write_mutex_> is held.
+   */
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Ring> > rings_;
+  std::unordered_map<std::thread::id, Ring*> threads_;
+  std::unordered_map<const File*, std::uint16_t> file_ids_;
+  std::uint32_t next_file_id_;
+
+  /**
+   * Bumped whenever a file id is forgotten, to empty the caches of the rings.
+   */
+  std::atomic<std::uint64_t> generation_;
+
+  /**
+   * Serializes writes to the trace file.
+   */
+  std::mutex write_mutex_;
+  std::string path_;
+  std::ofstream out_;
+  std::uint64_t written_;
+
+  /**
+   * Protects <stop_> and is waited on by the writer thread between drains.
+   */
+  std::mutex writer_mutex_;
+  std::condition_variable writer_wake_;
+  bool stop_;
+  std::uint32_t flush_ms_;
+  std::thread writer_;
+};
+
+/**
+ * @brief Reads the records of a trace written by a TraceRecorder.
+ */
+class TraceReader {
+ public:
+  /**
+   * Opens a trace and checks its header.
+   *
+   * @throws  FileIOException  If the file cannot be read or is not a trace of
+   *                           this format.
+   */
+  explicit TraceReader(const std::string& path);
+
+  /**
+   * Reads the next operation on a page, taking in the file names introduced
+   * on the way.
+   *
+   * @param record  Receives the operation.
+   * @return  False at the end of the trace.
+   */
+  bool next(TraceRecord& record);
+
+  /**
+   * Returns the name of the file with the given id, or an empty string if
+   * none was introduced yet.
+   */
+  const std::string& filename(const std::uint16_t file_id) const;
+
+ private:
+  std::string path_;
+  std::ifstream in_;
+  std::vector<std::string> filenames_;
+};
+
+}
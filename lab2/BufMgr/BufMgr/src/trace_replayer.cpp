@@ -0,0 +1,147 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "trace_replayer.h"
+
+#include <utility>
+
+#include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/page_not_pinned_exception.h"
+#include "file.h"
+#include "trace.h"
+
+namespace badgerdb {
+
+namespace {
+
+typedef std::pair<std::uint16_t, PageId> TracedPage;
+
+struct TracedPageHash {
+  std::size_t operator()(const TracedPage& page) const {
+    return (static_cast<std::size_t>(page.first) << 32) ^ page.second;
+  }
+};
+
+}
+
+TraceReplayer::TraceReplayer(const std::string& trace,
+                             const std::string& scratch_prefix)
+    : trace_(trace) {
+  TraceReader reader(trace_);
+  TraceRecord record;
+  while (reader.next(record)) {
+    if (record.file_id == TraceRecorder::NO_FILE) {
+      continue;
+    }
+    while (files_.size() <= record.file_id) {
+      const std::string name = scratch_prefix + "." + std::to_string(files_.size());
+      try {
+        File::remove(name);
+      } catch (const FileNotFoundException&) {
+      }
+      files_.push_back(std::unique_ptr<File>(new File(File::create(name))));
+      names_.push_back(name);
+      pages_.push_back(std::unordered_map<PageId, PageId>());
+    }
+    std::unordered_map<PageId, PageId>& pages = pages_[record.file_id];
+    if (pages.count(record.page_number) == 0) {
+      Page page;
+      files_[record.file_id]->allocatePage(page);
+      pages[record.page_number] = page.page_number();
+    }
+  }
+}
+
+TraceReplayer::~TraceReplayer() {
+  for (std::size_t i = 0; i < files_.size(); ++i) {
+    files_[i].reset();
+    try {
+      File::remove(names_[i]);
+    } catch (...) {
+    }
+  }
+}
+
+std::size_t TraceReplayer::numPages() const {
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < pages_.size(); ++i) {
+    total += pages_[i].size();
+  }
+  return total;
+}
+
+ReplayResult TraceReplayer::replay(BufMgr& pool) {
+  ReplayResult result;
+  result.operations = result.skipped = 0;
+  result.traced_reads = result.traced_hits = result.traced_evictions = 0;
+  // Pins the replay holds, per traced page.
+  std::unordered_map<TracedPage, std::uint32_t, TracedPageHash> pins;
+  pool.clearBufStats();
+
+  TraceReader reader(trace_);
+  TraceRecord record;
+  Page* page = NULL;
+  while (reader.next(record)) {
+    if (record.op == TRACE_READ) {
+      ++result.traced_reads;
+      if (record.flags & TraceRecord::HIT) {
+        ++result.traced_hits;
+      }
+    } else if (record.op == TRACE_EVICT) {
+      ++result.traced_evictions;
+      continue;
+    } else if (record.op == TRACE_DISPOSE) {
+      continue;
+    }
+    if (record.file_id >= files_.size()) {
+      ++result.skipped;
+      continue;
+    }
+    File* file = files_[record.file_id].get();
+    const PageId pageNo = pages_[record.file_id][record.page_number];
+    const TracedPage traced(record.file_id, record.page_number);
+    if (record.op == TRACE_READ || record.op == TRACE_ALLOC) {
+      try {
+        pool.readPage(file, pageNo, page);
+        ++pins[traced];
+        ++result.operations;
+      } catch (const BufferExceededException&) {
+        ++result.skipped;
+      }
+    } else if (record.op == TRACE_UNPIN) {
+      std::unordered_map<TracedPage, std::uint32_t, TracedPageHash>::iterator it =
+          pins.find(traced);
+      if (it == pins.end()) {
+        ++result.skipped;
+        continue;
+      }
+      pool.unPinPage(file, pageNo, (record.flags & TraceRecord::DIRTY) != 0);
+      if (--it->second == 0) {
+        pins.erase(it);
+      }
+      ++result.operations;
+    }
+  }
+
+  result.stats = pool.getStatsSnapshot();
+
+  for (std::unordered_map<TracedPage, std::uint32_t, TracedPageHash>::iterator it = pins.begin();
+       it != pins.end(); ++it) {
+    File* file = files_[it->first.first].get();
+    const PageId pageNo = pages_[it->first.first][it->first.second];
+    for (std::uint32_t i = 0; i < it->second; ++i) {
+      pool.unPinPage(file, pageNo, false);
+    }
+  }
+  for (std::size_t i = 0; i < files_.size(); ++i) {
+    pool.flushFile(files_[i].get());
+  }
+  return result;
+}
+
+}
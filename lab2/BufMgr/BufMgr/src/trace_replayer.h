@@ -0,0 +1,118 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Counts of a replay of a trace, beside the statistics of the pool it
+ *        drove.
+ */
+struct ReplayResult {
+  /**
+   * Operations on pages replayed.
+   */
+  std::uint64_t operations;
+
+  /**
+   * Operations that could not be replayed: unpins of pages pinned before the
+   * trace began, reads that found every frame pinned, and pages of files
+   * without an id.
+   */
+  std::uint64_t skipped;
+
+  /**
+   * Reads in the trace, and how many of them the traced pool served.
+   */
+  std::uint64_t traced_reads;
+  std::uint64_t traced_hits;
+
+  /**
+   * Evictions the traced pool made.
+   */
+  std::uint64_t traced_evictions;
+
+  /**
+   * Statistics of the replayed pool at the end of the trace.
+   */
+  BufStatsSnapshot stats;
+};
+
+/**
+ * @brief Drives buffer pools with the operations of a trace written by a
+ *        TraceRecorder, so that pool sizes and replacement policies can be
+ *        compared on a production workload away from production.
+ *
+ * The traced files are not needed: every page the trace touches is created in
+ * a scratch file per traced file, and reads of a traced page read its scratch
+ * page.  Reads, allocations and unpins are replayed as they were called, so
+ * pages stay pinned for as long as they were; disposals are not, as the page
+ * may be allocated again later in the trace.  Evictions are only counted, as
+ * they are what the replayed pool decides for itself.
+ */
+class TraceReplayer {
+ public:
+  /**
+   * Reads the trace once and creates the scratch files <scratch_prefix>.0,
+   * <scratch_prefix>.1, ..., one per traced file, holding every page the
+   * trace touches.
+   *
+   * @throws  FileIOException  If the trace cannot be read or a scratch file
+   *                           cannot be written.
+   */
+  TraceReplayer(const std::string& trace, const std::string& scratch_prefix);
+
+  /**
+   * Removes the scratch files.  No pool may hold their pages any more.
+   */
+  ~TraceReplayer();
+
+  TraceReplayer(const TraceReplayer&) = delete;
+  TraceReplayer& operator=(const TraceReplayer&) = delete;
+
+  /**
+   * Clears the statistics of <pool> and replays the trace against it, then
+   * unpins whatever the trace left pinned and flushes the scratch files out
+   * of the pool, so that the next replay starts cold.
+   */
+  ReplayResult replay(BufMgr& pool);
+
+  /**
+   * Returns the number of traced files and pages.
+   */
+  std::size_t numFiles() const { return files_.size(); }
+  std::size_t numPages() const;
+
+ private:
+  /**
+   * Path of the trace.
+   */
+  std::string trace_;
+
+  /**
+   * Scratch file of each traced file id, and its name.
+   */
+  std::vector<std::unique_ptr<File> > files_;
+  std::vector<std::string> names_;
+
+  /**
+   * Scratch page of every traced page, per traced file id.
+   */
+  std::vector<std::unordered_map<PageId, PageId> > pages_;
+};
+
+}
@@ -0,0 +1,107 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "two_q_policy.h"
+
+namespace badgerdb {
+
+TwoQPolicy::TwoQPolicy(const std::uint32_t numBufs)
+    : numBufs(numBufs),
+      kin(numBufs / 4 == 0 ? 1 : numBufs / 4),
+      kout(numBufs / 2 == 0 ? 1 : numBufs / 2),
+      lists(numBufs, 3),
+      pages(numBufs) {
+  for (FrameId i = 0; i < numBufs; ++i) {
+    lists.pushFront(FREE, i);
+  }
+}
+
+void TwoQPolicy::recordAccess(const FrameId frame) {
+  std::lock_guard<std::mutex> guard(mutex);
+  // hits in A1in are deliberately ignored: they are usually correlated
+  // references of the access that loaded the page.
+  if (lists.listOf(frame) == AM) {
+    lists.remove(frame);
+    lists.pushFront(AM, frame);
+  }
+}
+
+void TwoQPolicy::recordLoad(const FrameId frame, const File* file,
+                            const PageId pageNo) {
+  std::lock_guard<std::mutex> guard(mutex);
+  const PageKey key = {file->id(), pageNo};
+  lists.remove(frame);
+  pages[frame] = key;
+  lists.pushFront(a1out.remove(key) ? AM : A1IN, frame);
+}
+
+void TwoQPolicy::recordRemove(const FrameId frame) {
+  std::lock_guard<std::mutex> guard(mutex);
+  lists.remove(frame);
+  lists.pushFront(FREE, frame);
+}
+
+void TwoQPolicy::resize(const std::uint32_t numBufs) {
+  std::lock_guard<std::mutex> guard(mutex);
+  for (FrameId frame = numBufs; frame < this->numBufs; ++frame) {
+    lists.remove(frame);
+  }
+  for (FrameId frame = this->numBufs; frame < numBufs; ++frame) {
+    lists.pushFront(FREE, frame);
+  }
+  this->numBufs = numBufs;
+  kin = numBufs / 4 == 0 ? 1 : numBufs / 4;
+  kout = numBufs / 2 == 0 ? 1 : numBufs / 2;
+}
+
+bool TwoQPolicy::claimFrom(const std::uint8_t list, FrameClaimer& claimer,
+                           FrameId& frame) {
+  for (FrameId candidate = lists.back(list); candidate != lists.end();
+       candidate = lists.towardsFront(candidate)) {
+    if (claimer.claim(candidate)) {
+      if (list == A1IN) {
+        a1out.pushFront(pages[candidate], kout);
+      }
+      lists.remove(candidate);
+      frame = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TwoQPolicy::selectVictim(const File* file, const PageId pageNo,
+                              FrameClaimer& claimer, FrameId& frame) {
+  std::lock_guard<std::mutex> guard(mutex);
+  if (claimFrom(FREE, claimer, frame)) {
+    return true;
+  }
+  if (lists.size(A1IN) > kin) {
+    return claimFrom(A1IN, claimer, frame) || claimFrom(AM, claimer, frame);
+  }
+  return claimFrom(AM, claimer, frame) || claimFrom(A1IN, claimer, frame);
+}
+
+void TwoQPolicy::listFrom(const std::uint8_t list, const std::uint32_t count,
+                          std::vector<FrameId>& frames) const {
+  for (FrameId candidate = lists.back(list);
+       candidate != lists.end() && frames.size() < count;
+       candidate = lists.towardsFront(candidate)) {
+    frames.push_back(candidate);
+  }
+}
+
+void TwoQPolicy::nextVictims(const std::uint32_t count,
+                             std::vector<FrameId>& frames) {
+  std::lock_guard<std::mutex> guard(mutex);
+  frames.clear();
+  const bool preferA1in = lists.size(A1IN) > kin;
+  listFrom(preferA1in ? A1IN : AM, count, frames);
+  listFrom(preferA1in ? AM : A1IN, count, frames);
+}
+
+}
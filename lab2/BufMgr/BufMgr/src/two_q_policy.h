@@ -0,0 +1,100 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Full 2Q replacement (Johnson and Shasha).
+ *
+ * Pages seen for the first time enter the FIFO A1in.  When A1in holds more
+ * than a quarter of the pool its oldest page is evicted and remembered in the
+ * ghost FIFO A1out.  A page that is loaded again while remembered in A1out is
+ * promoted to the LRU queue Am.  A single sequential scan therefore only
+ * cycles through A1in and leaves the pages in Am alone.
+ */
+class TwoQPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructs a 2Q policy for <numBufs> frames.
+   */
+  explicit TwoQPolicy(const std::uint32_t numBufs);
+
+  const char* name() const { return "2q"; }
+  void recordAccess(const FrameId frame);
+  void recordLoad(const FrameId frame, const File* file, const PageId pageNo);
+  void recordRemove(const FrameId frame);
+  void resize(const std::uint32_t numBufs);
+  bool selectVictim(const File* file, const PageId pageNo,
+                    FrameClaimer& claimer, FrameId& frame);
+  void nextVictims(const std::uint32_t count, std::vector<FrameId>& frames);
+
+ private:
+  /**
+   * Lists kept in <lists>.
+   */
+  enum {
+    A1IN = 0,
+    AM = 1,
+    FREE = 2
+  };
+
+  /**
+   * Offers the frames of one list, oldest first, to the claimer.
+   */
+  bool claimFrom(const std::uint8_t list, FrameClaimer& claimer,
+                 FrameId& frame);
+
+  /**
+   * Appends the frames of one list, oldest first, until <count> are listed.
+   */
+  void listFrom(const std::uint8_t list, const std::uint32_t count,
+                std::vector<FrameId>& frames) const;
+
+  /**
+   * Serializes all calls.
+   */
+  std::mutex mutex;
+
+  /**
+   * Number of frames in use.
+   */
+  std::uint32_t numBufs;
+
+  /**
+   * Maximum number of frames in A1in before it is preferred for eviction.
+   */
+  std::uint32_t kin;
+
+  /**
+   * Number of pages remembered in A1out.
+   */
+  std::uint32_t kout;
+
+  /**
+   * A1in, Am and the free frames.
+   */
+  FrameLists lists;
+
+  /**
+   * Page held by each frame.
+   */
+  std::vector<PageKey> pages;
+
+  /**
+   * Pages recently evicted from A1in.
+   */
+  GhostList a1out;
+};
+
+}
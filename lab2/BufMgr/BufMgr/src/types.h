@@ -19,11 +19,23 @@ typedef std::uint32_t PageId;
  */
 typedef std::uint16_t SlotId;
 
+/**
+ * @brief Identifier of an open file, shared by all File objects for it and
+ *        reused once the file is closed.
+ */
+typedef std::uint32_t FileId;
+
 /**
  * @brief Identifier for a frame in buffer pool.
  */
 typedef std::uint32_t FrameId;
 
+/**
+ * @brief Log sequence number: position in the write-ahead log just past the end
+ *        of a record.  0 names no record.
+ */
+typedef std::uint64_t Lsn;
+
 /**
  * @brief Identifier for a record in a page.
  */
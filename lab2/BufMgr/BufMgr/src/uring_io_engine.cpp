@@ -0,0 +1,166 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "uring_io_engine.h"
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <system_error>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#endif
+
+namespace badgerdb {
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+
+UringIoEngine::UringIoEngine()
+    : ring_fd_(-1), depth_(0), sq_ring_(MAP_FAILED), sq_ring_size_(0),
+      cq_ring_(MAP_FAILED), cq_ring_size_(0),
+      sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)), sqes_size_(0),
+      to_submit_(0) {}
+
+UringIoEngine* UringIoEngine::open(const std::uint32_t depth) {
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  const int fd = syscall(__NR_io_uring_setup, depth == 0 ? 1 : depth, &params);
+  if (fd < 0) {
+    // ENOSYS on old kernels, EPERM where io_uring is disabled.
+    return NULL;
+  }
+  UringIoEngine* engine = new UringIoEngine();
+  engine->ring_fd_ = fd;
+  engine->depth_ = depth == 0 ? 1 : depth;
+
+  engine->sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  engine->cq_ring_size_ = params.cq_off.cqes +
+                          params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single) {
+    if (engine->cq_ring_size_ > engine->sq_ring_size_) {
+      engine->sq_ring_size_ = engine->cq_ring_size_;
+    }
+    engine->cq_ring_size_ = engine->sq_ring_size_;
+  }
+  engine->sq_ring_ = mmap(NULL, engine->sq_ring_size_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (engine->sq_ring_ == MAP_FAILED) {
+    delete engine;
+    return NULL;
+  }
+  if (single) {
+    engine->cq_ring_ = engine->sq_ring_;
+  } else {
+    engine->cq_ring_ = mmap(NULL, engine->cq_ring_size_, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (engine->cq_ring_ == MAP_FAILED) {
+      delete engine;
+      return NULL;
+    }
+  }
+  engine->sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = mmap(NULL, engine->sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  engine->sqes_ = static_cast<io_uring_sqe*>(sqes);
+  if (sqes == MAP_FAILED) {
+    delete engine;
+    return NULL;
+  }
+
+  char* sq = static_cast<char*>(engine->sq_ring_);
+  engine->sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  engine->sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  engine->sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  char* cq = static_cast<char*>(engine->cq_ring_);
+  engine->cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  engine->cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  engine->cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  engine->cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  return engine;
+}
+
+UringIoEngine::~UringIoEngine() {
+  if (sqes_ != MAP_FAILED) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != MAP_FAILED) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    ::close(ring_fd_);
+  }
+}
+
+void UringIoEngine::submit(IoRequest& request) {
+  // Only this thread writes the tail, so a plain read of it is current.
+  const unsigned tail = *sq_tail_;
+  const unsigned index = tail & *sq_mask_;
+  struct io_uring_sqe& sqe = sqes_[index];
+  std::memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = request.write ? IORING_OP_WRITEV : IORING_OP_READV;
+  sqe.fd = request.fd;
+  sqe.off = request.offset;
+  sqe.addr = reinterpret_cast<std::uintptr_t>(&request.iov);
+  sqe.len = 1;
+  sqe.user_data = reinterpret_cast<std::uintptr_t>(&request);
+  sq_array_[index] = index;
+  // Publish the entry before the new tail.
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  ++to_submit_;
+}
+
+IoRequest& UringIoEngine::wait() {
+  for (;;) {
+    const unsigned head = *cq_head_;
+    if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      const struct io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+      IoRequest& request =
+          *reinterpret_cast<IoRequest*>(static_cast<std::uintptr_t>(cqe.user_data));
+      request.result = cqe.res;
+      // Give the entry back to the kernel once it has been read.
+      __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+      return request;
+    }
+    const int submitted = syscall(__NR_io_uring_enter, ring_fd_, to_submit_,
+                                  1 /* min_complete */,
+                                  IORING_ENTER_GETEVENTS, NULL, 0);
+    if (submitted < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(),
+                              "io_uring_enter");
+    }
+    to_submit_ -= submitted;
+  }
+}
+
+#else
+
+UringIoEngine* UringIoEngine::open(const std::uint32_t depth) {
+  return NULL;
+}
+
+UringIoEngine::~UringIoEngine() {}
+
+void UringIoEngine::submit(IoRequest& request) {}
+
+IoRequest& UringIoEngine::wait() {
+  throw std::system_error(ENOSYS, std::generic_category(), "io_uring_enter");
+}
+
+#endif
+
+}
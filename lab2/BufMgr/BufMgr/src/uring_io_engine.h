@@ -0,0 +1,105 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "io_engine.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace badgerdb {
+
+/**
+ * @brief Engine on a Linux io_uring, driven with raw system calls so that no
+ *        library is needed.
+ *
+ * Requests are written to the submission ring by submit() and handed to the
+ * kernel in one io_uring_enter call by the next wait(), which also waits for
+ * a completion.  A ring is never shared between threads, so the rings are
+ * accessed without locks.
+ */
+class UringIoEngine : public IoEngine {
+ public:
+  /**
+   * Sets up a ring for up to <depth> requests in flight.
+   *
+   * @return  Newly allocated engine, or NULL if the kernel does not support
+   *          io_uring.
+   */
+  static UringIoEngine* open(const std::uint32_t depth);
+
+  /**
+   * Unmaps the rings and closes the ring descriptor.
+   */
+  ~UringIoEngine();
+
+  const char* name() const { return "io_uring"; }
+  std::uint32_t depth() const { return depth_; }
+  void submit(IoRequest& request);
+  IoRequest& wait();
+
+ private:
+  UringIoEngine();
+
+  UringIoEngine(const UringIoEngine&) = delete;
+  UringIoEngine& operator=(const UringIoEngine&) = delete;
+
+  /**
+   * Descriptor of the ring.
+   */
+  int ring_fd_;
+
+  /**
+   * Maximum number of requests in flight.
+   */
+  std::uint32_t depth_;
+
+  /**
+   * Mapping of the submission ring, and its length.
+   */
+  void* sq_ring_;
+  std::size_t sq_ring_size_;
+
+  /**
+   * Mapping of the completion ring, and its length.  Equal to <sq_ring_> if
+   * the kernel maps both rings at once.
+   */
+  void* cq_ring_;
+  std::size_t cq_ring_size_;
+
+  /**
+   * Mapping of the submission queue entries, and its length.
+   */
+  io_uring_sqe* sqes_;
+  std::size_t sqes_size_;
+
+  /**
+   * Fields of the submission ring shared with the kernel.
+   */
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+
+  /**
+   * Fields of the completion ring shared with the kernel.
+   */
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  io_uring_cqe* cqes_;
+
+  /**
+   * Number of entries written to the submission ring but not yet handed to
+   * the kernel.
+   */
+  unsigned to_submit_;
+};
+
+}
@@ -0,0 +1,77 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Replays a trace written by a TraceRecorder against pools of the given
+// sizes, and prints how each would have done beside the traced pool:
+//
+//   trace_replay <trace> <frames>[,<frames>...] [clock|lru-k|2q|arc]
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "exceptions/badgerdb_exception.h"
+#include "trace_replayer.h"
+
+using namespace badgerdb;
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0]
+              << " <trace> <frames>[,<frames>...] [clock|lru-k|2q|arc]\n";
+    return 2;
+  }
+  BufMgrOptions options;
+  const std::string policy = argc > 3 ? argv[3] : "clock";
+  if (policy == "lru-k") {
+    options.policy = POLICY_LRU_K;
+  } else if (policy == "2q") {
+    options.policy = POLICY_2Q;
+  } else if (policy == "arc") {
+    options.policy = POLICY_ARC;
+  } else if (policy != "clock") {
+    std::cerr << "unknown policy " << policy << "\n";
+    return 2;
+  }
+  std::vector<std::uint32_t> sizes;
+  std::stringstream list(argv[2]);
+  std::string size;
+  while (std::getline(list, size, ',')) {
+    sizes.push_back(std::strtoul(size.c_str(), NULL, 10));
+    if (sizes.back() == 0) {
+      std::cerr << "bad pool size " << size << "\n";
+      return 2;
+    }
+  }
+
+  try {
+    TraceReplayer replayer(argv[1], std::string(argv[1]) + ".scratch");
+    std::printf("%zu files, %zu pages\n", replayer.numFiles(), replayer.numPages());
+    std::printf("%10s %10s %10s %10s %10s %10s\n", "frames", "hit rate",
+                "traced", "evictions", "traced", "skipped");
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+      BufMgr pool(sizes[i], options);
+      const ReplayResult result = replayer.replay(pool);
+      // allocations are replayed as reads that miss, so both rates are of
+      // the traced reads.
+      const double reads = result.traced_reads == 0 ? 1.0 : result.traced_reads;
+      std::printf("%10u %10.4f %10.4f %10llu %10llu %10llu\n", sizes[i],
+                  result.stats.hits / reads, result.traced_hits / reads,
+                  static_cast<unsigned long long>(result.stats.evictions),
+                  static_cast<unsigned long long>(result.traced_evictions),
+                  static_cast<unsigned long long>(result.skipped));
+    }
+  } catch (const BadgerDbException& e) {
+    std::cerr << e << "\n";
+    return 1;
+  }
+  return 0;
+}
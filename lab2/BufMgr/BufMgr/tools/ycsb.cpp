@@ -0,0 +1,445 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// YCSB-style workload driver: loads records into files through a BufMgr, then
+// runs a mix of reads, updates, inserts and scans on worker threads and
+// reports throughput, latencies and buffer pool statistics.
+//
+//   ycsb [--workload a|b|c|d|e|f] [--records <n>] [--record-size <bytes>]
+//        [--files <n>] [--frames <n>] [--policy clock|lru-k|2q|arc]
+//        [--threads <n>] [--operations <n per thread>]
+//        [--read <fraction>] [--update <fraction>] [--insert <fraction>]
+//        [--scan <fraction>] [--scan-length <n>]
+//        [--distribution zipfian|uniform] [--path <prefix>]
+//
+// The workloads are those of YCSB: a 50% reads and 50% updates, b 95/5,
+// c reads only, d 95% reads and 5% inserts, e 95% scans and 5% inserts,
+// f 50% reads and 50% read-modify-writes.  Fractions given after --workload
+// override it.
+//
+// Reads and updates pick keys among the loaded records; inserted records are
+// only written.  A scan reads <scan-length> records in key order from its
+// first key, which follows page order within a file.  Readers copy records
+// optimistically and validate the copy, while writers bracket changes with
+// beginPageWrite and endPageWrite, so they never block each other.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "buffer.h"
+#include "exceptions/badgerdb_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "file.h"
+#include "latency_histogram.h"
+#include "page.h"
+#include "workload.h"
+
+using namespace badgerdb;
+using namespace badgerdb::bench;
+
+namespace {
+
+enum Operation { OP_READ, OP_UPDATE, OP_INSERT, OP_SCAN, NUM_OPS };
+
+const char* const OP_NAMES[NUM_OPS] = {"read", "update", "insert", "scan"};
+
+struct Config {
+  std::uint64_t records;
+  std::uint32_t record_size;
+  std::uint32_t files;
+  std::uint32_t frames;
+  ReplacementPolicyType policy;
+  int threads;
+  std::uint64_t operations;
+  double mix[NUM_OPS];
+  bool read_modify_write;
+  std::uint32_t scan_length;
+  KeyDistribution distribution;
+  std::string path;
+};
+
+/**
+ * Records loaded, by key, and the files they are in.
+ */
+struct Database {
+  std::vector<std::unique_ptr<File> > files;
+  std::vector<RecordId> rids;
+
+  File* fileOf(const std::uint64_t key) { return files[key % files.size()].get(); }
+};
+
+std::string makeRecord(const std::uint64_t key, const std::uint32_t size,
+                       const char fill) {
+  char prefix[32];
+  const int length = std::snprintf(prefix, sizeof(prefix), "user%llu:",
+                                   static_cast<unsigned long long>(key));
+  std::string record(size, fill);
+  record.replace(0, std::min<std::size_t>(length, size), prefix,
+                 std::min<std::size_t>(length, size));
+  return record;
+}
+
+// Loads <config.records> records, key k into file k % <config.files>, filling
+// each page before allocating the next.
+void load(BufMgr& pool, Database& db, const Config& config) {
+  db.rids.resize(config.records);
+  for (std::uint32_t f = 0; f < config.files; ++f) {
+    File* file = db.files[f].get();
+    Page* page = NULL;
+    PageId pageNo = Page::INVALID_NUMBER;
+    for (std::uint64_t key = f; key < config.records; key += config.files) {
+      const std::string record = makeRecord(key, config.record_size, 'a');
+      if (page != NULL && !page->hasSpaceForRecord(record)) {
+        pool.unPinPage(file, pageNo, true);
+        page = NULL;
+      }
+      if (page == NULL) {
+        pool.allocPage(file, pageNo, page);
+      }
+      db.rids[key] = page->insertRecord(record);
+    }
+    if (page != NULL) {
+      pool.unPinPage(file, pageNo, true);
+    }
+    pool.flushFile(file);
+  }
+}
+
+// Copies a record out of the pool, pinning its page for as long as it takes
+// a copy to validate.
+std::string readRecord(BufMgr& pool, File* file, const RecordId& rid) {
+  Page* page;
+  pool.readPage(file, rid.page_number, page);
+  OptimisticRead read;
+  read.page = page;
+  std::string value;
+  for (;;) {
+    // the pinned frame is the hint, so this takes no latch.
+    if (!pool.readPageOptimistic(file, rid.page_number, read)) {
+      std::this_thread::yield();  // being written
+      continue;
+    }
+    try {
+      value = read.page->getRecord(rid);
+    } catch (const BadgerDbException&) {
+      // the slot was being rewritten; validation fails below.
+    }
+    if (pool.validateRead(read)) {
+      break;
+    }
+  }
+  pool.unPinPage(page, false);
+  return value;
+}
+
+void updateRecord(BufMgr& pool, File* file, const RecordId& rid,
+                  const std::string& value) {
+  Page* page;
+  pool.readPage(file, rid.page_number, page);
+  pool.beginPageWrite(page);
+  page->updateRecord(rid, value);
+  pool.endPageWrite(page);
+  pool.unPinPage(page, true);
+}
+
+/**
+ * State of one worker thread.
+ */
+struct Worker {
+  Worker(const Config& config, const int thread)
+      : keys(config.distribution, config.records, thread + 1),
+        random(1000 + thread), unit(0.0, 1.0), insert_page(NULL),
+        insert_page_number(Page::INVALID_NUMBER), next_insert(0) {}
+
+  KeyGenerator keys;
+  std::mt19937_64 random;
+  std::uniform_real_distribution<double> unit;
+
+  /**
+   * Page this thread inserts into, pinned, in file <thread> % files.
+   */
+  Page* insert_page;
+  PageId insert_page_number;
+  std::uint64_t next_insert;
+};
+
+void insertRecord(BufMgr& pool, File* file, Worker& worker,
+                  const std::string& value) {
+  if (worker.insert_page != NULL) {
+    pool.beginPageWrite(worker.insert_page);
+    const bool fits = worker.insert_page->hasSpaceForRecord(value);
+    if (fits) {
+      worker.insert_page->insertRecord(value);
+    }
+    pool.endPageWrite(worker.insert_page);
+    if (fits) {
+      return;
+    }
+    pool.unPinPage(worker.insert_page, true);
+  }
+  pool.allocPage(file, worker.insert_page_number, worker.insert_page);
+  pool.beginPageWrite(worker.insert_page);
+  worker.insert_page->insertRecord(value);
+  pool.endPageWrite(worker.insert_page);
+}
+
+void work(BufMgr& pool, Database& db, const Config& config, const int thread,
+          LatencyRecorder* latency, std::atomic<std::uint64_t>* counts,
+          std::atomic<std::uint64_t>& bytes) {
+  Worker worker(config, thread);
+  std::uint64_t bytes_read = 0;
+  File* insert_file = db.files[thread % db.files.size()].get();
+  for (std::uint64_t i = 0; i < config.operations; ++i) {
+    double pick = worker.unit(worker.random);
+    int op = 0;
+    while (op + 1 < NUM_OPS && pick >= config.mix[op]) {
+      pick -= config.mix[op];
+      ++op;
+    }
+    const std::uint64_t key = worker.keys.next();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    switch (op) {
+      case OP_READ:
+        bytes_read += readRecord(pool, db.fileOf(key), db.rids[key]).size();
+        break;
+      case OP_UPDATE: {
+        if (config.read_modify_write) {
+          bytes_read += readRecord(pool, db.fileOf(key), db.rids[key]).size();
+        }
+        const char fill = 'a' + worker.random() % 26;
+        updateRecord(pool, db.fileOf(key), db.rids[key],
+                     makeRecord(key, config.record_size, fill));
+        break;
+      }
+      case OP_INSERT: {
+        const std::uint64_t new_key =
+            config.records + worker.next_insert++ * config.threads + thread;
+        insertRecord(pool, insert_file, worker,
+                     makeRecord(new_key, config.record_size, 'a'));
+        break;
+      }
+      case OP_SCAN:
+        for (std::uint32_t k = 0; k < config.scan_length; ++k) {
+          // keys of one file are a stride of <files> apart.
+          const std::uint64_t next = key + k * config.files;
+          if (next >= config.records) {
+            break;
+          }
+          bytes_read += readRecord(pool, db.fileOf(next), db.rids[next]).size();
+        }
+        break;
+    }
+    latency[op].record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    ++counts[op];
+  }
+  if (worker.insert_page != NULL) {
+    pool.unPinPage(worker.insert_page, true);
+  }
+  bytes += bytes_read;
+}
+
+bool parse(int argc, char* argv[], Config& config) {
+  config.records = 100000;
+  config.record_size = 1000;
+  config.files = 1;
+  config.frames = 1024;
+  config.policy = POLICY_CLOCK;
+  config.threads = 1;
+  config.operations = 100000;
+  const double workload_b[NUM_OPS] = {0.95, 0.05, 0, 0};
+  std::memcpy(config.mix, workload_b, sizeof(config.mix));
+  config.read_modify_write = false;
+  config.scan_length = 100;
+  config.distribution = KEYS_ZIPFIAN;
+  config.path = "ycsb.db";
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string option = argv[i];
+    const std::string value = argv[i + 1];
+    if (option == "--workload") {
+      const double mixes[6][NUM_OPS] = {{0.5, 0.5, 0, 0}, {0.95, 0.05, 0, 0},
+                                        {1, 0, 0, 0},     {0.95, 0, 0.05, 0},
+                                        {0, 0, 0.05, 0.95}, {0.5, 0.5, 0, 0}};
+      if (value.size() != 1 || value[0] < 'a' || value[0] > 'f') {
+        return false;
+      }
+      std::memcpy(config.mix, mixes[value[0] - 'a'], sizeof(config.mix));
+      config.read_modify_write = value == "f";
+    } else if (option == "--records") {
+      config.records = std::strtoull(value.c_str(), NULL, 10);
+    } else if (option == "--record-size") {
+      config.record_size = std::strtoul(value.c_str(), NULL, 10);
+    } else if (option == "--files") {
+      config.files = std::strtoul(value.c_str(), NULL, 10);
+    } else if (option == "--frames") {
+      config.frames = std::strtoul(value.c_str(), NULL, 10);
+    } else if (option == "--policy") {
+      if (value == "clock") {
+        config.policy = POLICY_CLOCK;
+      } else if (value == "lru-k") {
+        config.policy = POLICY_LRU_K;
+      } else if (value == "2q") {
+        config.policy = POLICY_2Q;
+      } else if (value == "arc") {
+        config.policy = POLICY_ARC;
+      } else {
+        return false;
+      }
+    } else if (option == "--threads") {
+      config.threads = std::atoi(value.c_str());
+    } else if (option == "--operations") {
+      config.operations = std::strtoull(value.c_str(), NULL, 10);
+    } else if (option == "--read") {
+      config.mix[OP_READ] = std::atof(value.c_str());
+    } else if (option == "--update") {
+      config.mix[OP_UPDATE] = std::atof(value.c_str());
+    } else if (option == "--insert") {
+      config.mix[OP_INSERT] = std::atof(value.c_str());
+    } else if (option == "--scan") {
+      config.mix[OP_SCAN] = std::atof(value.c_str());
+    } else if (option == "--scan-length") {
+      config.scan_length = std::strtoul(value.c_str(), NULL, 10);
+    } else if (option == "--distribution") {
+      if (value == "zipfian") {
+        config.distribution = KEYS_ZIPFIAN;
+      } else if (value == "uniform") {
+        config.distribution = KEYS_UNIFORM;
+      } else {
+        return false;
+      }
+    } else if (option == "--path") {
+      config.path = value;
+    } else {
+      return false;
+    }
+  }
+  const double total = config.mix[0] + config.mix[1] + config.mix[2] + config.mix[3];
+  if (argc % 2 == 0 || config.records == 0 || config.files == 0 ||
+      config.frames == 0 || config.threads < 1 || config.record_size == 0 ||
+      config.record_size > Page::DATA_SIZE / 2 || total <= 0) {
+    return false;
+  }
+  for (int op = 0; op < NUM_OPS; ++op) {
+    config.mix[op] /= total;
+  }
+  return true;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  Config config;
+  if (!parse(argc, argv, config)) {
+    std::fprintf(stderr, "usage: see the comment at the top of tools/ycsb.cpp\n");
+    return 2;
+  }
+
+  Database db;
+  try {
+    for (std::uint32_t f = 0; f < config.files; ++f) {
+      const std::string name = config.path + "." + std::to_string(f);
+      try {
+        File::remove(name);
+      } catch (const FileNotFoundException&) {
+      }
+      db.files.push_back(std::unique_ptr<File>(new File(File::create(name))));
+    }
+    BufMgrOptions options;
+    options.policy = config.policy;
+    BufMgr pool(config.frames, options);
+
+    const std::chrono::steady_clock::time_point load_start = std::chrono::steady_clock::now();
+    load(pool, db, config);
+    const double load_seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - load_start).count();
+    std::printf("loaded %llu records of %u bytes into %u files in %.2f s\n",
+                static_cast<unsigned long long>(config.records),
+                config.record_size, config.files, load_seconds);
+
+    LatencyRecorder latency[NUM_OPS];
+    std::atomic<std::uint64_t> counts[NUM_OPS];
+    std::atomic<std::uint64_t> bytes(0);
+    for (int op = 0; op < NUM_OPS; ++op) {
+      counts[op] = 0;
+    }
+    pool.clearBufStats();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    std::vector<std::string> errors(config.threads);
+    for (int t = 0; t < config.threads; ++t) {
+      workers.push_back(std::thread([&, t]() {
+        try {
+          work(pool, db, config, t, latency, counts, bytes);
+        } catch (const BadgerDbException& e) {
+          errors[t] = e.message();
+        }
+      }));
+    }
+    for (std::size_t t = 0; t < workers.size(); ++t) {
+      workers[t].join();
+    }
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    for (std::size_t t = 0; t < errors.size(); ++t) {
+      if (!errors[t].empty()) {
+        std::fprintf(stderr, "thread %zu failed: %s\n", t, errors[t].c_str());
+        return 1;
+      }
+    }
+
+    std::uint64_t total = 0;
+    for (int op = 0; op < NUM_OPS; ++op) {
+      total += counts[op];
+    }
+    std::printf("%llu operations on %d threads in %.2f s: %.0f ops/s, "
+                "%llu bytes read\n",
+                static_cast<unsigned long long>(total), config.threads,
+                seconds, total / seconds,
+                static_cast<unsigned long long>(bytes.load()));
+    // percentiles are the upper bounds of power-of-two buckets.
+    std::printf("%-8s %12s %12s %12s %12s %12s\n", "op", "count", "mean us",
+                "p50 us", "p99 us", "p999 us");
+    for (int op = 0; op < NUM_OPS; ++op) {
+      const LatencyHistogram histogram = latency[op].snapshot();
+      if (histogram.count() == 0) {
+        continue;
+      }
+      std::printf("%-8s %12llu %12.1f %12.1f %12.1f %12.1f\n", OP_NAMES[op],
+                  static_cast<unsigned long long>(histogram.count()),
+                  histogram.meanNanos() / 1e3,
+                  histogram.percentileNanos(0.5) / 1e3,
+                  histogram.percentileNanos(0.99) / 1e3,
+                  histogram.percentileNanos(0.999) / 1e3);
+    }
+    const BufStatsSnapshot stats = pool.getStatsSnapshot();
+    std::printf("%u frames, %s: hit rate %.4f, %llu disk reads, %llu disk writes, "
+                "%llu evictions\n",
+                config.frames, stats.policy, stats.hitRate(),
+                static_cast<unsigned long long>(stats.diskreads),
+                static_cast<unsigned long long>(stats.diskwrites),
+                static_cast<unsigned long long>(stats.evictions));
+
+    for (std::size_t f = 0; f < db.files.size(); ++f) {
+      pool.flushFile(db.files[f].get());
+    }
+  } catch (const BadgerDbException& e) {
+    std::fprintf(stderr, "%s\n", e.message().c_str());
+    return 1;
+  }
+  for (std::uint32_t f = 0; f < config.files; ++f) {
+    db.files[f].reset();
+    File::remove(config.path + "." + std::to_string(f));
+  }
+  return 0;
+}